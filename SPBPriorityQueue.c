@@ -9,6 +9,8 @@ struct sp_bp_queue_t {
 	int maxSize;
 	SPList queue;
 	double max, min;
+	SPBitset excluded;
+	SPBitset allowed;
 };
 
 SPBPQueue spBPQueueCreate(int maxSize) {
@@ -23,6 +25,8 @@ SPBPQueue spBPQueueCreate(int maxSize) {
 	temp->maxSize = maxSize;
 	temp->max = -1.0;
 	temp->min = -1.0;
+	temp->excluded = NULL;
+	temp->allowed = NULL;
 	temp->queue = spListCreate();
 	if (temp->queue == NULL) { // Allocation failure
 		free(temp);
@@ -41,6 +45,8 @@ SPBPQueue spBPQueueCopy(SPBPQueue source) {
 	if (temp == NULL) { // Allocation failure
 		return NULL;
 	}
+	temp->excluded = source->excluded;
+	temp->allowed = source->allowed;
 	if (spListGetSize(source->queue) == 0) { // If source's queue is empty we are done
 		return temp;
 	}
@@ -93,6 +99,9 @@ SP_BPQUEUE_MSG spBPQueueEnqueue(SPBPQueue source, SPListElement element) {
 	if (source == NULL || element == NULL || source->queue == NULL) { // Invalid arguments
 		return SP_BPQUEUE_INVALID_ARGUMENT;
 	}
+	if (!spBPQueueAccepts(source, spListElementGetIndex(element))) { // Excluded, nothing to insert
+		return SP_BPQUEUE_SUCCESS;
+	}
 	copy = spListElementCopy(element);
 	if (copy == NULL) { // Allocation failure
 		return SP_BPQUEUE_OUT_OF_MEMORY;
@@ -138,9 +147,11 @@ SP_BPQUEUE_MSG spBPQueueEnqueue(SPBPQueue source, SPListElement element) {
 	}
 	if (spListGetSize(source->queue) == spBPQueueGetMaxSize(source) + 1) { // Queue was full
 		data = spListGetFirst(source->queue);
-		for (i = 0; i < spListGetSize(source->queue) - 1; i++) { // Go to last element
+		for (i = 0; i < spListGetSize(source->queue) - 2; i++) { // Go to the element before last
 			data = spListGetNext(source->queue);
 		}
+		source->max = spListElementGetValue(data); // It becomes the maximum
+		spListGetNext(source->queue);
 		spListRemoveCurrent(source->queue); // Remove last element
 	}
 	spListElementDestroy(copy);
@@ -157,6 +168,10 @@ SP_BPQUEUE_MSG spBPQueueDequeue(SPBPQueue source) {
 		return SP_BPQUEUE_EMPTY;
 	}
 	spListRemoveCurrent(source->queue); // Remove first element
+	data = spListGetFirst(source->queue);
+	if (data != NULL) { // The next element becomes the minimum
+		source->min = spListElementGetValue(data);
+	}
 	return SP_BPQUEUE_SUCCESS; // All well
 }
 
@@ -207,3 +222,23 @@ bool spBPQueueIsFull(SPBPQueue source) {
 	assert(source != NULL); // Invalid argument
 	return spBPQueueSize(source) == spBPQueueGetMaxSize(source);
 }
+
+void spBPQueueSetExcluded(SPBPQueue source, SPBitset excluded) {
+	if (source != NULL) { // If source is NULL there's nothing to do
+		source->excluded = excluded;
+	}
+}
+
+void spBPQueueSetAllowed(SPBPQueue source, SPBitset allowed) {
+	if (source != NULL) { // If source is NULL there's nothing to do
+		source->allowed = allowed;
+	}
+}
+
+bool spBPQueueAccepts(SPBPQueue source, int index) {
+	assert(source != NULL); // Invalid argument
+	if (spBitsetContains(source->excluded, index)) { // Excluded
+		return false;
+	}
+	return source->allowed == NULL || spBitsetContains(source->allowed, index);
+}
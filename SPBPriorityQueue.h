@@ -1,6 +1,7 @@
 #ifndef SPBPRIORITYQUEUE_H_
 #define SPBPRIORITYQUEUE_H_
 #include "SPListElement.h"
+#include "SPBitset.h"
 #include <stdbool.h>
 /**
  * SP Bounded Priority Queue summary
@@ -10,6 +11,8 @@
  * SPList.h for usage.
  * In addition, the queue has a maximum size, and will not hold more itmes than
  * this size at any given time. Items have an integer index and double value.
+ * A queue may exclude a set of indexes, and may allow only another set of
+ * indexes, so items of other indexes are never inserted.
  *
  * The following functions are available:
  *
@@ -27,6 +30,9 @@
  *	 spBPQueueMaxValue			   - Returns the maximal value in a given queue
  *	 spBPQueueIsEmpty			   - Returns true if and only if the given queue is empty
  *	 spBPQueueIsFull			   - Returns true if and only if the given queue is full
+ *	 spBPQueueSetExcluded		   - Sets the indexes a given queue excludes
+ *	 spBPQueueSetAllowed		   - Sets the only indexes a given queue allows
+ *	 spBPQueueAccepts			   - Returns true if and only if a given queue inserts an index
  *
  */
 
@@ -120,6 +126,38 @@ int spBPQueueGetMaxSize(SPBPQueue source);
  */
 SP_BPQUEUE_MSG spBPQueueEnqueue(SPBPQueue source, SPListElement element);
 
+/**
+ * Sets the indexes the given queue excludes: an element whose index is in
+ * excluded is never inserted, and enqueueing it succeeds without changing
+ * the queue. A search which fills the queue thus keeps looking past the
+ * excluded items, as if they weren't there. The set isn't copied, it must
+ * outlive its use by the queue. Elements already in the queue stay.
+ * @param source Target queue
+ * @param excluded The indexes to exclude, NULL excludes none
+ */
+void spBPQueueSetExcluded(SPBPQueue source, SPBitset excluded);
+
+/**
+ * Sets the only indexes the given queue allows: an element whose index isn't
+ * in allowed is never inserted, as if it was excluded (see
+ * spBPQueueSetExcluded). The set isn't copied, it must outlive its use by the
+ * queue. Elements already in the queue stay.
+ * @param source Target queue
+ * @param allowed The indexes to allow, NULL allows all
+ */
+void spBPQueueSetAllowed(SPBPQueue source, SPBitset allowed);
+
+/**
+ * Checks whether the given queue would insert an element of the given index,
+ * if it was close enough. A search calls it before it computes the distance
+ * of an item, so items which can't be inserted cost nothing more.
+ * @param source Target queue
+ * @param index The index of the element
+ * @assert source != NULL
+ * @return false if index is excluded or not allowed, true otherwise
+ */
+bool spBPQueueAccepts(SPBPQueue source, int index);
+
 /**
  * Removes the first item from the given queue.
  * @param source Target queue to remove first element from.
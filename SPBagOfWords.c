@@ -0,0 +1,218 @@
+#include <string.h>
+#include <math.h>
+#include "SPBagOfWords.h"
+#include "SPKMeansTree.h"
+
+struct sp_bag_of_words_t
+{
+	SPKMeansTree vocabulary;
+	int dim;
+	int words;
+	double* idf;        // the weight of every word
+	int* postings;      // postings[w] to postings[w + 1] are the postings of word w
+	int* postingImages; // the image of every posting, ascending per word
+	double* postingWeights;
+};
+
+typedef struct sp_image_score_t
+{
+	int index;
+	double score;
+} SPImageScore;
+
+static int intComp(const void* a, const void* b)
+{
+	return *(const int*) a - *(const int*) b;
+}
+
+/*
+ * By score descending, then by index descending as imageHitsComp does.
+ */
+static int imageScoreComp(const void* a, const void* b)
+{
+	const SPImageScore* x = (const SPImageScore*) a;
+	const SPImageScore* y = (const SPImageScore*) b;
+	if (x->score != y->score)
+		return x->score < y->score ? 1 : -1;
+	return y->index - x->index;
+}
+
+/*
+ * Builds the posting lists of all words from the rows of their leaves, with
+ * the counts of the images as weights, and returns the number of images.
+ */
+static int buildPostings(SPBagOfWords bow, SPPointStore store, int* images)
+{
+	int w, i, amount, posting = 0, imagesAmount = 0;
+	const int* rows;
+	for (w = 0; w < bow->words; w++)
+	{
+		bow->postings[w] = posting;
+		amount = spKMeansTreeGetLeafRows(bow->vocabulary, w, &rows);
+		for (i = 0; i < amount; i++)
+			images[i] = spPointStoreGetImageIndex(store, rows[i]);
+		qsort(images, amount, sizeof(int), intComp);
+		for (i = 0; i < amount; i++)
+		{
+			if (i == 0 || images[i] != images[i - 1])
+			{
+				bow->postingImages[posting] = images[i];
+				bow->postingWeights[posting++] = 0;
+				if (images[i] >= imagesAmount)
+					imagesAmount = images[i] + 1;
+			}
+			bow->postingWeights[posting - 1]++;
+		}
+	}
+	bow->postings[bow->words] = posting;
+	return imagesAmount;
+}
+
+/*
+ * Weights the counts of the postings by TF-IDF and normalizes the vector of
+ * every image.
+ */
+static SP_BAG_OF_WORDS_MSG weighPostings(SPBagOfWords bow, int imagesAmount)
+{
+	int w, p;
+	double* norms = (double*) calloc(imagesAmount, sizeof(double));
+	if (norms == NULL)
+		return SP_BAG_OF_WORDS_ALLOC_FAIL;
+	for (w = 0; w < bow->words; w++)
+	{
+		bow->idf[w] = log((double) imagesAmount / (bow->postings[w + 1] - bow->postings[w]));
+		for (p = bow->postings[w]; p < bow->postings[w + 1]; p++)
+		{
+			bow->postingWeights[p] *= bow->idf[w];
+			norms[bow->postingImages[p]] += bow->postingWeights[p] * bow->postingWeights[p];
+		}
+	}
+	for (p = 0; p < bow->postings[bow->words]; p++)
+		if (norms[bow->postingImages[p]] > 0)
+			bow->postingWeights[p] /= sqrt(norms[bow->postingImages[p]]);
+	free(norms);
+	return SP_BAG_OF_WORDS_SUCCESS;
+}
+
+SPBagOfWords spBagOfWordsCreate(SPPointStore store, int branching, int iterations, int depth,
+		SP_BAG_OF_WORDS_MSG* msg)
+{
+	SPBagOfWords bow;
+	SP_KMEANS_TREE_MSG treeMsg;
+	int size, imagesAmount;
+	int* images;
+	assert(msg != NULL);
+	if (store == NULL || spPointStoreGetType(store) != SP_POINT_STORE_REAL
+			|| spPointStoreGetSize(store) == 0 || branching < 2 || iterations < 0 || depth < 1)
+	{
+		*msg = SP_BAG_OF_WORDS_INVALID_ARGUMENT;
+		return NULL;
+	}
+	bow = (SPBagOfWords) calloc(1, sizeof(*bow));
+	if (bow == NULL)
+	{
+		*msg = SP_BAG_OF_WORDS_ALLOC_FAIL;
+		return NULL;
+	}
+	size = spPointStoreGetSize(store);
+	bow->dim = spPointStoreGetDim(store);
+	// A node of at most branching features isn't worth splitting into words
+	bow->vocabulary = spKMeansTreeCreate(store, branching, iterations, depth, branching,
+			&treeMsg);
+	if (bow->vocabulary == NULL)
+	{
+		spBagOfWordsDestroy(bow);
+		*msg = SP_BAG_OF_WORDS_ALLOC_FAIL;
+		return NULL;
+	}
+	bow->words = spKMeansTreeGetLeavesAmount(bow->vocabulary);
+	bow->idf = (double*) malloc(bow->words * sizeof(double));
+	bow->postings = (int*) malloc((bow->words + 1) * sizeof(int));
+	bow->postingImages = (int*) malloc(size * sizeof(int));
+	bow->postingWeights = (double*) malloc(size * sizeof(double));
+	images = (int*) malloc(size * sizeof(int));
+	if (bow->idf == NULL || bow->postings == NULL || bow->postingImages == NULL
+			|| bow->postingWeights == NULL || images == NULL)
+	{
+		free(images);
+		spBagOfWordsDestroy(bow);
+		*msg = SP_BAG_OF_WORDS_ALLOC_FAIL;
+		return NULL;
+	}
+	imagesAmount = buildPostings(bow, store, images);
+	free(images);
+	*msg = weighPostings(bow, imagesAmount);
+	if (*msg != SP_BAG_OF_WORDS_SUCCESS)
+	{
+		spBagOfWordsDestroy(bow);
+		return NULL;
+	}
+	return bow;
+}
+
+SP_BAG_OF_WORDS_MSG spBagOfWordsRank(SPBagOfWords bow, SPPointStore queries, int imagesAmount,
+		int numOfSimilar, SPBitset allowed, int* images)
+{
+	int i, p, word, count, amount, image;
+	int* words;
+	double weight;
+	SPImageScore* scores;
+	if (bow == NULL || queries == NULL || images == NULL
+			|| spPointStoreGetType(queries) != SP_POINT_STORE_REAL
+			|| spPointStoreGetDim(queries) != bow->dim || numOfSimilar < 1
+			|| numOfSimilar > imagesAmount)
+		return SP_BAG_OF_WORDS_INVALID_ARGUMENT;
+	amount = spPointStoreGetSize(queries);
+	words = (int*) malloc((amount > 0 ? amount : 1) * sizeof(int));
+	scores = (SPImageScore*) malloc(imagesAmount * sizeof(SPImageScore));
+	if (words == NULL || scores == NULL)
+	{
+		free(words);
+		free(scores);
+		return SP_BAG_OF_WORDS_ALLOC_FAIL;
+	}
+	// Scores are never negative, so the images which aren't allowed rank last
+	for (i = 0; i < imagesAmount; i++)
+	{
+		scores[i].index = i;
+		scores[i].score = allowed == NULL || spBitsetContains(allowed, i) ? 0 : -1;
+	}
+
+	// The query's vector counts every word once per feature quantized to it
+	for (i = 0; i < amount; i++)
+		words[i] = spKMeansTreeQuantize(bow->vocabulary, spPointStoreGetRealRow(queries, i));
+	qsort(words, amount, sizeof(int), intComp);
+	for (i = 0; i < amount; i += count)
+	{
+		word = words[i];
+		for (count = 1; i + count < amount && words[i + count] == word; count++)
+			;
+		weight = count * bow->idf[word];
+		for (p = bow->postings[word]; p < bow->postings[word + 1]; p++)
+		{
+			image = bow->postingImages[p];
+			if (image < imagesAmount && scores[image].score >= 0)
+				scores[image].score += weight * bow->postingWeights[p];
+		}
+	}
+
+	// Normalizing the query's vector wouldn't change the order
+	qsort(scores, imagesAmount, sizeof(SPImageScore), imageScoreComp);
+	for (i = 0; i < numOfSimilar; i++)
+		images[i] = scores[i].score >= 0 ? scores[i].index : -1;
+	free(words);
+	free(scores);
+	return SP_BAG_OF_WORDS_SUCCESS;
+}
+
+void spBagOfWordsDestroy(SPBagOfWords bow)
+{
+	if (bow == NULL)
+		return;
+	spKMeansTreeDestroy(bow->vocabulary);
+	free(bow->idf);
+	free(bow->postings);
+	free(bow->postingImages);
+	free(bow->postingWeights);
+	free(bow);
+}
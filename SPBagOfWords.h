@@ -0,0 +1,93 @@
+#ifndef SPBAGOFWORDS_H_
+#define SPBAGOFWORDS_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "SPPointStore.h"
+#include "SPBitset.h"
+
+/**
+ * SP Bag Of Words summary
+ * An image level retrieval engine over visual words (Nister and Stewenius,
+ * "Scalable Recognition with a Vocabulary Tree"). Instead of searching the
+ * nearest features to every query feature, every feature is quantized to a
+ * visual word, a leaf of a hierarchical k-means tree (SPKMeansTree) trained
+ * on the features of the database.
+ *
+ * An image is a vector of the counts of its words, weighted by TF-IDF: a word
+ * weighs log(N / n) where N is the number of images and n the number of images
+ * it occurs in, so common words count less. The vectors are L2 normalized. An
+ * inverted file keeps for every word the images it occurs in, with their
+ * weights, so scoring a query only traverses the posting lists of its words.
+ * The score of an image is the dot product of its vector and the query's.
+ *
+ * The engine is built over a REAL point store, which must outlive it.
+ * Ranking is thread safe.
+ *
+ * The following functions are supported:
+ * spBagOfWordsCreate  - Trains a vocabulary and builds the inverted file over a store
+ * spBagOfWordsRank    - Finds the most similar images to a query image
+ * spBagOfWordsDestroy - Frees all resources associated with the engine
+ */
+
+typedef enum sp_bag_of_words_msg_t {
+	SP_BAG_OF_WORDS_INVALID_ARGUMENT,
+	SP_BAG_OF_WORDS_ALLOC_FAIL,
+	SP_BAG_OF_WORDS_SUCCESS
+} SP_BAG_OF_WORDS_MSG;
+
+typedef struct sp_bag_of_words_t* SPBagOfWords;
+
+/**
+ * Trains a vocabulary tree over the rows of store and indexes every image by
+ * the words of its features.
+ *
+ * @param store - a REAL point store
+ * @param branching - the number of children of every node of the vocabulary tree
+ * @param iterations - the maximal number of k-means iterations per node
+ * @param depth - the depth of the vocabulary tree, so there are at most
+ * 				  branching^depth words
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new engine.
+ *
+ * - SP_BAG_OF_WORDS_INVALID_ARGUMENT - if store == NULL or isn't REAL or is
+ * 		empty, or branching < 2 or iterations < 0 or depth < 1
+ * - SP_BAG_OF_WORDS_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_BAG_OF_WORDS_SUCCESS - in case of success
+ */
+SPBagOfWords spBagOfWordsCreate(SPPointStore store, int branching, int iterations, int depth,
+		SP_BAG_OF_WORDS_MSG* msg);
+
+/**
+ * Scores every image by the features of a query image and stores the
+ * indexes of the numOfSimilar best scored images in images, the best first.
+ * Ties are broken as in SPQuerySolverSolve, by the higher index first.
+ * Only the allowed images are scored and stored, if fewer than numOfSimilar
+ * are allowed the rest of images is filled with -1.
+ *
+ * @param bow - the engine
+ * @param queries - a REAL store of the same dimension as the engine's,
+ * 					the features of the query image
+ * @param imagesAmount - the number of images in the database
+ * @param numOfSimilar - the number of images to store
+ * @param allowed - the images to score, NULL scores all of them
+ * @param images - an array of numOfSimilar image indexes to fill
+ * @return
+ * - SP_BAG_OF_WORDS_INVALID_ARGUMENT - if bow == NULL or queries == NULL or
+ * 		images == NULL or queries isn't REAL or its dimension doesn't match,
+ * 		or numOfSimilar < 1 or numOfSimilar > imagesAmount
+ * - SP_BAG_OF_WORDS_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_BAG_OF_WORDS_SUCCESS - in case of success
+ */
+SP_BAG_OF_WORDS_MSG spBagOfWordsRank(SPBagOfWords bow, SPPointStore queries, int imagesAmount,
+		int numOfSimilar, SPBitset allowed, int* images);
+
+/**
+ * Frees all resources associated with the engine.
+ * If bow == NULL nothing happens.
+ */
+void spBagOfWordsDestroy(SPBagOfWords bow);
+
+#endif /* SPBAGOFWORDS_H_ */
@@ -0,0 +1,344 @@
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <vector>
+#include "SPBatchQuerySolver.h"
+extern "C" {
+#include "SPLogger.h"
+#include "SPQuerySolver.h"
+}
+
+#define STRING_LENGTH 1024
+#define QUEUE_SLOTS_PER_THREAD 2
+#define IN_FLIGHT_PER_THREAD 8
+#define EXIT_INPUT "<>"
+#define STDIN_NAME "stdin"
+#define STDOUT_NAME "stdout"
+
+#define RESULT_OK "OK"
+#define RESULT_ERROR "ERROR"
+#define FEATURES_ERROR "failed to get image features"
+#define QUERY_ERROR "failed to solve query"
+#define IMAGE_PATH_ERROR "failed to get image path"
+
+#define QUERY_LIST_ERROR "Query list couldn't be opened"
+#define OUTPUT_ERROR "Batch output couldn't be opened"
+#define WRITE_ERROR "Failed to write the batch results"
+#define SOLVED_INFO "Solved %d queries, %d failed, using %d feature threads and %d search threads in %.2f seconds (%.1f queries per second)"
+#define STAGE_INFO "Stage %s: %d threads, %.0f%% busy"
+#define STAGE_QUEUE_INFO "Stage %s: %d threads, %.0f%% busy, input queue depth %.1f on average, %d at most, capacity %d"
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* stageNames[] = { "read", "features", "search", "write" };
+
+static long long elapsedNanos(Clock::time_point start) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			Clock::now() - start).count();
+}
+
+sp::BatchQuerySolver::BatchQuerySolver(const SPConfig config, ImageProc* imgProc,
+		SPIndex index, SPQueryCache cache, SP_POINT_STORE_TYPE storeType,
+		int featureDim) :
+		config(config), imgProc(imgProc), index(index), cache(cache), storeType(storeType),
+		featureDim(featureDim), input(NULL), output(NULL), inFlight(0),
+		solvedAmount(0), failedAmount(0) {
+	SP_CONFIG_MSG msg = SP_CONFIG_SUCCESS;
+	imagesAmount = spConfigGetNumOfImages(config, &msg);
+	knn = spConfigGetKNN(config, &msg);
+	numOfSimilarImages = spConfigGetNumOfSimilarImages(config, &msg);
+	maxBatchSize = spConfigGetMaxBatchSize(config, &msg);
+	numOfThreads = spConfigGetNumOfThreads(config, &msg);
+	if (numOfThreads <= 0) {
+		numOfThreads = (int) std::thread::hardware_concurrency();
+	}
+	if (numOfThreads <= 0) {
+		numOfThreads = 1;
+	}
+	// A search of a batch is cheaper than extracting its features, half the
+	// threads keep up with it
+	numOfSearchThreads = numOfThreads / 2 > 0 ? numOfThreads / 2 : 1;
+	maxInFlight = numOfThreads * IN_FLIGHT_PER_THREAD;
+	for (int i = 0; i < STAGES_AMOUNT; i++) {
+		stageBusyTime[i] = 0;
+	}
+}
+
+bool sp::BatchQuerySolver::openFiles() {
+	char path[STRING_LENGTH] = { '\0' };
+	if (spConfigGetQueryListPath(path, config) != SP_CONFIG_SUCCESS
+			|| (input = strcmp(path, STDIN_NAME) == 0 ? stdin : fopen(path, "r")) == NULL) {
+		spLoggerPrintError(QUERY_LIST_ERROR, __FILE__, __func__, __LINE__);
+		return false;
+	}
+	if (spConfigGetBatchOutputPath(path, config) != SP_CONFIG_SUCCESS
+			|| (output = strcmp(path, STDOUT_NAME) == 0 ? stdout : fopen(path, "w")) == NULL) {
+		spLoggerPrintError(OUTPUT_ERROR, __FILE__, __func__, __LINE__);
+		closeFiles();
+		return false;
+	}
+	return true;
+}
+
+void sp::BatchQuerySolver::closeFiles() {
+	if (input != NULL && input != stdin) {
+		fclose(input);
+	}
+	if (output != NULL && output != stdout) {
+		fclose(output);
+	}
+	input = NULL;
+	output = NULL;
+}
+
+void sp::BatchQuerySolver::readStage() {
+	char line[STRING_LENGTH + 1] = { '\0' };
+	long long sequence = 0;
+	Clock::time_point start = Clock::now();
+	while (fgets(line, sizeof(line), input) != NULL) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (strcmp(line, EXIT_INPUT) == 0) {
+			break;
+		}
+		if (line[0] == '\0') {
+			continue;
+		}
+		QueryJob job;
+		job.sequence = sequence++;
+		job.imagePath = line;
+		job.hash = 0;
+		job.hashed = false;
+		job.version = 0;
+		job.features = NULL;
+		job.similarImages = NULL;
+		stageBusyTime[READ_STAGE] += elapsedNanos(start);
+		{
+			// The writer holds the results which are ready before the ones
+			// ahead of them, so the queries in flight are bounded
+			std::unique_lock<std::mutex> lock(inFlightMutex);
+			inFlightAvailable.wait(lock, [this]() {return inFlight < maxInFlight;});
+			inFlight++;
+		}
+		if (!featuresQueue->push(std::move(job))) {
+			return;
+		}
+		start = Clock::now();
+	}
+	stageBusyTime[READ_STAGE] += elapsedNanos(start);
+}
+
+void sp::BatchQuerySolver::featuresStage() {
+	QueryJob job;
+	while (featuresQueue->pop(job)) {
+		Clock::time_point start = Clock::now();
+		job.hashed = cache != NULL
+				&& spQueryCacheHashImage(job.imagePath.c_str(), config, &job.hash);
+		// The version is read before the search, so a result found by an index
+		// which changed meanwhile is never stamped as current
+		job.version = spIndexGetVersion(index);
+		if (job.hashed) {
+			job.similarImages = spQueryCacheGetResult(cache, job.hash, knn,
+					numOfSimilarImages, job.version);
+		}
+		if (job.similarImages == NULL) {
+			job.features = extractFeatures(job);
+			if (job.features == NULL) {
+				job.error = FEATURES_ERROR;
+			}
+		}
+		stageBusyTime[FEATURES_STAGE] += elapsedNanos(start);
+		if (!searchQueue->push(std::move(job))) {
+			return;
+		}
+	}
+}
+
+SPPointStore sp::BatchQuerySolver::extractFeatures(const QueryJob& job) {
+	int featuresAmount = 0;
+	SP_POINT_STORE_MSG storeMsg;
+	SPPointStore store = NULL;
+	if (job.hashed && (store = spQueryCacheGetFeatures(cache, job.hash)) != NULL) {
+		return store;
+	}
+	// Every features stage worker reuses its buffer across the queries
+	static thread_local std::vector<float> features;
+	if (!imgProc->getImageFeatures(job.imagePath.c_str(), 0, features,
+			&featuresAmount, true)) {
+		return NULL;
+	}
+	store = spPointStoreCreateFromFloats(storeType, features.data(),
+			featuresAmount, featureDim, 0, &storeMsg);
+	if (store != NULL && job.hashed) {
+		spQueryCachePutFeatures(cache, job.hash, store);
+	}
+	return store;
+}
+
+void sp::BatchQuerySolver::searchStage() {
+	std::vector<QueryJob> batch;
+	std::vector<SPPointStore> features;
+	std::vector<int> k, numOfSimilar;
+	QueryJob job;
+	while (searchQueue->pop(job)) {
+		Clock::time_point start = Clock::now();
+		// The queries whose features are ready are solved together
+		batch.clear();
+		batch.push_back(std::move(job));
+		while ((int) batch.size() < maxBatchSize && searchQueue->tryPop(job)) {
+			batch.push_back(std::move(job));
+		}
+		features.clear();
+		for (size_t i = 0; i < batch.size(); i++) {
+			if (batch[i].features != NULL) {
+				features.push_back(batch[i].features);
+			}
+		}
+		if (!features.empty()) {
+			k.assign(features.size(), knn);
+			numOfSimilar.assign(features.size(), numOfSimilarImages);
+			int** results = SPQuerySolverSolveBatch(index, &features[0], &k[0],
+					&numOfSimilar[0], (int) features.size(), imagesAmount, NULL);
+			for (size_t i = 0, solved = 0; i < batch.size(); i++) {
+				if (batch[i].features == NULL) {
+					continue;
+				}
+				batch[i].similarImages = results != NULL ? results[solved++] : NULL;
+				if (batch[i].similarImages == NULL) {
+					batch[i].error = QUERY_ERROR;
+				} else if (batch[i].hashed) {
+					spQueryCachePutResult(cache, batch[i].hash, knn, numOfSimilarImages,
+							batch[i].version, batch[i].similarImages);
+				}
+				spPointStoreDestroy(batch[i].features);
+				batch[i].features = NULL;
+			}
+			free(results);
+		}
+		stageBusyTime[SEARCH_STAGE] += elapsedNanos(start);
+		for (size_t i = 0; i < batch.size(); i++) {
+			if (!writeQueue->push(std::move(batch[i]))) {
+				return;
+			}
+		}
+	}
+}
+
+void sp::BatchQuerySolver::writeResult(QueryJob& job) {
+	char resImagePath[STRING_LENGTH] = { '\0' };
+	std::string line;
+	for (int i = 0; job.similarImages != NULL && i < numOfSimilarImages
+			&& job.similarImages[i] >= 0; i++) {
+		if (spConfigGetImagePath(resImagePath, config, job.similarImages[i])
+				!= SP_CONFIG_SUCCESS) {
+			job.error = IMAGE_PATH_ERROR;
+			break;
+		}
+		line += "\t";
+		line += resImagePath;
+	}
+	free(job.similarImages);
+	job.similarImages = NULL;
+	if (job.error.empty()) {
+		solvedAmount++;
+		fprintf(output, "%s\t%s%s\n", RESULT_OK, job.imagePath.c_str(), line.c_str());
+	} else {
+		failedAmount++;
+		fprintf(output, "%s\t%s\t%s\n", RESULT_ERROR, job.imagePath.c_str(),
+				job.error.c_str());
+	}
+}
+
+void sp::BatchQuerySolver::writeStage() {
+	std::map<long long, QueryJob> ready;
+	long long nextSequence = 0;
+	QueryJob job;
+	while (writeQueue->pop(job)) {
+		Clock::time_point start = Clock::now();
+		long long sequence = job.sequence;
+		ready[sequence] = std::move(job);
+		// The results are written in the order of the list
+		int written = 0;
+		std::map<long long, QueryJob>::iterator next;
+		while ((next = ready.find(nextSequence)) != ready.end()) {
+			writeResult(next->second);
+			ready.erase(next);
+			nextSequence++;
+			written++;
+		}
+		if (written > 0) {
+			std::lock_guard<std::mutex> lock(inFlightMutex);
+			inFlight -= written;
+			inFlightAvailable.notify_all();
+		}
+		stageBusyTime[WRITE_STAGE] += elapsedNanos(start);
+	}
+}
+
+void sp::BatchQuerySolver::logStageStats(double seconds) {
+	char infoMSG[STRING_LENGTH] = { '\0' };
+	int threads[] = { 1, numOfThreads, numOfSearchThreads, 1 };
+	BoundedQueue<QueryJob>* jobQueues[] = { NULL, featuresQueue.get(),
+			searchQueue.get(), writeQueue.get() };
+	for (int i = 0; i < STAGES_AMOUNT; i++) {
+		double busy = seconds > 0 ?
+				100.0 * stageBusyTime[i] / (seconds * 1e9 * threads[i]) : 0.0;
+		if (i == READ_STAGE) {
+			sprintf(infoMSG, STAGE_INFO, stageNames[i], threads[i], busy);
+		} else {
+			sprintf(infoMSG, STAGE_QUEUE_INFO, stageNames[i], threads[i], busy,
+					jobQueues[i]->getAverageDepth(), (int) jobQueues[i]->getMaxDepth(),
+					(int) jobQueues[i]->getCapacity());
+		}
+		spLoggerPrintInfo(infoMSG);
+	}
+}
+
+bool sp::BatchQuerySolver::run() {
+	char infoMSG[STRING_LENGTH] = { '\0' };
+	std::vector<std::thread> extractors, searchers;
+	if (!openFiles()) {
+		return false;
+	}
+	size_t capacity = (size_t) numOfThreads * QUEUE_SLOTS_PER_THREAD;
+	featuresQueue.reset(new BoundedQueue<QueryJob>(capacity));
+	searchQueue.reset(new BoundedQueue<QueryJob>(capacity));
+	writeQueue.reset(new BoundedQueue<QueryJob>(capacity));
+
+	// Every stage's queue is closed once all the stages feeding it are done
+	Clock::time_point start = Clock::now();
+	std::thread reader(&BatchQuerySolver::readStage, this);
+	for (int i = 0; i < numOfThreads; i++) {
+		extractors.push_back(std::thread(&BatchQuerySolver::featuresStage, this));
+	}
+	for (int i = 0; i < numOfSearchThreads; i++) {
+		searchers.push_back(std::thread(&BatchQuerySolver::searchStage, this));
+	}
+	std::thread writer(&BatchQuerySolver::writeStage, this);
+	reader.join();
+	featuresQueue->close();
+	for (size_t i = 0; i < extractors.size(); i++) {
+		extractors[i].join();
+	}
+	searchQueue->close();
+	for (size_t i = 0; i < searchers.size(); i++) {
+		searchers[i].join();
+	}
+	writeQueue->close();
+	writer.join();
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	bool written = fflush(output) == 0 && !ferror(output);
+	closeFiles();
+	if (!written) {
+		spLoggerPrintError(WRITE_ERROR, __FILE__, __func__, __LINE__);
+		return false;
+	}
+	int queriesAmount = solvedAmount + failedAmount;
+	sprintf(infoMSG, SOLVED_INFO, queriesAmount, (int) failedAmount, numOfThreads,
+			numOfSearchThreads, seconds, seconds > 0 ? queriesAmount / seconds : 0.0);
+	spLoggerPrintInfo(infoMSG);
+	logStageStats(seconds);
+	return true;
+}
@@ -0,0 +1,123 @@
+#ifndef SPBATCHQUERYSOLVER_H_
+#define SPBATCHQUERYSOLVER_H_
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "SPBoundedQueue.h"
+#include "SPImageProc.h"
+
+extern "C" {
+#include "SPConfig.h"
+#include "SPPointStore.h"
+#include "SPIndex.h"
+#include "SPQueryCache.h"
+}
+
+namespace sp {
+
+/**
+ * Solves a list of queries, the image paths listed one per line in
+ * spQueryListPath, and writes their results to spBatchOutputPath, one line
+ * per query in the order of the list:
+ *     OK<TAB><query path><TAB><the path of the most similar image><TAB>...
+ * or, if the query couldn't be solved,
+ *     ERROR<TAB><query path><TAB><the reason>
+ * The list ends at its end or at a line of the exit input "<>".
+ *
+ * Queries run through a pipeline of four stages connected by bounded queues,
+ * so many queries are in flight and no stage waits for another:
+ * - read: a single thread which reads the query paths
+ * - features: a pool of spNumOfThreads threads which extract the features of
+ *   the query images
+ * - search: a pool of threads which solve the queries whose features are
+ *   ready, up to spMaxBatchSize of them at once by SPQuerySolverSolveBatch
+ * - write: a single thread which writes the results, holding those which are
+ *   ready early until the queries before them are written
+ * The number of queries in flight is bounded, so memory stays bounded however
+ * long the list is. Every stage's utilization and input queue depth is logged
+ * when the list ends.
+ *
+ * Given a query cache, the features stage looks the query images up in it: a
+ * query whose result is cached passes the search stage untouched, and a query
+ * whose features are cached isn't extracted again.
+ */
+class BatchQuerySolver {
+private:
+	// A query on its way through the pipeline
+	struct QueryJob {
+		long long sequence;
+		std::string imagePath;
+		unsigned long long hash;
+		bool hashed;
+		unsigned long long version;
+		SPPointStore features;
+		int* similarImages;
+		std::string error;
+	};
+	enum Stage {
+		READ_STAGE, FEATURES_STAGE, SEARCH_STAGE, WRITE_STAGE, STAGES_AMOUNT
+	};
+	SPConfig config;
+	ImageProc* imgProc;
+	SPIndex index;
+	SPQueryCache cache;
+	SP_POINT_STORE_TYPE storeType;
+	int featureDim;
+	int imagesAmount;
+	int knn;
+	int numOfSimilarImages;
+	int numOfThreads;
+	int numOfSearchThreads;
+	int maxBatchSize;
+	int maxInFlight;
+	FILE* input;
+	FILE* output;
+	std::unique_ptr<BoundedQueue<QueryJob> > featuresQueue;
+	std::unique_ptr<BoundedQueue<QueryJob> > searchQueue;
+	std::unique_ptr<BoundedQueue<QueryJob> > writeQueue;
+	std::mutex inFlightMutex;
+	std::condition_variable inFlightAvailable;
+	int inFlight;
+	std::atomic<long long> stageBusyTime[STAGES_AMOUNT];
+	std::atomic<int> solvedAmount;
+	std::atomic<int> failedAmount;
+	bool openFiles();
+	void closeFiles();
+	void readStage();
+	void featuresStage();
+	SPPointStore extractFeatures(const QueryJob& job);
+	void searchStage();
+	void writeStage();
+	void writeResult(QueryJob& job);
+	void logStageStats(double seconds);
+public:
+
+	/**
+	 * Creates a new solver of the queries to an index, based on the
+	 * configuration file.
+	 * @param config - the configuration file
+	 * @param imgProc - the image processor used to extract the features of
+	 * 					the query images
+	 * @param index - the index of the features of the database
+	 * @param cache - the cache of the queries, NULL if they aren't cached
+	 * @param storeType - the type of the stores of the query features
+	 * @param featureDim - the dimension of the features
+	 */
+	BatchQuerySolver(const SPConfig config, ImageProc* imgProc, SPIndex index,
+			SPQueryCache cache, SP_POINT_STORE_TYPE storeType, int featureDim);
+
+	/**
+	 * Solves all the queries of the list and writes their results. A query
+	 * which fails is reported by its result line and doesn't stop the rest.
+	 * @return
+	 * true on success. false if the list or the output couldn't be opened,
+	 * or the results couldn't be written.
+	 */
+	bool run();
+};
+
+}
+#endif
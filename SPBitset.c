@@ -0,0 +1,119 @@
+#include <string.h>
+#include "SPBitset.h"
+
+#define WORD_BITS 64
+
+struct sp_bitset_t
+{
+	unsigned long long* words;
+	int wordsAmount;
+	int count;
+};
+
+SPBitset spBitsetCreate(int capacity, SP_BITSET_MSG* msg)
+{
+	SPBitset bitset;
+	assert(msg != NULL);
+	if (capacity < 0)
+	{
+		*msg = SP_BITSET_INVALID_ARGUMENT;
+		return NULL;
+	}
+	bitset = (SPBitset) calloc(1, sizeof(*bitset));
+	if (bitset == NULL)
+	{
+		*msg = SP_BITSET_ALLOC_FAIL;
+		return NULL;
+	}
+	bitset->wordsAmount = (capacity + WORD_BITS - 1) / WORD_BITS;
+	bitset->words = (unsigned long long*) calloc(bitset->wordsAmount > 0 ?
+			bitset->wordsAmount : 1, sizeof(unsigned long long));
+	if (bitset->words == NULL)
+	{
+		free(bitset);
+		*msg = SP_BITSET_ALLOC_FAIL;
+		return NULL;
+	}
+	*msg = SP_BITSET_SUCCESS;
+	return bitset;
+}
+
+SPBitset spBitsetCopy(SPBitset bitset, SP_BITSET_MSG* msg)
+{
+	SPBitset copy;
+	assert(msg != NULL);
+	if (bitset == NULL)
+	{
+		*msg = SP_BITSET_INVALID_ARGUMENT;
+		return NULL;
+	}
+	copy = spBitsetCreate(bitset->wordsAmount * WORD_BITS, msg);
+	if (copy == NULL)
+		return NULL;
+	memcpy(copy->words, bitset->words, bitset->wordsAmount * sizeof(unsigned long long));
+	copy->count = bitset->count;
+	return copy;
+}
+
+SP_BITSET_MSG spBitsetAdd(SPBitset bitset, int value)
+{
+	int word, wordsAmount;
+	unsigned long long bit, *words;
+	if (bitset == NULL || value < 0)
+		return SP_BITSET_INVALID_ARGUMENT;
+	word = value / WORD_BITS;
+	bit = 1ULL << (value % WORD_BITS);
+	if (word >= bitset->wordsAmount)
+	{
+		// Doubled, so adding increasing integers takes amortized constant time
+		wordsAmount = bitset->wordsAmount * 2 > word + 1 ? bitset->wordsAmount * 2 : word + 1;
+		words = (unsigned long long*) realloc(bitset->words,
+				wordsAmount * sizeof(unsigned long long));
+		if (words == NULL)
+			return SP_BITSET_ALLOC_FAIL;
+		memset(words + bitset->wordsAmount, 0,
+				(wordsAmount - bitset->wordsAmount) * sizeof(unsigned long long));
+		bitset->words = words;
+		bitset->wordsAmount = wordsAmount;
+	}
+	if (!(bitset->words[word] & bit))
+	{
+		bitset->words[word] |= bit;
+		bitset->count++;
+	}
+	return SP_BITSET_SUCCESS;
+}
+
+SP_BITSET_MSG spBitsetAddRange(SPBitset bitset, int first, int last)
+{
+	int value;
+	SP_BITSET_MSG msg;
+	if (bitset == NULL || first < 0 || last < first)
+		return SP_BITSET_INVALID_ARGUMENT;
+	// Growing to the last first, the rest of the range doesn't reallocate
+	msg = spBitsetAdd(bitset, last);
+	for (value = first; value < last && msg == SP_BITSET_SUCCESS; value++)
+		msg = spBitsetAdd(bitset, value);
+	return msg;
+}
+
+bool spBitsetContains(SPBitset bitset, int value)
+{
+	if (bitset == NULL || value < 0 || value / WORD_BITS >= bitset->wordsAmount)
+		return false;
+	return (bitset->words[value / WORD_BITS] >> (value % WORD_BITS)) & 1;
+}
+
+int spBitsetGetCount(SPBitset bitset)
+{
+	assert(bitset != NULL);
+	return bitset->count;
+}
+
+void spBitsetDestroy(SPBitset bitset)
+{
+	if (bitset == NULL)
+		return;
+	free(bitset->words);
+	free(bitset);
+}
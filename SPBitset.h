@@ -0,0 +1,104 @@
+#ifndef SPBITSET_H_
+#define SPBITSET_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+/**
+ * SP Bitset summary
+ * A set of non-negative integers, a bit each, which grows as larger integers
+ * are added. Used to mark the images deleted from an index, and the images a
+ * query is restricted to.
+ *
+ * The following functions are supported:
+ * spBitsetCreate   - Creates an empty set
+ * spBitsetCopy     - Creates a set holding the integers of another
+ * spBitsetAdd      - Adds an integer to a set
+ * spBitsetAddRange - Adds a range of integers to a set
+ * spBitsetContains - Checks whether an integer is in a set
+ * spBitsetGetCount - A getter of the number of integers in a set
+ * spBitsetDestroy  - Frees all resources associated with a set
+ */
+
+typedef enum sp_bitset_msg_t {
+	SP_BITSET_INVALID_ARGUMENT,
+	SP_BITSET_ALLOC_FAIL,
+	SP_BITSET_SUCCESS
+} SP_BITSET_MSG;
+
+typedef struct sp_bitset_t* SPBitset;
+
+/**
+ * Creates an empty set.
+ *
+ * @param capacity - the number of integers, from 0, to allocate room for
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new set.
+ *
+ * - SP_BITSET_INVALID_ARGUMENT - if capacity < 0
+ * - SP_BITSET_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_BITSET_SUCCESS - in case of success
+ */
+SPBitset spBitsetCreate(int capacity, SP_BITSET_MSG* msg);
+
+/**
+ * Creates a set holding the integers of bitset.
+ *
+ * @param bitset - the set to copy
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new set.
+ *
+ * - SP_BITSET_INVALID_ARGUMENT - if bitset == NULL
+ * - SP_BITSET_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_BITSET_SUCCESS - in case of success
+ */
+SPBitset spBitsetCopy(SPBitset bitset, SP_BITSET_MSG* msg);
+
+/**
+ * Adds value to the set, growing it as needed.
+ *
+ * @param bitset - the set
+ * @param value - the integer to add
+ * @return
+ * - SP_BITSET_INVALID_ARGUMENT - if bitset == NULL or value < 0
+ * - SP_BITSET_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_BITSET_SUCCESS - in case of success, also if value was in the set
+ */
+SP_BITSET_MSG spBitsetAdd(SPBitset bitset, int value);
+
+/**
+ * Adds the integers from first to last, both included, to the set, growing
+ * it as needed.
+ *
+ * @param bitset - the set
+ * @param first - the first integer to add
+ * @param last - the last integer to add
+ * @return
+ * - SP_BITSET_INVALID_ARGUMENT - if bitset == NULL or first < 0 or
+ * 		last < first
+ * - SP_BITSET_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_BITSET_SUCCESS - in case of success
+ */
+SP_BITSET_MSG spBitsetAddRange(SPBitset bitset, int first, int last);
+
+/**
+ * @return true if value is in the set, false otherwise or if bitset == NULL
+ */
+bool spBitsetContains(SPBitset bitset, int value);
+
+/**
+ * @assert bitset != NULL
+ * @return the number of integers in the set
+ */
+int spBitsetGetCount(SPBitset bitset);
+
+/**
+ * Frees all resources associated with the set.
+ * If bitset == NULL nothing happens.
+ */
+void spBitsetDestroy(SPBitset bitset);
+
+#endif /* SPBITSET_H_ */
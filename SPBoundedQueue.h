@@ -0,0 +1,165 @@
+#ifndef SPBOUNDEDQUEUE_H_
+#define SPBOUNDEDQUEUE_H_
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace sp {
+
+/**
+ * A blocking first-in first-out queue which holds at most a fixed amount of
+ * items, used to connect the stages of a pipeline. A producer blocks while the
+ * queue is full and a consumer blocks while it is empty, so a slow stage
+ * throttles the stages before it instead of letting their output pile up.
+ *
+ * Once the queue is closed no more items are accepted, and consumers receive
+ * the remaining items and then stop.
+ *
+ * The queue also records how full it was over its lifetime, which tells
+ * which side of it is the bottleneck: a queue which is always full has a
+ * slow consumer, a queue which is always empty has a slow producer.
+ */
+template<typename T>
+class BoundedQueue {
+private:
+	std::deque<T> items;
+	size_t capacity;
+	bool closed;
+	size_t pushAmount;
+	size_t depthSum;
+	size_t maxDepth;
+	std::mutex mutex;
+	std::condition_variable notFull;
+	std::condition_variable notEmpty;
+public:
+
+	/**
+	 * Creates an empty queue.
+	 * @param capacity - the maximal amount of items in the queue, at least 1
+	 */
+	BoundedQueue(size_t capacity) :
+			capacity(capacity > 0 ? capacity : 1), closed(false),
+			pushAmount(0), depthSum(0), maxDepth(0) {
+	}
+
+	/**
+	 * Inserts item at the end of the queue, waiting while the queue is full.
+	 * @param item - the item to insert, it is moved into the queue
+	 * @return
+	 * true if the item was inserted, false if the queue was closed.
+	 */
+	bool push(T&& item) {
+		std::unique_lock<std::mutex> lock(mutex);
+		notFull.wait(lock, [this]() {return closed || items.size() < capacity;});
+		if (closed) {
+			return false;
+		}
+		items.push_back(std::move(item));
+		pushAmount++;
+		depthSum += items.size();
+		if (items.size() > maxDepth) {
+			maxDepth = items.size();
+		}
+		notEmpty.notify_one();
+		return true;
+	}
+
+	/**
+	 * Inserts item at the end of the queue unless the queue is full, without
+	 * waiting, so a producer can turn work away instead of blocking.
+	 * @param item - the item to insert, it is moved into the queue if inserted
+	 * @return
+	 * true if the item was inserted, false if the queue was full or closed.
+	 */
+	bool tryPush(T&& item) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (closed || items.size() >= capacity) {
+			return false;
+		}
+		items.push_back(std::move(item));
+		pushAmount++;
+		depthSum += items.size();
+		if (items.size() > maxDepth) {
+			maxDepth = items.size();
+		}
+		notEmpty.notify_one();
+		return true;
+	}
+
+	/**
+	 * Removes the first item of the queue, waiting while the queue is empty.
+	 * @param item - the removed item is moved into item
+	 * @return
+	 * true if an item was removed, false if the queue is closed and empty.
+	 */
+	bool pop(T& item) {
+		std::unique_lock<std::mutex> lock(mutex);
+		notEmpty.wait(lock, [this]() {return closed || !items.empty();});
+		if (items.empty()) {
+			return false;
+		}
+		item = std::move(items.front());
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	/**
+	 * Removes the first item of the queue unless the queue is empty, without
+	 * waiting, so a consumer can take whatever else is ready along with an
+	 * item it waited for.
+	 * @param item - the removed item is moved into item
+	 * @return
+	 * true if an item was removed, false if the queue was empty.
+	 */
+	bool tryPop(T& item) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (items.empty()) {
+			return false;
+		}
+		item = std::move(items.front());
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	/**
+	 * Closes the queue. Waiting producers return immediately, waiting
+	 * consumers return once the queue is empty.
+	 */
+	void close() {
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		notFull.notify_all();
+		notEmpty.notify_all();
+	}
+
+	/**
+	 * @return the maximal amount of items in the queue
+	 */
+	size_t getCapacity() {
+		return capacity;
+	}
+
+	/**
+	 * @return the average amount of items in the queue right after a push,
+	 * 		   0 if nothing was pushed
+	 */
+	double getAverageDepth() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return pushAmount > 0 ? (double) depthSum / pushAmount : 0.0;
+	}
+
+	/**
+	 * @return the maximal amount of items the queue held at once
+	 */
+	size_t getMaxDepth() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return maxDepth;
+	}
+};
+
+}
+#endif
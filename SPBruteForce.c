@@ -0,0 +1,234 @@
+#include "SPBruteForce.h"
+
+#define BLOCK_ROWS 64 // rows of the store compared at once, one panel
+#define QUERY_TILE 4  // query features compared at once with a panel
+#define NORM_SLACK 1e-9 // relative rounding error allowed in the norms formulation
+
+struct sp_brute_force_t
+{
+	SPPointStore store;
+	int dim;
+	int size;
+	double* norms;  // REAL stores, the squared norm of every row
+	double* panels; // REAL stores, every block of rows transposed: dim x BLOCK_ROWS
+};
+
+/*
+ * Enqueues a row into bpq unless the queue is full of closer rows.
+ */
+static SP_BRUTE_FORCE_MSG enqueueRow(SPBruteForce bf, int row, double distance,
+		SPBPQueue bpq)
+{
+	SPListElement element;
+	SP_BPQUEUE_MSG bpqMsg;
+	if (spBPQueueIsFull(bpq) && distance >= spBPQueueMaxValue(bpq))
+		return SP_BRUTE_FORCE_SUCCESS;
+	element = spListElementCreate(spPointStoreGetImageIndex(bf->store, row), distance);
+	if (element == NULL)
+		return SP_BRUTE_FORCE_ALLOC_FAIL;
+	bpqMsg = spBPQueueEnqueue(bpq, element);
+	spListElementDestroy(element);
+	if (bpqMsg == SP_BPQUEUE_OUT_OF_MEMORY)
+		return SP_BRUTE_FORCE_ALLOC_FAIL;
+	return SP_BRUTE_FORCE_SUCCESS;
+}
+
+/*
+ * The dot products of 'amount' query rows with the rows of one panel.
+ * The innermost loop runs over a whole panel row with a fixed length, so the
+ * compiler vectorizes it, and the panel stays in the cache for all the queries.
+ */
+static void multiplyTile(const double* panel, const double** queries, int amount,
+		int dim, double dots[QUERY_TILE][BLOCK_ROWS])
+{
+	int i, j, d;
+	double value;
+	const double* column;
+	for (i = 0; i < amount; i++)
+	{
+		for (j = 0; j < BLOCK_ROWS; j++)
+			dots[i][j] = 0;
+		for (d = 0; d < dim; d++)
+		{
+			value = queries[i][d];
+			column = panel + (size_t) d * BLOCK_ROWS;
+			for (j = 0; j < BLOCK_ROWS; j++)
+				dots[i][j] += value * column[j];
+		}
+	}
+}
+
+/*
+ * Whether any of the amount queues accepts any row of a block, so a block
+ * whose rows are all filtered out isn't multiplied at all.
+ */
+static bool blockAccepted(SPBruteForce bf, int block, SPBPQueue* bpqs, int amount)
+{
+	int i, row;
+	for (row = block * BLOCK_ROWS; row < (block + 1) * BLOCK_ROWS && row < bf->size; row++)
+	{
+		for (i = 0; i < amount; i++)
+		{
+			if (spBPQueueAccepts(bpqs[i], spPointStoreGetImageIndex(bf->store, row)))
+				return true;
+		}
+	}
+	return false;
+}
+
+static double squaredNorm(const double* row, int dim)
+{
+	int i;
+	double norm = 0;
+	for (i = 0; i < dim; i++)
+		norm += row[i] * row[i];
+	return norm;
+}
+
+static SP_BRUTE_FORCE_MSG realKNN(SPBruteForce bf, SPPointStore queries, int first,
+		int amount, SPBPQueue* bpqs)
+{
+	int t, i, j, block, row, tile;
+	double distance;
+	double dots[QUERY_TILE][BLOCK_ROWS];
+	double queryNorms[QUERY_TILE];
+	double thresholds[QUERY_TILE]; // the distance a row must beat, per query
+	const double* tileRows[QUERY_TILE];
+	SP_BRUTE_FORCE_MSG msg = SP_BRUTE_FORCE_SUCCESS;
+
+	for (t = 0; t < amount && msg == SP_BRUTE_FORCE_SUCCESS; t += QUERY_TILE)
+	{
+		tile = amount - t < QUERY_TILE ? amount - t : QUERY_TILE;
+		for (i = 0; i < tile; i++)
+		{
+			tileRows[i] = spPointStoreGetRealRow(queries, first + t + i);
+			queryNorms[i] = squaredNorm(tileRows[i], bf->dim);
+			thresholds[i] = spBPQueueIsFull(bpqs[t + i]) ?
+					spBPQueueMaxValue(bpqs[t + i]) : -1;
+		}
+		for (block = 0; block * BLOCK_ROWS < bf->size && msg == SP_BRUTE_FORCE_SUCCESS; block++)
+		{
+			if (!blockAccepted(bf, block, bpqs + t, tile))
+				continue;
+			multiplyTile(bf->panels + (size_t) block * bf->dim * BLOCK_ROWS, tileRows, tile,
+					bf->dim, dots);
+			for (i = 0; i < tile && msg == SP_BRUTE_FORCE_SUCCESS; i++)
+			{
+				for (j = 0; j < BLOCK_ROWS && msg == SP_BRUTE_FORCE_SUCCESS; j++)
+				{
+					row = block * BLOCK_ROWS + j;
+					if (row >= bf->size)
+						break;
+					if (!spBPQueueAccepts(bpqs[t + i], spPointStoreGetImageIndex(bf->store, row)))
+						continue;
+					distance = queryNorms[i] + bf->norms[row] - 2 * dots[i][j];
+					if (thresholds[i] >= 0 && distance - NORM_SLACK
+							* (queryNorms[i] + bf->norms[row]) >= thresholds[i])
+						continue;
+					// A candidate, its distance is computed again exactly
+					distance = spPointStoreDistance(bf->store, row, queries, first + t + i);
+					msg = enqueueRow(bf, row, distance, bpqs[t + i]);
+					if (spBPQueueIsFull(bpqs[t + i]))
+						thresholds[i] = spBPQueueMaxValue(bpqs[t + i]);
+				}
+			}
+		}
+	}
+	return msg;
+}
+
+static SP_BRUTE_FORCE_MSG binaryKNN(SPBruteForce bf, SPPointStore queries, int first,
+		int amount, SPBPQueue* bpqs)
+{
+	int i, block, row, last, distance;
+	SP_BRUTE_FORCE_MSG msg = SP_BRUTE_FORCE_SUCCESS;
+	// Every block of rows is compared with all the queries while it's cached
+	for (block = 0; block < bf->size && msg == SP_BRUTE_FORCE_SUCCESS; block += BLOCK_ROWS)
+	{
+		last = block + BLOCK_ROWS < bf->size ? block + BLOCK_ROWS : bf->size;
+		for (i = 0; i < amount && msg == SP_BRUTE_FORCE_SUCCESS; i++)
+		{
+			for (row = block; row < last && msg == SP_BRUTE_FORCE_SUCCESS; row++)
+			{
+				// A row the queue doesn't accept isn't compared at all
+				if (!spBPQueueAccepts(bpqs[i], spPointStoreGetImageIndex(bf->store, row)))
+					continue;
+				distance = spPointStoreHammingDistance(spPointStoreGetBinaryRow(bf->store, row),
+						spPointStoreGetBinaryRow(queries, first + i), bf->dim);
+				msg = enqueueRow(bf, row, distance, bpqs[i]);
+			}
+		}
+	}
+	return msg;
+}
+
+SPBruteForce spBruteForceCreate(SPPointStore store, SP_BRUTE_FORCE_MSG* msg)
+{
+	SPBruteForce bf;
+	int row, d, blocks;
+	const double* data;
+	assert(msg != NULL);
+	if (store == NULL)
+	{
+		*msg = SP_BRUTE_FORCE_INVALID_ARGUMENT;
+		return NULL;
+	}
+	bf = (SPBruteForce) calloc(1, sizeof(*bf));
+	if (bf == NULL)
+	{
+		*msg = SP_BRUTE_FORCE_ALLOC_FAIL;
+		return NULL;
+	}
+	bf->store = store;
+	bf->dim = spPointStoreGetDim(store);
+	bf->size = spPointStoreGetSize(store);
+	if (spPointStoreGetType(store) == SP_POINT_STORE_BINARY)
+	{
+		*msg = SP_BRUTE_FORCE_SUCCESS;
+		return bf;
+	}
+
+	// The last panel is padded with zero rows, which are never reported
+	blocks = (bf->size + BLOCK_ROWS - 1) / BLOCK_ROWS;
+	bf->norms = (double*) malloc((bf->size > 0 ? bf->size : 1) * sizeof(double));
+	bf->panels = (double*) calloc((size_t) (blocks > 0 ? blocks : 1) * bf->dim * BLOCK_ROWS,
+			sizeof(double));
+	if (bf->norms == NULL || bf->panels == NULL)
+	{
+		spBruteForceDestroy(bf);
+		*msg = SP_BRUTE_FORCE_ALLOC_FAIL;
+		return NULL;
+	}
+	for (row = 0; row < bf->size; row++)
+	{
+		data = spPointStoreGetRealRow(store, row);
+		bf->norms[row] = squaredNorm(data, bf->dim);
+		for (d = 0; d < bf->dim; d++)
+			bf->panels[((size_t) (row / BLOCK_ROWS) * bf->dim + d) * BLOCK_ROWS
+					+ row % BLOCK_ROWS] = data[d];
+	}
+	*msg = SP_BRUTE_FORCE_SUCCESS;
+	return bf;
+}
+
+SP_BRUTE_FORCE_MSG spBruteForceKNN(SPBruteForce bf, SPPointStore queries, int first,
+		int amount, SPBPQueue* bpqs)
+{
+	if (bf == NULL || queries == NULL || bpqs == NULL || first < 0 || amount < 0
+			|| first + amount > spPointStoreGetSize(queries)
+			|| spPointStoreGetType(queries) != spPointStoreGetType(bf->store)
+			|| spPointStoreGetDim(queries) != bf->dim)
+		return SP_BRUTE_FORCE_INVALID_ARGUMENT;
+	if (spPointStoreGetType(bf->store) == SP_POINT_STORE_BINARY)
+		return binaryKNN(bf, queries, first, amount, bpqs);
+	return realKNN(bf, queries, first, amount, bpqs);
+}
+
+void spBruteForceDestroy(SPBruteForce bf)
+{
+	if (bf == NULL)
+		return;
+	free(bf->norms);
+	free(bf->panels);
+	free(bf);
+}
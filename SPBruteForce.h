@@ -0,0 +1,85 @@
+#ifndef SPBRUTEFORCE_H_
+#define SPBRUTEFORCE_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "SPPointStore.h"
+#include "SPBPriorityQueue.h"
+
+/**
+ * SP Brute Force summary
+ * An exact k nearest neighbours search which compares every query feature
+ * with every row of a point store. It is the fastest exact search over small
+ * databases and the ground truth against which the other indexes are measured.
+ *
+ * Over a REAL store the squared distances are computed as
+ * ||q||^2 + ||p||^2 - 2 q.p, where the dot products of a tile of queries with
+ * a block of rows are a small matrix multiplication. The rows are kept
+ * transposed in blocks, so the innermost loop of the multiplication runs over
+ * contiguous memory and is vectorized by the compiler. Rows which may enter
+ * the k nearest have their distance computed again directly, so the reported
+ * distances are the same as the other indexes'.
+ * Over a BINARY store the rows are scanned in blocks by Hamming distance.
+ * A row whose image a query's queue doesn't accept (see spBPQueueAccepts) isn't
+ * compared with the query, and a block of such rows isn't multiplied, so a
+ * search restricted to a few images scans little more than their rows.
+ *
+ * The search refers to the rows of the store, which must outlive it.
+ * Searching is thread safe.
+ *
+ * The following functions are supported:
+ * spBruteForceCreate  - Prepares the search over a store
+ * spBruteForceKNN     - Finds the nearest rows to a range of query features
+ * spBruteForceDestroy - Frees all resources associated with the search
+ */
+
+typedef enum sp_brute_force_msg_t {
+	SP_BRUTE_FORCE_INVALID_ARGUMENT,
+	SP_BRUTE_FORCE_ALLOC_FAIL,
+	SP_BRUTE_FORCE_SUCCESS
+} SP_BRUTE_FORCE_MSG;
+
+typedef struct sp_brute_force_t* SPBruteForce;
+
+/**
+ * Prepares the search over all the rows of store.
+ *
+ * @param store - a REAL or BINARY point store
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new search.
+ *
+ * - SP_BRUTE_FORCE_INVALID_ARGUMENT - if store == NULL
+ * - SP_BRUTE_FORCE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_BRUTE_FORCE_SUCCESS - in case of success
+ */
+SPBruteForce spBruteForceCreate(SPPointStore store, SP_BRUTE_FORCE_MSG* msg);
+
+/**
+ * For every query feature in rows first to first + amount - 1 of queries,
+ * enqueues the nearest rows into its queue, up to the queue's maximal size.
+ * Every element's index is the image index of the row and its value is its
+ * distance from the query feature.
+ *
+ * @param bf - the search
+ * @param queries - a store of the same type and dimension as the search's
+ * @param first - the first query row
+ * @param amount - the number of query rows
+ * @param bpqs - an array of 'amount' queues, bpqs[i] is filled for row first + i
+ * @return
+ * - SP_BRUTE_FORCE_INVALID_ARGUMENT - if bf == NULL or queries == NULL or
+ * 		bpqs == NULL or the rows are out of range or queries doesn't match
+ * - SP_BRUTE_FORCE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_BRUTE_FORCE_SUCCESS - in case of success
+ */
+SP_BRUTE_FORCE_MSG spBruteForceKNN(SPBruteForce bf, SPPointStore queries, int first,
+		int amount, SPBPQueue* bpqs);
+
+/**
+ * Frees all resources associated with the search. The store isn't destroyed.
+ * If bf == NULL nothing happens.
+ */
+void spBruteForceDestroy(SPBruteForce bf);
+
+#endif /* SPBRUTEFORCE_H_ */
@@ -23,6 +23,43 @@
 #define MINIMAL_GUI "spMinimalGUI"
 #define LOGGER_LEVEL "spLoggerLevel"
 #define LOGGER_FILENAME "spLoggerFilename"
+#define INCREMENTAL_EXTRACTION "spIncrementalExtraction"
+#define NUM_THREADS "spNumOfThreads"
+#define DESCRIPTOR_CACHE_MB "spDescriptorCacheMB"
+#define PCA_SAMPLE_RATE "spPCASampleRate"
+#define MAX_IMAGE_EDGE "spMaxImageEdge"
+#define DECODE_SCOPE "spReducedDecodeScope"
+#define PCA_FILE_FORMAT "spPCAFileFormat"
+#define DESCRIPTOR_TYPE "spDescriptorType"
+#define INDEX_TYPE "spIndexType"
+#define BRUTE_FORCE_THRESHOLD "spBruteForceThreshold"
+#define MEASURE_RECALL "spMeasureRecall"
+#define HNSW_M "spHNSWM"
+#define HNSW_EF_CONSTRUCTION "spHNSWEfConstruction"
+#define HNSW_EF_SEARCH "spHNSWEfSearch"
+#define IVF_LISTS "spIVFLists"
+#define IVF_PROBES "spIVFProbes"
+#define PQ_SUBQUANTIZERS "spPQSubquantizers"
+#define KMEANS_BRANCHING "spKMeansBranching"
+#define KMEANS_ITERATIONS "spKMeansIterations"
+#define VOCABULARY_DEPTH "spVocabularyDepth"
+#define KMEANS_CHECKS "spKMeansChecks"
+#define LSH_TABLES "spLSHTables"
+#define LSH_FUNCTIONS "spLSHFunctions"
+#define LSH_BUCKET_WIDTH "spLSHBucketWidth"
+#define LSH_PROBES "spLSHProbes"
+#define LSH_SEED "spLSHSeed"
+#define QUERY_MODE "spQueryMode"
+#define SERVER_SOCKET_PATH "spServerSocketPath"
+#define QUERY_LIST_PATH "spQueryListPath"
+#define BATCH_OUTPUT_PATH "spBatchOutputPath"
+#define SERVER_WORKERS "spServerWorkers"
+#define SERVER_QUEUE_SIZE "spServerQueueSize"
+#define BATCH_WINDOW "spBatchWindow"
+#define MAX_BATCH_SIZE "spMaxBatchSize"
+#define QUERY_CACHE_MEMORY "spQueryCacheMemory"
+#define INDEX_MERGE_THRESHOLD "spIndexMergeThreshold"
+#define INDEX_COMPACTION_PERCENT "spIndexCompactionPercent"
 
 #define IS_VALID_SUFFIX(STRING) (strcmp(STRING, ".jpg") == 0 || strcmp(STRING, ".png") == 0 \
 		|| strcmp(STRING, ".bmp") == 0 || strcmp(STRING, ".gif") == 0)
@@ -34,10 +71,45 @@
 #define KDTREE_SPLIT_RANDOM "RANDOM"
 #define KDTREE_SPLIT_MAX_SPREAD "MAX_SPREAD"
 #define KDTREE_SPLIT_INCREMENTAL "INCREMENTAL"
+#define DECODE_SCOPE_QUERY "QUERY"
+#define DECODE_SCOPE_ALL "ALL"
+#define PCA_FORMAT_YAML "YAML"
+#define PCA_FORMAT_BINARY "BINARY"
+#define DESCRIPTOR_SIFT "SIFT"
+#define DESCRIPTOR_ORB "ORB"
+#define INDEX_KD_TREE "KD_TREE"
+#define INDEX_MULTI_INDEX_HASHING "MULTI_INDEX_HASHING"
+#define INDEX_BRUTE_FORCE "BRUTE_FORCE"
+#define INDEX_HNSW "HNSW"
+#define INDEX_IVF_PQ "IVF_PQ"
+#define INDEX_BAG_OF_WORDS "BAG_OF_WORDS"
+#define INDEX_KMEANS_TREE "KMEANS_TREE"
+#define INDEX_LSH "LSH"
+#define INDEX_VP_TREE "VP_TREE"
+#define QUERY_MODE_INTERACTIVE "INTERACTIVE"
+#define QUERY_MODE_SERVER "SERVER"
+#define QUERY_MODE_BATCH "BATCH"
 
 // Constraints
 #define MIN_DIM 10
 #define MAX_DIM 28
+#define MIN_SAMPLE_RATE 1
+#define MAX_SAMPLE_RATE 100
+#define MIN_HNSW_M 2
+#define MIN_HNSW_EF 1
+#define MIN_IVF_LISTS 1
+#define MIN_IVF_PROBES 1
+#define MIN_PQ_SUBQUANTIZERS 1
+#define MIN_KMEANS_BRANCHING 2
+#define MIN_VOCABULARY_DEPTH 1
+#define MIN_KMEANS_CHECKS 1
+#define MIN_LSH_TABLES 1
+#define MIN_LSH_FUNCTIONS 1
+#define MIN_LSH_BUCKET_WIDTH 1
+#define MIN_LSH_PROBES 1
+#define MIN_SERVER_WORKERS 1
+#define MIN_SERVER_QUEUE_SIZE 1
+#define MIN_MAX_BATCH_SIZE 1
 
 // Default values
 #define DEF_PCA_DIM 20
@@ -50,6 +122,45 @@
 #define DEF_MINIMAL_GUI false
 #define DEF_LOGGER_LEVEL 3
 #define DEF_LOGGER_FILENAME "stdout"
+#define DEF_SERVER_SOCKET_PATH "spcbir.sock"
+#define DEF_QUERY_LIST_PATH "stdin"
+#define DEF_BATCH_OUTPUT_PATH "stdout"
+#define DEF_INCREMENTAL_EXTRACTION false
+#define DEF_NUM_THREADS 0
+#define DEF_DESCRIPTOR_CACHE_MB 1024
+#define DEF_PCA_SAMPLE_RATE 100
+#define DEF_MAX_IMAGE_EDGE 0
+#define DEF_DECODE_SCOPE SP_DECODE_ALL
+#define DEF_PCA_FILE_FORMAT SP_PCA_YAML
+#define DEF_DESCRIPTOR_TYPE SP_DESCRIPTOR_SIFT
+#define DEF_INDEX_TYPE SP_INDEX_KD_TREE
+#define DEF_BRUTE_FORCE_THRESHOLD 0
+#define DEF_MEASURE_RECALL false
+#define DEF_HNSW_M 16
+#define DEF_HNSW_EF_CONSTRUCTION 200
+#define DEF_HNSW_EF_SEARCH 64
+#define DEF_IVF_LISTS 256
+#define DEF_IVF_PROBES 8
+#define DEF_PQ_SUBQUANTIZERS 8
+#define DEF_KMEANS_BRANCHING 10
+#define DEF_KMEANS_ITERATIONS 10
+#define DEF_VOCABULARY_DEPTH 4
+#define DEF_KMEANS_CHECKS 256
+#define DEF_LSH_TABLES 8
+#define DEF_LSH_FUNCTIONS 8
+#define DEF_LSH_BUCKET_WIDTH 200
+#define DEF_LSH_PROBES 16
+#define DEF_LSH_SEED 0
+#define DEF_QUERY_MODE SP_QUERY_MODE_INTERACTIVE
+#define DEF_SERVER_WORKERS 4
+#define DEF_SERVER_QUEUE_SIZE 32
+#define DEF_BATCH_WINDOW 2000
+#define DEF_MAX_BATCH_SIZE 16
+#define DEF_QUERY_CACHE_MEMORY 16384
+#define DEF_INDEX_MERGE_THRESHOLD 4096
+#define DEF_INDEX_COMPACTION_PERCENT 20
+
+#define MANIFEST_SUFFIX ".manifest"
 
 // A struct representing the configuration
 struct sp_config_t 
@@ -68,6 +179,43 @@ struct sp_config_t
 	bool spMinimalGUI;
 	int spLoggerLevel;
 	char spLoggerFilename[MAX_LEN];
+	char spServerSocketPath[MAX_LEN];
+	char spQueryListPath[MAX_LEN];
+	char spBatchOutputPath[MAX_LEN];
+	bool spIncrementalExtraction;
+	int spNumOfThreads;
+	int spDescriptorCacheMB;
+	int spPCASampleRate;
+	int spMaxImageEdge;
+	SP_DECODE_SCOPE spReducedDecodeScope;
+	SP_PCA_FILE_FORMAT spPCAFileFormat;
+	SP_DESCRIPTOR_TYPE spDescriptorType;
+	SP_INDEX_TYPE spIndexType;
+	int spBruteForceThreshold;
+	bool spMeasureRecall;
+	int spHNSWM;
+	int spHNSWEfConstruction;
+	int spHNSWEfSearch;
+	int spIVFLists;
+	int spIVFProbes;
+	int spPQSubquantizers;
+	int spKMeansBranching;
+	int spKMeansIterations;
+	int spVocabularyDepth;
+	int spKMeansChecks;
+	int spLSHTables;
+	int spLSHFunctions;
+	int spLSHBucketWidth;
+	int spLSHProbes;
+	int spLSHSeed;
+	SP_QUERY_MODE spQueryMode;
+	int spServerWorkers;
+	int spServerQueueSize;
+	int spBatchWindow;
+	int spMaxBatchSize;
+	int spQueryCacheMemory;
+	int spIndexMergeThreshold;
+	int spIndexCompactionPercent;
 };
 
 SPConfig spConfigCreate(const char* filename, SP_CONFIG_MSG* msg)
@@ -100,6 +248,43 @@ SPConfig spConfigCreate(const char* filename, SP_CONFIG_MSG* msg)
 	bool spMinimalGUIInit = false;
 	bool spLoggerLevelInit = false;
 	bool spLoggerFilenameInit = false;
+	bool spServerSocketPathInit = false;
+	bool spQueryListPathInit = false;
+	bool spBatchOutputPathInit = false;
+	bool spIncrementalExtractionInit = false;
+	bool spNumOfThreadsInit = false;
+	bool spDescriptorCacheMBInit = false;
+	bool spPCASampleRateInit = false;
+	bool spMaxImageEdgeInit = false;
+	bool spReducedDecodeScopeInit = false;
+	bool spPCAFileFormatInit = false;
+	bool spDescriptorTypeInit = false;
+	bool spIndexTypeInit = false;
+	bool spBruteForceThresholdInit = false;
+	bool spMeasureRecallInit = false;
+	bool spHNSWMInit = false;
+	bool spHNSWEfConstructionInit = false;
+	bool spHNSWEfSearchInit = false;
+	bool spIVFListsInit = false;
+	bool spIVFProbesInit = false;
+	bool spPQSubquantizersInit = false;
+	bool spKMeansBranchingInit = false;
+	bool spKMeansIterationsInit = false;
+	bool spVocabularyDepthInit = false;
+	bool spKMeansChecksInit = false;
+	bool spLSHTablesInit = false;
+	bool spLSHFunctionsInit = false;
+	bool spLSHBucketWidthInit = false;
+	bool spLSHProbesInit = false;
+	bool spLSHSeedInit = false;
+	bool spQueryModeInit = false;
+	bool spServerWorkersInit = false;
+	bool spServerQueueSizeInit = false;
+	bool spBatchWindowInit = false;
+	bool spMaxBatchSizeInit = false;
+	bool spQueryCacheMemoryInit = false;
+	bool spIndexMergeThresholdInit = false;
+	bool spIndexCompactionPercentInit = false;
 	
 	assert(msg != NULL);
 	if (filename == NULL)
@@ -398,225 +583,1587 @@ SPConfig spConfigCreate(const char* filename, SP_CONFIG_MSG* msg)
 			sprintf(config->spLoggerFilename, "%s", varValue);
 			spLoggerFilenameInit = true;
 		}
-		else // line declares an illegal variable
+		else if (strcmp(varName, SERVER_SOCKET_PATH) == 0)
 		{
-			PRINT_ERROR(filename, lineNum, ERR_MSG_INVALID_LINE);
-			free(config);
-			free(varName);
-			free(varValue);
-			*msg = SP_CONFIG_INVALID_STRING;
-			return NULL;
+			sprintf(config->spServerSocketPath, "%s", varValue);
+			spServerSocketPathInit = true;
 		}
-		free(varName);
-		free(varValue);
-	} // Now done reading the file
-	
-	if (!feof(file))
-	{
-		PRINT_ERROR(filename, lineNum, ERR_MSG_INVALID_LINE);
-		free(config);
-		*msg = SP_CONFIG_INVALID_STRING;
-		return NULL;
-	}
-	
-	// Check all non-default variables were initialized
-	if (!spImagesDirectoryInit)
-	{
-		PRINT_ERROR(filename, lineNum, ERR_MSG_PARAMETER(IMAGES_DIRECTORY));
-		free(config);
-		*msg = SP_CONFIG_MISSING_DIR;
-		return NULL;
-	}
-	if (!spImagesPrefixInit)
-	{
-		PRINT_ERROR(filename, lineNum, ERR_MSG_PARAMETER(IMAGES_PREFIX));
-		free(config);
-		*msg = SP_CONFIG_MISSING_PREFIX;
-		return NULL;
-	}
-	if (!spImagesSuffixInit)
-	{
-		PRINT_ERROR(filename, lineNum, ERR_MSG_PARAMETER(IMAGES_SUFFIX));
-		free(config);
-		*msg = SP_CONFIG_MISSING_SUFFIX;
-		return NULL;
-	}
-	if (!spNumOfImagesInit)
-	{
-		PRINT_ERROR(filename, lineNum, ERR_MSG_PARAMETER(NUM_IMAGES));
-		free(config);
-		*msg = SP_CONFIG_MISSING_NUM_IMAGES;
-		return NULL;
-	}
-	
-	// If other variables were not initialized, set to default value
-	if (!spPCADimensionInit)
-		config->spPCADimension = DEF_PCA_DIM;
-	if (!spPCAFilenameInit)
-		sprintf(config->spPCAFilename, DEF_PCA_FILENAME);
-	if (!spNumOfFeaturesInit)
-		config->spNumOfFeatures = DEF_NUM_FEATURES;
-	if (!spExtractionModeInit)
-		config->spExtractionMode = DEF_EXTRACTION_MODE;
-	if (!spNumOfSimilarImagesInit)
-		config->spNumOfSimilarImages = DEF_NUM_SIMILAR_IMAGES;
-	if (!spKDTreeSplitMethodInit)
-		config->spKDTreeSplitMethod = DEF_KDTREE_SPLIT_METHOD;
-	if (!spKNNInit)
-		config->spKNN = DEF_KNN;
-	if (!spMinimalGUIInit)
-		config->spMinimalGUI = DEF_MINIMAL_GUI;
-	if (!spLoggerLevelInit)
-		config->spLoggerLevel = DEF_LOGGER_LEVEL;
-	if (!spLoggerFilenameInit)
-		sprintf(config->spLoggerFilename, DEF_LOGGER_FILENAME);
-	
-	// All done
-	*msg = SP_CONFIG_SUCCESS;
-	return config;
-}
-
-bool spConfigIsExtractionMode(const SPConfig config, SP_CONFIG_MSG* msg)
-{
-	assert(msg != NULL);
-	if (config == NULL) 
-	{
-		*msg = SP_CONFIG_INVALID_ARGUMENT;
-		return false;
-	}
-	*msg = SP_CONFIG_SUCCESS;
-	return config->spExtractionMode;
-}
-
-bool spConfigMinimalGui(const SPConfig config, SP_CONFIG_MSG* msg)
-{
-	assert(msg != NULL);
-	if (config == NULL)
-	{
-		*msg = SP_CONFIG_INVALID_ARGUMENT;
-		return false;
-	}
-	*msg = SP_CONFIG_SUCCESS;
-	return config->spMinimalGUI;
-}
-
-SP_KDTREE_SPLIT_METHOD spConfigGetKDTreeSplitMethod(SPConfig config, SP_CONFIG_MSG* msg)
-{
-	assert(msg != NULL);
-	if (config == NULL)
-	{
-		*msg = SP_CONFIG_INVALID_ARGUMENT;
-		return SP_KDTREE_MAX_SPREAD;
-	}
-	*msg = SP_CONFIG_SUCCESS;
-	return config->spKDTreeSplitMethod;
-}
-
-int spConfigGetNumOfImages(const SPConfig config, SP_CONFIG_MSG* msg)
-{
-	assert(msg != NULL);
-	if (config == NULL)
-	{
-		*msg = SP_CONFIG_INVALID_ARGUMENT;
-		return -1;
-	}
-	*msg = SP_CONFIG_SUCCESS;
-	return config->spNumOfImages;
-}
-
-int spConfigGetNumOfFeatures(const SPConfig config, SP_CONFIG_MSG* msg)
-{
-	assert(msg != NULL);
-	if (config == NULL)
-	{
-		*msg = SP_CONFIG_INVALID_ARGUMENT;
-		return -1;
-	}
-	*msg = SP_CONFIG_SUCCESS;
-	return config->spNumOfFeatures;
-}
-
-int spConfigGetPCADim(const SPConfig config, SP_CONFIG_MSG* msg)
-{
-	assert(msg != NULL);
-	if (config == NULL)
-	{
-		*msg = SP_CONFIG_INVALID_ARGUMENT;
-		return -1;
-	}
-	*msg = SP_CONFIG_SUCCESS;
-	return config->spPCADimension;
-}
-
-int spConfigGetLoggerLevel(const SPConfig config, SP_CONFIG_MSG* msg)
-{
-	assert(msg != NULL);
-	if (config == NULL)
-	{
-		*msg = SP_CONFIG_INVALID_ARGUMENT;
-		return -1;
-	}
-	*msg = SP_CONFIG_SUCCESS;
-	return config->spLoggerLevel;
-}
-
-int spConfigGetNumOfSimilarImages(const SPConfig config, SP_CONFIG_MSG * msg)
-{
-	assert(msg != NULL);
-	if (config == NULL)
-	{
-		*msg = SP_CONFIG_INVALID_ARGUMENT;
-		return -1;
-	}
-	*msg = SP_CONFIG_SUCCESS;
-	return config->spNumOfSimilarImages;
-}
-
-int spConfigGetKNN(const SPConfig config, SP_CONFIG_MSG * msg)
-{
-	assert(msg != NULL);
-	if (config == NULL)
-	{
-		*msg = SP_CONFIG_INVALID_ARGUMENT;
-		return -1;
-	}
-	*msg = SP_CONFIG_SUCCESS;
-	return config->spKNN;
-}
-
-SP_CONFIG_MSG spConfigGetLoggerFilename(char* loggerFilename, const SPConfig config)
-{
-	if (config == NULL || loggerFilename == NULL)
-		return SP_CONFIG_INVALID_ARGUMENT;
-	sprintf(loggerFilename, "%s", config->spLoggerFilename);
-	return SP_CONFIG_SUCCESS;
-}
-
-SP_CONFIG_MSG spConfigGetImagePath(char* imagePath, const SPConfig config, int index)
-{
-	if (config == NULL || imagePath == NULL || index < 0)
-		return SP_CONFIG_INVALID_ARGUMENT;
-	if (index >= config->spNumOfImages)
-		return SP_CONFIG_INDEX_OUT_OF_RANGE;
-	sprintf(imagePath, "%s%s%d%s", config->spImagesDirectory, config->spImagesPrefix, index, config->spImagesSuffix);
-	return SP_CONFIG_SUCCESS;
-}
-
-SP_CONFIG_MSG spConfigGetFeatsPath(char * featsPath, const SPConfig config, int index)
-{
-	if (config == NULL || featsPath == NULL || index < 0)
-		return SP_CONFIG_INVALID_ARGUMENT;
-	if (index >= config->spNumOfImages)
-		return SP_CONFIG_INDEX_OUT_OF_RANGE;
-	sprintf(featsPath, "%s%s%d.feats", config->spImagesDirectory, config->spImagesPrefix, index);
-	return SP_CONFIG_SUCCESS;
-}
-
-SP_CONFIG_MSG spConfigGetPCAPath(char* pcaPath, const SPConfig config)
-{
-	if (config == NULL || pcaPath == NULL)
-		return SP_CONFIG_INVALID_ARGUMENT;
-	sprintf(pcaPath, "%s", config->spPCAFilename);
+		else if (strcmp(varName, QUERY_LIST_PATH) == 0)
+		{
+			sprintf(config->spQueryListPath, "%s", varValue);
+			spQueryListPathInit = true;
+		}
+		else if (strcmp(varName, BATCH_OUTPUT_PATH) == 0)
+		{
+			sprintf(config->spBatchOutputPath, "%s", varValue);
+			spBatchOutputPathInit = true;
+		}
+		else if (strcmp(varName, INCREMENTAL_EXTRACTION) == 0)
+		{
+			if (strcmp(varValue, TRUE_STRING) == 0)
+			{
+				config->spIncrementalExtraction = true;
+			}
+			else if (strcmp(varValue, FALSE_STRING) == 0)
+			{
+				config->spIncrementalExtraction = false;
+			}
+			else
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_STRING;
+				return NULL;
+			}
+			spIncrementalExtractionInit = true;
+		}
+		else if (strcmp(varName, NUM_THREADS) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			config->spNumOfThreads = numberValue;
+			spNumOfThreadsInit = true;
+		}
+		else if (strcmp(varName, DESCRIPTOR_CACHE_MB) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			config->spDescriptorCacheMB = numberValue;
+			spDescriptorCacheMBInit = true;
+		}
+		else if (strcmp(varName, PCA_SAMPLE_RATE) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_SAMPLE_RATE || numberValue > MAX_SAMPLE_RATE)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spPCASampleRate = numberValue;
+			spPCASampleRateInit = true;
+		}
+		else if (strcmp(varName, MAX_IMAGE_EDGE) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			config->spMaxImageEdge = numberValue;
+			spMaxImageEdgeInit = true;
+		}
+		else if (strcmp(varName, DECODE_SCOPE) == 0)
+		{
+			if (strcmp(varValue, DECODE_SCOPE_QUERY) == 0) // check value is one of the options
+			{
+				config->spReducedDecodeScope = SP_DECODE_QUERY;
+			}
+			else if (strcmp(varValue, DECODE_SCOPE_ALL) == 0)
+			{
+				config->spReducedDecodeScope = SP_DECODE_ALL;
+			}
+			else
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_STRING;
+				return NULL;
+			}
+			spReducedDecodeScopeInit = true;
+		}
+		else if (strcmp(varName, PCA_FILE_FORMAT) == 0)
+		{
+			if (strcmp(varValue, PCA_FORMAT_YAML) == 0) // check value is one of the options
+			{
+				config->spPCAFileFormat = SP_PCA_YAML;
+			}
+			else if (strcmp(varValue, PCA_FORMAT_BINARY) == 0)
+			{
+				config->spPCAFileFormat = SP_PCA_BINARY;
+			}
+			else
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_STRING;
+				return NULL;
+			}
+			spPCAFileFormatInit = true;
+		}
+		else if (strcmp(varName, DESCRIPTOR_TYPE) == 0)
+		{
+			if (strcmp(varValue, DESCRIPTOR_SIFT) == 0) // check value is one of the options
+			{
+				config->spDescriptorType = SP_DESCRIPTOR_SIFT;
+			}
+			else if (strcmp(varValue, DESCRIPTOR_ORB) == 0)
+			{
+				config->spDescriptorType = SP_DESCRIPTOR_ORB;
+			}
+			else
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_STRING;
+				return NULL;
+			}
+			spDescriptorTypeInit = true;
+		}
+		else if (strcmp(varName, INDEX_TYPE) == 0)
+		{
+			if (strcmp(varValue, INDEX_KD_TREE) == 0) // check value is one of the options
+			{
+				config->spIndexType = SP_INDEX_KD_TREE;
+			}
+			else if (strcmp(varValue, INDEX_MULTI_INDEX_HASHING) == 0)
+			{
+				config->spIndexType = SP_INDEX_MULTI_INDEX_HASHING;
+			}
+			else if (strcmp(varValue, INDEX_BRUTE_FORCE) == 0)
+			{
+				config->spIndexType = SP_INDEX_BRUTE_FORCE;
+			}
+			else if (strcmp(varValue, INDEX_HNSW) == 0)
+			{
+				config->spIndexType = SP_INDEX_HNSW;
+			}
+			else if (strcmp(varValue, INDEX_IVF_PQ) == 0)
+			{
+				config->spIndexType = SP_INDEX_IVF_PQ;
+			}
+			else if (strcmp(varValue, INDEX_BAG_OF_WORDS) == 0)
+			{
+				config->spIndexType = SP_INDEX_BAG_OF_WORDS;
+			}
+			else if (strcmp(varValue, INDEX_KMEANS_TREE) == 0)
+			{
+				config->spIndexType = SP_INDEX_KMEANS_TREE;
+			}
+			else if (strcmp(varValue, INDEX_LSH) == 0)
+			{
+				config->spIndexType = SP_INDEX_LSH;
+			}
+			else if (strcmp(varValue, INDEX_VP_TREE) == 0)
+			{
+				config->spIndexType = SP_INDEX_VP_TREE;
+			}
+			else
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_STRING;
+				return NULL;
+			}
+			spIndexTypeInit = true;
+		}
+		else if (strcmp(varName, BRUTE_FORCE_THRESHOLD) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			config->spBruteForceThreshold = numberValue;
+			spBruteForceThresholdInit = true;
+		}
+		else if (strcmp(varName, MEASURE_RECALL) == 0)
+		{
+			if (strcmp(varValue, TRUE_STRING) == 0)
+			{
+				config->spMeasureRecall = true;
+			}
+			else if (strcmp(varValue, FALSE_STRING) == 0)
+			{
+				config->spMeasureRecall = false;
+			}
+			else
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_STRING;
+				return NULL;
+			}
+			spMeasureRecallInit = true;
+		}
+		else if (strcmp(varName, HNSW_M) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_HNSW_M)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spHNSWM = numberValue;
+			spHNSWMInit = true;
+		}
+		else if (strcmp(varName, HNSW_EF_CONSTRUCTION) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_HNSW_EF)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spHNSWEfConstruction = numberValue;
+			spHNSWEfConstructionInit = true;
+		}
+		else if (strcmp(varName, HNSW_EF_SEARCH) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_HNSW_EF)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spHNSWEfSearch = numberValue;
+			spHNSWEfSearchInit = true;
+		}
+		else if (strcmp(varName, IVF_LISTS) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_IVF_LISTS)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spIVFLists = numberValue;
+			spIVFListsInit = true;
+		}
+		else if (strcmp(varName, IVF_PROBES) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_IVF_PROBES)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spIVFProbes = numberValue;
+			spIVFProbesInit = true;
+		}
+		else if (strcmp(varName, PQ_SUBQUANTIZERS) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_PQ_SUBQUANTIZERS)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spPQSubquantizers = numberValue;
+			spPQSubquantizersInit = true;
+		}
+		else if (strcmp(varName, KMEANS_BRANCHING) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_KMEANS_BRANCHING)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spKMeansBranching = numberValue;
+			spKMeansBranchingInit = true;
+		}
+		else if (strcmp(varName, KMEANS_ITERATIONS) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			config->spKMeansIterations = numberValue;
+			spKMeansIterationsInit = true;
+		}
+		else if (strcmp(varName, VOCABULARY_DEPTH) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_VOCABULARY_DEPTH)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spVocabularyDepth = numberValue;
+			spVocabularyDepthInit = true;
+		}
+		else if (strcmp(varName, KMEANS_CHECKS) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_KMEANS_CHECKS)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spKMeansChecks = numberValue;
+			spKMeansChecksInit = true;
+		}
+		else if (strcmp(varName, LSH_TABLES) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_LSH_TABLES)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spLSHTables = numberValue;
+			spLSHTablesInit = true;
+		}
+		else if (strcmp(varName, LSH_FUNCTIONS) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_LSH_FUNCTIONS)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spLSHFunctions = numberValue;
+			spLSHFunctionsInit = true;
+		}
+		else if (strcmp(varName, LSH_BUCKET_WIDTH) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_LSH_BUCKET_WIDTH)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spLSHBucketWidth = numberValue;
+			spLSHBucketWidthInit = true;
+		}
+		else if (strcmp(varName, LSH_PROBES) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_LSH_PROBES)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spLSHProbes = numberValue;
+			spLSHProbesInit = true;
+		}
+		else if (strcmp(varName, LSH_SEED) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			config->spLSHSeed = numberValue;
+			spLSHSeedInit = true;
+		}
+		else if (strcmp(varName, QUERY_MODE) == 0)
+		{
+			if (strcmp(varValue, QUERY_MODE_INTERACTIVE) == 0) // check value is one of the options
+			{
+				config->spQueryMode = SP_QUERY_MODE_INTERACTIVE;
+			}
+			else if (strcmp(varValue, QUERY_MODE_SERVER) == 0)
+			{
+				config->spQueryMode = SP_QUERY_MODE_SERVER;
+			}
+			else if (strcmp(varValue, QUERY_MODE_BATCH) == 0)
+			{
+				config->spQueryMode = SP_QUERY_MODE_BATCH;
+			}
+			else
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_STRING;
+				return NULL;
+			}
+			spQueryModeInit = true;
+		}
+		else if (strcmp(varName, SERVER_WORKERS) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_SERVER_WORKERS)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spServerWorkers = numberValue;
+			spServerWorkersInit = true;
+		}
+		else if (strcmp(varName, SERVER_QUEUE_SIZE) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_SERVER_QUEUE_SIZE)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spServerQueueSize = numberValue;
+			spServerQueueSizeInit = true;
+		}
+		else if (strcmp(varName, BATCH_WINDOW) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			config->spBatchWindow = numberValue;
+			spBatchWindowInit = true;
+		}
+		else if (strcmp(varName, MAX_BATCH_SIZE) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			if (numberValue < MIN_MAX_BATCH_SIZE)
+			{
+				PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+				free(config);
+				free(varName);
+				free(varValue);
+				*msg = SP_CONFIG_INVALID_INTEGER;
+				return NULL;
+			}
+			config->spMaxBatchSize = numberValue;
+			spMaxBatchSizeInit = true;
+		}
+		else if (strcmp(varName, QUERY_CACHE_MEMORY) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			config->spQueryCacheMemory = numberValue;
+			spQueryCacheMemoryInit = true;
+		}
+		else if (strcmp(varName, INDEX_MERGE_THRESHOLD) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			config->spIndexMergeThreshold = numberValue;
+			spIndexMergeThresholdInit = true;
+		}
+		else if (strcmp(varName, INDEX_COMPACTION_PERCENT) == 0)
+		{
+			for (i = 0; i < (int)strlen(varValue); i++)
+			{
+				if (!isdigit(varValue[i]))
+				{
+					PRINT_ERROR(filename, lineNum, ERR_MSG_VALUE_CONSTRAINT);
+					free(config);
+					free(varName);
+					free(varValue);
+					*msg = SP_CONFIG_INVALID_INTEGER;
+					return NULL;
+				}
+			}
+			numberValue = atoi(varValue);
+			config->spIndexCompactionPercent = numberValue;
+			spIndexCompactionPercentInit = true;
+		}
+		else // line declares an illegal variable
+		{
+			PRINT_ERROR(filename, lineNum, ERR_MSG_INVALID_LINE);
+			free(config);
+			free(varName);
+			free(varValue);
+			*msg = SP_CONFIG_INVALID_STRING;
+			return NULL;
+		}
+		free(varName);
+		free(varValue);
+	} // Now done reading the file
+	
+	if (!feof(file))
+	{
+		PRINT_ERROR(filename, lineNum, ERR_MSG_INVALID_LINE);
+		free(config);
+		*msg = SP_CONFIG_INVALID_STRING;
+		return NULL;
+	}
+	
+	// Check all non-default variables were initialized
+	if (!spImagesDirectoryInit)
+	{
+		PRINT_ERROR(filename, lineNum, ERR_MSG_PARAMETER(IMAGES_DIRECTORY));
+		free(config);
+		*msg = SP_CONFIG_MISSING_DIR;
+		return NULL;
+	}
+	if (!spImagesPrefixInit)
+	{
+		PRINT_ERROR(filename, lineNum, ERR_MSG_PARAMETER(IMAGES_PREFIX));
+		free(config);
+		*msg = SP_CONFIG_MISSING_PREFIX;
+		return NULL;
+	}
+	if (!spImagesSuffixInit)
+	{
+		PRINT_ERROR(filename, lineNum, ERR_MSG_PARAMETER(IMAGES_SUFFIX));
+		free(config);
+		*msg = SP_CONFIG_MISSING_SUFFIX;
+		return NULL;
+	}
+	if (!spNumOfImagesInit)
+	{
+		PRINT_ERROR(filename, lineNum, ERR_MSG_PARAMETER(NUM_IMAGES));
+		free(config);
+		*msg = SP_CONFIG_MISSING_NUM_IMAGES;
+		return NULL;
+	}
+	
+	// If other variables were not initialized, set to default value
+	if (!spPCADimensionInit)
+		config->spPCADimension = DEF_PCA_DIM;
+	if (!spPCAFilenameInit)
+		sprintf(config->spPCAFilename, DEF_PCA_FILENAME);
+	if (!spNumOfFeaturesInit)
+		config->spNumOfFeatures = DEF_NUM_FEATURES;
+	if (!spExtractionModeInit)
+		config->spExtractionMode = DEF_EXTRACTION_MODE;
+	if (!spNumOfSimilarImagesInit)
+		config->spNumOfSimilarImages = DEF_NUM_SIMILAR_IMAGES;
+	if (!spKDTreeSplitMethodInit)
+		config->spKDTreeSplitMethod = DEF_KDTREE_SPLIT_METHOD;
+	if (!spKNNInit)
+		config->spKNN = DEF_KNN;
+	if (!spMinimalGUIInit)
+		config->spMinimalGUI = DEF_MINIMAL_GUI;
+	if (!spLoggerLevelInit)
+		config->spLoggerLevel = DEF_LOGGER_LEVEL;
+	if (!spLoggerFilenameInit)
+		sprintf(config->spLoggerFilename, DEF_LOGGER_FILENAME);
+	if (!spServerSocketPathInit)
+		sprintf(config->spServerSocketPath, DEF_SERVER_SOCKET_PATH);
+	if (!spQueryListPathInit)
+		sprintf(config->spQueryListPath, DEF_QUERY_LIST_PATH);
+	if (!spBatchOutputPathInit)
+		sprintf(config->spBatchOutputPath, DEF_BATCH_OUTPUT_PATH);
+	if (!spIncrementalExtractionInit)
+		config->spIncrementalExtraction = DEF_INCREMENTAL_EXTRACTION;
+	if (!spNumOfThreadsInit)
+		config->spNumOfThreads = DEF_NUM_THREADS;
+	if (!spDescriptorCacheMBInit)
+		config->spDescriptorCacheMB = DEF_DESCRIPTOR_CACHE_MB;
+	if (!spPCASampleRateInit)
+		config->spPCASampleRate = DEF_PCA_SAMPLE_RATE;
+	if (!spMaxImageEdgeInit)
+		config->spMaxImageEdge = DEF_MAX_IMAGE_EDGE;
+	if (!spReducedDecodeScopeInit)
+		config->spReducedDecodeScope = DEF_DECODE_SCOPE;
+	if (!spPCAFileFormatInit)
+		config->spPCAFileFormat = DEF_PCA_FILE_FORMAT;
+	if (!spDescriptorTypeInit)
+		config->spDescriptorType = DEF_DESCRIPTOR_TYPE;
+	if (!spIndexTypeInit)
+		config->spIndexType = config->spDescriptorType == SP_DESCRIPTOR_ORB ?
+				SP_INDEX_MULTI_INDEX_HASHING : DEF_INDEX_TYPE;
+	if (!spBruteForceThresholdInit)
+		config->spBruteForceThreshold = DEF_BRUTE_FORCE_THRESHOLD;
+	if (!spMeasureRecallInit)
+		config->spMeasureRecall = DEF_MEASURE_RECALL;
+	if (!spHNSWMInit)
+		config->spHNSWM = DEF_HNSW_M;
+	if (!spHNSWEfConstructionInit)
+		config->spHNSWEfConstruction = DEF_HNSW_EF_CONSTRUCTION;
+	if (!spHNSWEfSearchInit)
+		config->spHNSWEfSearch = DEF_HNSW_EF_SEARCH;
+	if (!spIVFListsInit)
+		config->spIVFLists = DEF_IVF_LISTS;
+	if (!spIVFProbesInit)
+		config->spIVFProbes = DEF_IVF_PROBES;
+	if (!spPQSubquantizersInit)
+		config->spPQSubquantizers = DEF_PQ_SUBQUANTIZERS;
+	if (!spKMeansBranchingInit)
+		config->spKMeansBranching = DEF_KMEANS_BRANCHING;
+	if (!spKMeansIterationsInit)
+		config->spKMeansIterations = DEF_KMEANS_ITERATIONS;
+	if (!spVocabularyDepthInit)
+		config->spVocabularyDepth = DEF_VOCABULARY_DEPTH;
+	if (!spKMeansChecksInit)
+		config->spKMeansChecks = DEF_KMEANS_CHECKS;
+	if (!spLSHTablesInit)
+		config->spLSHTables = DEF_LSH_TABLES;
+	if (!spLSHFunctionsInit)
+		config->spLSHFunctions = DEF_LSH_FUNCTIONS;
+	if (!spLSHBucketWidthInit)
+		config->spLSHBucketWidth = DEF_LSH_BUCKET_WIDTH;
+	if (!spLSHProbesInit)
+		config->spLSHProbes = DEF_LSH_PROBES;
+	if (!spLSHSeedInit)
+		config->spLSHSeed = DEF_LSH_SEED;
+	if (!spQueryModeInit)
+		config->spQueryMode = DEF_QUERY_MODE;
+	if (!spServerWorkersInit)
+		config->spServerWorkers = DEF_SERVER_WORKERS;
+	if (!spServerQueueSizeInit)
+		config->spServerQueueSize = DEF_SERVER_QUEUE_SIZE;
+	if (!spBatchWindowInit)
+		config->spBatchWindow = DEF_BATCH_WINDOW;
+	if (!spMaxBatchSizeInit)
+		config->spMaxBatchSize = DEF_MAX_BATCH_SIZE;
+	if (!spQueryCacheMemoryInit)
+		config->spQueryCacheMemory = DEF_QUERY_CACHE_MEMORY;
+	if (!spIndexMergeThresholdInit)
+		config->spIndexMergeThreshold = DEF_INDEX_MERGE_THRESHOLD;
+	if (!spIndexCompactionPercentInit)
+		config->spIndexCompactionPercent = DEF_INDEX_COMPACTION_PERCENT;
+	
+	// All done
+	*msg = SP_CONFIG_SUCCESS;
+	return config;
+}
+
+bool spConfigIsExtractionMode(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL) 
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return false;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spExtractionMode;
+}
+
+bool spConfigIsIncrementalExtraction(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return false;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spIncrementalExtraction;
+}
+
+bool spConfigMinimalGui(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return false;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spMinimalGUI;
+}
+
+SP_KDTREE_SPLIT_METHOD spConfigGetKDTreeSplitMethod(SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return SP_KDTREE_MAX_SPREAD;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spKDTreeSplitMethod;
+}
+
+int spConfigGetNumOfImages(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spNumOfImages;
+}
+
+int spConfigGetNumOfFeatures(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spNumOfFeatures;
+}
+
+int spConfigGetPCADim(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spPCADimension;
+}
+
+int spConfigGetFeatureDim(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	if (config->spDescriptorType == SP_DESCRIPTOR_ORB)
+		return SP_ORB_DESCRIPTOR_BYTES;
+	return config->spPCADimension;
+}
+
+int spConfigGetLoggerLevel(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spLoggerLevel;
+}
+
+int spConfigGetNumOfSimilarImages(const SPConfig config, SP_CONFIG_MSG * msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spNumOfSimilarImages;
+}
+
+int spConfigGetKNN(const SPConfig config, SP_CONFIG_MSG * msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spKNN;
+}
+
+int spConfigGetNumOfThreads(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spNumOfThreads;
+}
+
+int spConfigGetDescriptorCacheMB(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spDescriptorCacheMB;
+}
+
+int spConfigGetPCASampleRate(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spPCASampleRate;
+}
+
+int spConfigGetMaxImageEdge(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spMaxImageEdge;
+}
+
+SP_DECODE_SCOPE spConfigGetReducedDecodeScope(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return DEF_DECODE_SCOPE;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spReducedDecodeScope;
+}
+
+SP_PCA_FILE_FORMAT spConfigGetPCAFileFormat(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return DEF_PCA_FILE_FORMAT;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spPCAFileFormat;
+}
+
+SP_DESCRIPTOR_TYPE spConfigGetDescriptorType(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return DEF_DESCRIPTOR_TYPE;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spDescriptorType;
+}
+
+SP_INDEX_TYPE spConfigGetIndexType(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return DEF_INDEX_TYPE;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spIndexType;
+}
+
+int spConfigGetBruteForceThreshold(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spBruteForceThreshold;
+}
+
+bool spConfigIsMeasureRecall(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return false;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spMeasureRecall;
+}
+
+int spConfigGetHNSWM(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spHNSWM;
+}
+
+int spConfigGetHNSWEfConstruction(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spHNSWEfConstruction;
+}
+
+int spConfigGetHNSWEfSearch(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spHNSWEfSearch;
+}
+
+int spConfigGetIVFLists(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spIVFLists;
+}
+
+int spConfigGetIVFProbes(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spIVFProbes;
+}
+
+int spConfigGetPQSubquantizers(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spPQSubquantizers;
+}
+
+int spConfigGetKMeansBranching(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spKMeansBranching;
+}
+
+int spConfigGetKMeansIterations(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spKMeansIterations;
+}
+
+int spConfigGetVocabularyDepth(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spVocabularyDepth;
+}
+
+int spConfigGetKMeansChecks(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spKMeansChecks;
+}
+
+int spConfigGetLSHTables(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spLSHTables;
+}
+
+int spConfigGetLSHFunctions(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spLSHFunctions;
+}
+
+int spConfigGetLSHBucketWidth(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spLSHBucketWidth;
+}
+
+int spConfigGetLSHProbes(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spLSHProbes;
+}
+
+int spConfigGetLSHSeed(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spLSHSeed;
+}
+
+SP_QUERY_MODE spConfigGetQueryMode(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return DEF_QUERY_MODE;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spQueryMode;
+}
+
+int spConfigGetServerWorkers(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spServerWorkers;
+}
+
+int spConfigGetServerQueueSize(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spServerQueueSize;
+}
+
+int spConfigGetBatchWindow(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spBatchWindow;
+}
+
+int spConfigGetMaxBatchSize(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spMaxBatchSize;
+}
+
+int spConfigGetQueryCacheMemory(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spQueryCacheMemory;
+}
+
+int spConfigGetIndexMergeThreshold(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spIndexMergeThreshold;
+}
+
+int spConfigGetIndexCompactionPercent(const SPConfig config, SP_CONFIG_MSG* msg)
+{
+	assert(msg != NULL);
+	if (config == NULL)
+	{
+		*msg = SP_CONFIG_INVALID_ARGUMENT;
+		return -1;
+	}
+	*msg = SP_CONFIG_SUCCESS;
+	return config->spIndexCompactionPercent;
+}
+
+SP_CONFIG_MSG spConfigGetLoggerFilename(char* loggerFilename, const SPConfig config)
+{
+	if (config == NULL || loggerFilename == NULL)
+		return SP_CONFIG_INVALID_ARGUMENT;
+	sprintf(loggerFilename, "%s", config->spLoggerFilename);
+	return SP_CONFIG_SUCCESS;
+}
+
+SP_CONFIG_MSG spConfigGetServerSocketPath(char* socketPath, const SPConfig config)
+{
+	if (config == NULL || socketPath == NULL)
+		return SP_CONFIG_INVALID_ARGUMENT;
+	sprintf(socketPath, "%s", config->spServerSocketPath);
+	return SP_CONFIG_SUCCESS;
+}
+
+SP_CONFIG_MSG spConfigGetBatchOutputPath(char* outputPath, const SPConfig config)
+{
+	if (config == NULL || outputPath == NULL)
+		return SP_CONFIG_INVALID_ARGUMENT;
+	sprintf(outputPath, "%s", config->spBatchOutputPath);
+	return SP_CONFIG_SUCCESS;
+}
+
+SP_CONFIG_MSG spConfigGetQueryListPath(char* queryListPath, const SPConfig config)
+{
+	if (config == NULL || queryListPath == NULL)
+		return SP_CONFIG_INVALID_ARGUMENT;
+	sprintf(queryListPath, "%s", config->spQueryListPath);
+	return SP_CONFIG_SUCCESS;
+}
+
+SP_CONFIG_MSG spConfigGetImagePath(char* imagePath, const SPConfig config, int index)
+{
+	if (config == NULL || imagePath == NULL || index < 0)
+		return SP_CONFIG_INVALID_ARGUMENT;
+	if (index >= config->spNumOfImages)
+		return SP_CONFIG_INDEX_OUT_OF_RANGE;
+	sprintf(imagePath, "%s%s%d%s", config->spImagesDirectory, config->spImagesPrefix, index, config->spImagesSuffix);
+	return SP_CONFIG_SUCCESS;
+}
+
+SP_CONFIG_MSG spConfigGetFeatsPath(char * featsPath, const SPConfig config, int index)
+{
+	if (config == NULL || featsPath == NULL || index < 0)
+		return SP_CONFIG_INVALID_ARGUMENT;
+	if (index >= config->spNumOfImages)
+		return SP_CONFIG_INDEX_OUT_OF_RANGE;
+	sprintf(featsPath, "%s%s%d.feats", config->spImagesDirectory, config->spImagesPrefix, index);
+	return SP_CONFIG_SUCCESS;
+}
+
+SP_CONFIG_MSG spConfigGetPCAPath(char* pcaPath, const SPConfig config)
+{
+	if (config == NULL || pcaPath == NULL)
+		return SP_CONFIG_INVALID_ARGUMENT;
+	sprintf(pcaPath, "%s", config->spPCAFilename);
+	return SP_CONFIG_SUCCESS;
+}
+
+SP_CONFIG_MSG spConfigGetManifestPath(char* manifestPath, const SPConfig config)
+{
+	if (config == NULL || manifestPath == NULL)
+		return SP_CONFIG_INVALID_ARGUMENT;
+	sprintf(manifestPath, "%s%s%s", config->spImagesDirectory, config->spImagesPrefix, MANIFEST_SUFFIX);
 	return SP_CONFIG_SUCCESS;
 }
 
@@ -9,6 +9,11 @@
 #include <ctype.h>
 #include "SPKDTree.h"
 #include "SPKDTreeSplitMethod.h"
+#include "SPDecodeScope.h"
+#include "SPPCAFileFormat.h"
+#include "SPDescriptorType.h"
+#include "SPIndexType.h"
+#include "SPQueryMode.h"
 
 /**
  * A data-structure which is used for configuring the system.
@@ -69,6 +74,21 @@ SPConfig spConfigCreate(const char* filename, SP_CONFIG_MSG* msg);
  */
 bool spConfigIsExtractionMode(const SPConfig config, SP_CONFIG_MSG* msg);
 
+/*
+ * Returns true if spIncrementalExtraction = true, false otherwise.
+ * In incremental extraction mode an existing PCA file is reused and only
+ * images which are new or were changed since the last extraction are processed.
+ *
+ * @param config - the configuration structure
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return true if spIncrementalExtraction = true, false otherwise.
+ *
+ * - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+ * - SP_CONFIG_SUCCESS - in case of success
+ */
+bool spConfigIsIncrementalExtraction(const SPConfig config, SP_CONFIG_MSG* msg);
+
 /*
  * Returns true if spMinimalGUI = true, false otherwise.
  *
@@ -135,6 +155,21 @@ int spConfigGetNumOfFeatures(const SPConfig config, SP_CONFIG_MSG* msg);
  */
 int spConfigGetPCADim(const SPConfig config, SP_CONFIG_MSG* msg);
 
+/**
+ * Returns the dimension of the stored features: spPCADimension for SIFT
+ * descriptors, SP_ORB_DESCRIPTOR_BYTES for ORB descriptors, whose every
+ * coordinate holds one byte of the descriptor.
+ *
+ * @param config - the configuration structure
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return positive integer in success, negative integer otherwise.
+ *
+ * - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+ * - SP_CONFIG_SUCCESS - in case of success
+ */
+int spConfigGetFeatureDim(const SPConfig config, SP_CONFIG_MSG* msg);
+
 /**
 * Returns the level of the logger, i.e. the value of spLoggerLevel.
 * 1 indicates error level, 2 indicates warning level, 3 indicates info level,
@@ -176,6 +211,469 @@ int spConfigGetNumOfSimilarImages(const SPConfig config, SP_CONFIG_MSG* msg);
 */
 int spConfigGetKNN(const SPConfig config, SP_CONFIG_MSG* msg);
 
+/**
+* Returns the number of worker threads to use, i.e. the value of spNumOfThreads.
+* 0 means one thread per available core.
+*
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return non-negative integer in success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetNumOfThreads(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the amount of memory, in megabytes, which may hold the SIFT descriptors
+* computed during preprocessing, i.e. the value of spDescriptorCacheMB.
+* Descriptors beyond this amount are spilled to a temporary file.
+*
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return non-negative integer in success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetDescriptorCacheMB(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the percentage of SIFT descriptors used to fit the PCA,
+* i.e. the value of spPCASampleRate. Its value is between 1 and 100.
+*
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer in success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetPCASampleRate(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the maximal length in pixels of the long edge of a decoded image,
+* i.e. the value of spMaxImageEdge. Larger images are scaled down before
+* their features are extracted. 0 means images are used at full resolution.
+*
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return non-negative integer in success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetMaxImageEdge(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the images to which spMaxImageEdge applies: QUERY for the query
+* images only, ALL for both the query images and the database images.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return decode scope on success, default value (ALL) on failure
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+SP_DECODE_SCOPE spConfigGetReducedDecodeScope(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the format in which the PCA file is written in extraction mode:
+* YAML or BINARY. The PCA file is read in either format regardless of it.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return PCA file format on success, default value (YAML) on failure
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+SP_PCA_FILE_FORMAT spConfigGetPCAFileFormat(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the type of the local descriptors extracted from the images:
+* SIFT, reduced by PCA to spPCADimension coordinates, or ORB, binary
+* descriptors of SP_ORB_DESCRIPTOR_BYTES bytes compared by Hamming distance.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return descriptor type on success, default value (SIFT) on failure
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+SP_DESCRIPTOR_TYPE spConfigGetDescriptorType(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the type of the index in which the database features are searched:
+* KD_TREE for SIFT descriptors, MULTI_INDEX_HASHING for ORB descriptors,
+* BRUTE_FORCE, an exact scan for either, HNSW, an approximate graph search
+* for either, IVF_PQ, an approximate search over compressed SIFT features,
+* BAG_OF_WORDS, which ranks images by the visual words of SIFT features, or
+* KMEANS_TREE, an approximate search of a hierarchical k-means tree of SIFT
+* features, LSH, an approximate search of hash tables of SIFT features, or
+* VP_TREE, an exact search of a vantage point tree for either.
+* If spIndexType isn't set, the index matching spDescriptorType is returned.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return index type on success, default value (KD_TREE) on failure
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+SP_INDEX_TYPE spConfigGetIndexType(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the largest database, in features, which is searched by brute force
+* when spIndexType is KD_TREE. Over few features a scan of the whole database
+* is faster than the tree, and both are exact. 0, the default, always uses
+* the tree.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return non negative integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetBruteForceThreshold(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns true if spMeasureRecall = true, false otherwise.
+* When set, the results of the index are compared with an exact brute force
+* search for every query, and the recall is logged.
+* A BAG_OF_WORDS index isn't measured, since it ranks images instead.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return true if spMeasureRecall = true, false otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+bool spConfigIsMeasureRecall(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the number of neighbours every feature is linked to in the upper
+* layers of an HNSW index, twice as many are kept in the bottom layer.
+* More links give a better recall at the cost of memory and build time.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetHNSWM(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the number of candidates kept while searching for the neighbours of
+* a feature inserted into an HNSW index. Larger values build a better graph,
+* slower.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetHNSWEfConstruction(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the number of candidates kept while searching an HNSW index, at
+* least spKNN are kept. Larger values give a better recall, slower.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetHNSWEfSearch(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the number of lists of the coarse quantizer of an IVF_PQ index,
+* i.e. the number of clusters the features are divided into.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetIVFLists(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the number of lists of an IVF_PQ index scanned for every query
+* feature. More lists give a better recall, slower.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetIVFProbes(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the number of subvectors a feature is split into by an IVF_PQ
+* index, every one stored as a byte. At most spPCADimension are used.
+* More subvectors give more accurate distances and larger codes.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetPQSubquantizers(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the number of children of every node of a hierarchical k-means
+* tree: the vocabulary of a BAG_OF_WORDS index, or a KMEANS_TREE index.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetKMeansBranching(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the maximal number of k-means iterations clustering every node of
+* a hierarchical k-means tree. 0 keeps the k-means++ seeds as the centroids.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return non negative integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetKMeansIterations(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the depth of the vocabulary tree of a BAG_OF_WORDS index, so the
+* vocabulary has at most spKMeansBranching^spVocabularyDepth visual words.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetVocabularyDepth(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the number of database features compared with every query feature
+* by a KMEANS_TREE index, whose leaves are searched nearest first until that
+* many were compared. More checks give a better recall, slower.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetKMeansChecks(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the number of hash tables of an LSH index. More tables give a
+* better recall, and take more memory and time.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetLSHTables(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the number of hash functions of every table of an LSH index, whose
+* values together make a bucket. More functions make smaller buckets. At most
+* SP_LSH_MAX_FUNCTIONS (32) are used.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetLSHFunctions(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the width of the buckets of every hash function of an LSH index,
+* in percents of the standard deviation of the projections of the features.
+* Wider buckets hold more features.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetLSHBucketWidth(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the number of buckets of every table of an LSH index probed for
+* every query feature: the query's bucket and the nearest ones to it.
+* More probes give a better recall with the same tables, slower.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetLSHProbes(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the seed from which the hash functions of an LSH index are drawn.
+* The same seed builds the same index, whatever spNumOfThreads is.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return non negative integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetLSHSeed(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns how queries are received: INTERACTIVE reads image paths from the
+* standard input one at a time, SERVER accepts concurrent requests on the
+* Unix domain socket spServerSocketPath, BATCH solves all the image paths
+* listed in spQueryListPath and writes the results to spBatchOutputPath.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return query mode on success, default value (INTERACTIVE) on failure
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+SP_QUERY_MODE spConfigGetQueryMode(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the number of worker threads which handle the requests of the
+* query server, in SERVER query mode.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetServerWorkers(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the number of requests the query server admits while all its
+* workers are busy. Further requests are rejected until one is handled,
+* so the work in flight stays bounded.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetServerQueueSize(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns how long, in microseconds, the query server gathers the queries
+* which arrive together into one batch, which is searched at once. 0 searches
+* every query by itself.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return non-negative integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetBatchWindow(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the maximal number of queries in a batch of the query server. A
+* batch which fills up is searched without waiting for the rest of the
+* batch window.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return positive integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetMaxBatchSize(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the memory of the cache of query features and results, in
+* kilobytes, so a query image which is sent again isn't extracted or searched
+* again. 0 disables the cache.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return non-negative integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetQueryCacheMemory(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the number of features inserted into a running index above which
+* they're merged into a freshly built main index in the background, until
+* then they're searched by brute force. 0 never merges. An IVF_PQ index
+* isn't built again, the inserted features are encoded into it instead.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return non-negative integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetIndexMergeThreshold(const SPConfig config, SP_CONFIG_MSG* msg);
+
+/**
+* Returns the percentage of the features of an index which may belong to
+* deleted images before the index is compacted in the background: rebuilt
+* without them. 0 never compacts.
+* @param config - the configuration structure
+* @assert msg != NULL
+* @param msg - pointer in which the msg returned by the function is stored
+* @return non-negative integer on success, negative integer otherwise.
+*
+* - SP_CONFIG_INVALID_ARGUMENT - if config == NULL
+* - SP_CONFIG_SUCCESS - in case of success
+*/
+int spConfigGetIndexCompactionPercent(const SPConfig config, SP_CONFIG_MSG* msg);
+
 /**
 * The function stores in loggerFilename the value of spLoggerFilename.
 * Thus the address given by loggerFilename must contain enough space to
@@ -189,6 +687,48 @@ int spConfigGetKNN(const SPConfig config, SP_CONFIG_MSG* msg);
 */
 SP_CONFIG_MSG spConfigGetLoggerFilename(char* loggerFilename, const SPConfig config);
 
+/**
+* The function stores in socketPath the value of spServerSocketPath, the path
+* of the Unix domain socket on which the query server listens in SERVER
+* query mode. Thus the address given by socketPath must contain enough space
+* to store the resulting string.
+*
+* @param socketPath - an address to store the result in, it must contain enough space
+* @param config - the configuration structure
+* @return
+*  - SP_CONFIG_INVALID_ARGUMENT - if socketPath == NULL or config == NULL
+*  - SP_CONFIG_SUCCESS - in case of success
+*/
+SP_CONFIG_MSG spConfigGetServerSocketPath(char* socketPath, const SPConfig config);
+
+/**
+* The function stores in queryListPath the value of spQueryListPath, the file
+* from which BATCH query mode reads the image paths to query, one per line,
+* or "stdin" for the standard input. Thus the address given by queryListPath
+* must contain enough space to store the resulting string.
+*
+* @param queryListPath - an address to store the result in, it must contain enough space
+* @param config - the configuration structure
+* @return
+*  - SP_CONFIG_INVALID_ARGUMENT - if queryListPath == NULL or config == NULL
+*  - SP_CONFIG_SUCCESS - in case of success
+*/
+SP_CONFIG_MSG spConfigGetQueryListPath(char* queryListPath, const SPConfig config);
+
+/**
+* The function stores in outputPath the value of spBatchOutputPath, the file
+* to which the results of BATCH query mode are written, or "stdout" for the
+* standard output. Thus the address given by outputPath must contain enough
+* space to store the resulting string.
+*
+* @param outputPath - an address to store the result in, it must contain enough space
+* @param config - the configuration structure
+* @return
+*  - SP_CONFIG_INVALID_ARGUMENT - if outputPath == NULL or config == NULL
+*  - SP_CONFIG_SUCCESS - in case of success
+*/
+SP_CONFIG_MSG spConfigGetBatchOutputPath(char* outputPath, const SPConfig config);
+
 /**
  * Given an index 'index' the function stores in imagePath the full path of the
  * ith image.
@@ -253,6 +793,23 @@ SP_CONFIG_MSG spConfigGetFeatsPath(char* featsPath, const SPConfig config,
  */
 SP_CONFIG_MSG spConfigGetPCAPath(char* pcaPath, const SPConfig config);
 
+/**
+ * The function stores in manifestPath the full path of the extraction manifest.
+ * For example given the values of:
+ *  spImagesDirectory = "./images/"
+ *  spImagesPrefix = "img"
+ *
+ * The functions stores "./images/img.manifest" to the address given by manifestPath.
+ * Thus the address given by manifestPath must contain enough space to
+ * store the resulting string.
+ *
+ * @param manifestPath - an address to store the result in, it must contain enough space.
+ * @param config - the configuration structure
+ * @return
+ *  - SP_CONFIG_INVALID_ARGUMENT - if manifestPath == NULL or config == NULL
+ *  - SP_CONFIG_SUCCESS - in case of success
+ */
+SP_CONFIG_MSG spConfigGetManifestPath(char* manifestPath, const SPConfig config);
 
 /**
  * Frees all memory resources associate with config. 
@@ -25,67 +25,63 @@ bool spDatabaseManagerSave(SPConfig config, int index, int featuresAmount, SPPoi
 	char featsPath[STRING_LEN];
 	FILE *file;
 	int dim;
+	size_t size;
+	bool success;
 	SP_CONFIG_MSG msg = SP_CONFIG_SUCCESS;
-	double *coordinate = (double*) malloc(sizeof(double));
-	char* charCoordinate; // Used to change a double to a char array
-	char* charFeaturesAmount; // Used to change an int to a char array
-	
-	if(coordinate == NULL)
-	{
-		free(coordinate);
-		return 0;
-	}
+	double coordinate;
+	char* buffer; // The whole file, written with a single fwrite
+	char* position;
+	char* charCoordinate = (char*) &coordinate; // Used to change a double to a char array
+	char* charFeaturesAmount = (char*) &featuresAmount; // Used to change an int to a char array
 
 	if(spConfigGetFeatsPath(featsPath, config, index) != SP_CONFIG_SUCCESS)
-	{
-		free(coordinate);
 		return 0;
-	}
 
-	dim = spConfigGetPCADim(config, &msg);
+	dim = spConfigGetFeatureDim(config, &msg);
 	if(msg != SP_CONFIG_SUCCESS)
-	{
-		free(coordinate);
 		return 0;
-	}
 
-	file = fopen(featsPath, "w");
-	if(file == NULL)
-	{		
-		free(coordinate);
+	size = sizeof(int) + (size_t) featuresAmount * dim * sizeof(double);
+	buffer = (char*) malloc(size);
+	if(buffer == NULL)
 		return 0;
-	}
-	
-	charFeaturesAmount = (char*) &featuresAmount;
+
+	position = buffer;
 	for(k = 0; k < (int) (sizeof(int) / sizeof(char)); k++)
 	{
 		if(is_bigendian())
-			fputc(charFeaturesAmount[sizeof(int) / sizeof(char) - k - 1], file);
+			*position++ = charFeaturesAmount[sizeof(int) / sizeof(char) - k - 1];
 		else
-			fputc(charFeaturesAmount[k], file);
+			*position++ = charFeaturesAmount[k];
 	}
 	for(i = 0; i < featuresAmount; i++)
 	{
 		for(j = 0; j < dim; j++)
 		{
-			*coordinate = spPointGetAxisCoor(features[i], j);
-			charCoordinate = (char*) coordinate;
+			coordinate = spPointGetAxisCoor(features[i], j);
 			for(k = 0; k < (int) (sizeof(double) / sizeof(char)); k++)
 			{
 				if(is_bigendian())
-					fputc(charCoordinate[sizeof(double) / sizeof(char) - k - 1], file);
+					*position++ = charCoordinate[sizeof(double) / sizeof(char) - k - 1];
 				else
-					fputc(charCoordinate[k], file);
+					*position++ = charCoordinate[k];
 			}
 		}
 	}
 
-	fflush(file);
-	fclose(file);
-	
-	free(coordinate);
+	file = fopen(featsPath, "w");
+	if(file == NULL)
+	{
+		free(buffer);
+		return 0;
+	}
+	success = fwrite(buffer, 1, size, file) == size;
+	if(fclose(file) != 0)
+		success = false;
+
+	free(buffer);
 
-	return 1;
+	return success;
 }
 
 SPPoint* spDatabaseManagerLoad(SPConfig config, int index, int* featuresAmount)
@@ -119,7 +115,7 @@ SPPoint* spDatabaseManagerLoad(SPConfig config, int index, int* featuresAmount)
 		return NULL;
 	}
 
-	dim = spConfigGetPCADim(config, &msg);
+	dim = spConfigGetFeatureDim(config, &msg);
 	if(msg != SP_CONFIG_SUCCESS)
 	{		
 		free(charFeaturesAmount);
@@ -208,3 +204,46 @@ SPPoint* spDatabaseManagerLoad(SPConfig config, int index, int* featuresAmount)
 	
 	return result;
 }
+
+int spDatabaseManagerLoadAmount(SPConfig config, int index)
+{
+	int k;
+	int ind;
+	int dim;
+	int featuresAmount;
+	long size;
+	char featsPath[STRING_LEN];
+	char* charFeaturesAmount = (char*) &featuresAmount; // Used to change chars into an int
+	FILE *file;
+	SP_CONFIG_MSG msg = SP_CONFIG_SUCCESS;
+
+	if(spConfigGetFeatsPath(featsPath, config, index) != SP_CONFIG_SUCCESS)
+		return -1;
+
+	dim = spConfigGetFeatureDim(config, &msg);
+	if(msg != SP_CONFIG_SUCCESS)
+		return -1;
+
+	file = fopen(featsPath, "r");
+	if(file == NULL)
+		return -1;
+
+	for(k = 0; k < (int) (sizeof(int) / sizeof(char)); k++)
+	{
+		if(is_bigendian())
+			ind = sizeof(int) / sizeof(char) - k - 1;
+		else
+			ind = k;
+		charFeaturesAmount[ind] = fgetc(file);
+	}
+
+	// The features themselves aren't read, the size of the file tells whether they're all there
+	if(feof(file) || featuresAmount < 0 || fseek(file, 0, SEEK_END) != 0
+			|| (size = ftell(file)) < 0
+			|| (size_t) size != sizeof(int) + (size_t) featuresAmount * dim * sizeof(double))
+		featuresAmount = -1;
+
+	fclose(file);
+
+	return featuresAmount;
+}
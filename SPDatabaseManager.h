@@ -30,4 +30,16 @@ bool spDatabaseManagerSave(SPConfig config, int index, int featuresAmount, SPPoi
 */
 SPPoint* spDatabaseManagerLoad(SPConfig config, int index, int* featuresAmount);
 
+/*
+ * Reads the amount of features in a .feats file without decoding them, and
+ * checks the file holds exactly that many features
+ * The .feats file path is spConfigGetFeatsPath for the given image index
+ *
+ * @param config - the configuration file
+ * @param index - the index of the image
+ * @return  The amount of features - on success
+			-1 - if an error occurred or the file is truncated
+*/
+int spDatabaseManagerLoadAmount(SPConfig config, int index);
+
 #endif
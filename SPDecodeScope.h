@@ -0,0 +1,9 @@
+#ifndef SPDECODESCOPE_H_
+#define SPDECODESCOPE_H_
+
+typedef enum sp_decode_scope_t {
+	SP_DECODE_QUERY,
+	SP_DECODE_ALL
+} SP_DECODE_SCOPE;
+
+#endif /* SPDECODESCOPE_H_ */
@@ -0,0 +1,12 @@
+#ifndef SPDESCRIPTORTYPE_H_
+#define SPDESCRIPTORTYPE_H_
+
+// The length in bytes of a binary ORB descriptor
+#define SP_ORB_DESCRIPTOR_BYTES 32
+
+typedef enum sp_descriptor_type_t {
+	SP_DESCRIPTOR_SIFT,
+	SP_DESCRIPTOR_ORB
+} SP_DESCRIPTOR_TYPE;
+
+#endif /* SPDESCRIPTORTYPE_H_ */
@@ -0,0 +1,341 @@
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "SPFeatureExtractor.h"
+extern "C" {
+#include "SPLogger.h"
+#include "SPDatabaseManager.h"
+#include "SPHash.h"
+}
+
+#define STRING_LENGTH 1024
+#define QUEUE_SLOTS_PER_THREAD 2
+
+#define IMAGE_PATH_ERROR "Image path couldn't be resolved"
+#define FEATS_PATH_ERROR "Features file path couldn't be resolved"
+#define PCA_FILE_NOT_RESOLVED "PCA file couldn't be read"
+#define MANIFEST_ERROR "Extraction manifest couldn't be created"
+#define READ_ERROR "Failed to read image file"
+#define DECODE_ERROR "Failed to decode image"
+#define EXTRACT_ERROR "Failed to extract image features"
+#define SAVE_ERROR "Failed to save features to database"
+#define MANIFEST_UPDATE_WARNING "Extraction manifest entry couldn't be updated"
+#define MANIFEST_SAVE_WARNING "Extraction manifest couldn't be saved"
+#define EXTRACTED_INFO "Extracted the features of %d images using %d threads in %.2f seconds (%.1f images per second)"
+#define MAX_EDGE_INFO "Database images were scaled to a long edge of at most %d pixels"
+#define REUSED_INFO "Reused the features of %d out of %d images"
+#define STAGE_INFO "Stage %s: %d threads, %.0f%% busy"
+#define STAGE_QUEUE_INFO "Stage %s: %d threads, %.0f%% busy, input queue depth %.1f on average, %d at most, capacity %d"
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* stageNames[] = { "read", "decode", "features", "write" };
+
+static long long elapsedNanos(Clock::time_point start) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			Clock::now() - start).count();
+}
+
+sp::FeatureExtractor::FeatureExtractor(const SPConfig config, ImageProc* imgProc) :
+		config(config), imgProc(imgProc), manifest(NULL), reusedAmount(0),
+		failed(false) {
+	SP_CONFIG_MSG msg = SP_CONFIG_SUCCESS;
+	numOfImages = spConfigGetNumOfImages(config, &msg);
+	incremental = spConfigIsIncrementalExtraction(config, &msg);
+	numOfThreads = spConfigGetNumOfThreads(config, &msg);
+	if (numOfThreads <= 0) {
+		numOfThreads = (int) std::thread::hardware_concurrency();
+	}
+	if (numOfThreads > numOfImages) {
+		numOfThreads = numOfImages;
+	}
+	if (numOfThreads <= 0) {
+		numOfThreads = 1;
+	}
+	// Decoding is cheaper than SIFT, half the threads keep up with it
+	numOfDecodeThreads = numOfThreads / 2 > 0 ? numOfThreads / 2 : 1;
+	for (int i = 0; i < STAGES_AMOUNT; i++) {
+		stageBusyTime[i] = 0;
+	}
+}
+
+bool sp::FeatureExtractor::getStateHash(unsigned long long* stateHash) {
+	// The .feats files depend on the descriptor type, the PCA basis and the
+	// configured dimensions
+	SP_CONFIG_MSG msg = SP_CONFIG_SUCCESS;
+	char pcaPath[STRING_LENGTH + 1] = { '\0' };
+	int pcaDim = spConfigGetPCADim(config, &msg);
+	int numOfFeatures = spConfigGetNumOfFeatures(config, &msg);
+	int maxEdge = spConfigGetMaxImageEdge(config, &msg);
+	if (spConfigGetReducedDecodeScope(config, &msg) != SP_DECODE_ALL) {
+		maxEdge = 0;
+	}
+	SP_DESCRIPTOR_TYPE descriptorType = spConfigGetDescriptorType(config, &msg);
+	*stateHash = SP_HASH_SEED;
+	if (descriptorType == SP_DESCRIPTOR_SIFT
+			&& (spConfigGetPCAPath(pcaPath, config) != SP_CONFIG_SUCCESS
+					|| !spHashFile(pcaPath, stateHash))) {
+		return false;
+	}
+	*stateHash = spHashBytes(&descriptorType, sizeof(descriptorType), *stateHash);
+	*stateHash = spHashBytes(&pcaDim, sizeof(pcaDim), *stateHash);
+	*stateHash = spHashBytes(&numOfFeatures, sizeof(numOfFeatures), *stateHash);
+	*stateHash = spHashBytes(&maxEdge, sizeof(maxEdge), *stateHash);
+	return true;
+}
+
+void sp::FeatureExtractor::destroyFeatures(int index) {
+	if (featuresByImage[index] == NULL) {
+		return;
+	}
+	for (int j = 0; j < featuresAmount[index]; j++) {
+		spPointDestroy(featuresByImage[index][j]);
+	}
+	free(featuresByImage[index]);
+	featuresByImage[index] = NULL;
+}
+
+bool sp::FeatureExtractor::readImageFile(const char* imagePath,
+		std::vector<unsigned char>& bytes) {
+	FILE* file = fopen(imagePath, "rb");
+	if (!file) {
+		return false;
+	}
+	long size = -1;
+	if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) > 0
+			&& fseek(file, 0, SEEK_SET) == 0) {
+		bytes.resize(size);
+		if (fread(bytes.data(), 1, size, file) != (size_t) size) {
+			size = -1;
+		}
+	}
+	fclose(file);
+	return size > 0;
+}
+
+void sp::FeatureExtractor::fail() {
+	// Closing the queues releases every stage waiting on them
+	failed = true;
+	decodeQueue->close();
+	featuresQueue->close();
+	writeQueue->close();
+}
+
+void sp::FeatureExtractor::readStage() {
+	char imagePath[STRING_LENGTH + 1] = { '\0' };
+	char featsPath[STRING_LENGTH + 1] = { '\0' };
+	for (int index = 0; index < numOfImages && !failed; index++) {
+		Clock::time_point start = Clock::now();
+		if (spConfigGetImagePath(imagePath, config, index) != SP_CONFIG_SUCCESS) {
+			spLoggerPrintError(IMAGE_PATH_ERROR, __FILE__, __func__, __LINE__);
+			fail();
+			return;
+		}
+		if (spConfigGetFeatsPath(featsPath, config, index) != SP_CONFIG_SUCCESS) {
+			spLoggerPrintError(FEATS_PATH_ERROR, __FILE__, __func__, __LINE__);
+			fail();
+			return;
+		}
+
+		if (manifest && spManifestIsUpToDate(manifest, index, imagePath, featsPath)) {
+			if (spDatabaseManagerLoadAmount(config, index) >= 0) {
+				reusedAmount++;
+				stageBusyTime[READ_STAGE] += elapsedNanos(start);
+				continue;
+			}
+			// The .feats file is unreadable, extract the image again
+		}
+
+		ExtractionJob job;
+		job.index = index;
+		job.imagePath = imagePath;
+		// Images whose descriptors were kept by preprocessing aren't decoded
+		bool decoded = imgProc->hasRawDescriptors(index, imagePath);
+		if (!decoded && !readImageFile(imagePath, job.bytes)) {
+			spLoggerPrintError(READ_ERROR, __FILE__, __func__, __LINE__);
+			fail();
+			return;
+		}
+		stageBusyTime[READ_STAGE] += elapsedNanos(start);
+		if (!(decoded ? featuresQueue : decodeQueue)->push(std::move(job))) {
+			return;
+		}
+	}
+}
+
+void sp::FeatureExtractor::decodeStage() {
+	ExtractionJob job;
+	while (decodeQueue->pop(job)) {
+		Clock::time_point start = Clock::now();
+		bool decoded = imgProc->decodeImage(job.bytes, job.image);
+		job.bytes = std::vector<unsigned char>();
+		stageBusyTime[DECODE_STAGE] += elapsedNanos(start);
+		if (!decoded) {
+			spLoggerPrintError(DECODE_ERROR, __FILE__, __func__, __LINE__);
+			fail();
+			return;
+		}
+		if (!featuresQueue->push(std::move(job))) {
+			return;
+		}
+	}
+}
+
+void sp::FeatureExtractor::featuresStage() {
+	ExtractionJob job;
+	while (featuresQueue->pop(job)) {
+		Clock::time_point start = Clock::now();
+		int index = job.index;
+		featuresByImage[index] = imgProc->getImageFeatures(job.image,
+				job.imagePath.c_str(), index, &featuresAmount[index]);
+		job.image.release();
+		stageBusyTime[FEATURES_STAGE] += elapsedNanos(start);
+		if (featuresByImage[index] == NULL) {
+			featuresAmount[index] = 0;
+			spLoggerPrintError(EXTRACT_ERROR, __FILE__, __func__, __LINE__);
+			fail();
+			return;
+		}
+		if (!writeQueue->push(std::move(index))) {
+			return;
+		}
+	}
+}
+
+void sp::FeatureExtractor::writeStage() {
+	char imagePath[STRING_LENGTH + 1] = { '\0' };
+	char featsPath[STRING_LENGTH + 1] = { '\0' };
+	int index;
+	while (writeQueue->pop(index)) {
+		Clock::time_point start = Clock::now();
+		bool saved = spDatabaseManagerSave(config, index, featuresAmount[index],
+				featuresByImage[index]);
+		destroyFeatures(index);
+		if (!saved) {
+			spLoggerPrintError(SAVE_ERROR, __FILE__, __func__, __LINE__);
+			fail();
+			return;
+		}
+		if (manifest && (spConfigGetImagePath(imagePath, config, index) != SP_CONFIG_SUCCESS
+				|| spConfigGetFeatsPath(featsPath, config, index) != SP_CONFIG_SUCCESS
+				|| spManifestUpdate(manifest, index, imagePath, featsPath)
+						!= SP_MANIFEST_SUCCESS)) {
+			spLoggerPrintWarning(MANIFEST_UPDATE_WARNING, __FILE__, __func__, __LINE__);
+		}
+		stageBusyTime[WRITE_STAGE] += elapsedNanos(start);
+	}
+}
+
+void sp::FeatureExtractor::logStageStats(double seconds) {
+	char infoMSG[STRING_LENGTH] = { '\0' };
+	int threads[] = { 1, numOfDecodeThreads, numOfThreads, 1 };
+	BoundedQueue<ExtractionJob>* jobQueues[] = { NULL, decodeQueue.get(),
+			featuresQueue.get() };
+	for (int i = 0; i < STAGES_AMOUNT; i++) {
+		double busy = seconds > 0 ?
+				100.0 * stageBusyTime[i] / (seconds * 1e9 * threads[i]) : 0.0;
+		if (i == READ_STAGE) {
+			sprintf(infoMSG, STAGE_INFO, stageNames[i], threads[i], busy);
+		} else if (i == WRITE_STAGE) {
+			sprintf(infoMSG, STAGE_QUEUE_INFO, stageNames[i], threads[i], busy,
+					writeQueue->getAverageDepth(), (int) writeQueue->getMaxDepth(),
+					(int) writeQueue->getCapacity());
+		} else {
+			sprintf(infoMSG, STAGE_QUEUE_INFO, stageNames[i], threads[i], busy,
+					jobQueues[i]->getAverageDepth(), (int) jobQueues[i]->getMaxDepth(),
+					(int) jobQueues[i]->getCapacity());
+		}
+		spLoggerPrintInfo(infoMSG);
+	}
+}
+
+bool sp::FeatureExtractor::extractAll() {
+	SP_MANIFEST_MSG manifestMsg = SP_MANIFEST_SUCCESS;
+	SP_CONFIG_MSG configMsg = SP_CONFIG_SUCCESS;
+	unsigned long long stateHash = 0;
+	char manifestPath[STRING_LENGTH + 1] = { '\0' };
+	char infoMSG[STRING_LENGTH] = { '\0' };
+	std::vector<std::thread> decoders, extractors;
+
+	if (incremental) {
+		if (!getStateHash(&stateHash)) {
+			spLoggerPrintError(PCA_FILE_NOT_RESOLVED, __FILE__, __func__, __LINE__);
+			return false;
+		}
+		if (spConfigGetManifestPath(manifestPath, config) != SP_CONFIG_SUCCESS
+				|| (manifest = spManifestCreate(manifestPath, numOfImages,
+						stateHash, &manifestMsg)) == NULL) {
+			spLoggerPrintError(MANIFEST_ERROR, __FILE__, __func__, __LINE__);
+			return false;
+		}
+	}
+
+	featuresByImage.assign(numOfImages, NULL);
+	featuresAmount.assign(numOfImages, 0);
+	for (int i = 0; i < STAGES_AMOUNT; i++) {
+		stageBusyTime[i] = 0;
+	}
+	reusedAmount = 0;
+	failed = false;
+	size_t capacity = (size_t) numOfThreads * QUEUE_SLOTS_PER_THREAD;
+	decodeQueue.reset(new BoundedQueue<ExtractionJob>(capacity));
+	featuresQueue.reset(new BoundedQueue<ExtractionJob>(capacity));
+	writeQueue.reset(new BoundedQueue<int>(capacity));
+
+	// Every stage's queue is closed once all the stages feeding it are done
+	Clock::time_point start = Clock::now();
+	std::thread reader(&FeatureExtractor::readStage, this);
+	for (int i = 0; i < numOfDecodeThreads; i++) {
+		decoders.push_back(std::thread(&FeatureExtractor::decodeStage, this));
+	}
+	for (int i = 0; i < numOfThreads; i++) {
+		extractors.push_back(std::thread(&FeatureExtractor::featuresStage, this));
+	}
+	std::thread writer(&FeatureExtractor::writeStage, this);
+	reader.join();
+	decodeQueue->close();
+	for (size_t i = 0; i < decoders.size(); i++) {
+		decoders[i].join();
+	}
+	featuresQueue->close();
+	for (size_t i = 0; i < extractors.size(); i++) {
+		extractors[i].join();
+	}
+	writeQueue->close();
+	writer.join();
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	if (manifest) {
+		// A failed run still records the images which were extracted
+		if (spManifestSave(manifest, manifestPath) != SP_MANIFEST_SUCCESS) {
+			spLoggerPrintWarning(MANIFEST_SAVE_WARNING, __FILE__, __func__, __LINE__);
+		}
+		spManifestDestroy(manifest);
+		manifest = NULL;
+	}
+	// The features of the images which weren't saved are left after a failure
+	for (int i = 0; i < numOfImages; i++) {
+		destroyFeatures(i);
+	}
+	if (failed) {
+		return false;
+	}
+
+	int extractedAmount = numOfImages - reusedAmount;
+	sprintf(infoMSG, EXTRACTED_INFO, extractedAmount, numOfThreads, seconds,
+			seconds > 0 ? extractedAmount / seconds : 0.0);
+	spLoggerPrintInfo(infoMSG);
+	logStageStats(seconds);
+	int maxEdge = spConfigGetMaxImageEdge(config, &configMsg);
+	if (maxEdge > 0 && spConfigGetReducedDecodeScope(config, &configMsg) == SP_DECODE_ALL) {
+		sprintf(infoMSG, MAX_EDGE_INFO, maxEdge);
+		spLoggerPrintInfo(infoMSG);
+	}
+	if (incremental) {
+		sprintf(infoMSG, REUSED_INFO, (int) reusedAmount, numOfImages);
+		spLoggerPrintInfo(infoMSG);
+	}
+	return true;
+}
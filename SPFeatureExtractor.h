@@ -0,0 +1,103 @@
+#ifndef SPFEATUREEXTRACTOR_H_
+#define SPFEATUREEXTRACTOR_H_
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "SPBoundedQueue.h"
+#include "SPImageProc.h"
+
+extern "C" {
+#include "SPConfig.h"
+#include "SPPoint.h"
+#include "SPManifest.h"
+}
+
+namespace sp {
+
+/**
+ * Extracts the features of all the images in the database and saves each
+ * image's features to its .feats file.
+ *
+ * Extraction runs as a pipeline of four stages connected by bounded queues,
+ * so disk reads and writes overlap with the computation:
+ * - read: a single thread which reads the content of every image file
+ * - decode: a pool of threads which decode the images
+ * - features: a pool of spNumOfThreads threads which run SIFT and the PCA
+ *   projection (images whose descriptors were kept by preprocessing skip
+ *   the read and decode stages)
+ * - write: a single thread which saves the .feats files
+ * The queues hold a few images per thread, so memory stays bounded however
+ * large the database is. Every stage's utilization and input queue depth is
+ * logged when extraction ends. Every image is processed independently, so
+ * the results are identical to a serial run.
+ *
+ * The features of every image are freed as soon as they're saved, so the
+ * features of the whole database are never in memory, they're loaded from
+ * the .feats files afterwards (see IndexLoader).
+ *
+ * In incremental extraction mode (spIncrementalExtraction = true) an
+ * extraction manifest is kept next to the .feats files. Only images which are
+ * new or were changed since the last extraction are processed, the .feats
+ * files of all other images are kept.
+ */
+class FeatureExtractor {
+private:
+	// An image on its way through the pipeline
+	struct ExtractionJob {
+		int index;
+		std::string imagePath;
+		std::vector<unsigned char> bytes;
+		cv::Mat image;
+	};
+	enum Stage {
+		READ_STAGE, DECODE_STAGE, FEATURES_STAGE, WRITE_STAGE, STAGES_AMOUNT
+	};
+	SPConfig config;
+	ImageProc* imgProc;
+	int numOfImages;
+	int numOfThreads;
+	int numOfDecodeThreads;
+	bool incremental;
+	SPManifest manifest;
+	std::vector<SPPoint*> featuresByImage;
+	std::vector<int> featuresAmount;
+	std::unique_ptr<BoundedQueue<ExtractionJob> > decodeQueue;
+	std::unique_ptr<BoundedQueue<ExtractionJob> > featuresQueue;
+	std::unique_ptr<BoundedQueue<int> > writeQueue;
+	std::atomic<long long> stageBusyTime[STAGES_AMOUNT];
+	std::atomic<int> reusedAmount;
+	std::atomic<bool> failed;
+	bool getStateHash(unsigned long long* stateHash);
+	bool readImageFile(const char* imagePath, std::vector<unsigned char>& bytes);
+	void fail();
+	void readStage();
+	void decodeStage();
+	void featuresStage();
+	void writeStage();
+	void logStageStats(double seconds);
+	void destroyFeatures(int index);
+public:
+
+	/**
+	 * Creates a new extractor based on the configuration file.
+	 * @param config - the configuration file
+	 * @param imgProc - the image processor used to extract features, its PCA
+	 * 					must already be initialized
+	 */
+	FeatureExtractor(const SPConfig config, ImageProc* imgProc);
+
+	/**
+	 * Extracts the features of every image in the database which isn't up to
+	 * date and saves them to its .feats file, so the .feats files of all the
+	 * images can be loaded afterwards.
+	 *
+	 * @return
+	 * true on success. false if an error occurred.
+	 */
+	bool extractAll();
+};
+
+}
+#endif
@@ -0,0 +1,600 @@
+#define _POSIX_C_SOURCE 200809L // For sysconf
+#include <math.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "SPHNSW.h"
+
+#define LEVEL_SEED 0x9E3779B97F4A7C15ULL
+#define MAX_LEVEL 16
+#define MIN_HEAP_CAPACITY 64
+#define MIN_VISITED_CAPACITY 256
+#define EMPTY_SLOT (-1)
+
+typedef struct sp_hnsw_candidate_t
+{
+	double distance;
+	int node;
+} SPHNSWCandidate;
+
+/*
+ * A binary heap of candidates, the nearest on top if sign is 1 and the
+ * farthest on top if sign is -1.
+ */
+typedef struct sp_hnsw_heap_t
+{
+	SPHNSWCandidate* items;
+	int size;
+	int capacity;
+	int sign;
+} SPHNSWHeap;
+
+/*
+ * The nodes visited by a search, an open addressing hash set.
+ */
+typedef struct sp_hnsw_visited_t
+{
+	int* nodes;
+	int size;
+	int capacity;
+} SPHNSWVisited;
+
+/*
+ * The memory a search works in, allocated once per query feature or per
+ * inserting thread.
+ */
+typedef struct sp_hnsw_search_t
+{
+	SPHNSWHeap candidates; // to expand, nearest on top
+	SPHNSWHeap results;    // the 'ef' nearest found, farthest on top
+	SPHNSWVisited visited;
+	int* neighbours;       // the links of the expanded node
+	int* selected;         // the links chosen for a new node
+	int* reselected;       // the links kept by a node which had too many
+	SPHNSWCandidate* pruned;
+} SPHNSWSearch;
+
+struct sp_hnsw_t
+{
+	SPPointStore store;
+	int size;
+	int M;
+	int maxM0;
+	int efConstruction;
+	int* levels;
+	size_t* linkOffsets; // where the links of every node start in links
+	int* links;          // per node and level, a count followed by the neighbours
+	pthread_mutex_t* locks;
+	pthread_mutex_t entryLock;
+	int entryPoint;
+	int maxLevel;
+	pthread_mutex_t nextLock;
+	int next;
+	bool failed;
+};
+
+static bool heapInit(SPHNSWHeap* heap, int sign)
+{
+	heap->size = 0;
+	heap->capacity = MIN_HEAP_CAPACITY;
+	heap->sign = sign;
+	heap->items = (SPHNSWCandidate*) malloc(heap->capacity * sizeof(SPHNSWCandidate));
+	return heap->items != NULL;
+}
+
+static bool heapAbove(const SPHNSWHeap* heap, SPHNSWCandidate a, SPHNSWCandidate b)
+{
+	return heap->sign * (a.distance - b.distance) < 0;
+}
+
+static bool heapPush(SPHNSWHeap* heap, SPHNSWCandidate candidate)
+{
+	int i, parent;
+	SPHNSWCandidate* items;
+	if (heap->size == heap->capacity)
+	{
+		items = (SPHNSWCandidate*) realloc(heap->items,
+				2 * heap->capacity * sizeof(SPHNSWCandidate));
+		if (items == NULL)
+			return false;
+		heap->items = items;
+		heap->capacity *= 2;
+	}
+	for (i = heap->size++; i > 0; i = parent)
+	{
+		parent = (i - 1) / 2;
+		if (!heapAbove(heap, candidate, heap->items[parent]))
+			break;
+		heap->items[i] = heap->items[parent];
+	}
+	heap->items[i] = candidate;
+	return true;
+}
+
+static SPHNSWCandidate heapPop(SPHNSWHeap* heap)
+{
+	int i = 0, child;
+	SPHNSWCandidate top = heap->items[0], last = heap->items[--heap->size];
+	while ((child = 2 * i + 1) < heap->size)
+	{
+		if (child + 1 < heap->size && heapAbove(heap, heap->items[child + 1], heap->items[child]))
+			child++;
+		if (!heapAbove(heap, heap->items[child], last))
+			break;
+		heap->items[i] = heap->items[child];
+		i = child;
+	}
+	heap->items[i] = last;
+	return top;
+}
+
+static int candidateComp(const void* a, const void* b)
+{
+	double x = ((const SPHNSWCandidate*) a)->distance;
+	double y = ((const SPHNSWCandidate*) b)->distance;
+	return (x > y) - (x < y);
+}
+
+static void visitedClear(SPHNSWVisited* visited)
+{
+	visited->size = 0;
+	memset(visited->nodes, EMPTY_SLOT, visited->capacity * sizeof(int));
+}
+
+static bool visitedInit(SPHNSWVisited* visited)
+{
+	visited->capacity = MIN_VISITED_CAPACITY;
+	visited->nodes = (int*) malloc(visited->capacity * sizeof(int));
+	if (visited->nodes == NULL)
+		return false;
+	visitedClear(visited);
+	return true;
+}
+
+static int* visitedSlot(int* nodes, int capacity, int node)
+{
+	unsigned int i = ((unsigned int) node * 2654435761u) & (capacity - 1);
+	while (nodes[i] != EMPTY_SLOT && nodes[i] != node)
+		i = (i + 1) & (capacity - 1);
+	return nodes + i;
+}
+
+/*
+ * Marks node as visited. Stores in isNew whether it wasn't visited before.
+ * Returns false on an allocation failure.
+ */
+static bool visitedAdd(SPHNSWVisited* visited, int node, bool* isNew)
+{
+	int i, *nodes, *slot;
+	if (2 * (visited->size + 1) > visited->capacity)
+	{
+		nodes = (int*) malloc(2 * visited->capacity * sizeof(int));
+		if (nodes == NULL)
+			return false;
+		memset(nodes, EMPTY_SLOT, 2 * visited->capacity * sizeof(int));
+		for (i = 0; i < visited->capacity; i++)
+			if (visited->nodes[i] != EMPTY_SLOT)
+				*visitedSlot(nodes, 2 * visited->capacity, visited->nodes[i]) = visited->nodes[i];
+		free(visited->nodes);
+		visited->nodes = nodes;
+		visited->capacity *= 2;
+	}
+	slot = visitedSlot(visited->nodes, visited->capacity, node);
+	*isNew = *slot == EMPTY_SLOT;
+	if (*isNew)
+	{
+		*slot = node;
+		visited->size++;
+	}
+	return true;
+}
+
+static void searchDestroy(SPHNSWSearch* search)
+{
+	free(search->candidates.items);
+	free(search->results.items);
+	free(search->visited.nodes);
+	free(search->neighbours);
+	free(search->selected);
+	free(search->reselected);
+	free(search->pruned);
+}
+
+static bool searchInit(SPHNSWSearch* search, SPHNSW hnsw)
+{
+	memset(search, 0, sizeof(*search));
+	search->neighbours = (int*) malloc(hnsw->maxM0 * sizeof(int));
+	search->selected = (int*) malloc(hnsw->maxM0 * sizeof(int));
+	search->reselected = (int*) malloc(hnsw->maxM0 * sizeof(int));
+	search->pruned = (SPHNSWCandidate*) malloc((hnsw->maxM0 + 1) * sizeof(SPHNSWCandidate));
+	if (!heapInit(&search->candidates, 1) || !heapInit(&search->results, -1)
+			|| !visitedInit(&search->visited) || search->neighbours == NULL
+			|| search->selected == NULL || search->reselected == NULL || search->pruned == NULL)
+	{
+		searchDestroy(search);
+		return false;
+	}
+	return true;
+}
+
+/*
+ * The links of a node in a layer: a count followed by the neighbours.
+ */
+static int* getLinks(SPHNSW hnsw, int node, int level)
+{
+	int* links = hnsw->links + hnsw->linkOffsets[node];
+	return level == 0 ? links : links + (1 + hnsw->maxM0) + (level - 1) * (1 + hnsw->M);
+}
+
+/*
+ * Copies the neighbours of a node in a layer, under its lock while building.
+ */
+static int copyNeighbours(SPHNSW hnsw, int node, int level, int* neighbours, bool locked)
+{
+	int count;
+	int* links = getLinks(hnsw, node, level);
+	if (locked)
+		pthread_mutex_lock(&hnsw->locks[node]);
+	count = links[0];
+	memcpy(neighbours, links + 1, count * sizeof(int));
+	if (locked)
+		pthread_mutex_unlock(&hnsw->locks[node]);
+	return count;
+}
+
+/*
+ * Whether a node may be a result of a search whose results are enqueued into
+ * bpq, all nodes may if bpq is NULL.
+ */
+static bool isAccepted(SPHNSW hnsw, SPBPQueue bpq, int node)
+{
+	return bpq == NULL || spBPQueueAccepts(bpq, spPointStoreGetImageIndex(hnsw->store, node));
+}
+
+/*
+ * Searches a layer from entry, leaving the 'ef' nearest nodes found to the
+ * query feature in search->results. Given bpq, only the nodes it accepts are
+ * results, the others are only passed through, so the 'ef' results are all
+ * nodes which may enter it.
+ */
+static SP_HNSW_MSG searchLayer(SPHNSW hnsw, SPHNSWSearch* search, SPPointStore queries, int row,
+		SPHNSWCandidate entry, int ef, int level, bool locked, SPBPQueue bpq)
+{
+	int i, count;
+	bool isNew;
+	SPHNSWCandidate nearest, neighbour;
+	search->candidates.size = 0;
+	search->results.size = 0;
+	visitedClear(&search->visited);
+	if (!visitedAdd(&search->visited, entry.node, &isNew) || !heapPush(&search->candidates, entry)
+			|| (isAccepted(hnsw, bpq, entry.node) && !heapPush(&search->results, entry)))
+		return SP_HNSW_ALLOC_FAIL;
+
+	while (search->candidates.size > 0)
+	{
+		nearest = heapPop(&search->candidates);
+		// A filtered search goes on until it found 'ef' accepted nodes
+		if (search->results.size > 0 && (bpq == NULL || search->results.size >= ef)
+				&& nearest.distance > search->results.items[0].distance)
+			break;
+		count = copyNeighbours(hnsw, nearest.node, level, search->neighbours, locked);
+		for (i = 0; i < count; i++)
+		{
+			if (!visitedAdd(&search->visited, search->neighbours[i], &isNew))
+				return SP_HNSW_ALLOC_FAIL;
+			if (!isNew)
+				continue;
+			neighbour.node = search->neighbours[i];
+			neighbour.distance = spPointStoreDistance(hnsw->store, neighbour.node, queries, row);
+			if (search->results.size < ef || neighbour.distance < search->results.items[0].distance)
+			{
+				if (!heapPush(&search->candidates, neighbour))
+					return SP_HNSW_ALLOC_FAIL;
+				if (!isAccepted(hnsw, bpq, neighbour.node))
+					continue;
+				if (!heapPush(&search->results, neighbour))
+					return SP_HNSW_ALLOC_FAIL;
+				if (search->results.size > ef)
+					heapPop(&search->results);
+			}
+		}
+	}
+	return SP_HNSW_SUCCESS;
+}
+
+/*
+ * Chooses up to maxAmount neighbours out of candidates sorted by their
+ * distance from a node: a candidate is skipped if it's nearer to a chosen
+ * neighbour than to the node.
+ */
+static int selectNeighbours(SPHNSW hnsw, const SPHNSWCandidate* sorted, int amount,
+		int maxAmount, int* selected)
+{
+	int i, j, chosen = 0;
+	bool keep;
+	for (i = 0; i < amount && chosen < maxAmount; i++)
+	{
+		keep = true;
+		for (j = 0; j < chosen && keep; j++)
+			keep = spPointStoreDistance(hnsw->store, sorted[i].node, hnsw->store, selected[j])
+					>= sorted[i].distance;
+		if (keep)
+			selected[chosen++] = sorted[i].node;
+	}
+	return chosen;
+}
+
+/*
+ * Links node to neighbour, replacing neighbour's links by the heuristic's
+ * choice when it has too many.
+ */
+static void addLink(SPHNSW hnsw, SPHNSWSearch* search, int neighbour, int node, int level)
+{
+	int i, count, maxLinks = level == 0 ? hnsw->maxM0 : hnsw->M;
+	int* links = getLinks(hnsw, neighbour, level);
+	pthread_mutex_lock(&hnsw->locks[neighbour]);
+	if (links[0] < maxLinks)
+	{
+		links[1 + links[0]++] = node;
+		pthread_mutex_unlock(&hnsw->locks[neighbour]);
+		return;
+	}
+	for (i = 0; i < links[0]; i++)
+	{
+		search->pruned[i].node = links[1 + i];
+		search->pruned[i].distance = spPointStoreDistance(hnsw->store, links[1 + i],
+				hnsw->store, neighbour);
+	}
+	search->pruned[i].node = node;
+	search->pruned[i].distance = spPointStoreDistance(hnsw->store, node, hnsw->store, neighbour);
+	qsort(search->pruned, links[0] + 1, sizeof(SPHNSWCandidate), candidateComp);
+	count = selectNeighbours(hnsw, search->pruned, links[0] + 1, maxLinks, search->reselected);
+	memcpy(links + 1, search->reselected, count * sizeof(int));
+	links[0] = count;
+	pthread_mutex_unlock(&hnsw->locks[neighbour]);
+}
+
+static SP_HNSW_MSG insertNode(SPHNSW hnsw, SPHNSWSearch* search, int node)
+{
+	int l, count, entryPoint, top, level = hnsw->levels[node];
+	int* links;
+	SPHNSWCandidate entry;
+	SP_HNSW_MSG msg;
+
+	pthread_mutex_lock(&hnsw->entryLock);
+	entryPoint = hnsw->entryPoint;
+	top = hnsw->maxLevel;
+	pthread_mutex_unlock(&hnsw->entryLock);
+
+	entry.node = entryPoint;
+	entry.distance = spPointStoreDistance(hnsw->store, entryPoint, hnsw->store, node);
+	for (l = top; l > level; l--)
+	{
+		msg = searchLayer(hnsw, search, hnsw->store, node, entry, 1, l, true, NULL);
+		if (msg != SP_HNSW_SUCCESS)
+			return msg;
+		entry = search->results.items[0];
+	}
+	for (l = level < top ? level : top; l >= 0; l--)
+	{
+		msg = searchLayer(hnsw, search, hnsw->store, node, entry, hnsw->efConstruction, l, true,
+				NULL);
+		if (msg != SP_HNSW_SUCCESS)
+			return msg;
+		qsort(search->results.items, search->results.size, sizeof(SPHNSWCandidate),
+				candidateComp);
+		entry = search->results.items[0];
+		count = selectNeighbours(hnsw, search->results.items, search->results.size, hnsw->M,
+				search->selected);
+		links = getLinks(hnsw, node, l);
+		pthread_mutex_lock(&hnsw->locks[node]);
+		memcpy(links + 1, search->selected, count * sizeof(int));
+		links[0] = count;
+		pthread_mutex_unlock(&hnsw->locks[node]);
+		while (count-- > 0)
+			addLink(hnsw, search, search->selected[count], node, l);
+	}
+
+	if (level > top)
+	{
+		pthread_mutex_lock(&hnsw->entryLock);
+		if (level > hnsw->maxLevel)
+		{
+			hnsw->maxLevel = level;
+			hnsw->entryPoint = node;
+		}
+		pthread_mutex_unlock(&hnsw->entryLock);
+	}
+	return SP_HNSW_SUCCESS;
+}
+
+/*
+ * An inserting thread, takes the next row to insert until none is left.
+ */
+static void* insertWorker(void* arg)
+{
+	SPHNSW hnsw = (SPHNSW) arg;
+	SPHNSWSearch search;
+	int node;
+	bool ready = searchInit(&search, hnsw);
+	while (true)
+	{
+		pthread_mutex_lock(&hnsw->nextLock);
+		hnsw->failed = hnsw->failed || !ready;
+		node = hnsw->failed ? hnsw->size : hnsw->next++;
+		pthread_mutex_unlock(&hnsw->nextLock);
+		if (node >= hnsw->size)
+			break;
+		if (insertNode(hnsw, &search, node) != SP_HNSW_SUCCESS)
+		{
+			pthread_mutex_lock(&hnsw->nextLock);
+			hnsw->failed = true;
+			pthread_mutex_unlock(&hnsw->nextLock);
+		}
+	}
+	if (ready)
+		searchDestroy(&search);
+	return NULL;
+}
+
+/*
+ * The layer of a node, drawn from an exponential distribution by a hash of
+ * the node, so it doesn't depend on the order of insertion.
+ */
+static int drawLevel(int node, double levelFactor)
+{
+	int level;
+	unsigned long long x = LEVEL_SEED ^ (unsigned long long) node;
+	double uniform;
+	// splitmix64 finalizer
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	x ^= x >> 31;
+	uniform = ((x >> 11) + 1) * (1.0 / 9007199254740992.0); // in (0, 1]
+	level = (int) (-log(uniform) * levelFactor);
+	return level < MAX_LEVEL ? level : MAX_LEVEL;
+}
+
+SPHNSW spHNSWCreate(SPPointStore store, int M, int efConstruction, int numOfThreads,
+		SP_HNSW_MSG* msg)
+{
+	SPHNSW hnsw;
+	int i, created;
+	size_t total = 0;
+	pthread_t* threads;
+	assert(msg != NULL);
+	if (store == NULL || M < 2 || efConstruction < 1)
+	{
+		*msg = SP_HNSW_INVALID_ARGUMENT;
+		return NULL;
+	}
+	hnsw = (SPHNSW) calloc(1, sizeof(*hnsw));
+	if (hnsw == NULL)
+	{
+		*msg = SP_HNSW_ALLOC_FAIL;
+		return NULL;
+	}
+	hnsw->store = store;
+	hnsw->size = spPointStoreGetSize(store);
+	hnsw->M = M;
+	hnsw->maxM0 = 2 * M;
+	hnsw->efConstruction = efConstruction;
+	hnsw->entryPoint = -1;
+	pthread_mutex_init(&hnsw->entryLock, NULL);
+	pthread_mutex_init(&hnsw->nextLock, NULL);
+	hnsw->levels = (int*) malloc((hnsw->size > 0 ? hnsw->size : 1) * sizeof(int));
+	hnsw->linkOffsets = (size_t*) malloc((hnsw->size > 0 ? hnsw->size : 1) * sizeof(size_t));
+	hnsw->locks = (pthread_mutex_t*) malloc((hnsw->size > 0 ? hnsw->size : 1)
+			* sizeof(pthread_mutex_t));
+	if (hnsw->levels == NULL || hnsw->linkOffsets == NULL || hnsw->locks == NULL)
+	{
+		spHNSWDestroy(hnsw);
+		*msg = SP_HNSW_ALLOC_FAIL;
+		return NULL;
+	}
+
+	// The links of all the nodes are allocated at once
+	for (i = 0; i < hnsw->size; i++)
+	{
+		hnsw->levels[i] = drawLevel(i, 1 / log((double) M));
+		hnsw->linkOffsets[i] = total;
+		total += (1 + hnsw->maxM0) + (size_t) hnsw->levels[i] * (1 + M);
+		pthread_mutex_init(&hnsw->locks[i], NULL);
+	}
+	hnsw->links = (int*) calloc(total > 0 ? total : 1, sizeof(int));
+	if (hnsw->links == NULL)
+	{
+		spHNSWDestroy(hnsw);
+		*msg = SP_HNSW_ALLOC_FAIL;
+		return NULL;
+	}
+	if (hnsw->size == 0)
+	{
+		*msg = SP_HNSW_SUCCESS;
+		return hnsw;
+	}
+
+	// The first node is the entry point, the others are inserted in parallel
+	hnsw->entryPoint = 0;
+	hnsw->maxLevel = hnsw->levels[0];
+	hnsw->next = 1;
+	if (numOfThreads <= 0)
+		numOfThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if (numOfThreads > hnsw->size)
+		numOfThreads = hnsw->size;
+	if (numOfThreads < 1)
+		numOfThreads = 1;
+	threads = (pthread_t*) malloc(numOfThreads * sizeof(pthread_t));
+	for (created = 0; threads != NULL && created < numOfThreads - 1; created++)
+		if (pthread_create(&threads[created], NULL, insertWorker, hnsw) != 0)
+			break;
+	insertWorker(hnsw);
+	for (i = 0; i < created; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+
+	if (hnsw->failed)
+	{
+		spHNSWDestroy(hnsw);
+		*msg = SP_HNSW_ALLOC_FAIL;
+		return NULL;
+	}
+	*msg = SP_HNSW_SUCCESS;
+	return hnsw;
+}
+
+SP_HNSW_MSG spHNSWKNN(SPHNSW hnsw, SPPointStore queries, int row, int ef, SPBPQueue bpq)
+{
+	int i, l;
+	SPHNSWSearch search;
+	SPHNSWCandidate entry;
+	SPListElement element;
+	SP_HNSW_MSG msg = SP_HNSW_SUCCESS;
+	if (hnsw == NULL || queries == NULL || bpq == NULL || row < 0
+			|| row >= spPointStoreGetSize(queries))
+		return SP_HNSW_INVALID_ARGUMENT;
+	if (hnsw->size == 0)
+		return SP_HNSW_SUCCESS;
+	if (ef < spBPQueueGetMaxSize(bpq))
+		ef = spBPQueueGetMaxSize(bpq);
+	if (!searchInit(&search, hnsw))
+		return SP_HNSW_ALLOC_FAIL;
+
+	entry.node = hnsw->entryPoint;
+	entry.distance = spPointStoreDistance(hnsw->store, entry.node, queries, row);
+	for (l = hnsw->maxLevel; l > 0 && msg == SP_HNSW_SUCCESS; l--)
+	{
+		msg = searchLayer(hnsw, &search, queries, row, entry, 1, l, false, NULL);
+		entry = search.results.items[0];
+	}
+	if (msg == SP_HNSW_SUCCESS)
+		msg = searchLayer(hnsw, &search, queries, row, entry, ef, 0, false, bpq);
+	for (i = 0; i < search.results.size && msg == SP_HNSW_SUCCESS; i++)
+	{
+		element = spListElementCreate(spPointStoreGetImageIndex(hnsw->store,
+				search.results.items[i].node), search.results.items[i].distance);
+		if (element == NULL || spBPQueueEnqueue(bpq, element) == SP_BPQUEUE_OUT_OF_MEMORY)
+			msg = SP_HNSW_ALLOC_FAIL;
+		spListElementDestroy(element);
+	}
+	searchDestroy(&search);
+	return msg;
+}
+
+void spHNSWDestroy(SPHNSW hnsw)
+{
+	int i;
+	if (hnsw == NULL)
+		return;
+	// The locks are initialized with the levels, once all three are allocated
+	if (hnsw->levels != NULL && hnsw->linkOffsets != NULL && hnsw->locks != NULL)
+		for (i = 0; i < hnsw->size; i++)
+			pthread_mutex_destroy(&hnsw->locks[i]);
+	pthread_mutex_destroy(&hnsw->entryLock);
+	pthread_mutex_destroy(&hnsw->nextLock);
+	free(hnsw->levels);
+	free(hnsw->linkOffsets);
+	free(hnsw->links);
+	free(hnsw->locks);
+	free(hnsw);
+}
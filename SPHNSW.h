@@ -0,0 +1,95 @@
+#ifndef SPHNSW_H_
+#define SPHNSW_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "SPPointStore.h"
+#include "SPBPriorityQueue.h"
+
+/**
+ * SP HNSW summary
+ * An approximate k nearest neighbours index: a Hierarchical Navigable Small
+ * World graph (Malkov and Yashunin, "Efficient and robust approximate nearest
+ * neighbor search using Hierarchical Navigable Small World graphs").
+ *
+ * Every row is a node of the graph, linked to close rows. The bottom layer
+ * holds all the rows and every layer above holds an exponentially decreasing
+ * random subset of the one below. A search descends greedily from the top
+ * layer, and in the bottom layer keeps the 'ef' nearest rows found so far,
+ * expanding the nearest unexpanded one until none of them is nearer than the
+ * farthest kept. The neighbours of a row are chosen by the heuristic of the
+ * paper, which prefers neighbours in different directions.
+ *
+ * Build parameters:
+ * - M: the number of links of a row in the upper layers, 2 * M in the bottom
+ * - efConstruction: the 'ef' of the searches for the neighbours of a new row
+ * The rows are inserted by several threads, so the graph, and the results,
+ * may differ slightly between builds.
+ *
+ * The index refers to the rows of a point store, REAL or BINARY, which must
+ * outlive it. Searching is thread safe.
+ *
+ * The following functions are supported:
+ * spHNSWCreate  - Builds the index over a store
+ * spHNSWKNN     - Finds the nearest rows to a query feature
+ * spHNSWDestroy - Frees all resources associated with the index
+ */
+
+typedef enum sp_hnsw_msg_t {
+	SP_HNSW_INVALID_ARGUMENT,
+	SP_HNSW_ALLOC_FAIL,
+	SP_HNSW_SUCCESS
+} SP_HNSW_MSG;
+
+typedef struct sp_hnsw_t* SPHNSW;
+
+/**
+ * Builds the index over all the rows of store.
+ *
+ * @param store - the rows to index
+ * @param M - the number of links of a row in the upper layers
+ * @param efConstruction - the number of candidates kept while inserting a row
+ * @param numOfThreads - the number of inserting threads, non positive values
+ * 						 use a thread per core
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new index.
+ *
+ * - SP_HNSW_INVALID_ARGUMENT - if store == NULL or M < 2 or efConstruction < 1
+ * - SP_HNSW_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_HNSW_SUCCESS - in case of success
+ */
+SPHNSW spHNSWCreate(SPPointStore store, int M, int efConstruction, int numOfThreads,
+		SP_HNSW_MSG* msg);
+
+/**
+ * Enqueues the nearest rows found to a query feature into bpq, up to its
+ * maximal size. Every element's index is the image index of the row and its
+ * value is its distance from the query feature.
+ * Only the rows bpq accepts (see spBPQueueAccepts) are kept as candidates:
+ * the others are still passed through on the way, since the graph links
+ * them, but the search goes on until it kept 'ef' accepted rows, so a
+ * selective filter still fills bpq, at the cost of a longer search.
+ *
+ * @param hnsw - the index
+ * @param queries - a store of the same type and dimension as the index's
+ * @param row - the row of the query feature in queries
+ * @param ef - the number of candidates kept, at least the maximal size of bpq
+ * 			   are kept
+ * @param bpq - the queue to fill, its maximal size is the k in k nearest
+ * @return
+ * - SP_HNSW_INVALID_ARGUMENT - if hnsw == NULL or queries == NULL or
+ * 		bpq == NULL or row is out of range
+ * - SP_HNSW_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_HNSW_SUCCESS - in case of success
+ */
+SP_HNSW_MSG spHNSWKNN(SPHNSW hnsw, SPPointStore queries, int row, int ef, SPBPQueue bpq);
+
+/**
+ * Frees all resources associated with the index. The store isn't destroyed.
+ * If hnsw == NULL nothing happens.
+ */
+void spHNSWDestroy(SPHNSW hnsw);
+
+#endif /* SPHNSW_H_ */
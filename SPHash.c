@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include "SPHash.h"
+
+#define FNV_PRIME (1099511628211ULL)
+#define READ_BUFFER_SIZE (64 * 1024)
+
+unsigned long long spHashBytes(const void* data, size_t size, unsigned long long hash)
+{
+	const unsigned char* bytes = (const unsigned char*) data;
+	size_t i;
+	for (i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+bool spHashFile(const char* path, unsigned long long* hash)
+{
+	FILE* file;
+	unsigned char* buffer;
+	size_t readAmount;
+	bool success;
+
+	if (path == NULL || hash == NULL)
+		return false;
+
+	buffer = (unsigned char*) malloc(READ_BUFFER_SIZE);
+	if (buffer == NULL)
+		return false;
+
+	file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		free(buffer);
+		return false;
+	}
+
+	*hash = SP_HASH_SEED;
+	while ((readAmount = fread(buffer, 1, READ_BUFFER_SIZE, file)) > 0)
+		*hash = spHashBytes(buffer, readAmount, *hash);
+	success = !ferror(file);
+
+	fclose(file);
+	free(buffer);
+	return success;
+}
@@ -0,0 +1,42 @@
+#ifndef SPHASH_H_
+#define SPHASH_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+/**
+ * SP Hash summary
+ * Fast non-cryptographic hashing (64 bit FNV-1a) of memory buffers and files.
+ * Used to detect whether an image file changed between two runs.
+ *
+ * The following functions are supported:
+ * spHashBytes - Continues a hash with the given bytes
+ * spHashFile  - Hashes the content of a file
+ */
+
+/** The initial value of every hash **/
+#define SP_HASH_SEED (14695981039346656037ULL)
+
+/**
+ * Continues the hash 'hash' with 'size' bytes starting at 'data'.
+ * To hash a single buffer call spHashBytes(data, size, SP_HASH_SEED).
+ *
+ * @param data - the bytes to hash
+ * @param size - the amount of bytes in data
+ * @param hash - the hash computed so far
+ * @return the updated hash
+ */
+unsigned long long spHashBytes(const void* data, size_t size, unsigned long long hash);
+
+/**
+ * Hashes the content of the file given by path.
+ *
+ * @param path - the path of the file
+ * @param hash - a pointer in which the hash of the file is stored
+ * @return
+ * true - on success
+ * false - if path == NULL or hash == NULL or the file couldn't be read
+ */
+bool spHashFile(const char* path, unsigned long long* hash);
+
+#endif /* SPHASH_H_ */
@@ -0,0 +1,413 @@
+#include <string.h>
+#include "SPIVFPQ.h"
+#include "SPKMeans.h"
+
+#define TRAIN_POINTS_PER_CENTROID 64
+#define KMEANS_ITERATIONS 20
+
+struct sp_ivf_pq_t
+{
+	int dim;
+	int size;
+	int lists;
+	int subquantizers;
+	int* subStarts;        // the first coordinate of every subvector, and dim
+	double* coarse;        // lists x dim
+	double* codebooks;     // per subvector, SP_IVF_PQ_CENTROIDS centroids of its length
+	int* listOffsets;      // the first position of every list in codes
+	unsigned char* codes;  // size x subquantizers, ordered by list
+	int* imageIndexes;     // size, ordered by list
+};
+
+typedef struct sp_ivf_pq_list_t
+{
+	double distance;
+	int list;
+} SPIVFPQList;
+
+static int listComp(const void* a, const void* b)
+{
+	double x = ((const SPIVFPQList*) a)->distance;
+	double y = ((const SPIVFPQList*) b)->distance;
+	return (x > y) - (x < y);
+}
+
+static double squaredDistance(const double* a, const double* b, int dim)
+{
+	int i;
+	double diff, distance = 0;
+	for (i = 0; i < dim; i++)
+	{
+		diff = a[i] - b[i];
+		distance += diff * diff;
+	}
+	return distance;
+}
+
+/*
+ * The centroids of a subvector: SP_IVF_PQ_CENTROIDS rows of its length.
+ */
+static double* getCodebook(SPIVFPQ ivfpq, int subquantizer)
+{
+	return ivfpq->codebooks + (size_t) SP_IVF_PQ_CENTROIDS * ivfpq->subStarts[subquantizer];
+}
+
+/*
+ * Trains the centroids of every subvector on the residuals of the sample.
+ */
+static SP_IVF_PQ_MSG trainCodebooks(SPIVFPQ ivfpq, const double* residuals, int sampleSize)
+{
+	int s, i, length;
+	double* subvectors;
+	SP_KMEANS_MSG kmeansMsg = SP_KMEANS_SUCCESS;
+	subvectors = (double*) malloc((size_t) sampleSize * ivfpq->dim * sizeof(double));
+	if (subvectors == NULL)
+		return SP_IVF_PQ_ALLOC_FAIL;
+	for (s = 0; s < ivfpq->subquantizers && kmeansMsg == SP_KMEANS_SUCCESS; s++)
+	{
+		length = ivfpq->subStarts[s + 1] - ivfpq->subStarts[s];
+		for (i = 0; i < sampleSize; i++)
+			memcpy(subvectors + (size_t) i * length,
+					residuals + (size_t) i * ivfpq->dim + ivfpq->subStarts[s],
+					length * sizeof(double));
+		kmeansMsg = spKMeansTrain(subvectors, length, NULL, sampleSize, SP_IVF_PQ_CENTROIDS,
+				KMEANS_ITERATIONS, getCodebook(ivfpq, s), NULL);
+	}
+	free(subvectors);
+	return kmeansMsg == SP_KMEANS_SUCCESS ? SP_IVF_PQ_SUCCESS : SP_IVF_PQ_ALLOC_FAIL;
+}
+
+/*
+ * Trains the coarse quantizer and the subquantizers on evenly spaced rows.
+ */
+static SP_IVF_PQ_MSG train(SPIVFPQ ivfpq, const double* data)
+{
+	int i, d, sampleSize;
+	int *sampleRows, *assignments;
+	double* residuals;
+	SP_IVF_PQ_MSG msg = SP_IVF_PQ_ALLOC_FAIL;
+	sampleSize = TRAIN_POINTS_PER_CENTROID
+			* (ivfpq->lists > SP_IVF_PQ_CENTROIDS ? ivfpq->lists : SP_IVF_PQ_CENTROIDS);
+	if (sampleSize > ivfpq->size)
+		sampleSize = ivfpq->size;
+	sampleRows = (int*) malloc(sampleSize * sizeof(int));
+	assignments = (int*) malloc(sampleSize * sizeof(int));
+	residuals = (double*) malloc((size_t) sampleSize * ivfpq->dim * sizeof(double));
+	if (sampleRows != NULL && assignments != NULL && residuals != NULL)
+	{
+		for (i = 0; i < sampleSize; i++)
+			sampleRows[i] = (int) ((long long) i * ivfpq->size / sampleSize);
+		if (spKMeansTrain(data, ivfpq->dim, sampleRows, sampleSize, ivfpq->lists,
+				KMEANS_ITERATIONS, ivfpq->coarse, assignments) == SP_KMEANS_SUCCESS)
+		{
+			for (i = 0; i < sampleSize; i++)
+				for (d = 0; d < ivfpq->dim; d++)
+					residuals[(size_t) i * ivfpq->dim + d] =
+							data[(size_t) sampleRows[i] * ivfpq->dim + d]
+							- ivfpq->coarse[(size_t) assignments[i] * ivfpq->dim + d];
+			msg = trainCodebooks(ivfpq, residuals, sampleSize);
+		}
+	}
+	free(sampleRows);
+	free(assignments);
+	free(residuals);
+	return msg;
+}
+
+/*
+ * Fills the lists with the codes of source, an index with the same
+ * quantizers, but those of the images in removed, and with the codes of the
+ * rows of store, either of which may be NULL. The codes are ordered by list
+ * with a counting sort.
+ */
+static SP_IVF_PQ_MSG encode(SPIVFPQ ivfpq, SPIVFPQ source, SPBitset removed, SPPointStore store)
+{
+	int i, d, s, list, length, position, rows = store != NULL ? spPointStoreGetSize(store) : 0;
+	int *listOf, *cursor;
+	double* residual;
+	const double* row;
+	unsigned char* code;
+	listOf = (int*) malloc((rows > 0 ? rows : 1) * sizeof(int));
+	cursor = (int*) malloc(ivfpq->lists * sizeof(int));
+	residual = (double*) malloc(ivfpq->dim * sizeof(double));
+	code = (unsigned char*) malloc(ivfpq->subquantizers);
+	if (listOf == NULL || cursor == NULL || residual == NULL || code == NULL)
+	{
+		free(listOf);
+		free(cursor);
+		free(residual);
+		free(code);
+		return SP_IVF_PQ_ALLOC_FAIL;
+	}
+	for (list = 0; source != NULL && list < source->lists; list++)
+		for (i = source->listOffsets[list]; i < source->listOffsets[list + 1]; i++)
+			if (!spBitsetContains(removed, source->imageIndexes[i]))
+				ivfpq->listOffsets[list + 1]++;
+	for (i = 0; i < rows; i++)
+	{
+		listOf[i] = spKMeansNearest(ivfpq->coarse, ivfpq->lists, ivfpq->dim,
+				spPointStoreGetRealRow(store, i), NULL);
+		ivfpq->listOffsets[listOf[i] + 1]++;
+	}
+	for (i = 0; i < ivfpq->lists; i++)
+	{
+		ivfpq->listOffsets[i + 1] += ivfpq->listOffsets[i];
+		cursor[i] = ivfpq->listOffsets[i];
+	}
+	// The codes of source are copied as they are, its quantizers are the same
+	for (list = 0; source != NULL && list < source->lists; list++)
+	{
+		for (i = source->listOffsets[list]; i < source->listOffsets[list + 1]; i++)
+		{
+			if (spBitsetContains(removed, source->imageIndexes[i]))
+				continue;
+			position = cursor[list]++;
+			memcpy(ivfpq->codes + (size_t) position * ivfpq->subquantizers,
+					source->codes + (size_t) i * source->subquantizers, ivfpq->subquantizers);
+			ivfpq->imageIndexes[position] = source->imageIndexes[i];
+		}
+	}
+	for (i = 0; i < rows; i++)
+	{
+		row = spPointStoreGetRealRow(store, i);
+		for (d = 0; d < ivfpq->dim; d++)
+			residual[d] = row[d] - ivfpq->coarse[(size_t) listOf[i] * ivfpq->dim + d];
+		for (s = 0; s < ivfpq->subquantizers; s++)
+		{
+			length = ivfpq->subStarts[s + 1] - ivfpq->subStarts[s];
+			code[s] = (unsigned char) spKMeansNearest(getCodebook(ivfpq, s), SP_IVF_PQ_CENTROIDS,
+					length, residual + ivfpq->subStarts[s], NULL);
+		}
+		position = cursor[listOf[i]]++;
+		memcpy(ivfpq->codes + (size_t) position * ivfpq->subquantizers, code,
+				ivfpq->subquantizers);
+		ivfpq->imageIndexes[position] = spPointStoreGetImageIndex(store, i);
+	}
+	free(listOf);
+	free(cursor);
+	free(residual);
+	free(code);
+	return SP_IVF_PQ_SUCCESS;
+}
+
+/*
+ * Allocates an index of size codes, whose quantizers and codes are yet to be
+ * filled. Returns NULL on an allocation failure.
+ */
+static SPIVFPQ allocate(int dim, int size, int lists, int subquantizers)
+{
+	SPIVFPQ ivfpq = (SPIVFPQ) calloc(1, sizeof(*ivfpq));
+	if (ivfpq == NULL)
+		return NULL;
+	ivfpq->dim = dim;
+	ivfpq->size = size;
+	ivfpq->lists = lists;
+	ivfpq->subquantizers = subquantizers;
+	ivfpq->subStarts = (int*) malloc((subquantizers + 1) * sizeof(int));
+	ivfpq->coarse = (double*) malloc((size_t) lists * dim * sizeof(double));
+	ivfpq->codebooks = (double*) malloc((size_t) SP_IVF_PQ_CENTROIDS * dim * sizeof(double));
+	ivfpq->listOffsets = (int*) calloc(lists + 1, sizeof(int));
+	ivfpq->codes = (unsigned char*) malloc((size_t) size * subquantizers);
+	ivfpq->imageIndexes = (int*) malloc(size * sizeof(int));
+	if (ivfpq->subStarts == NULL || ivfpq->coarse == NULL || ivfpq->codebooks == NULL
+			|| ivfpq->listOffsets == NULL || ivfpq->codes == NULL || ivfpq->imageIndexes == NULL)
+	{
+		spIVFPQDestroy(ivfpq);
+		return NULL;
+	}
+	return ivfpq;
+}
+
+SPIVFPQ spIVFPQCreate(SPPointStore store, int lists, int subquantizers, SP_IVF_PQ_MSG* msg)
+{
+	SPIVFPQ ivfpq;
+	int s, size;
+	assert(msg != NULL);
+	if (store == NULL || spPointStoreGetType(store) != SP_POINT_STORE_REAL
+			|| spPointStoreGetSize(store) == 0 || lists < 1 || subquantizers < 1
+			|| subquantizers > spPointStoreGetDim(store))
+	{
+		*msg = SP_IVF_PQ_INVALID_ARGUMENT;
+		return NULL;
+	}
+	size = spPointStoreGetSize(store);
+	ivfpq = allocate(spPointStoreGetDim(store), size, lists < size ? lists : size,
+			subquantizers);
+	if (ivfpq == NULL)
+	{
+		*msg = SP_IVF_PQ_ALLOC_FAIL;
+		return NULL;
+	}
+	// The subvectors split the coordinates as evenly as possible
+	for (s = 0; s <= subquantizers; s++)
+		ivfpq->subStarts[s] = s * ivfpq->dim / subquantizers;
+
+	*msg = train(ivfpq, spPointStoreGetRealRow(store, 0));
+	if (*msg == SP_IVF_PQ_SUCCESS)
+		*msg = encode(ivfpq, NULL, NULL, store);
+	if (*msg != SP_IVF_PQ_SUCCESS)
+	{
+		spIVFPQDestroy(ivfpq);
+		return NULL;
+	}
+	return ivfpq;
+}
+
+SPIVFPQ spIVFPQCreateFrom(SPIVFPQ ivfpq, SPPointStore added, SPBitset removed,
+		SP_IVF_PQ_MSG* msg)
+{
+	SPIVFPQ result;
+	int i, size;
+	assert(msg != NULL);
+	if (ivfpq == NULL || (added != NULL && (spPointStoreGetType(added) != SP_POINT_STORE_REAL
+			|| spPointStoreGetDim(added) != ivfpq->dim || !spPointStoreHasRows(added))))
+	{
+		*msg = SP_IVF_PQ_INVALID_ARGUMENT;
+		return NULL;
+	}
+	size = added != NULL ? spPointStoreGetSize(added) : 0;
+	for (i = 0; i < ivfpq->size; i++)
+		if (!spBitsetContains(removed, ivfpq->imageIndexes[i]))
+			size++;
+	if (size == 0)
+	{
+		*msg = SP_IVF_PQ_INVALID_ARGUMENT;
+		return NULL;
+	}
+	result = allocate(ivfpq->dim, size, ivfpq->lists, ivfpq->subquantizers);
+	if (result == NULL)
+	{
+		*msg = SP_IVF_PQ_ALLOC_FAIL;
+		return NULL;
+	}
+	memcpy(result->subStarts, ivfpq->subStarts, (ivfpq->subquantizers + 1) * sizeof(int));
+	memcpy(result->coarse, ivfpq->coarse, (size_t) ivfpq->lists * ivfpq->dim * sizeof(double));
+	memcpy(result->codebooks, ivfpq->codebooks,
+			(size_t) SP_IVF_PQ_CENTROIDS * ivfpq->dim * sizeof(double));
+	*msg = encode(result, ivfpq, removed, added);
+	if (*msg != SP_IVF_PQ_SUCCESS)
+	{
+		spIVFPQDestroy(result);
+		return NULL;
+	}
+	return result;
+}
+
+/*
+ * Fills tables with the distance of every subvector of the query's residual
+ * from the coarse centroid of list from every centroid of its subquantizer.
+ */
+static void computeTables(SPIVFPQ ivfpq, const double* query, int list, double* residual,
+		double* tables)
+{
+	int d, s, c, length;
+	for (d = 0; d < ivfpq->dim; d++)
+		residual[d] = query[d] - ivfpq->coarse[(size_t) list * ivfpq->dim + d];
+	for (s = 0; s < ivfpq->subquantizers; s++)
+	{
+		length = ivfpq->subStarts[s + 1] - ivfpq->subStarts[s];
+		for (c = 0; c < SP_IVF_PQ_CENTROIDS; c++)
+			tables[s * SP_IVF_PQ_CENTROIDS + c] = squaredDistance(
+					residual + ivfpq->subStarts[s],
+					getCodebook(ivfpq, s) + (size_t) c * length, length);
+	}
+}
+
+SP_IVF_PQ_MSG spIVFPQKNN(SPIVFPQ ivfpq, SPPointStore queries, int row, int probes,
+		SPBPQueue bpq)
+{
+	int p, i, s, list;
+	bool tablesReady;
+	double distance;
+	double *tables, *residual;
+	const double* query;
+	const unsigned char* code;
+	SPIVFPQList* order;
+	SPListElement element;
+	SP_IVF_PQ_MSG msg = SP_IVF_PQ_SUCCESS;
+	if (ivfpq == NULL || queries == NULL || bpq == NULL || row < 0
+			|| row >= spPointStoreGetSize(queries) || probes < 1)
+		return SP_IVF_PQ_INVALID_ARGUMENT;
+	if (probes > ivfpq->lists)
+		probes = ivfpq->lists;
+	order = (SPIVFPQList*) malloc(ivfpq->lists * sizeof(SPIVFPQList));
+	tables = (double*) malloc((size_t) ivfpq->subquantizers * SP_IVF_PQ_CENTROIDS
+			* sizeof(double));
+	residual = (double*) malloc(ivfpq->dim * sizeof(double));
+	if (order == NULL || tables == NULL || residual == NULL)
+	{
+		free(order);
+		free(tables);
+		free(residual);
+		return SP_IVF_PQ_ALLOC_FAIL;
+	}
+
+	query = spPointStoreGetRealRow(queries, row);
+	for (i = 0; i < ivfpq->lists; i++)
+	{
+		order[i].list = i;
+		order[i].distance = squaredDistance(query, ivfpq->coarse + (size_t) i * ivfpq->dim,
+				ivfpq->dim);
+	}
+	qsort(order, ivfpq->lists, sizeof(SPIVFPQList), listComp);
+
+	// Lists past 'probes' are scanned while the queue isn't full, so the codes
+	// bpq doesn't accept don't leave it short of results
+	for (p = 0; p < ivfpq->lists && (p < probes || !spBPQueueIsFull(bpq))
+			&& msg == SP_IVF_PQ_SUCCESS; p++)
+	{
+		list = order[p].list;
+		tablesReady = false;
+		for (i = ivfpq->listOffsets[list]; i < ivfpq->listOffsets[list + 1]
+				&& msg == SP_IVF_PQ_SUCCESS; i++)
+		{
+			if (!spBPQueueAccepts(bpq, ivfpq->imageIndexes[i]))
+				continue;
+			// The tables are computed for the lists which hold accepted codes only
+			if (!tablesReady)
+			{
+				computeTables(ivfpq, query, list, residual, tables);
+				tablesReady = true;
+			}
+			code = ivfpq->codes + (size_t) i * ivfpq->subquantizers;
+			distance = 0;
+			for (s = 0; s < ivfpq->subquantizers; s++)
+				distance += tables[s * SP_IVF_PQ_CENTROIDS + code[s]];
+			if (spBPQueueIsFull(bpq) && distance >= spBPQueueMaxValue(bpq))
+				continue;
+			element = spListElementCreate(ivfpq->imageIndexes[i], distance);
+			if (element == NULL || spBPQueueEnqueue(bpq, element) == SP_BPQUEUE_OUT_OF_MEMORY)
+				msg = SP_IVF_PQ_ALLOC_FAIL;
+			spListElementDestroy(element);
+		}
+	}
+	free(order);
+	free(tables);
+	free(residual);
+	return msg;
+}
+
+int spIVFPQGetSize(SPIVFPQ ivfpq)
+{
+	assert(ivfpq != NULL);
+	return ivfpq->size;
+}
+
+int spIVFPQGetImageIndex(SPIVFPQ ivfpq, int position)
+{
+	assert(ivfpq != NULL && position >= 0 && position < ivfpq->size);
+	return ivfpq->imageIndexes[position];
+}
+
+void spIVFPQDestroy(SPIVFPQ ivfpq)
+{
+	if (ivfpq == NULL)
+		return;
+	free(ivfpq->subStarts);
+	free(ivfpq->coarse);
+	free(ivfpq->codebooks);
+	free(ivfpq->listOffsets);
+	free(ivfpq->codes);
+	free(ivfpq->imageIndexes);
+	free(ivfpq);
+}
@@ -0,0 +1,139 @@
+#ifndef SPIVFPQ_H_
+#define SPIVFPQ_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "SPPointStore.h"
+#include "SPBPriorityQueue.h"
+
+/**
+ * SP IVF-PQ summary
+ * An approximate k nearest neighbours index which keeps the features
+ * compressed: an inverted file over a coarse quantizer, holding product
+ * quantization codes (Jegou, Douze and Schmid, "Product Quantization for
+ * Nearest Neighbor Search").
+ *
+ * The coarse quantizer clusters the features into lists by k-means. The
+ * residual of every feature from its list's centroid is split into
+ * subvectors, and every subvector is replaced by the number of its nearest
+ * centroid out of SP_IVF_PQ_CENTROIDS, trained by k-means per subvector. So
+ * a feature is stored as one byte per subvector, instead of 8 bytes per
+ * coordinate. Both quantizers are trained on a sample of the features.
+ *
+ * A search scans the lists of the 'probes' nearest centroids to the query.
+ * For every list it computes a table of the distances between the query's
+ * residual subvectors and all the subvector centroids, so the distance to
+ * every code is the sum of one table entry per byte (asymmetric distance
+ * computation). The distances are approximate squared L2 distances.
+ *
+ * The index copies what it needs from the REAL point store it's built over,
+ * which may be destroyed or released afterwards. Searching is thread safe.
+ * Features are added and removed by creating a new index from an existing
+ * one, with the same quantizers, so the features of the existing index
+ * aren't needed again.
+ *
+ * The following functions are supported:
+ * spIVFPQCreate        - Trains and builds the index over a store
+ * spIVFPQCreateFrom    - Creates an index of the codes of another and more rows
+ * spIVFPQKNN           - Finds the nearest features to a query feature
+ * spIVFPQGetSize       - A getter of the number of features in the index
+ * spIVFPQGetImageIndex - A getter of the image index of a feature in the index
+ * spIVFPQDestroy       - Frees all resources associated with the index
+ */
+
+/** The number of centroids of every subquantizer, so that a code is a byte **/
+#define SP_IVF_PQ_CENTROIDS 256
+
+typedef enum sp_ivf_pq_msg_t {
+	SP_IVF_PQ_INVALID_ARGUMENT,
+	SP_IVF_PQ_ALLOC_FAIL,
+	SP_IVF_PQ_SUCCESS
+} SP_IVF_PQ_MSG;
+
+typedef struct sp_ivf_pq_t* SPIVFPQ;
+
+/**
+ * Trains the quantizers on a sample of the rows of store and encodes all of
+ * them.
+ *
+ * @param store - a REAL point store
+ * @param lists - the number of lists of the coarse quantizer, at most the
+ * 				  number of rows are used
+ * @param subquantizers - the number of subvectors a feature is split into,
+ * 						  at most the dimension of the store
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new index.
+ *
+ * - SP_IVF_PQ_INVALID_ARGUMENT - if store == NULL or isn't REAL or is empty,
+ * 		or lists < 1 or subquantizers < 1 or subquantizers > the dimension
+ * - SP_IVF_PQ_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_IVF_PQ_SUCCESS - in case of success
+ */
+SPIVFPQ spIVFPQCreate(SPPointStore store, int lists, int subquantizers, SP_IVF_PQ_MSG* msg);
+
+/**
+ * Creates an index with the quantizers of ivfpq, which aren't trained again,
+ * holding the codes of ivfpq but those of the images in removed, followed by
+ * the codes of all the rows of added. ivfpq isn't changed.
+ *
+ * @param ivfpq - the index whose quantizers and codes are taken
+ * @param added - a REAL store of the dimension of the index, or NULL to add
+ * 				  no rows
+ * @param removed - the images whose codes are dropped, or NULL to keep all
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new index.
+ *
+ * - SP_IVF_PQ_INVALID_ARGUMENT - if ivfpq == NULL, or added isn't REAL or
+ * 		isn't of the dimension of the index or its rows were released, or the
+ * 		new index would hold no codes
+ * - SP_IVF_PQ_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_IVF_PQ_SUCCESS - in case of success
+ */
+SPIVFPQ spIVFPQCreateFrom(SPIVFPQ ivfpq, SPPointStore added, SPBitset removed,
+		SP_IVF_PQ_MSG* msg);
+
+/**
+ * Enqueues the nearest features found to a query feature into bpq, up to its
+ * maximal size. Every element's index is the image index of the feature and
+ * its value is its approximate squared distance from the query feature.
+ * Only the codes bpq accepts (see spBPQueueAccepts) are scored, and the
+ * nearest lists are scanned past 'probes' while bpq isn't full, so a
+ * selective filter still fills it.
+ *
+ * @param ivfpq - the index
+ * @param queries - a REAL store of the same dimension as the index's
+ * @param row - the row of the query feature in queries
+ * @param probes - the number of lists to scan at least
+ * @param bpq - the queue to fill, its maximal size is the k in k nearest
+ * @return
+ * - SP_IVF_PQ_INVALID_ARGUMENT - if ivfpq == NULL or queries == NULL or
+ * 		bpq == NULL or row is out of range or probes < 1
+ * - SP_IVF_PQ_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_IVF_PQ_SUCCESS - in case of success
+ */
+SP_IVF_PQ_MSG spIVFPQKNN(SPIVFPQ ivfpq, SPPointStore queries, int row, int probes,
+		SPBPQueue bpq);
+
+/**
+ * @assert ivfpq != NULL
+ * @return the number of features encoded in the index
+ */
+int spIVFPQGetSize(SPIVFPQ ivfpq);
+
+/**
+ * @assert ivfpq != NULL and 0 <= position < the number of features
+ * @return the image index of the feature at position, in the order of the
+ * 		   lists
+ */
+int spIVFPQGetImageIndex(SPIVFPQ ivfpq, int position);
+
+/**
+ * Frees all resources associated with the index.
+ * If ivfpq == NULL nothing happens.
+ */
+void spIVFPQDestroy(SPIVFPQ ivfpq);
+
+#endif /* SPIVFPQ_H_ */
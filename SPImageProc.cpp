@@ -2,12 +2,17 @@
 #include <cassert>
 #include <cstring>
 #include <opencv2/xfeatures2d.hpp>
+#include <opencv2/features2d.hpp>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/highgui.hpp>
 #include <cstdio>
+#include <algorithm>
+#include <condition_variable>
+#include <thread>
 #include "SPImageProc.h"
+#include "SPBoundedQueue.h"
 extern "C" {
 #include "SPLogger.h"
 }
@@ -19,6 +24,7 @@ using namespace std;
 #define PCA_EIGEN_VEC_STR "e_vectors"
 #define PCA_EIGEN_VAL_STR "e_values"
 #define STRING_LENGTH 1024
+#define DESCRIPTOR_LENGTH 128
 #define WARNING_MSG_LENGTH 2048
 
 #define GENERAL_ERROR_MSG "An error occurred"
@@ -28,11 +34,39 @@ using namespace std;
 #define NUM_OF_IMAGES_ERROR "Number of images couldn't be resolved"
 #define NUM_OF_FEATS_ERROR "Number of features couldn't be resolved"
 #define MINIMAL_GUI_ERROR "Minimal GUI mode couldn't be resolved"
+#define NUM_OF_THREADS_ERROR "Number of threads couldn't be resolved"
 #define IMAGE_PATH_ERROR "Image path couldn't be resolved"
 #define IMAGE_NOT_EXIST_MSG ": Images doesn't exist"
 #define MINIMAL_GUI_NOT_SET_WARNING "Cannot display images in non-Minimal-GUI mode"
 #define ALLOC_ERROR_MSG "Allocation error"
 #define INVALID_ARG_ERROR "Invalid arguments"
+#define DESCRIPTOR_CACHE_ERROR "Descriptor cache size couldn't be resolved"
+#define SPILL_FILE_ERROR "Descriptors couldn't be spilled to a temporary file"
+#define SPILL_READ_ERROR "Spilled descriptors couldn't be read"
+#define SAMPLE_RATE_ERROR "PCA sample rate couldn't be resolved"
+#define NO_DESCRIPTORS_ERROR "No descriptors were sampled for the PCA"
+#define PCA_EIGEN_ERROR "PCA eigen decomposition failed"
+#define FULL_SAMPLE_RATE 100
+#define QUEUE_SLOTS_PER_THREAD 2
+#define MAX_IMAGE_EDGE_ERROR "Maximal image edge couldn't be resolved"
+#define DECODE_SCOPE_ERROR "Reduced decode scope couldn't be resolved"
+#define PCA_FORMAT_ERROR "PCA file format couldn't be resolved"
+#define DESCRIPTOR_TYPE_ERROR "Descriptor type couldn't be resolved"
+#define PCA_WRITE_ERROR "PCA file couldn't be written"
+#define PCA_BINARY_CORRUPT "PCA file is corrupt"
+#define PCA_DIM_MISMATCH "PCA file dimension doesn't match spPCADimension"
+#define PCA_DIM_REFIT_WARNING "PCA file dimension doesn't match spPCADimension, the PCA is computed again and every image is extracted again"
+#define PCA_BINARY_MAGIC "SPPCA001"
+#define PCA_BINARY_MAGIC_LENGTH 8
+
+// The header of a binary PCA file, followed by the mean (length floats),
+// the eigenvectors (dim rows of length floats) and the eigenvalues (dim floats)
+struct PCABinaryHeader {
+	char magic[PCA_BINARY_MAGIC_LENGTH];
+	int dim;
+	int length;
+};
+#define BYTES_PER_MB (1024 * 1024)
 
 void sp::ImageProc::initFromConfig(const SPConfig config) {
 	SP_CONFIG_MSG msg = SP_CONFIG_SUCCESS;
@@ -56,73 +90,409 @@ void sp::ImageProc::initFromConfig(const SPConfig config) {
 		spLoggerPrintError(MINIMAL_GUI_ERROR, __FILE__, __func__, __LINE__);
 		throw Exception();
 	}
+	numOfThreads = spConfigGetNumOfThreads(config, &msg);
+	if (msg != SP_CONFIG_SUCCESS) {
+		spLoggerPrintError(NUM_OF_THREADS_ERROR, __FILE__, __func__, __LINE__);
+		throw Exception();
+	}
+	if (numOfThreads <= 0) {
+		numOfThreads = std::max(1, (int) std::thread::hardware_concurrency());
+	}
+	int cacheMB = spConfigGetDescriptorCacheMB(config, &msg);
+	if (msg != SP_CONFIG_SUCCESS) {
+		spLoggerPrintError(DESCRIPTOR_CACHE_ERROR, __FILE__, __func__, __LINE__);
+		throw Exception();
+	}
+	descriptorCacheLimit = (size_t) cacheMB * BYTES_PER_MB;
+	descriptorCacheSize = 0;
+	sampleRate = spConfigGetPCASampleRate(config, &msg);
+	if (msg != SP_CONFIG_SUCCESS) {
+		spLoggerPrintError(SAMPLE_RATE_ERROR, __FILE__, __func__, __LINE__);
+		throw Exception();
+	}
+	queryMaxEdge = spConfigGetMaxImageEdge(config, &msg);
+	if (msg != SP_CONFIG_SUCCESS) {
+		spLoggerPrintError(MAX_IMAGE_EDGE_ERROR, __FILE__, __func__, __LINE__);
+		throw Exception();
+	}
+	SP_DECODE_SCOPE scope = spConfigGetReducedDecodeScope(config, &msg);
+	if (msg != SP_CONFIG_SUCCESS) {
+		spLoggerPrintError(DECODE_SCOPE_ERROR, __FILE__, __func__, __LINE__);
+		throw Exception();
+	}
+	databaseMaxEdge = scope == SP_DECODE_ALL ? queryMaxEdge : 0;
+	descriptorType = spConfigGetDescriptorType(config, &msg);
+	if (msg != SP_CONFIG_SUCCESS) {
+		spLoggerPrintError(DESCRIPTOR_TYPE_ERROR, __FILE__, __func__, __LINE__);
+		throw Exception();
+	}
+	featureDim = descriptorType == SP_DESCRIPTOR_ORB ? SP_ORB_DESCRIPTOR_BYTES : pcaDim;
+}
+
+void sp::ImageProc::scaleImage(Mat& img, bool query) {
+	//Scale the image down so its long edge is at most maxEdge, SIFT then
+	//runs over a smaller pyramid
+	int maxEdge = query ? queryMaxEdge : databaseMaxEdge;
+	int longEdge = std::max(img.rows, img.cols);
+	if (maxEdge > 0 && longEdge > maxEdge) {
+		double scale = (double) maxEdge / longEdge;
+		Mat scaled;
+		resize(img, scaled, Size(), scale, scale, INTER_AREA);
+		img = scaled;
+	}
+}
+
+void sp::ImageProc::describeImage(const Mat& img, Mat& descriptors) {
+	//To store the keypoints that will be extracted by SIFT
+	vector<KeyPoint> keypoints;
+	if (descriptorType == SP_DESCRIPTOR_ORB) {
+		//The ORB extractor, kept by every thread like the SIFT one
+		static thread_local Ptr<ORB> orb;
+		static thread_local int orbFeatures = 0;
+		if (!orb || orbFeatures != numOfFeatures) {
+			orb = ORB::create(numOfFeatures);
+			orbFeatures = numOfFeatures;
+		}
+		orb->detectAndCompute(img, noArray(), keypoints, descriptors);
+		return;
+	}
+	//The SIFT feature extractor and descriptor, every thread creates its own
+	//on first use and keeps it for the following images
+	static thread_local Ptr<xfeatures2d::SiftDescriptorExtractor> detector;
+	static thread_local int detectorFeatures = 0;
+	if (!detector || detectorFeatures != numOfFeatures) {
+		detector = xfeatures2d::SIFT::create(numOfFeatures);
+		detectorFeatures = numOfFeatures;
+	}
+	//detect the feature points and compute their descriptors in one pass
+	detector->detectAndCompute(img, noArray(), keypoints, descriptors);
+}
+
+bool sp::ImageProc::computeDescriptors(const char* imagePath, Mat& descriptors,
+		bool query) {
+	//The image is released as soon as its descriptors are computed
+	Mat img = imread(imagePath, IMREAD_GRAYSCALE);
+	if (img.empty()) {
+		return false;
+	}
+	scaleImage(img, query);
+	describeImage(img, descriptors);
+	return true;
+}
+
+void sp::ImageProc::accumulateCovariance(const Mat& descriptors,
+		CovarianceSums& sums) {
+	sums.sum = Mat::zeros(1, DESCRIPTOR_LENGTH, CV_64F);
+	sums.outerSum = Mat::zeros(DESCRIPTOR_LENGTH, DESCRIPTOR_LENGTH, CV_64F);
+	sums.count = 0;
+	double* sum = sums.sum.ptr<double>(0);
+	double row[DESCRIPTOR_LENGTH];
+	for (int i = 0; i < descriptors.rows; i++) {
+		//sampleRate percent of the rows are taken, evenly spaced, so the
+		//sample is the same on every run
+		if ((i + 1) * sampleRate / FULL_SAMPLE_RATE
+				== i * sampleRate / FULL_SAMPLE_RATE) {
+			continue;
+		}
+		const float* descriptor = descriptors.ptr<float>(i);
+		for (int j = 0; j < DESCRIPTOR_LENGTH; j++) {
+			row[j] = (double) descriptor[j];
+			sum[j] += row[j];
+		}
+		//only the upper triangle, fitPCA mirrors it
+		for (int j = 0; j < DESCRIPTOR_LENGTH; j++) {
+			double* outer = sums.outerSum.ptr<double>(j);
+			for (int k = j; k < DESCRIPTOR_LENGTH; k++) {
+				outer[k] += row[j] * row[k];
+			}
+		}
+		sums.count++;
+	}
+}
+
+void sp::ImageProc::fitPCA(const CovarianceSums& sums) {
+	if (sums.count == 0) {
+		spLoggerPrintError(NO_DESCRIPTORS_ERROR, __FILE__, __func__, __LINE__);
+		throw Exception();
+	}
+	//covariance = E[x^T * x] - mean^T * mean, the same scaling as cv::PCA
+	Mat mean = sums.sum / (double) sums.count;
+	Mat covariance(DESCRIPTOR_LENGTH, DESCRIPTOR_LENGTH, CV_64F);
+	const double* m = mean.ptr<double>(0);
+	for (int j = 0; j < DESCRIPTOR_LENGTH; j++) {
+		for (int k = j; k < DESCRIPTOR_LENGTH; k++) {
+			double value = sums.outerSum.at<double>(j, k) / sums.count
+					- m[j] * m[k];
+			covariance.at<double>(j, k) = value;
+			covariance.at<double>(k, j) = value;
+		}
+	}
+	//eigenvalues are returned in descending order, eigenvectors as rows
+	Mat eigenvalues, eigenvectors;
+	if (!eigen(covariance, eigenvalues, eigenvectors)) {
+		spLoggerPrintError(PCA_EIGEN_ERROR, __FILE__, __func__, __LINE__);
+		throw Exception();
+	}
+	mean.convertTo(pca.mean, CV_32F);
+	eigenvalues.rowRange(0, pcaDim).convertTo(pca.eigenvalues, CV_32F);
+	eigenvectors.rowRange(0, pcaDim).convertTo(pca.eigenvectors, CV_32F);
 }
 
-void sp::ImageProc::getImagesMat(vector<Mat>& images, const SPConfig config) {
+void sp::ImageProc::getFeatures(const SPConfig config, CovarianceSums& sums) {
 	char warningMSG[WARNING_MSG_LENGTH] = { '\0' };
+	rawDescriptors.resize(numOfImages);
+	sums.sum = Mat::zeros(1, DESCRIPTOR_LENGTH, CV_64F);
+	sums.outerSum = Mat::zeros(DESCRIPTOR_LENGTH, DESCRIPTOR_LENGTH, CV_64F);
+	sums.count = 0;
+	vector<string> imagePaths(numOfImages);
 	for (int i = 0; i < numOfImages; i++) {
 		char imagePath[STRING_LENGTH + 1] = { '\0' };
 		if (spConfigGetImagePath(imagePath, config, i) != SP_CONFIG_SUCCESS) {
 			spLoggerPrintError(IMAGE_PATH_ERROR, __FILE__, __func__, __LINE__);
 			throw Exception();
 		}
-		Mat img = imread(imagePath, IMREAD_GRAYSCALE);
-		if (img.empty()) {
-			sprintf(warningMSG, "%s %s", imagePath, IMAGE_NOT_EXIST_MSG);
-			spLoggerPrintWarning(warningMSG, __FILE__, __func__, __LINE__);
-			continue;
+		imagePaths[i] = imagePath;
+	}
+
+	//An image on its way through preprocessing, the image i waits in slot
+	//i % window until the images before it were reduced
+	struct PreprocessedImage {
+		Mat descriptors;
+		CovarianceSums sums;
+		bool decoded;
+		bool done;
+		PreprocessedImage() : decoded(false), done(false) {
 		}
-		images.push_back(img);
+	};
+	//The workers are started once, so every one of them creates its feature
+	//detector once, and take the images from a queue. No more than window
+	//images are in flight, and their decoded images are released as soon as
+	//their descriptors are computed
+	int workersAmount = std::max(1, std::min(numOfThreads, numOfImages));
+	int window = workersAmount * QUEUE_SLOTS_PER_THREAD;
+	vector<PreprocessedImage> slots(window);
+	BoundedQueue<int> jobs(window);
+	std::mutex doneMutex;
+	std::condition_variable doneChanged;
+	vector<std::thread> workers;
+	for (int i = 0; i < workersAmount; i++) {
+		workers.push_back(std::thread([this, window, &imagePaths, &slots, &jobs,
+				&doneMutex, &doneChanged]() {
+			int index;
+			while (jobs.pop(index)) {
+				PreprocessedImage& slot = slots[index % window];
+				slot.decoded = computeDescriptors(imagePaths[index].c_str(),
+						slot.descriptors, false);
+				if (slot.decoded) {
+					accumulateCovariance(slot.descriptors, slot.sums);
+				}
+				std::lock_guard<std::mutex> lock(doneMutex);
+				slot.done = true;
+				doneChanged.notify_all();
+			}
+		}));
 	}
-}
 
-void sp::ImageProc::getFeatures(vector<Mat>& images, Mat& features) {
-	//To store the keypoints that will be extracted by SIFT
-	vector<KeyPoint> keypoints;
-	//To store the SIFT descriptor of current image
-	Mat descriptor;
-	//To store all the descriptors that are extracted from all the images.
+	try {
+		for (int next = 0; next < std::min(window, numOfImages); next++) {
+			int index = next;
+			jobs.push(std::move(index));
+		}
+		//reduce the per image sums in image order, so the PCA doesn't depend
+		//on the scheduling of the threads
+		for (int i = 0; i < numOfImages; i++) {
+			PreprocessedImage& slot = slots[i % window];
+			{
+				std::unique_lock<std::mutex> lock(doneMutex);
+				doneChanged.wait(lock, [&slot]() {return slot.done;});
+				slot.done = false;
+			}
+			if (!slot.decoded) {
+				sprintf(warningMSG, "%s %s", imagePaths[i].c_str(), IMAGE_NOT_EXIST_MSG);
+				spLoggerPrintWarning(warningMSG, __FILE__, __func__, __LINE__);
+			} else {
+				sums.sum += slot.sums.sum;
+				sums.outerSum += slot.sums.outerSum;
+				sums.count += slot.sums.count;
+				//keep them for the extraction of this image
+				rawDescriptors[i].imagePath = imagePaths[i];
+				storeRawDescriptors(i, slot.descriptors);
+			}
+			slot.descriptors.release();
+			//the slot is free, so the image window images ahead may take it
+			int next = i + window;
+			if (next < numOfImages) {
+				jobs.push(std::move(next));
+			}
+		}
+	} catch (...) {
+		//the workers finish the images they were given and stop
+		jobs.close();
+		for (size_t i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
+		throw;
+	}
+	jobs.close();
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+}
 
-	//The SIFT feature extractor and descriptor
-	Ptr<xfeatures2d::SiftDescriptorExtractor> detector =
-			xfeatures2d::SIFT::create(numOfFeatures);
+void sp::ImageProc::storeRawDescriptors(int index, const Mat& descriptors) {
+	RawDescriptors& raw = rawDescriptors[index];
+	size_t size = descriptors.total() * descriptors.elemSize();
+	raw.rows = descriptors.rows;
+	if (descriptorCacheSize + size <= descriptorCacheLimit) {
+		raw.descriptors = descriptors;
+		raw.spillOffset = -1;
+		descriptorCacheSize += size;
+		return;
+	}
+	// Over the memory budget, append the descriptors to the spill file
+	if (!spillFile && !(spillFile = tmpfile())) {
+		spLoggerPrintError(SPILL_FILE_ERROR, __FILE__, __func__, __LINE__);
+		throw Exception();
+	}
+	Mat continuous = descriptors.isContinuous() ? descriptors : descriptors.clone();
+	if (fseek(spillFile, 0, SEEK_END) != 0
+			|| (raw.spillOffset = ftell(spillFile)) < 0
+			|| fwrite(continuous.data, 1, size, spillFile) != size) {
+		spLoggerPrintError(SPILL_FILE_ERROR, __FILE__, __func__, __LINE__);
+		throw Exception();
+	}
+}
 
-	//feature descriptors and build the vocabulary
-	for (int i = 0; i < static_cast<int>(images.size()); i++) {
-		//detect feature points
-		detector->detect(images[i], keypoints);
-		//compute the descriptors for each keypoint
-		detector->compute(images[i], keypoints, descriptor);
-		//put the all feature descriptors in a single Mat object
-		features.push_back(descriptor);
+bool sp::ImageProc::takeRawDescriptors(int index, const char* imagePath,
+		Mat& descriptors) {
+	if (index < 0 || index >= static_cast<int>(rawDescriptors.size())
+			|| rawDescriptors[index].imagePath != imagePath) {
+		return false;
+	}
+	RawDescriptors& raw = rawDescriptors[index];
+	bool success = true;
+	if (raw.spillOffset < 0) {
+		descriptors = raw.descriptors;
+		std::lock_guard<std::mutex> lock(spillMutex);
+		descriptorCacheSize -= descriptors.total() * descriptors.elemSize();
+	} else {
+		descriptors.create(raw.rows, DESCRIPTOR_LENGTH, CV_32F);
+		size_t size = descriptors.total() * descriptors.elemSize();
+		std::lock_guard<std::mutex> lock(spillMutex);
+		if (fseek(spillFile, raw.spillOffset, SEEK_SET) != 0
+				|| fread(descriptors.data, 1, size, spillFile) != size) {
+			spLoggerPrintWarning(SPILL_READ_ERROR, __FILE__, __func__, __LINE__);
+			descriptors.release();
+			success = false;
+		}
 	}
+	// Every database image is extracted once, so release its descriptors, and
+	// the caller computes them again from the image if they couldn't be read
+	raw.imagePath.clear();
+	raw.descriptors.release();
+	return success;
 }
 
 void sp::ImageProc::preprocess(const SPConfig config) {
 	try {
-		vector<Mat> images;
-		Mat features;
+		CovarianceSums sums;
 		char pcaPath[STRING_LENGTH + 1] = { '\0' };
-		getImagesMat(images, config);
-		getFeatures(images, features);
-		pca = PCA(features, Mat(), CV_PCA_DATA_AS_ROW, pcaDim);
+		SP_CONFIG_MSG msg = SP_CONFIG_SUCCESS;
+		SP_PCA_FILE_FORMAT format = spConfigGetPCAFileFormat(config, &msg);
+		if (msg != SP_CONFIG_SUCCESS) {
+			spLoggerPrintError(PCA_FORMAT_ERROR, __FILE__, __func__, __LINE__);
+			throw Exception();
+		}
+		getFeatures(config, sums);
+		fitPCA(sums);
 		if (spConfigGetPCAPath(pcaPath, config) != SP_CONFIG_SUCCESS) {
 			spLoggerPrintError(PCA_FILE_NOT_RESOLVED, __FILE__, __func__,
 			__LINE__);
 			throw Exception();
 		}
-		FileStorage fs(pcaPath, FileStorage::WRITE);
-		fs << PCA_EIGEN_VEC_STR << pca.eigenvectors;
-		fs << PCA_EIGEN_VAL_STR << pca.eigenvalues;
-		fs << PCA_MEAN_STR << pca.mean;
-		fs.release();
+		if (format == SP_PCA_BINARY) {
+			savePCABinary(pcaPath);
+		} else {
+			FileStorage fs(pcaPath, FileStorage::WRITE);
+			fs << PCA_EIGEN_VEC_STR << pca.eigenvectors;
+			fs << PCA_EIGEN_VAL_STR << pca.eigenvalues;
+			fs << PCA_MEAN_STR << pca.mean;
+			fs.release();
+		}
 	} catch (...) {
 		spLoggerPrintError(GENERAL_ERROR_MSG, __FILE__, __func__, __LINE__);
 		throw Exception();
 	}
 }
 
-void sp::ImageProc::initPCAFromFile(const SPConfig config) {
+void sp::ImageProc::savePCABinary(const char* pcaPath) {
+	PCABinaryHeader header;
+	memcpy(header.magic, PCA_BINARY_MAGIC, PCA_BINARY_MAGIC_LENGTH);
+	header.dim = pca.eigenvectors.rows;
+	header.length = pca.eigenvectors.cols;
+	//clone() makes every part continuous so it's written with one fwrite
+	Mat parts[] = { pca.mean.clone(), pca.eigenvectors.clone(),
+			pca.eigenvalues.clone() };
+	FILE* file = fopen(pcaPath, "wb");
+	bool success = file && fwrite(&header, sizeof(header), 1, file) == 1;
+	for (int i = 0; success && i < 3; i++) {
+		size_t size = parts[i].total() * parts[i].elemSize();
+		success = fwrite(parts[i].data, 1, size, file) == size;
+	}
+	if (file && fclose(file) != 0) {
+		success = false;
+	}
+	if (!success) {
+		spLoggerPrintError(PCA_WRITE_ERROR, __FILE__, __func__, __LINE__);
+		throw Exception();
+	}
+}
+
+bool sp::ImageProc::loadPCABinary(const char* pcaPath) {
+	FILE* file = fopen(pcaPath, "rb");
+	if (!file) {
+		return false;
+	}
+	//the whole file is read with a single fread
+	vector<char> content;
+	long fileSize = -1;
+	if (fseek(file, 0, SEEK_END) == 0 && (fileSize = ftell(file)) >= 0
+			&& fseek(file, 0, SEEK_SET) == 0) {
+		content.resize(fileSize);
+		if (fileSize > 0 && fread(content.data(), 1, fileSize, file)
+				!= (size_t) fileSize) {
+			fileSize = -1;
+		}
+	}
+	fclose(file);
+	PCABinaryHeader header;
+	if (fileSize < (long) sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, content.data(), sizeof(header));
+	if (memcmp(header.magic, PCA_BINARY_MAGIC, PCA_BINARY_MAGIC_LENGTH) != 0) {
+		return false;
+	}
+	size_t floats = (size_t) header.length * (header.dim + 1) + header.dim;
+	if (header.dim <= 0 || header.length <= 0
+			|| (size_t) fileSize != sizeof(header) + floats * sizeof(float)) {
+		spLoggerPrintError(PCA_BINARY_CORRUPT, __FILE__, __func__, __LINE__);
+		throw Exception();
+	}
+	const char* data = content.data() + sizeof(header);
+	pca.mean.create(1, header.length, CV_32F);
+	pca.eigenvectors.create(header.dim, header.length, CV_32F);
+	pca.eigenvalues.create(header.dim, 1, CV_32F);
+	Mat* parts[] = { &pca.mean, &pca.eigenvectors, &pca.eigenvalues };
+	for (int i = 0; i < 3; i++) {
+		size_t size = parts[i]->total() * parts[i]->elemSize();
+		memcpy(parts[i]->data, data, size);
+		data += size;
+	}
+	return true;
+}
+
+void sp::ImageProc::loadPCAFile(const SPConfig config) {
 	if (!config) {
 		spLoggerPrintError(GENERAL_ERROR_MSG, __FILE__, __func__, __LINE__);
 		throw Exception();
@@ -132,30 +502,74 @@ void sp::ImageProc::initPCAFromFile(const SPConfig config) {
 		spLoggerPrintError(PCA_FILE_NOT_RESOLVED, __FILE__, __func__, __LINE__);
 		throw Exception();
 	}
-	FileStorage fs(pcaFilename, FileStorage::READ);
-	if (!fs.isOpened()) {
-		spLoggerPrintError(PCA_FILE_NOT_EXIST, __FILE__, __func__, __LINE__);
+	//binary PCA files are recognized by their header, anything else is YAML
+	if (!loadPCABinary(pcaFilename)) {
+		FileStorage fs(pcaFilename, FileStorage::READ);
+		if (!fs.isOpened()) {
+			spLoggerPrintError(PCA_FILE_NOT_EXIST, __FILE__, __func__, __LINE__);
+			throw Exception();
+		}
+		fs[PCA_EIGEN_VEC_STR] >> pca.eigenvectors;
+		fs[PCA_EIGEN_VAL_STR] >> pca.eigenvalues;
+		fs[PCA_MEAN_STR] >> pca.mean;
+		fs.release();
+	}
+}
+
+void sp::ImageProc::initPCAFromFile(const SPConfig config) {
+	loadPCAFile(config);
+	//the features are projected into buffers of pcaDim floats per row
+	if (pca.eigenvectors.rows != pcaDim) {
+		spLoggerPrintError(PCA_DIM_MISMATCH, __FILE__, __func__, __LINE__);
 		throw Exception();
 	}
-	fs[PCA_EIGEN_VEC_STR] >> pca.eigenvectors;
-	fs[PCA_EIGEN_VAL_STR] >> pca.eigenvalues;
-	fs[PCA_MEAN_STR] >> pca.mean;
-	fs.release();
 }
 
-sp::ImageProc::ImageProc(const SPConfig config) {
+bool sp::ImageProc::pcaFileExists(const SPConfig config) {
+	char pcaFilename[STRING_LENGTH + 1] = { '\0' };
+	if (spConfigGetPCAPath(pcaFilename, config) != SP_CONFIG_SUCCESS) {
+		return false;
+	}
+	FILE* file = fopen(pcaFilename, "r");
+	if (!file) {
+		return false;
+	}
+	fclose(file);
+	return true;
+}
+
+sp::ImageProc::ImageProc(const SPConfig config) :
+		spillFile(NULL) {
 	try {
 		if (!config) {
 			spLoggerPrintError(INVALID_ARG_ERROR, __FILE__, __func__, __LINE__);
 			throw Exception();
 		}
 		SP_CONFIG_MSG msg;
-		bool preprocMode = false;
 		initFromConfig(config);
-		if ((preprocMode = spConfigIsExtractionMode(config, &msg))) {
-			preprocess(config);
-		} else {
+		if (descriptorType == SP_DESCRIPTOR_ORB) {
+			//binary descriptors are used as they are, without a PCA
+			return;
+		}
+		if (!spConfigIsExtractionMode(config, &msg)) {
 			initPCAFromFile(config);
+			return;
+		}
+		bool reusePCA = spConfigIsIncrementalExtraction(config, &msg)
+				&& pcaFileExists(config);
+		if (reusePCA) {
+			loadPCAFile(config);
+			//a PCA of another dimension can't project the features, so it's
+			//fitted again, which changes the PCA file and with it the state
+			//hash of the manifest, so no .feats file is reused either
+			if (pca.eigenvectors.rows != pcaDim) {
+				spLoggerPrintWarning(PCA_DIM_REFIT_WARNING, __FILE__, __func__,
+						__LINE__);
+				reusePCA = false;
+			}
+		}
+		if (!reusePCA) {
+			preprocess(config);
 		}
 	} catch (...) {
 		spLoggerPrintError(GENERAL_ERROR_MSG, __FILE__, __func__, __LINE__);
@@ -163,48 +577,114 @@ sp::ImageProc::ImageProc(const SPConfig config) {
 	}
 }
 
-SPPoint* sp::ImageProc::getImageFeatures(const char* imagePath, int index,
+sp::ImageProc::~ImageProc() {
+	if (spillFile) {
+		fclose(spillFile);
+	}
+}
+
+void sp::ImageProc::projectDescriptors(const Mat& descriptors,
+		vector<float>& buffer) {
+	if (descriptors.rows == 0) {
+		return;
+	}
+	//the projection is written straight into buffer, which Mat wraps
+	buffer.resize((size_t) descriptors.rows * featureDim);
+	Mat points(descriptors.rows, featureDim, CV_32F, buffer.data());
+	if (descriptorType == SP_DESCRIPTOR_ORB) {
+		//binary descriptors aren't projected, every byte is a coordinate
+		descriptors.convertTo(points, CV_32F);
+		return;
+	}
+	pca.project(descriptors, points);
+}
+
+SPPoint* sp::ImageProc::createPoints(const Mat& descriptors, int index,
 		int* numOfFeats) {
-	vector<KeyPoint> keypoints;
-	Mat descriptor, img, points;
-	double* pcaSift = NULL;
+	vector<float> projected;
+	vector<double> pcaSift(featureDim);
+	projectDescriptors(descriptors, projected);
+	*numOfFeats = descriptors.rows;
+	SPPoint* resPoints = (SPPoint*) malloc(sizeof(*resPoints) * *numOfFeats);
+	if (!resPoints) {
+		spLoggerPrintError(ALLOC_ERROR_MSG, __FILE__, __func__, __LINE__);
+		return NULL;
+	}
+	for (int i = 0; i < *numOfFeats; i++) {
+		const float* row = projected.data() + (size_t) i * featureDim;
+		for (int j = 0; j < featureDim; j++) {
+			pcaSift[j] = (double) row[j];
+		}
+		resPoints[i] = spPointCreate(pcaSift.data(), featureDim, index);
+		if (!resPoints[i]) {
+			for (int k = 0; k < i; k++) {
+				spPointDestroy(resPoints[k]);
+			}
+			free(resPoints);
+			spLoggerPrintError(ALLOC_ERROR_MSG, __FILE__, __func__, __LINE__);
+			return NULL;
+		}
+	}
+	return resPoints;
+}
+
+bool sp::ImageProc::getImageFeatures(const char* imagePath, int index,
+		vector<float>& buffer, int* numOfFeats, bool query) {
+	Mat descriptor;
 	char errorMSG[STRING_LENGTH * 2];
-	Ptr<xfeatures2d::SiftDescriptorExtractor> detector;
 	if (!imagePath || !numOfFeats) {
 		spLoggerPrintError(INVALID_ARG_ERROR, __FILE__, __func__, __LINE__);
-		return NULL;
+		return false;
 	}
-	img = imread(imagePath, IMREAD_GRAYSCALE);
-	if (img.empty()) {
+	if ((query || !takeRawDescriptors(index, imagePath, descriptor))
+			&& !computeDescriptors(imagePath, descriptor, query)) {
 		sprintf(errorMSG, "%s %s", imagePath, IMAGE_NOT_EXIST_MSG);
 		spLoggerPrintError(errorMSG, __FILE__, __func__, __LINE__);
-		return NULL;
+		return false;
 	}
-	detector = xfeatures2d::SIFT::create(numOfFeatures);
-	detector->detect(img, keypoints);
-	detector->compute(img, keypoints, descriptor);
-	points = pca.project(descriptor);
-	pcaSift = (double*) malloc(sizeof(double) * pcaDim);
-	if (!pcaSift) {
-		spLoggerPrintError(ALLOC_ERROR_MSG, __FILE__, __func__, __LINE__);
-		return NULL;
+	*numOfFeats = descriptor.rows;
+	projectDescriptors(descriptor, buffer);
+	return true;
+}
+
+bool sp::ImageProc::hasRawDescriptors(int index, const char* imagePath) {
+	return imagePath && index >= 0
+			&& index < static_cast<int>(rawDescriptors.size())
+			&& rawDescriptors[index].imagePath == imagePath;
+}
+
+bool sp::ImageProc::decodeImage(const vector<unsigned char>& bytes, Mat& image,
+		bool query) {
+	if (bytes.empty()) {
+		return false;
 	}
-	*numOfFeats = points.rows;
-	SPPoint* resPoints = (SPPoint*) malloc(sizeof(*resPoints) * points.rows);
-	if (!resPoints) {
-		free(pcaSift);
-		spLoggerPrintError(ALLOC_ERROR_MSG, __FILE__, __func__, __LINE__);
+	image = imdecode(bytes, IMREAD_GRAYSCALE);
+	if (image.empty()) {
+		return false;
+	}
+	scaleImage(image, query);
+	return true;
+}
+
+SPPoint* sp::ImageProc::getImageFeatures(const Mat& image, const char* imagePath,
+		int index, int* numOfFeats) {
+	Mat descriptor;
+	char errorMSG[STRING_LENGTH * 2];
+	if (!imagePath || !numOfFeats) {
+		spLoggerPrintError(INVALID_ARG_ERROR, __FILE__, __func__, __LINE__);
 		return NULL;
 	}
-	for (int i = 0; i < points.rows; i++) {
-		for (int j = 0; j < points.cols; j++) {
-			pcaSift[j] = (double) points.at<float>(i, j);
+	if (!takeRawDescriptors(index, imagePath, descriptor)) {
+		//an image whose kept descriptors couldn't be read wasn't decoded
+		if (!image.empty()) {
+			describeImage(image, descriptor);
+		} else if (!computeDescriptors(imagePath, descriptor, false)) {
+			sprintf(errorMSG, "%s %s", imagePath, IMAGE_NOT_EXIST_MSG);
+			spLoggerPrintError(errorMSG, __FILE__, __func__, __LINE__);
+			return NULL;
 		}
-		resPoints[i] = spPointCreate(pcaSift, pcaDim, index);
 	}
-	// TODO: delete if they don't update, the following line is ours
-	//free(pcaSift);
-	return resPoints;
+	return createPoints(descriptor, index, numOfFeats);
 }
 
 void sp::ImageProc::showImage(const char* imgPath) {
@@ -2,6 +2,9 @@
 #define SPIMAGEPROC_H_
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
+#include <cstdio>
+#include <mutex>
+#include <string>
 #include <vector>
 
 extern "C" {
@@ -20,37 +23,145 @@ private:
 	int pcaDim;
 	int numOfImages;
 	int numOfFeatures;
+	int numOfThreads;
 	cv::PCA pca;
 	bool minimalGui;
+	// The SIFT descriptors of a database image, computed during preprocessing
+	struct RawDescriptors {
+		std::string imagePath;
+		cv::Mat descriptors;
+		long spillOffset; // -1 if the descriptors are held in memory
+		int rows;
+	};
+	std::vector<RawDescriptors> rawDescriptors;
+	size_t descriptorCacheLimit;
+	size_t descriptorCacheSize; // the bytes of the descriptors held in memory
+	FILE* spillFile;
+	std::mutex spillMutex; // guards the spill file and descriptorCacheSize
+	int sampleRate;
+	SP_DESCRIPTOR_TYPE descriptorType;
+	int featureDim; // pcaDim for SIFT, the descriptor length in bytes for ORB
+	int queryMaxEdge;    // 0 if query images are decoded at full resolution
+	int databaseMaxEdge; // 0 if database images are decoded at full resolution
+	// Running sums over the descriptors sampled for the PCA, so the PCA is
+	// fitted without holding all the descriptors in memory
+	struct CovarianceSums {
+		cv::Mat sum;      // 1 x descriptor length, sum of the descriptors
+		cv::Mat outerSum; // descriptor length squared, sum of x^T * x
+		long count;
+	};
 	void initFromConfig(const SPConfig);
-	void getImagesMat(std::vector<cv::Mat>&, const SPConfig);
-	void getFeatures(std::vector<cv::Mat>&,
-			cv::Mat&);
+	void scaleImage(cv::Mat& img, bool query);
+	void describeImage(const cv::Mat& img, cv::Mat& descriptors);
+	bool computeDescriptors(const char* imagePath, cv::Mat& descriptors,
+			bool query);
+	void projectDescriptors(const cv::Mat& descriptors, std::vector<float>& buffer);
+	SPPoint* createPoints(const cv::Mat& descriptors, int index, int* numOfFeats);
+	void accumulateCovariance(const cv::Mat& descriptors, CovarianceSums& sums);
+	void fitPCA(const CovarianceSums& sums);
+	void getFeatures(const SPConfig, CovarianceSums&);
+	void storeRawDescriptors(int index, const cv::Mat& descriptors);
+	bool takeRawDescriptors(int index, const char* imagePath, cv::Mat& descriptors);
 	void preprocess(const SPConfig config);
+	void loadPCAFile(const SPConfig config);
 	void initPCAFromFile(const SPConfig config);
+	void savePCABinary(const char* pcaPath);
+	bool loadPCABinary(const char* pcaPath);
+	bool pcaFileExists(const SPConfig config);
 public:
 
 	/**
 	 * Creates a new object for the purpose of image processing based
-	 * on the configuration file.
+	 * on the configuration file. In extraction mode the PCA is computed
+	 * over all the images, unless incremental extraction is set and the
+	 * PCA file already exists, in which case it is reused. A PCA file of
+	 * another dimension than spPCADimension isn't reused: the PCA is
+	 * computed again, and a warning is logged. ORB descriptors
+	 * (spDescriptorType = ORB) use no PCA: every feature holds the bytes of
+	 * its binary descriptor as coordinates.
 	 * @param config - the configuration file from which the object is created
 	 */
 	ImageProc(const SPConfig config);
 
 	/**
-	 * Returns an array of features for the image imagePath. All SPPoint elements
-	 * will have the index given by index. The actual number of features extracted
-	 * for this image will be stored in the pointer given by numOfFeats.
+	 * Frees all resources associated with the object.
+	 */
+	~ImageProc();
+
+	/**
+	 * Extracts the features of the image imagePath and writes their PCA
+	 * projection straight into buffer: the features are stored contiguously,
+	 * row after row, each row of PCA dimension floats, or of the descriptor
+	 * length for ORB. buffer is resized as needed, so a caller reusing it
+	 * across calls doesn't allocate per image or per feature. The actual
+	 * number of features extracted for this image will be stored in the
+	 * pointer given by numOfFeats.
+	 * This function may be called concurrently from several threads, every
+	 * thread keeps its own feature detector across calls.
+	 * The SIFT descriptors of every database image are computed only once:
+	 * if preprocessing already computed them for the image given by index and
+	 * imagePath, they're projected without decoding the image again.
+	 * If spMaxImageEdge is set, the image is scaled down before its features
+	 * are extracted. Query images are always scaled, database images only
+	 * if spReducedDecodeScope is ALL.
 	 *
 	 * @param imagePath - the target imagePath
 	 * @param index - the index  of the image in the database
+	 * @param buffer - the buffer in which the projected features are stored
+	 * @param numOfFeats - a pointer in which the actual number of feats extracted
+	 * 					   will be stored
+	 * @param query - true if imagePath is a query image rather than a database
+	 * 				  image
+	 * @return
+	 * true in case of success, false in case of an error.
+	 */
+	bool getImageFeatures(const char* imagePath, int index,
+			std::vector<float>& buffer, int* numOfFeats, bool query = false);
+
+	/**
+	 * Checks whether preprocessing kept the SIFT descriptors of the database
+	 * image given by index and imagePath, in which case its features can be
+	 * extracted without decoding the image.
+	 *
+	 * @param index - the index of the image in the database
+	 * @param imagePath - the path of the image
+	 * @return
+	 * true if the descriptors are kept, false otherwise.
+	 */
+	bool hasRawDescriptors(int index, const char* imagePath);
+
+	/**
+	 * Decodes a database image from the content of its file, in grayscale and
+	 * scaled down like the images decoded by getImageFeatures.
+	 * This function may be called concurrently from several threads.
+	 *
+	 * @param bytes - the content of the image file
+	 * @param image - the decoded image is stored in image
+	 * @param query - true if the image is a query image rather than a database
+	 * 				  image
+	 * @return
+	 * true in case of success, false if the image couldn't be decoded.
+	 */
+	bool decodeImage(const std::vector<unsigned char>& bytes, cv::Mat& image,
+			bool query = false);
+
+	/**
+	 * Returns an array of features for a database image which was already
+	 * decoded by decodeImage. If hasRawDescriptors is true for the image,
+	 * image may be empty and the kept descriptors are used instead, or the
+	 * image is decoded from imagePath if they can't be read back.
+	 *
+	 * @param image - the decoded image
+	 * @param imagePath - the path of the image
+	 * @param index - the index  of the image in the database
 	 * @param numOfFeats - a pointer in which the actual number of feats extracted
 	 * 					   will be stored
 	 * @return
 	 * An array of the actual features extracted. NULL is returned in case of
 	 * an error.
 	 */
-	SPPoint* getImageFeatures(const char* imagePath,int index,int* numOfFeats);
+	SPPoint* getImageFeatures(const cv::Mat& image, const char* imagePath,
+			int index, int* numOfFeats);
 
 	/**
 	 *	Displays the image given by imagePath. Notice that this function works
@@ -0,0 +1,1214 @@
+#define _GNU_SOURCE // For pthread_rwlock_t and its writer preference
+#include <pthread.h>
+#include "SPIndex.h"
+#include "SPKDTree.h"
+#include "SPMultiIndexHash.h"
+#include "SPBruteForce.h"
+#include "SPHNSW.h"
+#include "SPIVFPQ.h"
+#include "SPBagOfWords.h"
+#include "SPKMeansTree.h"
+#include "SPLSH.h"
+#include "SPVPTree.h"
+
+// The inserted features are kept in chunks of this many rows, so an insert
+// builds the last chunk again, not all of them
+#define DELTA_CHUNK_ROWS 1024
+
+/*
+ * The main index: a search structure built over a store at once
+ */
+typedef struct sp_index_base_t
+{
+	SP_INDEX_TYPE type;
+	SPPointStore store;
+	SPKDTreeNode kdTree;
+	SPMultiIndexHash mih;
+	SPBruteForce bruteForce; // the BRUTE_FORCE search, or the ground truth of the others
+	SPHNSW hnsw;
+	int efSearch;
+	SPIVFPQ ivfpq;
+	int probes;
+	SPBagOfWords bow;
+	SPKMeansTree kmeansTree;
+	int checks;
+	SPLSH lsh;
+	int lshProbes;
+	SPVPTree vpTree;
+} SPIndexBase;
+
+/*
+ * Inserted features and a brute force search over them
+ */
+typedef struct sp_index_chunk_t
+{
+	SPPointStore store;
+	SPBruteForce search;
+} SPIndexChunk;
+
+struct sp_index_t
+{
+	SPIndexBase* base;
+	SPIndexChunk* delta; // the features inserted since the main index was built,
+	                     // DELTA_CHUNK_ROWS in every chunk but the last
+	int deltaChunks;
+	int deltaCapacity;
+	int deltaSize;
+	SPBitset deleted;   // the images deleted, which searches pass over
+	int deletedFeatures; // the features of the deleted images still stored
+	SPConfig config;
+	int imagesAmount;
+	int mergeThreshold;
+	int compactionPercent;
+	bool merging;
+	bool mergerStarted;
+	pthread_t merger;
+	pthread_rwlock_t lock;       // searches read, swaps of the parts above write
+	pthread_mutex_t insertLock;  // serializes the changes of the parts above
+	unsigned long long version;
+};
+
+// The version of the last index created or changed
+static unsigned long long lastVersion = 0;
+static pthread_mutex_t versionLock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned long long nextVersion()
+{
+	unsigned long long version;
+	pthread_mutex_lock(&versionLock);
+	version = ++lastVersion;
+	pthread_mutex_unlock(&versionLock);
+	return version;
+}
+
+static int intComp(const void* a, const void* b)
+{
+	return *(const int*) a - *(const int*) b;
+}
+
+/*
+ * Builds a KD-Tree over the rows of a REAL store. The tree is built from
+ * points, which are copied by the tree, so temporary points are created
+ * for the rows.
+ */
+static SPKDTreeNode spIndexCreateKDTree(SPPointStore store, const SPConfig config,
+		SP_INDEX_MSG* msg)
+{
+	int i, size = spPointStoreGetSize(store);
+	SPPoint* points;
+	SPKDTreeNode tree;
+	SP_KDTREE_MSG kdTreeMsg;
+	SP_CONFIG_MSG configMsg;
+	SP_KDTREE_SPLIT_METHOD splitMethod = spConfigGetKDTreeSplitMethod(config, &configMsg);
+
+	points = (SPPoint*) calloc(size, sizeof(SPPoint));
+	if (points == NULL)
+	{
+		*msg = SP_INDEX_ALLOC_FAIL;
+		return NULL;
+	}
+	for (i = 0; i < size; i++)
+	{
+		points[i] = spPointCreate((double*) spPointStoreGetRealRow(store, i),
+				spPointStoreGetDim(store), spPointStoreGetImageIndex(store, i));
+		if (points[i] == NULL)
+			break;
+	}
+	tree = i == size ? SPKDTreeInit(points, size, spPointStoreGetDim(store), splitMethod,
+			&kdTreeMsg) : NULL;
+	for (i = 0; i < size; i++)
+		spPointDestroy(points[i]);
+	free(points);
+	*msg = tree != NULL ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+	return tree;
+}
+
+static SP_INDEX_MSG spIndexKDTreeKNN(SPIndexBase* base, SPPointStore queries, int row,
+		SPBPQueue bpq)
+{
+	SPPoint query;
+	SP_KDTREE_MSG kdTreeMsg = SP_KDTREE_SUCCESS;
+	query = spPointCreate((double*) spPointStoreGetRealRow(queries, row),
+			spPointStoreGetDim(queries), 0);
+	if (query == NULL)
+		return SP_INDEX_ALLOC_FAIL;
+	SPKDTreeKNNRecursive(base->kdTree, query, bpq, &kdTreeMsg);
+	spPointDestroy(query);
+	return kdTreeMsg == SP_KDTREE_SUCCESS ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+}
+
+/*
+ * A query row and the path of its leaf in the KD-Tree
+ */
+typedef struct sp_index_leaf_path_t
+{
+	unsigned long long path;
+	int row;
+} SPIndexLeafPath;
+
+static int leafPathComp(const void* a, const void* b)
+{
+	const SPIndexLeafPath* x = (const SPIndexLeafPath*) a;
+	const SPIndexLeafPath* y = (const SPIndexLeafPath*) b;
+	if (x->path != y->path)
+		return x->path < y->path ? -1 : 1;
+	return x->row - y->row;
+}
+
+/*
+ * Searches the KD-Tree for every query row in the order of their leaves, so
+ * rows which descend the same way are searched one after the other while the
+ * nodes they share are still in the cache. The results don't depend on the
+ * order, every row fills its own queue.
+ */
+static SP_INDEX_MSG spIndexKDTreeKNNAll(SPIndexBase* base, SPPointStore queries, SPBPQueue* bpqs)
+{
+	int i, amount = spPointStoreGetSize(queries);
+	SPPoint query;
+	SPIndexLeafPath* paths;
+	SP_INDEX_MSG msg = SP_INDEX_SUCCESS;
+	paths = (SPIndexLeafPath*) malloc((amount > 0 ? amount : 1) * sizeof(SPIndexLeafPath));
+	if (paths == NULL)
+		return SP_INDEX_ALLOC_FAIL;
+	for (i = 0; i < amount; i++)
+	{
+		query = spPointCreate((double*) spPointStoreGetRealRow(queries, i),
+				spPointStoreGetDim(queries), 0);
+		if (query == NULL)
+		{
+			free(paths);
+			return SP_INDEX_ALLOC_FAIL;
+		}
+		paths[i].path = SPKDTreeLeafPath(base->kdTree, query);
+		paths[i].row = i;
+		spPointDestroy(query);
+	}
+	qsort(paths, amount, sizeof(SPIndexLeafPath), leafPathComp);
+	for (i = 0; i < amount && msg == SP_INDEX_SUCCESS; i++)
+		msg = spIndexKDTreeKNN(base, queries, paths[i].row, bpqs[paths[i].row]);
+	free(paths);
+	return msg;
+}
+
+static void spIndexBaseDestroy(SPIndexBase* base)
+{
+	if (base == NULL)
+		return;
+	SPKDTreeDestroy(base->kdTree);
+	spMultiIndexHashDestroy(base->mih);
+	spBruteForceDestroy(base->bruteForce);
+	spHNSWDestroy(base->hnsw);
+	spIVFPQDestroy(base->ivfpq);
+	spBagOfWordsDestroy(base->bow);
+	spKMeansTreeDestroy(base->kmeansTree);
+	spLSHDestroy(base->lsh);
+	spVPTreeDestroy(base->vpTree);
+	spPointStoreDestroy(base->store);
+	free(base);
+}
+
+/*
+ * Builds the main index of the type given by spIndexType over all the rows of
+ * store, which it takes ownership of, as spIndexCreate does.
+ */
+static SPIndexBase* spIndexBaseCreate(SPPointStore store, const SPConfig config,
+		SP_INDEX_MSG* msg)
+{
+	SPIndexBase* base;
+	SP_CONFIG_MSG configMsg;
+	SP_MULTI_INDEX_HASH_MSG mihMsg;
+	SP_BRUTE_FORCE_MSG bruteForceMsg;
+	SP_HNSW_MSG hnswMsg;
+	SP_IVF_PQ_MSG ivfpqMsg;
+	SP_BAG_OF_WORDS_MSG bowMsg;
+	SP_KMEANS_TREE_MSG kmeansTreeMsg;
+	SP_LSH_MSG lshMsg;
+	SP_VP_TREE_MSG vpTreeMsg;
+	int branching, functions;
+	int subquantizers;
+	SP_POINT_STORE_TYPE storeType;
+	base = (SPIndexBase*) calloc(1, sizeof(*base));
+	if (base == NULL)
+	{
+		spPointStoreDestroy(store);
+		*msg = SP_INDEX_ALLOC_FAIL;
+		return NULL;
+	}
+	base->store = store;
+	base->type = spConfigGetIndexType(config, &configMsg);
+	storeType = spPointStoreGetType(store);
+	// Over few features a scan is faster than the tree, and just as exact
+	if (base->type == SP_INDEX_KD_TREE
+			&& spPointStoreGetSize(store) <= spConfigGetBruteForceThreshold(config, &configMsg))
+		base->type = SP_INDEX_BRUTE_FORCE;
+
+	switch (base->type)
+	{
+	case SP_INDEX_KD_TREE:
+		if (storeType != SP_POINT_STORE_REAL)
+		{
+			*msg = SP_INDEX_TYPE_MISMATCH;
+			break;
+		}
+		base->kdTree = spIndexCreateKDTree(store, config, msg);
+		break;
+	case SP_INDEX_MULTI_INDEX_HASHING:
+		if (storeType != SP_POINT_STORE_BINARY)
+		{
+			*msg = SP_INDEX_TYPE_MISMATCH;
+			break;
+		}
+		base->mih = spMultiIndexHashCreate(store, &mihMsg);
+		*msg = base->mih != NULL ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+		break;
+	case SP_INDEX_BRUTE_FORCE:
+		*msg = SP_INDEX_SUCCESS;
+		break;
+	case SP_INDEX_HNSW:
+		base->efSearch = spConfigGetHNSWEfSearch(config, &configMsg);
+		base->hnsw = spHNSWCreate(store, spConfigGetHNSWM(config, &configMsg),
+				spConfigGetHNSWEfConstruction(config, &configMsg),
+				spConfigGetNumOfThreads(config, &configMsg), &hnswMsg);
+		*msg = base->hnsw != NULL ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+		break;
+	case SP_INDEX_IVF_PQ:
+		if (storeType != SP_POINT_STORE_REAL)
+		{
+			*msg = SP_INDEX_TYPE_MISMATCH;
+			break;
+		}
+		base->probes = spConfigGetIVFProbes(config, &configMsg);
+		subquantizers = spConfigGetPQSubquantizers(config, &configMsg);
+		if (subquantizers > spPointStoreGetDim(store))
+			subquantizers = spPointStoreGetDim(store);
+		base->ivfpq = spIVFPQCreate(store, spConfigGetIVFLists(config, &configMsg),
+				subquantizers, &ivfpqMsg);
+		*msg = base->ivfpq != NULL ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+		break;
+	case SP_INDEX_BAG_OF_WORDS:
+		if (storeType != SP_POINT_STORE_REAL)
+		{
+			*msg = SP_INDEX_TYPE_MISMATCH;
+			break;
+		}
+		base->bow = spBagOfWordsCreate(store, spConfigGetKMeansBranching(config, &configMsg),
+				spConfigGetKMeansIterations(config, &configMsg),
+				spConfigGetVocabularyDepth(config, &configMsg), &bowMsg);
+		*msg = base->bow != NULL ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+		break;
+	case SP_INDEX_KMEANS_TREE:
+		if (storeType != SP_POINT_STORE_REAL)
+		{
+			*msg = SP_INDEX_TYPE_MISMATCH;
+			break;
+		}
+		// Nodes are split as long as they have more rows than children
+		base->checks = spConfigGetKMeansChecks(config, &configMsg);
+		branching = spConfigGetKMeansBranching(config, &configMsg);
+		base->kmeansTree = spKMeansTreeCreate(store, branching,
+				spConfigGetKMeansIterations(config, &configMsg), 0, branching, &kmeansTreeMsg);
+		*msg = base->kmeansTree != NULL ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+		break;
+	case SP_INDEX_LSH:
+		if (storeType != SP_POINT_STORE_REAL)
+		{
+			*msg = SP_INDEX_TYPE_MISMATCH;
+			break;
+		}
+		base->lshProbes = spConfigGetLSHProbes(config, &configMsg);
+		functions = spConfigGetLSHFunctions(config, &configMsg);
+		if (functions > SP_LSH_MAX_FUNCTIONS)
+			functions = SP_LSH_MAX_FUNCTIONS;
+		base->lsh = spLSHCreate(store, spConfigGetLSHTables(config, &configMsg), functions,
+				spConfigGetLSHBucketWidth(config, &configMsg),
+				(unsigned int) spConfigGetLSHSeed(config, &configMsg),
+				spConfigGetNumOfThreads(config, &configMsg), &lshMsg);
+		*msg = base->lsh != NULL ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+		break;
+	case SP_INDEX_VP_TREE:
+		base->vpTree = spVPTreeCreate(store, &vpTreeMsg);
+		*msg = base->vpTree != NULL ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+		break;
+	default:
+		*msg = SP_INDEX_INVALID_ARGUMENT;
+		break;
+	}
+
+	// A BAG_OF_WORDS index ranks images, it has no nearest features to measure
+	if (*msg == SP_INDEX_SUCCESS && (base->type == SP_INDEX_BRUTE_FORCE
+			|| (spConfigIsMeasureRecall(config, &configMsg)
+					&& base->type != SP_INDEX_BAG_OF_WORDS)))
+	{
+		base->bruteForce = spBruteForceCreate(store, &bruteForceMsg);
+		if (base->bruteForce == NULL)
+			*msg = SP_INDEX_ALLOC_FAIL;
+	}
+	// The codes replace the features, unless they're the recall's ground truth.
+	// Merges encode the inserted features with the quantizers trained here,
+	// so they don't need them either.
+	if (*msg == SP_INDEX_SUCCESS && base->type == SP_INDEX_IVF_PQ && base->bruteForce == NULL)
+		spPointStoreReleaseRows(store);
+
+	if (*msg != SP_INDEX_SUCCESS)
+	{
+		spIndexBaseDestroy(base);
+		return NULL;
+	}
+	return base;
+}
+
+/*
+ * Builds an IVF_PQ main index from the current one, old, without training it
+ * again: the codes of the images in removed are dropped and the rows of added
+ * are encoded by the quantizers of old. store holds all the features of the
+ * new index as the recall's ground truth, which the new index takes
+ * ownership of, or is NULL if old has no ground truth.
+ */
+static SPIndexBase* spIndexBaseMergeIVFPQ(SPIndexBase* old, SPPointStore added,
+		SPBitset removed, SPPointStore store, SP_INDEX_MSG* msg)
+{
+	SPIndexBase* base;
+	SP_POINT_STORE_MSG storeMsg;
+	SP_IVF_PQ_MSG ivfpqMsg;
+	SP_BRUTE_FORCE_MSG bruteForceMsg;
+	// Without a ground truth the store only tells the type and the dimension
+	if (store == NULL)
+	{
+		store = spPointStoreCreate(spPointStoreGetType(old->store),
+				spPointStoreGetDim(old->store), 0, &storeMsg);
+		spPointStoreReleaseRows(store);
+	}
+	base = (SPIndexBase*) calloc(1, sizeof(*base));
+	if (store == NULL || base == NULL)
+	{
+		spPointStoreDestroy(store);
+		free(base);
+		*msg = SP_INDEX_ALLOC_FAIL;
+		return NULL;
+	}
+	base->type = SP_INDEX_IVF_PQ;
+	base->store = store;
+	base->probes = old->probes;
+	base->ivfpq = spIVFPQCreateFrom(old->ivfpq, added, removed, &ivfpqMsg);
+	*msg = base->ivfpq != NULL ? SP_INDEX_SUCCESS
+			: ivfpqMsg == SP_IVF_PQ_ALLOC_FAIL ? SP_INDEX_ALLOC_FAIL : SP_INDEX_INVALID_ARGUMENT;
+	if (*msg == SP_INDEX_SUCCESS && spPointStoreHasRows(store))
+	{
+		base->bruteForce = spBruteForceCreate(store, &bruteForceMsg);
+		if (base->bruteForce == NULL)
+			*msg = SP_INDEX_ALLOC_FAIL;
+	}
+	if (*msg != SP_INDEX_SUCCESS)
+	{
+		spIndexBaseDestroy(base);
+		return NULL;
+	}
+	return base;
+}
+
+/*
+ * Initializes a lock which an insert gets ahead of the searches waiting for
+ * it, so a steady stream of overlapping searches doesn't hold inserts off
+ * forever. Searches don't take the lock again while they hold it, which such
+ * a lock would deadlock on.
+ */
+static void initLock(pthread_rwlock_t* lock)
+{
+	pthread_rwlockattr_t attr;
+	pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+	pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+	pthread_rwlock_init(lock, &attr);
+	pthread_rwlockattr_destroy(&attr);
+}
+
+SPIndex spIndexCreate(SPPointStore store, const SPConfig config, SP_INDEX_MSG* msg)
+{
+	SPIndex index;
+	SP_CONFIG_MSG configMsg;
+	SP_BITSET_MSG bitsetMsg;
+	int i;
+	assert(msg != NULL);
+	if (store == NULL || config == NULL || spPointStoreGetSize(store) == 0)
+	{
+		spPointStoreDestroy(store);
+		*msg = SP_INDEX_INVALID_ARGUMENT;
+		return NULL;
+	}
+	index = (SPIndex) calloc(1, sizeof(*index));
+	if (index == NULL)
+	{
+		spPointStoreDestroy(store);
+		*msg = SP_INDEX_ALLOC_FAIL;
+		return NULL;
+	}
+	// Inserted images are numbered after all the images of the database
+	index->imagesAmount = spConfigGetNumOfImages(config, &configMsg);
+	for (i = 0; i < spPointStoreGetSize(store); i++)
+		if (spPointStoreGetImageIndex(store, i) >= index->imagesAmount)
+			index->imagesAmount = spPointStoreGetImageIndex(store, i) + 1;
+	index->base = spIndexBaseCreate(store, config, msg);
+	if (index->base == NULL)
+	{
+		free(index);
+		return NULL;
+	}
+	index->deleted = spBitsetCreate(index->imagesAmount, &bitsetMsg);
+	if (index->deleted == NULL)
+	{
+		spIndexBaseDestroy(index->base);
+		free(index);
+		*msg = SP_INDEX_ALLOC_FAIL;
+		return NULL;
+	}
+	index->config = config;
+	index->mergeThreshold = spConfigGetIndexMergeThreshold(config, &configMsg);
+	index->compactionPercent = spConfigGetIndexCompactionPercent(config, &configMsg);
+	index->version = nextVersion();
+	initLock(&index->lock);
+	pthread_mutex_init(&index->insertLock, NULL);
+	return index;
+}
+
+static SP_INDEX_MSG spIndexBaseKNN(SPIndexBase* base, SPPointStore queries, int row,
+		SPBPQueue bpq)
+{
+	switch (base->type)
+	{
+	case SP_INDEX_KD_TREE:
+		return spIndexKDTreeKNN(base, queries, row, bpq);
+	case SP_INDEX_MULTI_INDEX_HASHING:
+		return spMultiIndexHashKNN(base->mih, spPointStoreGetBinaryRow(queries, row), bpq)
+				== SP_MULTI_INDEX_HASH_SUCCESS ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+	case SP_INDEX_BRUTE_FORCE:
+		return spBruteForceKNN(base->bruteForce, queries, row, 1, &bpq)
+				== SP_BRUTE_FORCE_SUCCESS ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+	case SP_INDEX_HNSW:
+		return spHNSWKNN(base->hnsw, queries, row, base->efSearch, bpq)
+				== SP_HNSW_SUCCESS ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+	case SP_INDEX_IVF_PQ:
+		return spIVFPQKNN(base->ivfpq, queries, row, base->probes, bpq)
+				== SP_IVF_PQ_SUCCESS ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+	case SP_INDEX_KMEANS_TREE:
+		return spKMeansTreeKNN(base->kmeansTree, queries, row, base->checks, bpq)
+				== SP_KMEANS_TREE_SUCCESS ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+	case SP_INDEX_LSH:
+		return spLSHKNN(base->lsh, queries, row, base->lshProbes, bpq)
+				== SP_LSH_SUCCESS ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+	case SP_INDEX_VP_TREE:
+		return spVPTreeKNN(base->vpTree, queries, row, bpq)
+				== SP_VP_TREE_SUCCESS ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+	default:
+		return SP_INDEX_INVALID_ARGUMENT;
+	}
+}
+
+static SP_INDEX_MSG spIndexBaseKNNAll(SPIndexBase* base, SPPointStore queries, SPBPQueue* bpqs)
+{
+	int i;
+	SP_INDEX_MSG msg = SP_INDEX_SUCCESS;
+	// The brute force search compares tiles of query features at once
+	if (base->type == SP_INDEX_BRUTE_FORCE)
+		return spBruteForceKNN(base->bruteForce, queries, 0, spPointStoreGetSize(queries),
+				bpqs) == SP_BRUTE_FORCE_SUCCESS ? SP_INDEX_SUCCESS : SP_INDEX_ALLOC_FAIL;
+	if (base->type == SP_INDEX_KD_TREE)
+		return spIndexKDTreeKNNAll(base, queries, bpqs);
+	for (i = 0; i < spPointStoreGetSize(queries) && msg == SP_INDEX_SUCCESS; i++)
+		msg = spIndexBaseKNN(base, queries, i, bpqs[i]);
+	return msg;
+}
+
+/*
+ * Enqueues the nearest inserted features to the query rows first to
+ * first + amount - 1 into their queues, which already hold the nearest
+ * features of the main index, so the queues end up with the nearest of both.
+ */
+static SP_INDEX_MSG spIndexDeltaKNN(SPIndex index, SPPointStore queries, int first,
+		int amount, SPBPQueue* bpqs)
+{
+	int i;
+	for (i = 0; i < index->deltaChunks; i++)
+		if (spBruteForceKNN(index->delta[i].search, queries, first, amount, bpqs)
+				!= SP_BRUTE_FORCE_SUCCESS)
+			return SP_INDEX_ALLOC_FAIL;
+	return SP_INDEX_SUCCESS;
+}
+
+/*
+ * Makes the queues pass over the deleted images, or stop to if excluded is
+ * NULL. The caller holds the lock, so the deleted images don't change.
+ */
+static void excludeDeleted(SPIndex index, SPBPQueue* bpqs, int amount, SPBitset excluded)
+{
+	int i;
+	if (spBitsetGetCount(index->deleted) == 0)
+		return;
+	for (i = 0; i < amount; i++)
+		spBPQueueSetExcluded(bpqs[i], excluded);
+}
+
+SP_INDEX_MSG spIndexKNN(SPIndex index, SPPointStore queries, int row, SPBPQueue bpq)
+{
+	SP_INDEX_MSG msg;
+	if (index == NULL || queries == NULL || bpq == NULL || row < 0
+			|| row >= spPointStoreGetSize(queries))
+		return SP_INDEX_INVALID_ARGUMENT;
+	pthread_rwlock_rdlock(&index->lock);
+	if (spPointStoreGetType(queries) != spPointStoreGetType(index->base->store)
+			|| spPointStoreGetDim(queries) != spPointStoreGetDim(index->base->store))
+		msg = SP_INDEX_TYPE_MISMATCH;
+	else
+	{
+		excludeDeleted(index, &bpq, 1, index->deleted);
+		msg = spIndexBaseKNN(index->base, queries, row, bpq);
+		if (msg == SP_INDEX_SUCCESS)
+			msg = spIndexDeltaKNN(index, queries, row, 1, &bpq);
+		excludeDeleted(index, &bpq, 1, NULL);
+	}
+	pthread_rwlock_unlock(&index->lock);
+	return msg;
+}
+
+SP_INDEX_MSG spIndexKNNAll(SPIndex index, SPPointStore queries, SPBPQueue* bpqs)
+{
+	SP_INDEX_MSG msg;
+	if (index == NULL || queries == NULL || bpqs == NULL)
+		return SP_INDEX_INVALID_ARGUMENT;
+	pthread_rwlock_rdlock(&index->lock);
+	if (spPointStoreGetType(queries) != spPointStoreGetType(index->base->store)
+			|| spPointStoreGetDim(queries) != spPointStoreGetDim(index->base->store))
+		msg = SP_INDEX_TYPE_MISMATCH;
+	else if (index->base->type == SP_INDEX_BAG_OF_WORDS)
+		msg = SP_INDEX_INVALID_ARGUMENT;
+	else
+	{
+		excludeDeleted(index, bpqs, spPointStoreGetSize(queries), index->deleted);
+		msg = spIndexBaseKNNAll(index->base, queries, bpqs);
+		if (msg == SP_INDEX_SUCCESS)
+			msg = spIndexDeltaKNN(index, queries, 0, spPointStoreGetSize(queries), bpqs);
+		excludeDeleted(index, bpqs, spPointStoreGetSize(queries), NULL);
+	}
+	pthread_rwlock_unlock(&index->lock);
+	return msg;
+}
+
+/*
+ * Empties bpq into images, sorted. Returns the number of elements.
+ */
+static int drainImages(SPBPQueue bpq, int* images)
+{
+	int amount = 0;
+	SPListElement head;
+	while (!spBPQueueIsEmpty(bpq))
+	{
+		head = spBPQueuePeek(bpq);
+		images[amount++] = spListElementGetIndex(head);
+		spListElementDestroy(head);
+		spBPQueueDequeue(bpq);
+	}
+	qsort(images, amount, sizeof(int), intComp);
+	return amount;
+}
+
+/*
+ * The number of results which are found in truth. Results with exact
+ * distances are found if they're as near as the farthest of truth, so ties
+ * count. The approximate distances of IVF_PQ can't be compared, so its
+ * results are matched to truth by their images.
+ */
+static int countFound(SPIndexBase* base, SPBPQueue results, SPBPQueue truth, int* resultImages,
+		int* truthImages)
+{
+	int i = 0, j = 0, found = 0, resultsAmount, truthAmount;
+	double farthest = spBPQueueMaxValue(truth);
+	SPListElement head;
+	if (base->type != SP_INDEX_IVF_PQ)
+	{
+		for (; !spBPQueueIsEmpty(results); spBPQueueDequeue(results))
+		{
+			head = spBPQueuePeek(results);
+			found += spListElementGetValue(head) <= farthest;
+			spListElementDestroy(head);
+		}
+		return found;
+	}
+	resultsAmount = drainImages(results, resultImages);
+	truthAmount = drainImages(truth, truthImages);
+	while (i < resultsAmount && j < truthAmount)
+	{
+		if (resultImages[i] == truthImages[j])
+		{
+			found++;
+			i++;
+			j++;
+		}
+		else if (resultImages[i] < truthImages[j])
+			i++;
+		else
+			j++;
+	}
+	return found;
+}
+
+SP_INDEX_MSG spIndexMeasureRecall(SPIndex index, SPPointStore queries, int k, double* recall)
+{
+	int i, found = 0, expected = 0;
+	int *resultImages, *truthImages;
+	SPBPQueue results, truth;
+	SP_INDEX_MSG msg;
+	SPIndexBase* base;
+	if (index == NULL || queries == NULL || recall == NULL || k <= 0)
+		return SP_INDEX_INVALID_ARGUMENT;
+	// The main index is measured, a merge mustn't replace it meanwhile
+	pthread_rwlock_rdlock(&index->lock);
+	base = index->base;
+	if (base->bruteForce == NULL)
+	{
+		pthread_rwlock_unlock(&index->lock);
+		return SP_INDEX_INVALID_ARGUMENT;
+	}
+	if (spPointStoreGetType(queries) != spPointStoreGetType(base->store)
+			|| spPointStoreGetDim(queries) != spPointStoreGetDim(base->store))
+	{
+		pthread_rwlock_unlock(&index->lock);
+		return SP_INDEX_TYPE_MISMATCH;
+	}
+	results = spBPQueueCreate(k);
+	truth = spBPQueueCreate(k);
+	resultImages = (int*) malloc(k * sizeof(int));
+	truthImages = (int*) malloc(k * sizeof(int));
+	if (results == NULL || truth == NULL || resultImages == NULL || truthImages == NULL)
+	{
+		spBPQueueDestroy(results);
+		spBPQueueDestroy(truth);
+		free(resultImages);
+		free(truthImages);
+		pthread_rwlock_unlock(&index->lock);
+		return SP_INDEX_ALLOC_FAIL;
+	}
+	// The deleted images are passed over by both searches
+	excludeDeleted(index, &results, 1, index->deleted);
+	excludeDeleted(index, &truth, 1, index->deleted);
+	for (i = 0, msg = SP_INDEX_SUCCESS; i < spPointStoreGetSize(queries)
+			&& msg == SP_INDEX_SUCCESS; i++)
+	{
+		spBPQueueClear(results);
+		spBPQueueClear(truth);
+		msg = spIndexBaseKNN(base, queries, i, results);
+		if (msg == SP_INDEX_SUCCESS && spBruteForceKNN(base->bruteForce, queries, i, 1, &truth)
+				!= SP_BRUTE_FORCE_SUCCESS)
+			msg = SP_INDEX_ALLOC_FAIL;
+		if (msg != SP_INDEX_SUCCESS || spBPQueueIsEmpty(truth))
+			continue;
+		expected += spBPQueueSize(truth);
+		found += countFound(base, results, truth, resultImages, truthImages);
+	}
+	pthread_rwlock_unlock(&index->lock);
+	spBPQueueDestroy(results);
+	spBPQueueDestroy(truth);
+	free(resultImages);
+	free(truthImages);
+	*recall = expected > 0 ? (double) found / expected : 1;
+	return msg;
+}
+
+SP_INDEX_MSG spIndexRankImages(SPIndex index, SPPointStore queries, int imagesAmount,
+		int numOfSimilar, SPBitset allowed, int* images)
+{
+	// Images aren't inserted into a BAG_OF_WORDS index, so it's never replaced
+	if (index == NULL || queries == NULL || images == NULL || index->base->bow == NULL)
+		return SP_INDEX_INVALID_ARGUMENT;
+	if (spPointStoreGetType(queries) != spPointStoreGetType(index->base->store)
+			|| spPointStoreGetDim(queries) != spPointStoreGetDim(index->base->store))
+		return SP_INDEX_TYPE_MISMATCH;
+	switch (spBagOfWordsRank(index->base->bow, queries, imagesAmount, numOfSimilar, allowed,
+			images))
+	{
+	case SP_BAG_OF_WORDS_SUCCESS:
+		return SP_INDEX_SUCCESS;
+	case SP_BAG_OF_WORDS_ALLOC_FAIL:
+		return SP_INDEX_ALLOC_FAIL;
+	default:
+		return SP_INDEX_INVALID_ARGUMENT;
+	}
+}
+
+/*
+ * Appends the rows of source to dest, but those of the images in skipped.
+ */
+static SP_POINT_STORE_MSG appendRows(SPPointStore dest, SPPointStore source, SPBitset skipped)
+{
+	int i, image;
+	SP_POINT_STORE_MSG msg = SP_POINT_STORE_SUCCESS;
+	for (i = 0; i < spPointStoreGetSize(source) && msg == SP_POINT_STORE_SUCCESS; i++)
+	{
+		image = spPointStoreGetImageIndex(source, i);
+		if (spBitsetContains(skipped, image))
+			continue;
+		if (spPointStoreGetType(source) == SP_POINT_STORE_REAL)
+			msg = spPointStoreAddReal(dest, spPointStoreGetRealRow(source, i), image);
+		else
+			msg = spPointStoreAddBinary(dest, spPointStoreGetBinaryRow(source, i), image);
+	}
+	return msg;
+}
+
+static void destroyChunks(SPIndexChunk* chunks, int amount)
+{
+	int i;
+	for (i = 0; i < amount; i++)
+	{
+		spBruteForceDestroy(chunks[i].search);
+		spPointStoreDestroy(chunks[i].store);
+	}
+}
+
+/*
+ * Creates the chunks of the inserted rows from position first on, but those
+ * of the images in skipped if it isn't NULL, followed by the rows of features
+ * as the image imageIndex if it isn't NULL, and a brute force search over
+ * every chunk. The caller holds insertLock, so the inserted rows and the
+ * deleted images don't change meanwhile, and frees the array of the chunks.
+ * Returns false on an allocation failure.
+ */
+static bool createChunks(SPIndex index, int first, SPBitset skipped, SPPointStore features,
+		int imageIndex, SPIndexChunk** chunks, int* amount)
+{
+	int i, row, image, rows = index->deltaSize
+			+ (features != NULL ? spPointStoreGetSize(features) : 0);
+	SPPointStore source, store = NULL;
+	SP_POINT_STORE_MSG storeMsg = SP_POINT_STORE_SUCCESS;
+	SP_BRUTE_FORCE_MSG bruteForceMsg;
+	*amount = 0;
+	*chunks = (SPIndexChunk*) calloc((rows - first) / DELTA_CHUNK_ROWS + 1,
+			sizeof(SPIndexChunk));
+	if (*chunks == NULL)
+		return false;
+	for (i = first; i < rows && storeMsg == SP_POINT_STORE_SUCCESS; i++)
+	{
+		// Every chunk but the last is full, so a position tells its chunk
+		if (i < index->deltaSize)
+		{
+			source = index->delta[i / DELTA_CHUNK_ROWS].store;
+			row = i % DELTA_CHUNK_ROWS;
+			image = spPointStoreGetImageIndex(source, row);
+			if (spBitsetContains(skipped, image))
+				continue;
+		}
+		else
+		{
+			source = features;
+			row = i - index->deltaSize;
+			image = imageIndex;
+		}
+		if (store == NULL || spPointStoreGetSize(store) == DELTA_CHUNK_ROWS)
+		{
+			store = spPointStoreCreate(spPointStoreGetType(index->base->store),
+					spPointStoreGetDim(index->base->store), DELTA_CHUNK_ROWS, &storeMsg);
+			if (store == NULL)
+				continue;
+			(*chunks)[(*amount)++].store = store;
+		}
+		if (spPointStoreGetType(source) == SP_POINT_STORE_REAL)
+			storeMsg = spPointStoreAddReal(store, spPointStoreGetRealRow(source, row), image);
+		else
+			storeMsg = spPointStoreAddBinary(store, spPointStoreGetBinaryRow(source, row), image);
+	}
+	for (i = 0; i < *amount && storeMsg == SP_POINT_STORE_SUCCESS; i++)
+	{
+		(*chunks)[i].search = spBruteForceCreate((*chunks)[i].store, &bruteForceMsg);
+		if ((*chunks)[i].search == NULL)
+			storeMsg = SP_POINT_STORE_ALLOC_FAIL;
+	}
+	if (storeMsg != SP_POINT_STORE_SUCCESS)
+	{
+		destroyChunks(*chunks, *amount);
+		free(*chunks);
+		*chunks = NULL;
+		*amount = 0;
+		return false;
+	}
+	return true;
+}
+
+/*
+ * The number of rows of store whose image is in images, or is image if
+ * image >= 0.
+ */
+static int countRows(SPPointStore store, SPBitset images, int image)
+{
+	int i, amount = 0;
+	for (i = 0; i < spPointStoreGetSize(store); i++)
+	{
+		if (image >= 0 ? spPointStoreGetImageIndex(store, i) == image
+				: spBitsetContains(images, spPointStoreGetImageIndex(store, i)))
+			amount++;
+	}
+	return amount;
+}
+
+/*
+ * The number of features of the index whose image is in images, or is image
+ * if image >= 0. The rows of an IVF_PQ store may be released or, after a
+ * merge, absent, so its codes are counted instead.
+ */
+static int countFeatures(SPIndex index, SPBitset images, int image)
+{
+	int i, current, amount = 0;
+	SPIVFPQ ivfpq = index->base->ivfpq;
+	if (ivfpq == NULL)
+		amount = countRows(index->base->store, images, image);
+	for (i = 0; ivfpq != NULL && i < spIVFPQGetSize(ivfpq); i++)
+	{
+		current = spIVFPQGetImageIndex(ivfpq, i);
+		if (image >= 0 ? current == image : spBitsetContains(images, current))
+			amount++;
+	}
+	for (i = 0; i < index->deltaChunks; i++)
+		amount += countRows(index->delta[i].store, images, image);
+	return amount;
+}
+
+/*
+ * Whether the delta is large enough or the features of deleted images are
+ * too many of all the features. The caller holds insertLock.
+ */
+static bool mergeNeeded(SPIndex index)
+{
+	long long features = (index->base->ivfpq != NULL ? spIVFPQGetSize(index->base->ivfpq)
+			: spPointStoreGetSize(index->base->store)) + index->deltaSize;
+	return (index->mergeThreshold > 0 && index->deltaSize >= index->mergeThreshold)
+			|| (index->compactionPercent > 0 && index->deletedFeatures > 0
+					&& index->deletedFeatures * 100LL >= index->compactionPercent * features);
+}
+
+/*
+ * Creates a store of the inserted rows, preceded by the rows of the main
+ * index if withBase is true, but those of the deleted images. The caller
+ * holds insertLock. Returns NULL on an allocation failure.
+ */
+static SPPointStore gatherRows(SPIndex index, bool withBase)
+{
+	int i;
+	SPPointStore store;
+	SP_POINT_STORE_MSG msg;
+	store = spPointStoreCreate(spPointStoreGetType(index->base->store),
+			spPointStoreGetDim(index->base->store), index->deltaSize
+					+ (withBase ? spPointStoreGetSize(index->base->store) : 0), &msg);
+	if (store != NULL && withBase)
+		msg = appendRows(store, index->base->store, index->deleted);
+	for (i = 0; store != NULL && i < index->deltaChunks && msg == SP_POINT_STORE_SUCCESS; i++)
+		msg = appendRows(store, index->delta[i].store, index->deleted);
+	if (store != NULL && msg != SP_POINT_STORE_SUCCESS)
+	{
+		spPointStoreDestroy(store);
+		return NULL;
+	}
+	return store;
+}
+
+/*
+ * Builds a new main index over the features of the current one and the
+ * inserted ones, but those of the deleted images, off the lock so searches,
+ * inserts and deletes go on meanwhile, and then replaces the current one with
+ * it. An IVF_PQ index isn't built again, the inserted features are encoded by
+ * its quantizers and the codes of the deleted images are dropped, so the
+ * inserted features are released only once their codes replace them. The
+ * features inserted during the build stay in the delta, and those of the
+ * images deleted during the build stay deleted.
+ * Returns false if the new index wasn't built.
+ */
+static bool merge(SPIndex index)
+{
+	SPIndexBase *base = NULL, *oldBase = NULL;
+	SPPointStore store = NULL, added = NULL;
+	SPIndexChunk *delta, *oldDelta = NULL;
+	SPBitset removed = NULL;
+	SP_BITSET_MSG bitsetMsg;
+	SP_INDEX_MSG msg;
+	int merged, amount, oldAmount = 0;
+	bool ivfpq, failed = false;
+
+	// Only this thread replaces the main index, so it's read off the locks
+	pthread_mutex_lock(&index->insertLock);
+	merged = index->deltaSize;
+	ivfpq = index->base->type == SP_INDEX_IVF_PQ;
+	if (ivfpq)
+	{
+		added = gatherRows(index, false);
+		removed = spBitsetCopy(index->deleted, &bitsetMsg);
+		failed = added == NULL || removed == NULL;
+	}
+	if (!failed && spPointStoreHasRows(index->base->store))
+	{
+		store = gatherRows(index, true);
+		failed = store == NULL;
+	}
+	pthread_mutex_unlock(&index->insertLock);
+
+	if (!failed && ivfpq)
+		base = spIndexBaseMergeIVFPQ(index->base, added, removed, store, &msg);
+	// An index of no features can't be built, searching the delta is as fast
+	else if (!failed && spPointStoreGetSize(store) > 0)
+		base = spIndexBaseCreate(store, index->config, &msg);
+	else
+		spPointStoreDestroy(store);
+	spPointStoreDestroy(added);
+	spBitsetDestroy(removed);
+
+	pthread_mutex_lock(&index->insertLock);
+	// Only merges drop rows of the delta, so the rows inserted during the
+	// build are still those from merged on
+	if (base != NULL && createChunks(index, merged, index->deleted, NULL, 0, &delta, &amount))
+	{
+		pthread_rwlock_wrlock(&index->lock);
+		oldBase = index->base;
+		oldDelta = index->delta;
+		oldAmount = index->deltaChunks;
+		index->base = base;
+		index->delta = delta;
+		index->deltaChunks = amount;
+		index->deltaCapacity = amount;
+		index->deltaSize = amount > 0 ? (amount - 1) * DELTA_CHUNK_ROWS
+				+ spPointStoreGetSize(delta[amount - 1].store) : 0;
+		index->deletedFeatures = countFeatures(index, index->deleted, -1);
+		index->version = nextVersion();
+		pthread_rwlock_unlock(&index->lock);
+	}
+	else
+	{
+		oldBase = base;
+		base = NULL;
+	}
+	pthread_mutex_unlock(&index->insertLock);
+
+	spIndexBaseDestroy(oldBase);
+	destroyChunks(oldDelta, oldAmount);
+	free(oldDelta);
+	return base != NULL;
+}
+
+/*
+ * Merges until no merge is needed, so the inserts and deletes which came
+ * during a merge are merged too, or until a merge fails.
+ */
+static void* mergeWorker(void* arg)
+{
+	SPIndex index = (SPIndex) arg;
+	bool again;
+	do
+	{
+		again = merge(index);
+		pthread_mutex_lock(&index->insertLock);
+		again = again && mergeNeeded(index);
+		index->merging = again;
+		pthread_mutex_unlock(&index->insertLock);
+	} while (again);
+	return NULL;
+}
+
+/*
+ * Starts a merge in the background if one is needed, unless a merge is
+ * running. The caller holds insertLock.
+ */
+static void startMergeIfNeeded(SPIndex index)
+{
+	if (index->merging || !mergeNeeded(index))
+		return;
+	// The previous merge is done, its thread only has to return
+	if (index->mergerStarted)
+		pthread_join(index->merger, NULL);
+	index->merging = pthread_create(&index->merger, NULL, mergeWorker, index) == 0;
+	index->mergerStarted = index->merging;
+}
+
+SP_INDEX_MSG spIndexInsert(SPIndex index, SPPointStore features, int* imageIndex)
+{
+	SPIndexChunk *chunks, *grown = NULL, *oldDelta = NULL;
+	SPIndexChunk replaced = { NULL, NULL };
+	int first, start, amount, capacity;
+	SP_INDEX_MSG msg = SP_INDEX_SUCCESS;
+	if (index == NULL || features == NULL || imageIndex == NULL
+			|| spPointStoreGetSize(features) == 0)
+		return SP_INDEX_INVALID_ARGUMENT;
+
+	// Searches go on over the current delta while the chunks taking the
+	// features are built, from the last chunk of the delta if it isn't full
+	pthread_mutex_lock(&index->insertLock);
+	first = index->deltaSize / DELTA_CHUNK_ROWS * DELTA_CHUNK_ROWS;
+	start = first / DELTA_CHUNK_ROWS;
+	if (index->base->type == SP_INDEX_BAG_OF_WORDS)
+		msg = SP_INDEX_INVALID_ARGUMENT;
+	else if (spPointStoreGetType(features) != spPointStoreGetType(index->base->store)
+			|| spPointStoreGetDim(features) != spPointStoreGetDim(index->base->store))
+		msg = SP_INDEX_TYPE_MISMATCH;
+	// The rows of deleted images are kept until the next merge, which tells
+	// the rows it merged from those inserted meanwhile by their position
+	else if (!createChunks(index, first, NULL, features, index->imagesAmount, &chunks,
+			&amount))
+		msg = SP_INDEX_ALLOC_FAIL;
+	// The array of the chunks is doubled when full, searches still read the
+	// current one
+	else if (start + amount > index->deltaCapacity)
+	{
+		capacity = index->deltaCapacity * 2 > start + amount ? index->deltaCapacity * 2
+				: start + amount;
+		grown = (SPIndexChunk*) malloc(capacity * sizeof(SPIndexChunk));
+		if (grown == NULL)
+		{
+			destroyChunks(chunks, amount);
+			free(chunks);
+			msg = SP_INDEX_ALLOC_FAIL;
+		}
+		else if (index->deltaChunks > 0)
+			memcpy(grown, index->delta, index->deltaChunks * sizeof(SPIndexChunk));
+	}
+	if (msg != SP_INDEX_SUCCESS)
+	{
+		pthread_mutex_unlock(&index->insertLock);
+		return msg;
+	}
+	pthread_rwlock_wrlock(&index->lock);
+	if (grown != NULL)
+	{
+		oldDelta = index->delta;
+		index->delta = grown;
+		index->deltaCapacity = capacity;
+	}
+	if (start < index->deltaChunks)
+		replaced = index->delta[start];
+	memcpy(index->delta + start, chunks, amount * sizeof(SPIndexChunk));
+	index->deltaChunks = start + amount;
+	index->deltaSize += spPointStoreGetSize(features);
+	*imageIndex = index->imagesAmount++;
+	index->version = nextVersion();
+	pthread_rwlock_unlock(&index->lock);
+	startMergeIfNeeded(index);
+	pthread_mutex_unlock(&index->insertLock);
+	free(chunks);
+	free(oldDelta);
+	destroyChunks(&replaced, 1);
+	return SP_INDEX_SUCCESS;
+}
+
+SP_INDEX_MSG spIndexDelete(SPIndex index, int imageIndex)
+{
+	int features;
+	SP_INDEX_MSG msg = SP_INDEX_SUCCESS;
+	if (index == NULL || imageIndex < 0)
+		return SP_INDEX_INVALID_ARGUMENT;
+
+	// Searches pass over the image from now on, its features are removed by
+	// the next compaction
+	pthread_mutex_lock(&index->insertLock);
+	if (index->base->type == SP_INDEX_BAG_OF_WORDS || imageIndex >= index->imagesAmount)
+		msg = SP_INDEX_INVALID_ARGUMENT;
+	if (msg != SP_INDEX_SUCCESS || spBitsetContains(index->deleted, imageIndex))
+	{
+		pthread_mutex_unlock(&index->insertLock);
+		return msg;
+	}
+	features = countFeatures(index, NULL, imageIndex);
+	pthread_rwlock_wrlock(&index->lock);
+	if (spBitsetAdd(index->deleted, imageIndex) != SP_BITSET_SUCCESS)
+		msg = SP_INDEX_ALLOC_FAIL;
+	else
+	{
+		index->deletedFeatures += features;
+		index->version = nextVersion();
+	}
+	pthread_rwlock_unlock(&index->lock);
+	if (msg == SP_INDEX_SUCCESS)
+		startMergeIfNeeded(index);
+	pthread_mutex_unlock(&index->insertLock);
+	return msg;
+}
+
+SPPointStore spIndexGetStore(SPIndex index)
+{
+	assert(index != NULL);
+	return index->base->store;
+}
+
+SP_INDEX_TYPE spIndexGetType(SPIndex index)
+{
+	SP_INDEX_TYPE type;
+	assert(index != NULL);
+	pthread_rwlock_rdlock(&index->lock);
+	type = index->base->type;
+	pthread_rwlock_unlock(&index->lock);
+	return type;
+}
+
+int spIndexGetImagesAmount(SPIndex index)
+{
+	int imagesAmount;
+	assert(index != NULL);
+	pthread_rwlock_rdlock(&index->lock);
+	imagesAmount = index->imagesAmount;
+	pthread_rwlock_unlock(&index->lock);
+	return imagesAmount;
+}
+
+bool spIndexIsDeleted(SPIndex index, int imageIndex)
+{
+	bool deleted;
+	assert(index != NULL);
+	pthread_rwlock_rdlock(&index->lock);
+	deleted = spBitsetContains(index->deleted, imageIndex);
+	pthread_rwlock_unlock(&index->lock);
+	return deleted;
+}
+
+SPBitset spIndexCopyDeleted(SPIndex index, SP_INDEX_MSG* msg)
+{
+	SPBitset deleted = NULL;
+	SP_BITSET_MSG bitsetMsg;
+	assert(msg != NULL);
+	if (index == NULL)
+	{
+		*msg = SP_INDEX_INVALID_ARGUMENT;
+		return NULL;
+	}
+	*msg = SP_INDEX_SUCCESS;
+	pthread_rwlock_rdlock(&index->lock);
+	if (spBitsetGetCount(index->deleted) > 0)
+	{
+		deleted = spBitsetCopy(index->deleted, &bitsetMsg);
+		if (deleted == NULL)
+			*msg = SP_INDEX_ALLOC_FAIL;
+	}
+	pthread_rwlock_unlock(&index->lock);
+	return deleted;
+}
+
+unsigned long long spIndexGetVersion(SPIndex index)
+{
+	unsigned long long version;
+	assert(index != NULL);
+	pthread_rwlock_rdlock(&index->lock);
+	version = index->version;
+	pthread_rwlock_unlock(&index->lock);
+	return version;
+}
+
+void spIndexDestroy(SPIndex index)
+{
+	bool mergerStarted;
+	if (index == NULL)
+		return;
+	// A merge in progress is waited for, it uses the index
+	pthread_mutex_lock(&index->insertLock);
+	mergerStarted = index->mergerStarted;
+	pthread_mutex_unlock(&index->insertLock);
+	if (mergerStarted)
+		pthread_join(index->merger, NULL);
+	spIndexBaseDestroy(index->base);
+	destroyChunks(index->delta, index->deltaChunks);
+	free(index->delta);
+	spBitsetDestroy(index->deleted);
+	pthread_rwlock_destroy(&index->lock);
+	pthread_mutex_destroy(&index->insertLock);
+	free(index);
+}
@@ -0,0 +1,305 @@
+#ifndef SPINDEX_H_
+#define SPINDEX_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "SPConfig.h"
+#include "SPPointStore.h"
+#include "SPBPriorityQueue.h"
+#include "SPIndexType.h"
+
+/**
+ * SP Index summary
+ * A k nearest neighbours index over the features of the database, stored in
+ * a point store. The search structure is chosen by spIndexType:
+ * - KD_TREE: a KD-Tree over a REAL store, split by spKDTreeSplitMethod
+ * - MULTI_INDEX_HASHING: multi-index hashing over a BINARY store
+ * - BRUTE_FORCE: an exact scan over either store. A KD_TREE index over at most
+ *   spBruteForceThreshold features is searched this way too.
+ * - HNSW: an approximate search of a graph over either store, built with
+ *   spHNSWM and spHNSWEfConstruction by spNumOfThreads threads and searched
+ *   with spHNSWEfSearch
+ * - IVF_PQ: an approximate search over product quantization codes of a REAL
+ *   store, in spIVFLists lists of which spIVFProbes are scanned, with
+ *   spPQSubquantizers bytes per feature. Its distances are approximate. Once
+ *   the codes are built the rows of the store are released, unless
+ *   spMeasureRecall needs them.
+ * - BAG_OF_WORDS: not a feature search but an image ranking, by the visual
+ *   words of a REAL store in a vocabulary tree of spKMeansBranching children
+ *   per node and spVocabularyDepth levels, trained with spKMeansIterations.
+ *   Such an index is queried by spIndexRankImages only.
+ * - KMEANS_TREE: an approximate search of a hierarchical k-means tree over a
+ *   REAL store, of spKMeansBranching children per node trained with
+ *   spKMeansIterations, comparing spKMeansChecks features per query feature
+ * - LSH: an approximate search of spLSHTables hash tables over a REAL store,
+ *   of spLSHFunctions functions of spLSHBucketWidth wide buckets, drawn from
+ *   spLSHSeed and built by spNumOfThreads threads, probing spLSHProbes
+ *   buckets per table
+ * - VP_TREE: an exact search of a vantage point tree over either store, by
+ *   the L2 metric or the Hamming metric
+ *
+ * When spMeasureRecall is set, every index but BAG_OF_WORDS also keeps a brute
+ * force search as the ground truth its results are measured against.
+ *
+ * Whatever the structure, a search fills a bounded priority queue with the
+ * image indexes of the nearest features and their distances, so callers
+ * (such as SPQuerySolverSolve) don't depend on the structure. A search
+ * restricted to some of the images gives a queue which allows only them (see
+ * spBPQueueSetAllowed): the features of other images never enter it, and
+ * no structure computes their distances, but those HNSW passes through on
+ * its graph. HNSW, IVF_PQ and KMEANS_TREE search on until they found enough
+ * allowed features, LSH probes only its usual buckets, so it may find fewer
+ * nearest features under a restrictive filter.
+ *
+ * The images of a running index grow by spIndexInsert, without a rebuild: the
+ * features of an inserted image go to a small delta searched by brute force
+ * alongside the main index, and a search returns the nearest features of
+ * both. Once the delta holds spIndexMergeThreshold features, a background
+ * thread builds a new main index over all the features and replaces the
+ * current one with it, while searches and inserts go on. An IVF_PQ index
+ * keeps its quantizers instead: the delta is encoded by them and its codes
+ * join those of the current index.
+ *
+ * An image is deleted by spIndexDelete at once: it's marked in a set of
+ * deleted images, and every search passes over its features as it scans
+ * them, so they never reach the results. The features themselves stay until
+ * they reach spIndexCompactionPercent percent of all the features, then a
+ * background compaction, the same as a merge, builds a new main index
+ * without them.
+ * Searching, inserting and deleting are thread safe.
+ *
+ * The following functions are supported:
+ * spIndexCreate        - Builds an index over a store
+ * spIndexKNN           - Finds the nearest features to a query feature
+ * spIndexKNNAll        - Finds the nearest features to every query feature
+ * spIndexMeasureRecall - Measures the recall of the index against brute force
+ * spIndexRankImages    - Finds the most similar images by a BAG_OF_WORDS index
+ * spIndexInsert        - Inserts the features of a new image
+ * spIndexDelete        - Deletes an image
+ * spIndexIsDeleted     - Checks whether an image was deleted
+ * spIndexCopyDeleted   - Copies the set of the deleted images
+ * spIndexGetStore      - A getter of the store of an index
+ * spIndexGetType       - A getter of the type of an index
+ * spIndexGetImagesAmount - A getter of the number of images of an index
+ * spIndexGetVersion    - A getter of the version of an index
+ * spIndexDestroy       - Frees all resources associated with an index
+ */
+
+typedef enum sp_index_msg_t {
+	SP_INDEX_INVALID_ARGUMENT,
+	SP_INDEX_TYPE_MISMATCH,
+	SP_INDEX_ALLOC_FAIL,
+	SP_INDEX_SUCCESS
+} SP_INDEX_MSG;
+
+typedef struct sp_index_t* SPIndex;
+
+/**
+ * Builds an index of the type given by spIndexType over all the rows of
+ * store. The index takes ownership of the store: it is destroyed with the
+ * index, also when the creation fails. The index keeps config, which must
+ * outlive it, to build the main index again when merging.
+ *
+ * @param store - the features of the database
+ * @param config - the configuration
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new index.
+ *
+ * - SP_INDEX_INVALID_ARGUMENT - if store == NULL or config == NULL or the
+ * 								store is empty
+ * - SP_INDEX_TYPE_MISMATCH - if the index type doesn't support the type of
+ * 							  the store (e.g. a KD-Tree over binary features)
+ * - SP_INDEX_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_INDEX_SUCCESS - in case of success
+ */
+SPIndex spIndexCreate(SPPointStore store, const SPConfig config, SP_INDEX_MSG* msg);
+
+/**
+ * Enqueues the nearest features to a query feature into bpq, up to its
+ * maximal size. Every element's index is the image index of the feature and
+ * its value is its distance from the query feature.
+ *
+ * @param index - the index
+ * @param queries - a store of the same type and dimension as the index's
+ * @param row - the row of the query feature in queries
+ * @param bpq - the queue to fill, its maximal size is the k in k nearest
+ * @return
+ * - SP_INDEX_INVALID_ARGUMENT - if index == NULL or queries == NULL or
+ * 		bpq == NULL or row is out of range or the index is BAG_OF_WORDS
+ * - SP_INDEX_TYPE_MISMATCH - if queries doesn't match the index's store
+ * - SP_INDEX_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_INDEX_SUCCESS - in case of success
+ */
+SP_INDEX_MSG spIndexKNN(SPIndex index, SPPointStore queries, int row, SPBPQueue bpq);
+
+/**
+ * Enqueues the nearest features to every query feature into its own queue,
+ * as spIndexKNN does for a single one. A BRUTE_FORCE index compares many
+ * query features with every feature at once, which is faster than one by one.
+ * A KD_TREE index searches the query features in the order of the leaves they
+ * fall in, so the features of a large batch share their paths in the cache.
+ *
+ * @param index - the index
+ * @param queries - a store of the same type and dimension as the index's
+ * @param bpqs - an array of a queue per row of queries, bpqs[i] is filled for row i
+ * @return
+ * - SP_INDEX_INVALID_ARGUMENT - if index == NULL or queries == NULL or
+ * 		bpqs == NULL or the index is BAG_OF_WORDS
+ * - SP_INDEX_TYPE_MISMATCH - if queries doesn't match the index's store
+ * - SP_INDEX_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_INDEX_SUCCESS - in case of success
+ */
+SP_INDEX_MSG spIndexKNNAll(SPIndex index, SPPointStore queries, SPBPQueue* bpqs);
+
+/**
+ * Measures the recall of the index: the fraction of the exact k nearest
+ * features to every query feature, as found by brute force, which the index
+ * finds too. A feature as far as the exact kth nearest counts as found. The
+ * approximate distances of IVF_PQ aren't compared, its results count as found
+ * by the images they belong to.
+ * Requires spMeasureRecall, or a BRUTE_FORCE index, whose recall is 1.
+ *
+ * @param index - the index
+ * @param queries - a store of the same type and dimension as the index's
+ * @param k - the k in k nearest
+ * @param recall - pointer in which the recall, between 0 and 1, is stored
+ * @return
+ * - SP_INDEX_INVALID_ARGUMENT - if index == NULL or queries == NULL or
+ * 		recall == NULL or k <= 0 or the index has no brute force search
+ * - SP_INDEX_TYPE_MISMATCH - if queries doesn't match the index's store
+ * - SP_INDEX_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_INDEX_SUCCESS - in case of success
+ */
+SP_INDEX_MSG spIndexMeasureRecall(SPIndex index, SPPointStore queries, int k, double* recall);
+
+/**
+ * Ranks the images of the database by their similarity to a query image, by
+ * the visual words of its features, and stores the numOfSimilar most similar
+ * in images, the most similar first. Only the allowed images are ranked and
+ * stored, if fewer than numOfSimilar are allowed the rest of images is
+ * filled with -1.
+ *
+ * @param index - a BAG_OF_WORDS index
+ * @param queries - the features of the query image, a store of the same type
+ * 					and dimension as the index's
+ * @param imagesAmount - the number of images in the database
+ * @param numOfSimilar - the number of images to store
+ * @param allowed - the images to rank, NULL ranks all of them
+ * @param images - an array of numOfSimilar image indexes to fill
+ * @return
+ * - SP_INDEX_INVALID_ARGUMENT - if index == NULL or queries == NULL or
+ * 		images == NULL or the index isn't BAG_OF_WORDS, or numOfSimilar < 1
+ * 		or numOfSimilar > imagesAmount
+ * - SP_INDEX_TYPE_MISMATCH - if queries doesn't match the index's store
+ * - SP_INDEX_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_INDEX_SUCCESS - in case of success
+ */
+SP_INDEX_MSG spIndexRankImages(SPIndex index, SPPointStore queries, int imagesAmount,
+		int numOfSimilar, SPBitset allowed, int* images);
+
+/**
+ * Inserts the features of a new image into the index, as the image numbered
+ * after all of its images, so searches find them from now on. The insert
+ * changes the version of the index. An insert which fills the delta up to
+ * spIndexMergeThreshold features starts a merge in the background, unless
+ * one is already running.
+ *
+ * @param index - the index, not a BAG_OF_WORDS one
+ * @param features - the features of the image, a store of the same type and
+ * 					 dimension as the index's, which is copied
+ * @param imageIndex - pointer in which the index of the new image is stored
+ * @return
+ * - SP_INDEX_INVALID_ARGUMENT - if index == NULL or features == NULL or
+ * 		imageIndex == NULL or features is empty or the index is BAG_OF_WORDS
+ * - SP_INDEX_TYPE_MISMATCH - if features doesn't match the index's store
+ * - SP_INDEX_ALLOC_FAIL - if an allocation failure occurred, then nothing
+ * 		was inserted
+ * - SP_INDEX_SUCCESS - in case of success
+ */
+SP_INDEX_MSG spIndexInsert(SPIndex index, SPPointStore features, int* imageIndex);
+
+/**
+ * Deletes an image from the index, so searches don't find its features from
+ * now on. The delete changes the version of the index. A delete which brings
+ * the features of the deleted images up to spIndexCompactionPercent percent
+ * of all the features starts a compaction in the background, unless a merge
+ * is already running.
+ *
+ * @param index - the index, not a BAG_OF_WORDS one
+ * @param imageIndex - the index of the image
+ * @return
+ * - SP_INDEX_INVALID_ARGUMENT - if index == NULL or imageIndex isn't an image
+ * 		of the index or the index is BAG_OF_WORDS
+ * - SP_INDEX_ALLOC_FAIL - if an allocation failure occurred, then nothing
+ * 		was deleted
+ * - SP_INDEX_SUCCESS - in case of success, also if the image was deleted
+ * 		before
+ */
+SP_INDEX_MSG spIndexDelete(SPIndex index, int imageIndex);
+
+/**
+ * @assert index != NULL
+ * @return true if the image was deleted from the index, false otherwise
+ */
+bool spIndexIsDeleted(SPIndex index, int imageIndex);
+
+/**
+ * Copies the set of the images deleted from the index, under a single lock,
+ * so a caller checking many images doesn't lock the index once per image and
+ * sees the deletes of one moment. Every image deleted before a search is in
+ * a copy taken after it.
+ *
+ * @param index - the index
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL if no image was deleted or an error occurred. Otherwise, the
+ * 		   copy, which the caller destroys.
+ *
+ * - SP_INDEX_INVALID_ARGUMENT - if index == NULL
+ * - SP_INDEX_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_INDEX_SUCCESS - in case of success
+ */
+SPBitset spIndexCopyDeleted(SPIndex index, SP_INDEX_MSG* msg);
+
+/**
+ * @assert index != NULL
+ * @return the store of the main index, whose rows may have been released by
+ * 		   an IVF_PQ index, which holds no rows at all after a merge. A merge
+ * 		   or a compaction replaces it, so it's valid only while no images
+ * 		   are inserted or deleted.
+ */
+SPPointStore spIndexGetStore(SPIndex index);
+
+/**
+ * @assert index != NULL
+ * @return the type of the index, BRUTE_FORCE also when a KD_TREE was
+ * 		   replaced by brute force over a small store
+ */
+SP_INDEX_TYPE spIndexGetType(SPIndex index);
+
+/**
+ * @assert index != NULL
+ * @return the number of images of the index: the images of the database and
+ * 		   those inserted since, whose image indexes are all below it
+ */
+int spIndexGetImagesAmount(SPIndex index);
+
+/**
+ * @assert index != NULL
+ * @return the version of the index, which differs between any two indexes
+ * 		   created by the process and changes whenever images are inserted,
+ * 		   deleted or merged, so results found by an index can be told apart from
+ * 		   those of another or of an earlier state
+ */
+unsigned long long spIndexGetVersion(SPIndex index);
+
+/**
+ * Frees all resources associated with the index, including its store, once
+ * a merge in progress is done.
+ * If index == NULL nothing happens.
+ */
+void spIndexDestroy(SPIndex index);
+
+#endif /* SPINDEX_H_ */
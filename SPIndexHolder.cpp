@@ -0,0 +1,16 @@
+#include "SPIndexHolder.h"
+
+sp::IndexHolder::IndexHolder(SPIndex index) :
+		current(index, spIndexDestroy) {
+}
+
+sp::IndexSnapshot sp::IndexHolder::acquire() const {
+	return std::atomic_load(&current);
+}
+
+void sp::IndexHolder::publish(SPIndex index) {
+	// The replaced snapshot is released here, outside the swap, so if it was
+	// the last one the index is destroyed without delaying other swaps
+	IndexSnapshot replaced = std::atomic_exchange(&current,
+			IndexSnapshot(index, spIndexDestroy));
+}
@@ -0,0 +1,55 @@
+#ifndef SPINDEXHOLDER_H_
+#define SPINDEXHOLDER_H_
+#include <memory>
+
+extern "C" {
+#include "SPIndex.h"
+}
+
+namespace sp {
+
+/**
+ * A reference counted snapshot of an index. The index is destroyed once the
+ * last snapshot of it is released.
+ */
+typedef std::shared_ptr<struct sp_index_t> IndexSnapshot;
+
+/**
+ * Holds the current index of a process whose index is replaced while queries
+ * go on. A query acquires a snapshot of the current index and searches it
+ * until it's done, and a new index is published by an atomic swap of the
+ * current snapshot, without waiting for the queries in flight. A replaced
+ * index is destroyed once the last query which acquired it releases it, so
+ * a query never fails nor waits because of a swap, and at most the indexes
+ * which queries still search are kept in memory.
+ */
+class IndexHolder {
+private:
+	IndexSnapshot current;
+public:
+
+	/**
+	 * Creates a new holder of an index.
+	 * @param index - the index, which the holder owns from now on
+	 */
+	explicit IndexHolder(SPIndex index);
+
+	/**
+	 * This function may be called concurrently from several threads.
+	 * @return a snapshot of the current index, which stays valid while it's
+	 * 		   held however many indexes are published meanwhile
+	 */
+	IndexSnapshot acquire() const;
+
+	/**
+	 * Makes index the current index, so the queries which acquire a snapshot
+	 * from now on search it. The previous index is destroyed once no
+	 * snapshot of it is held.
+	 * This function may be called concurrently from several threads.
+	 * @param index - the new index, which the holder owns from now on
+	 */
+	void publish(SPIndex index);
+};
+
+}
+#endif
@@ -0,0 +1,88 @@
+#include <cstdlib>
+#include "SPIndexLoader.h"
+#include "SPFeatureExtractor.h"
+extern "C" {
+#include "SPLogger.h"
+#include "SPDatabaseManager.h"
+}
+
+#define LOGGER_PRINT_ERROR(HUMAN_MSG, FILE, FUNCTION, LINE) spLoggerPrintError("Error: " HUMAN_MSG, FILE, FUNCTION, LINE)
+
+#define ERR_MEM_ALLOCATION "Memory allocation failed\n"
+#define ERR_EXTRACT_FAILED "Failed to extract image features\n"
+#define ERR_LOAD_FAILED "Failed to load image features from file\n"
+#define ERR_INDEX_FAILED "Failed to build the index, check spIndexType matches spDescriptorType\n"
+
+sp::IndexLoader::IndexLoader(const SPConfig config, ImageProc* imgProc,
+		SP_POINT_STORE_TYPE storeType, int featureDim) :
+		config(config), imgProc(imgProc), storeType(storeType), featureDim(featureDim) {
+	SP_CONFIG_MSG msg = SP_CONFIG_SUCCESS;
+	numOfImages = spConfigGetNumOfImages(config, &msg);
+}
+
+bool sp::IndexLoader::extractFeatures() {
+	FeatureExtractor extractor(config, imgProc);
+	if (!extractor.extractAll()) {
+		LOGGER_PRINT_ERROR(ERR_EXTRACT_FAILED, __FILE__, __func__, __LINE__);
+		return false;
+	}
+	return true;
+}
+
+SPPointStore sp::IndexLoader::createStore() {
+	SP_POINT_STORE_MSG storeMsg = SP_POINT_STORE_SUCCESS;
+	int totalFeaturesAmount = 0;
+	// The amounts are read first, so the store is allocated once and the
+	// features of one .feats file at a time are decoded into it
+	for (int i = 0; i < numOfImages; i++) {
+		int featuresAmount = spDatabaseManagerLoadAmount(config, i);
+		if (featuresAmount < 0) {
+			LOGGER_PRINT_ERROR(ERR_LOAD_FAILED, __FILE__, __func__, __LINE__);
+			return NULL;
+		}
+		totalFeaturesAmount += featuresAmount;
+	}
+	SPPointStore store = spPointStoreCreate(storeType, featureDim, totalFeaturesAmount,
+			&storeMsg);
+	if (store == NULL) {
+		LOGGER_PRINT_ERROR(ERR_MEM_ALLOCATION, __FILE__, __func__, __LINE__);
+		return NULL;
+	}
+	for (int i = 0; i < numOfImages; i++) {
+		int featuresAmount = 0;
+		SPPoint* features = spDatabaseManagerLoad(config, i, &featuresAmount);
+		if (features == NULL) {
+			LOGGER_PRINT_ERROR(ERR_LOAD_FAILED, __FILE__, __func__, __LINE__);
+			spPointStoreDestroy(store);
+			return NULL;
+		}
+		storeMsg = spPointStoreAddPoints(store, features, featuresAmount);
+		for (int j = 0; j < featuresAmount; j++) {
+			spPointDestroy(features[j]);
+		}
+		free(features);
+		if (storeMsg != SP_POINT_STORE_SUCCESS) {
+			LOGGER_PRINT_ERROR(ERR_MEM_ALLOCATION, __FILE__, __func__, __LINE__);
+			spPointStoreDestroy(store);
+			return NULL;
+		}
+	}
+	return store;
+}
+
+SPIndex sp::IndexLoader::load() {
+	SP_INDEX_MSG indexMsg = SP_INDEX_SUCCESS;
+	SP_CONFIG_MSG configMsg = SP_CONFIG_SUCCESS;
+	if (spConfigIsExtractionMode(config, &configMsg) && !extractFeatures()) {
+		return NULL;
+	}
+	SPPointStore store = createStore();
+	if (store == NULL) {
+		return NULL;
+	}
+	SPIndex index = spIndexCreate(store, config, &indexMsg);
+	if (index == NULL) {
+		LOGGER_PRINT_ERROR(ERR_INDEX_FAILED, __FILE__, __func__, __LINE__);
+	}
+	return index;
+}
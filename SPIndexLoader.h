@@ -0,0 +1,57 @@
+#ifndef SPINDEXLOADER_H_
+#define SPINDEXLOADER_H_
+#include "SPImageProc.h"
+
+extern "C" {
+#include "SPConfig.h"
+#include "SPPointStore.h"
+#include "SPIndex.h"
+}
+
+namespace sp {
+
+/**
+ * Builds the index of the features of the database: extracts the features of
+ * all the images to their .feats files in extraction mode (see
+ * FeatureExtractor), loads the .feats files one at a time into one
+ * contiguous store, allocated once for all of them, and builds an index of
+ * spIndexType over it. So the features of the database are in memory once,
+ * in the store.
+ *
+ * Loading doesn't touch any index already built, so a running server can
+ * load a new index in the background, after the features or the .feats
+ * files were rebuilt, while its queries go on.
+ */
+class IndexLoader {
+private:
+	SPConfig config;
+	ImageProc* imgProc;
+	SP_POINT_STORE_TYPE storeType;
+	int featureDim;
+	int numOfImages;
+	bool extractFeatures();
+	SPPointStore createStore();
+public:
+
+	/**
+	 * Creates a new loader based on the configuration file.
+	 * @param config - the configuration file
+	 * @param imgProc - the image processor used to extract the features of
+	 * 					the images
+	 * @param storeType - the type of the store of the features
+	 * @param featureDim - the dimension of the features
+	 */
+	IndexLoader(const SPConfig config, ImageProc* imgProc,
+			SP_POINT_STORE_TYPE storeType, int featureDim);
+
+	/**
+	 * Builds a new index of the features of the database. An error is
+	 * logged when the index can't be built.
+	 * @return the new index, which the caller destroys, or NULL if an error
+	 * 		   occurred
+	 */
+	SPIndex load();
+};
+
+}
+#endif
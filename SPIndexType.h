@@ -0,0 +1,16 @@
+#ifndef SPINDEXTYPE_H_
+#define SPINDEXTYPE_H_
+
+typedef enum sp_index_type_t {
+	SP_INDEX_KD_TREE,
+	SP_INDEX_MULTI_INDEX_HASHING,
+	SP_INDEX_BRUTE_FORCE,
+	SP_INDEX_HNSW,
+	SP_INDEX_IVF_PQ,
+	SP_INDEX_BAG_OF_WORDS,
+	SP_INDEX_KMEANS_TREE,
+	SP_INDEX_LSH,
+	SP_INDEX_VP_TREE
+} SP_INDEX_TYPE;
+
+#endif /* SPINDEXTYPE_H_ */
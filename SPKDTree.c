@@ -198,6 +198,12 @@ void SPKDTreeKNNRecursive(SPKDTreeNode treeNode, SPPoint p, SPBPQueue bpq, SP_KD
 	if(treeNode->left == NULL && treeNode->right == NULL)
 	{
 		treePoint = *(treeNode->data);
+		// A point the queue doesn't accept isn't compared at all
+		if(!spBPQueueAccepts(bpq, spPointGetIndex(treePoint)))
+		{
+			*msg = SP_KDTREE_SUCCESS;
+			return;
+		}
 		listElement = spListElementCreate(spPointGetIndex(treePoint), spPointL2SquaredDistance(p, treePoint));
 		spBPQueueEnqueue(bpq, listElement);
 		spListElementDestroy(listElement);
@@ -221,11 +227,9 @@ void SPKDTreeKNNRecursive(SPKDTreeNode treeNode, SPPoint p, SPBPQueue bpq, SP_KD
 			return;
 	}
 
-	// dist = |treeNode.val - p[treeNode.dim]|
+	// dist = (treeNode.val - p[treeNode.dim])^2, squared as the distances in bpq are
 	dist = treeNode->val - spPointGetAxisCoor(p, treeNode->dim);
-	if(dist < 0)
-		dist *= -1;
-	//dist *= dist;
+	dist *= dist;
 
 	if(!spBPQueueIsFull(bpq) || dist < spBPQueueMaxValue(bpq))
 	{
@@ -237,6 +241,27 @@ void SPKDTreeKNNRecursive(SPKDTreeNode treeNode, SPPoint p, SPBPQueue bpq, SP_KD
 	
 }
 
+unsigned long long SPKDTreeLeafPath(SPKDTreeNode tree, SPPoint p)
+{
+	unsigned long long path = 0;
+	int level = 0;
+	if (p == NULL)
+		return 0;
+	while (tree != NULL && (tree->left != NULL || tree->right != NULL))
+	{
+		if (spPointGetAxisCoor(p, tree->dim) <= tree->val)
+			tree = tree->left;
+		else
+		{
+			if (level < 64)
+				path |= 1ULL << (63 - level);
+			tree = tree->right;
+		}
+		level++;
+	}
+	return path;
+}
+
 void SPKDTreeDestroy(SPKDTreeNode tree)
 {
 	if (tree != NULL)
@@ -68,11 +68,26 @@ int* SPKDTreeKNN(SPKDTreeNode tree, SPPoint p, int k, SP_KDTREE_MSG* msg);
  * 	This is a helper function for SPKDTreeKNN.
  * 	It follows the pseudo code in the instructions pdf file to recursively search
  * 	points that are close to the point p.
- * 	Each time we get to a leaf, we enqueue it to the given bpq.
+ * 	Each time we get to a leaf, we enqueue it to the given bpq, unless the bpq doesn't
+ * 	accept its image (see spBPQueueAccepts), then its distance isn't even computed.
  *
 */
 void SPKDTreeKNNRecursive(SPKDTreeNode treeNode, SPPoint p, SPBPQueue bpq, SP_KDTREE_MSG* msg);
 
+/*
+ * Returns the path from the root of the tree to the leaf which would contain
+ * the point p, as a search descends it: the bit of every level, from the most
+ * significant down, is 1 if the search turns right there. Levels beyond the
+ * 64th aren't recorded. Points with nearer paths share more of the search,
+ * so searching points in the order of their paths keeps the shared nodes hot
+ * in the cache.
+ *
+ * @param tree - the kdTree
+ * @param p - the point
+ * @return the path of p, 0 if tree == NULL or p == NULL
+ */
+unsigned long long SPKDTreeLeafPath(SPKDTreeNode tree, SPPoint p);
+
 void SPKDTreeDestroy(SPKDTreeNode tree);
 
 #endif /* SPKDTREE_H_ */
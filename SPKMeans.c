@@ -0,0 +1,153 @@
+#include <string.h>
+#include "SPKMeans.h"
+
+#define KMEANS_SEED 0x2545F4914F6CDD1DULL
+
+/*
+ * The next number of a xorshift64* generator, uniform in [0, 1).
+ */
+static double nextUniform(unsigned long long* state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return ((*state * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double squaredDistance(const double* a, const double* b, int dim)
+{
+	int i;
+	double diff, distance = 0;
+	for (i = 0; i < dim; i++)
+	{
+		diff = a[i] - b[i];
+		distance += diff * diff;
+	}
+	return distance;
+}
+
+static const double* getRow(const double* data, int dim, const int* rows, int i)
+{
+	return data + (size_t) (rows != NULL ? rows[i] : i) * dim;
+}
+
+/*
+ * k-means++: every next centroid is a vector drawn with a probability
+ * proportional to its squared distance from the nearest centroid so far.
+ */
+static void seedCentroids(const double* data, int dim, const int* rows, int amount, int k,
+		double* centroids, double* nearest)
+{
+	int c, i;
+	double total, target, distance;
+	unsigned long long state = KMEANS_SEED;
+	memcpy(centroids, getRow(data, dim, rows, 0), dim * sizeof(double));
+	for (i = 0; i < amount; i++)
+		nearest[i] = squaredDistance(getRow(data, dim, rows, i), centroids, dim);
+	for (c = 1; c < k; c++)
+	{
+		total = 0;
+		for (i = 0; i < amount; i++)
+			total += nearest[i];
+		target = nextUniform(&state) * total;
+		for (i = 0; i < amount - 1 && target >= nearest[i]; i++)
+			target -= nearest[i];
+		memcpy(centroids + (size_t) c * dim, getRow(data, dim, rows, i), dim * sizeof(double));
+		for (i = 0; i < amount; i++)
+		{
+			distance = squaredDistance(getRow(data, dim, rows, i),
+					centroids + (size_t) c * dim, dim);
+			if (distance < nearest[i])
+				nearest[i] = distance;
+		}
+	}
+}
+
+SP_KMEANS_MSG spKMeansTrain(const double* data, int dim, const int* rows, int amount, int k,
+		int iterations, double* centroids, int* assignments)
+{
+	int i, c, d, iteration, cluster;
+	int *clusters, *counts;
+	double* nearest;
+	const double* row;
+	bool changed = true;
+	if (data == NULL || centroids == NULL || dim <= 0 || amount <= 0 || k <= 0
+			|| iterations < 0)
+		return SP_KMEANS_INVALID_ARGUMENT;
+	if (amount <= k)
+	{
+		for (c = 0; c < k; c++)
+			memcpy(centroids + (size_t) c * dim, getRow(data, dim, rows, c % amount),
+					dim * sizeof(double));
+		for (i = 0; assignments != NULL && i < amount; i++)
+			assignments[i] = i;
+		return SP_KMEANS_SUCCESS;
+	}
+
+	clusters = (int*) malloc(amount * sizeof(int));
+	counts = (int*) malloc(k * sizeof(int));
+	nearest = (double*) malloc(amount * sizeof(double));
+	if (clusters == NULL || counts == NULL || nearest == NULL)
+	{
+		free(clusters);
+		free(counts);
+		free(nearest);
+		return SP_KMEANS_ALLOC_FAIL;
+	}
+	seedCentroids(data, dim, rows, amount, k, centroids, nearest);
+	for (i = 0; i < amount; i++)
+		clusters[i] = -1;
+
+	for (iteration = 0; iteration <= iterations && changed; iteration++)
+	{
+		changed = false;
+		for (i = 0; i < amount; i++)
+		{
+			cluster = spKMeansNearest(centroids, k, dim, getRow(data, dim, rows, i), NULL);
+			changed = changed || cluster != clusters[i];
+			clusters[i] = cluster;
+		}
+		if (!changed || iteration == iterations)
+			break;
+		// Every centroid moves to the mean of its cluster, an empty one stays
+		memset(counts, 0, k * sizeof(int));
+		for (i = 0; i < amount; i++)
+			if (counts[clusters[i]]++ == 0)
+				memset(centroids + (size_t) clusters[i] * dim, 0, dim * sizeof(double));
+		for (i = 0; i < amount; i++)
+		{
+			row = getRow(data, dim, rows, i);
+			for (d = 0; d < dim; d++)
+				centroids[(size_t) clusters[i] * dim + d] += row[d];
+		}
+		for (c = 0; c < k; c++)
+			for (d = 0; counts[c] > 0 && d < dim; d++)
+				centroids[(size_t) c * dim + d] /= counts[c];
+	}
+
+	if (assignments != NULL)
+		memcpy(assignments, clusters, amount * sizeof(int));
+	free(clusters);
+	free(counts);
+	free(nearest);
+	return SP_KMEANS_SUCCESS;
+}
+
+int spKMeansNearest(const double* centroids, int k, int dim, const double* vector,
+		double* distance)
+{
+	int c, best = 0;
+	double current, bestDistance = squaredDistance(vector, centroids, dim);
+	for (c = 1; c < k; c++)
+	{
+		current = squaredDistance(vector, centroids + (size_t) c * dim, dim);
+		if (current < bestDistance)
+		{
+			bestDistance = current;
+			best = c;
+		}
+	}
+	if (distance != NULL)
+		*distance = bestDistance;
+	return best;
+}
@@ -0,0 +1,66 @@
+#ifndef SPKMEANS_H_
+#define SPKMEANS_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+/**
+ * SP K-Means summary
+ * Clusters real vectors by Lloyd's k-means, seeded by k-means++ with a fixed
+ * seed so the same vectors always give the same centroids. Used to train the
+ * quantizers of the indexes.
+ *
+ * The vectors are rows of 'dim' doubles in one array, and a subset of them is
+ * chosen by an array of row numbers, so callers cluster samples and subsets
+ * without copying them.
+ *
+ * The following functions are supported:
+ * spKMeansTrain   - Computes the centroids of a set of vectors
+ * spKMeansNearest - Finds the nearest centroid to a vector
+ */
+
+typedef enum sp_kmeans_msg_t {
+	SP_KMEANS_INVALID_ARGUMENT,
+	SP_KMEANS_ALLOC_FAIL,
+	SP_KMEANS_SUCCESS
+} SP_KMEANS_MSG;
+
+/**
+ * Clusters vectors into k clusters. When there are fewer vectors than
+ * clusters, every vector is a centroid and the rest repeat them.
+ *
+ * @param data - the vectors, 'dim' doubles each
+ * @param dim - the dimension of the vectors
+ * @param rows - the numbers of the vectors to cluster, NULL for rows 0 to amount - 1
+ * @param amount - the number of vectors to cluster
+ * @param k - the number of clusters
+ * @param iterations - the maximal number of Lloyd iterations, fewer are run
+ * 					   if the clusters stop changing
+ * @param centroids - an array of k * dim doubles, in which the centroids are stored
+ * @param assignments - NULL, or an array of 'amount' ints in which the cluster
+ * 						of every vector is stored
+ * @return
+ * - SP_KMEANS_INVALID_ARGUMENT - if data == NULL or centroids == NULL or
+ * 		dim <= 0 or amount <= 0 or k <= 0 or iterations < 0
+ * - SP_KMEANS_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_KMEANS_SUCCESS - in case of success
+ */
+SP_KMEANS_MSG spKMeansTrain(const double* data, int dim, const int* rows, int amount, int k,
+		int iterations, double* centroids, int* assignments);
+
+/**
+ * Finds the nearest centroid to a vector.
+ *
+ * @param centroids - k centroids, 'dim' doubles each
+ * @param k - the number of centroids
+ * @param dim - the dimension of the vectors
+ * @param vector - the vector
+ * @param distance - NULL, or a pointer in which the squared distance from the
+ * 					 nearest centroid is stored
+ * @return the number of the nearest centroid
+ */
+int spKMeansNearest(const double* centroids, int k, int dim, const double* vector,
+		double* distance);
+
+#endif /* SPKMEANS_H_ */
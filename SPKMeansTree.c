@@ -0,0 +1,407 @@
+#include <string.h>
+#include "SPKMeansTree.h"
+#include "SPKMeans.h"
+
+#define MIN_NODES_CAPACITY 64
+#define MIN_HEAP_CAPACITY 64
+
+typedef struct sp_kmeans_tree_node_t
+{
+	int firstChild; // the children are consecutive nodes, -1 for a leaf
+	int children;
+	int leaf;       // the number of the leaf, -1 for an inner node
+	int first;      // the position of the node's rows in rows
+	int amount;
+} SPKMeansTreeNode;
+
+/*
+ * A node not yet searched, and the distance of the query from its centroid.
+ */
+typedef struct sp_kmeans_tree_branch_t
+{
+	double distance;
+	int node;
+} SPKMeansTreeBranch;
+
+/*
+ * A binary heap of branches, the nearest on top.
+ */
+typedef struct sp_kmeans_tree_heap_t
+{
+	SPKMeansTreeBranch* items;
+	int size;
+	int capacity;
+} SPKMeansTreeHeap;
+
+struct sp_kmeans_tree_t
+{
+	SPPointStore store;
+	const double* data;
+	int dim;
+	int branching;
+	int iterations;
+	int maxDepth;
+	int leafSize;
+	SPKMeansTreeNode* nodes;
+	double* centroids; // the centroid of every node
+	int nodesAmount;
+	int nodesCapacity;
+	int* rows;         // all the rows, the rows of every node consecutive
+	int leaves;
+	int* leafNodes;    // the node of every leaf
+};
+
+/*
+ * Appends amount nodes, returns the first of them or -1 on an allocation failure.
+ */
+static int addNodes(SPKMeansTree tree, int amount)
+{
+	int capacity = tree->nodesCapacity;
+	SPKMeansTreeNode* nodes;
+	double* centroids;
+	while (tree->nodesAmount + amount > capacity)
+		capacity = capacity < MIN_NODES_CAPACITY ? MIN_NODES_CAPACITY : 2 * capacity;
+	if (capacity > tree->nodesCapacity)
+	{
+		nodes = (SPKMeansTreeNode*) realloc(tree->nodes, capacity * sizeof(SPKMeansTreeNode));
+		if (nodes == NULL)
+			return -1;
+		tree->nodes = nodes;
+		centroids = (double*) realloc(tree->centroids,
+				(size_t) capacity * tree->dim * sizeof(double));
+		if (centroids == NULL)
+			return -1;
+		tree->centroids = centroids;
+		tree->nodesCapacity = capacity;
+	}
+	tree->nodesAmount += amount;
+	return tree->nodesAmount - amount;
+}
+
+static void makeLeaf(SPKMeansTree tree, int node)
+{
+	tree->nodes[node].firstChild = -1;
+	tree->nodes[node].children = 0;
+	tree->nodes[node].leaf = tree->leaves++;
+}
+
+/*
+ * Clusters the rows of node into its children and builds them. The rows of
+ * the node are reordered by child.
+ */
+static SP_KMEANS_TREE_MSG buildNode(SPKMeansTree tree, int node, int depth)
+{
+	int i, c, k, child, children = 0;
+	int first = tree->nodes[node].first, amount = tree->nodes[node].amount;
+	int *assignments, *childOf, *positions, *reordered;
+	double* centroids;
+	SP_KMEANS_TREE_MSG msg = SP_KMEANS_TREE_SUCCESS;
+	if (amount <= tree->leafSize || (tree->maxDepth > 0 && depth >= tree->maxDepth))
+	{
+		makeLeaf(tree, node);
+		return SP_KMEANS_TREE_SUCCESS;
+	}
+
+	k = amount < tree->branching ? amount : tree->branching;
+	centroids = (double*) malloc((size_t) k * tree->dim * sizeof(double));
+	assignments = (int*) malloc(amount * sizeof(int));
+	childOf = (int*) malloc(k * sizeof(int));
+	positions = (int*) calloc(k + 1, sizeof(int));
+	reordered = (int*) malloc(amount * sizeof(int));
+	if (centroids == NULL || assignments == NULL || childOf == NULL || positions == NULL
+			|| reordered == NULL || spKMeansTrain(tree->data, tree->dim, tree->rows + first,
+					amount, k, tree->iterations, centroids, assignments) != SP_KMEANS_SUCCESS)
+		msg = SP_KMEANS_TREE_ALLOC_FAIL;
+
+	if (msg == SP_KMEANS_TREE_SUCCESS)
+	{
+		// Empty clusters get no child
+		for (i = 0; i < amount; i++)
+			positions[assignments[i] + 1]++;
+		for (c = 0; c < k; c++)
+		{
+			childOf[c] = positions[c + 1] > 0 ? children++ : -1;
+			positions[c + 1] += positions[c];
+		}
+	}
+	if (msg == SP_KMEANS_TREE_SUCCESS && children <= 1)
+	{
+		// The rows are identical, they can't be split
+		makeLeaf(tree, node);
+		children = 0;
+	}
+	else if (msg == SP_KMEANS_TREE_SUCCESS && (child = addNodes(tree, children)) < 0)
+		msg = SP_KMEANS_TREE_ALLOC_FAIL;
+	else if (msg == SP_KMEANS_TREE_SUCCESS)
+	{
+		for (c = 0; c < k; c++)
+		{
+			if (childOf[c] < 0)
+				continue;
+			tree->nodes[child + childOf[c]].first = first + positions[c];
+			tree->nodes[child + childOf[c]].amount = positions[c + 1] - positions[c];
+			memcpy(tree->centroids + (size_t) (child + childOf[c]) * tree->dim,
+					centroids + (size_t) c * tree->dim, tree->dim * sizeof(double));
+		}
+		for (i = 0; i < amount; i++)
+			reordered[positions[assignments[i]]++] = tree->rows[first + i];
+		memcpy(tree->rows + first, reordered, amount * sizeof(int));
+		tree->nodes[node].firstChild = child;
+		tree->nodes[node].children = children;
+		tree->nodes[node].leaf = -1;
+	}
+	free(centroids);
+	free(assignments);
+	free(childOf);
+	free(positions);
+	free(reordered);
+
+	for (c = 0; c < children && msg == SP_KMEANS_TREE_SUCCESS; c++)
+		msg = buildNode(tree, tree->nodes[node].firstChild + c, depth + 1);
+	return msg;
+}
+
+SPKMeansTree spKMeansTreeCreate(SPPointStore store, int branching, int iterations,
+		int maxDepth, int leafSize, SP_KMEANS_TREE_MSG* msg)
+{
+	SPKMeansTree tree;
+	int i, size;
+	assert(msg != NULL);
+	if (store == NULL || spPointStoreGetType(store) != SP_POINT_STORE_REAL || branching < 2
+			|| iterations < 0 || maxDepth < 0 || leafSize < 1)
+	{
+		*msg = SP_KMEANS_TREE_INVALID_ARGUMENT;
+		return NULL;
+	}
+	tree = (SPKMeansTree) calloc(1, sizeof(*tree));
+	if (tree == NULL)
+	{
+		*msg = SP_KMEANS_TREE_ALLOC_FAIL;
+		return NULL;
+	}
+	size = spPointStoreGetSize(store);
+	tree->store = store;
+	tree->data = size > 0 ? spPointStoreGetRealRow(store, 0) : NULL;
+	tree->dim = spPointStoreGetDim(store);
+	tree->branching = branching;
+	tree->iterations = iterations;
+	tree->maxDepth = maxDepth;
+	tree->leafSize = leafSize;
+	tree->rows = (int*) malloc((size > 0 ? size : 1) * sizeof(int));
+	if (tree->rows == NULL || addNodes(tree, 1) < 0)
+	{
+		spKMeansTreeDestroy(tree);
+		*msg = SP_KMEANS_TREE_ALLOC_FAIL;
+		return NULL;
+	}
+	for (i = 0; i < size; i++)
+		tree->rows[i] = i;
+	tree->nodes[0].first = 0;
+	tree->nodes[0].amount = size;
+	memset(tree->centroids, 0, tree->dim * sizeof(double));
+
+	*msg = buildNode(tree, 0, 0);
+	if (*msg == SP_KMEANS_TREE_SUCCESS)
+	{
+		tree->leafNodes = (int*) malloc(tree->leaves * sizeof(int));
+		if (tree->leafNodes == NULL)
+			*msg = SP_KMEANS_TREE_ALLOC_FAIL;
+		for (i = 0; tree->leafNodes != NULL && i < tree->nodesAmount; i++)
+			if (tree->nodes[i].leaf >= 0)
+				tree->leafNodes[tree->nodes[i].leaf] = i;
+	}
+	if (*msg != SP_KMEANS_TREE_SUCCESS)
+	{
+		spKMeansTreeDestroy(tree);
+		return NULL;
+	}
+	return tree;
+}
+
+int spKMeansTreeQuantize(SPKMeansTree tree, const double* vector)
+{
+	int node = 0;
+	const SPKMeansTreeNode* current;
+	assert(tree != NULL && vector != NULL);
+	for (current = tree->nodes; current->firstChild >= 0; current = tree->nodes + node)
+		node = current->firstChild + spKMeansNearest(tree->centroids
+				+ (size_t) current->firstChild * tree->dim, current->children, tree->dim,
+				vector, NULL);
+	return current->leaf;
+}
+
+static double squaredDistance(const double* a, const double* b, int dim)
+{
+	int i;
+	double diff, distance = 0;
+	for (i = 0; i < dim; i++)
+	{
+		diff = a[i] - b[i];
+		distance += diff * diff;
+	}
+	return distance;
+}
+
+static bool heapPush(SPKMeansTreeHeap* heap, SPKMeansTreeBranch branch)
+{
+	int i, parent;
+	SPKMeansTreeBranch* items;
+	if (heap->size == heap->capacity)
+	{
+		items = (SPKMeansTreeBranch*) realloc(heap->items,
+				2 * heap->capacity * sizeof(SPKMeansTreeBranch));
+		if (items == NULL)
+			return false;
+		heap->items = items;
+		heap->capacity *= 2;
+	}
+	for (i = heap->size++; i > 0; i = parent)
+	{
+		parent = (i - 1) / 2;
+		if (heap->items[parent].distance <= branch.distance)
+			break;
+		heap->items[i] = heap->items[parent];
+	}
+	heap->items[i] = branch;
+	return true;
+}
+
+static SPKMeansTreeBranch heapPop(SPKMeansTreeHeap* heap)
+{
+	int i = 0, child;
+	SPKMeansTreeBranch top = heap->items[0], last = heap->items[--heap->size];
+	while ((child = 2 * i + 1) < heap->size)
+	{
+		if (child + 1 < heap->size && heap->items[child + 1].distance < heap->items[child].distance)
+			child++;
+		if (heap->items[child].distance >= last.distance)
+			break;
+		heap->items[i] = heap->items[child];
+		i = child;
+	}
+	heap->items[i] = last;
+	return top;
+}
+
+/*
+ * Enqueues the rows of a leaf into bpq, unless the queue doesn't accept them
+ * or is full of closer rows, and adds the number of rows compared to checked.
+ */
+static SP_KMEANS_TREE_MSG searchLeaf(SPKMeansTree tree, const SPKMeansTreeNode* leaf,
+		SPPointStore queries, int row, SPBPQueue bpq, int* checked)
+{
+	int i, current;
+	double distance;
+	SPListElement element;
+	SP_BPQUEUE_MSG bpqMsg;
+	for (i = 0; i < leaf->amount; i++)
+	{
+		current = tree->rows[leaf->first + i];
+		if (!spBPQueueAccepts(bpq, spPointStoreGetImageIndex(tree->store, current)))
+			continue;
+		(*checked)++;
+		distance = spPointStoreDistance(tree->store, current, queries, row);
+		if (spBPQueueIsFull(bpq) && distance >= spBPQueueMaxValue(bpq))
+			continue;
+		element = spListElementCreate(spPointStoreGetImageIndex(tree->store, current), distance);
+		if (element == NULL)
+			return SP_KMEANS_TREE_ALLOC_FAIL;
+		bpqMsg = spBPQueueEnqueue(bpq, element);
+		spListElementDestroy(element);
+		if (bpqMsg == SP_BPQUEUE_OUT_OF_MEMORY)
+			return SP_KMEANS_TREE_ALLOC_FAIL;
+	}
+	return SP_KMEANS_TREE_SUCCESS;
+}
+
+/*
+ * Descends from node to a leaf through the nearest child at every level and
+ * remembers the other children in heap, then searches the leaf.
+ * Returns the number of rows checked, or -1 on an allocation failure.
+ */
+static int searchBranch(SPKMeansTree tree, int node, const double* query, SPPointStore queries,
+		int row, SPKMeansTreeHeap* heap, SPBPQueue bpq)
+{
+	int c, nearest, checked = 0;
+	double distance, nearestDistance;
+	const SPKMeansTreeNode* current = tree->nodes + node;
+	SPKMeansTreeBranch branch;
+	while (current->firstChild >= 0)
+	{
+		nearest = current->firstChild;
+		nearestDistance = squaredDistance(query, tree->centroids
+				+ (size_t) nearest * tree->dim, tree->dim);
+		for (c = current->firstChild + 1; c < current->firstChild + current->children; c++)
+		{
+			distance = squaredDistance(query, tree->centroids + (size_t) c * tree->dim,
+					tree->dim);
+			branch.node = distance < nearestDistance ? nearest : c;
+			branch.distance = distance < nearestDistance ? nearestDistance : distance;
+			if (distance < nearestDistance)
+			{
+				nearest = c;
+				nearestDistance = distance;
+			}
+			if (!heapPush(heap, branch))
+				return -1;
+		}
+		current = tree->nodes + nearest;
+	}
+	if (searchLeaf(tree, current, queries, row, bpq, &checked) != SP_KMEANS_TREE_SUCCESS)
+		return -1;
+	return checked;
+}
+
+SP_KMEANS_TREE_MSG spKMeansTreeKNN(SPKMeansTree tree, SPPointStore queries, int row,
+		int checks, SPBPQueue bpq)
+{
+	int checked = 0, amount = 0;
+	const double* query;
+	SPKMeansTreeHeap heap;
+	if (tree == NULL || queries == NULL || bpq == NULL || checks < 1 || row < 0
+			|| row >= spPointStoreGetSize(queries)
+			|| spPointStoreGetType(queries) != SP_POINT_STORE_REAL
+			|| spPointStoreGetDim(queries) != tree->dim)
+		return SP_KMEANS_TREE_INVALID_ARGUMENT;
+	heap.size = 0;
+	heap.capacity = MIN_HEAP_CAPACITY;
+	heap.items = (SPKMeansTreeBranch*) malloc(heap.capacity * sizeof(SPKMeansTreeBranch));
+	if (heap.items == NULL)
+		return SP_KMEANS_TREE_ALLOC_FAIL;
+	query = spPointStoreGetRealRow(queries, row);
+
+	// Best bin first: the nearest branch not searched yet is searched next,
+	// until enough rows were checked and the queue is full
+	amount = searchBranch(tree, 0, query, queries, row, &heap, bpq);
+	for (checked = amount; amount >= 0 && heap.size > 0
+			&& (checked < checks || !spBPQueueIsFull(bpq)); checked += amount)
+		amount = searchBranch(tree, heapPop(&heap).node, query, queries, row, &heap, bpq);
+	free(heap.items);
+	return amount >= 0 ? SP_KMEANS_TREE_SUCCESS : SP_KMEANS_TREE_ALLOC_FAIL;
+}
+
+int spKMeansTreeGetLeavesAmount(SPKMeansTree tree)
+{
+	assert(tree != NULL);
+	return tree->leaves;
+}
+
+int spKMeansTreeGetLeafRows(SPKMeansTree tree, int leaf, const int** rows)
+{
+	const SPKMeansTreeNode* node;
+	assert(tree != NULL && rows != NULL && leaf >= 0 && leaf < tree->leaves);
+	node = tree->nodes + tree->leafNodes[leaf];
+	*rows = tree->rows + node->first;
+	return node->amount;
+}
+
+void spKMeansTreeDestroy(SPKMeansTree tree)
+{
+	if (tree == NULL)
+		return;
+	free(tree->nodes);
+	free(tree->centroids);
+	free(tree->rows);
+	free(tree->leafNodes);
+	free(tree);
+}
@@ -0,0 +1,120 @@
+#ifndef SPKMEANSTREE_H_
+#define SPKMEANSTREE_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "SPPointStore.h"
+#include "SPBPriorityQueue.h"
+
+/**
+ * SP K-Means Tree summary
+ * A hierarchical k-means tree over the rows of a REAL point store: the rows
+ * are clustered by k-means into 'branching' children, and every child is
+ * clustered again, until a node holds at most 'leafSize' rows or reaches the
+ * maximal depth. Every node keeps the centroid of its rows.
+ *
+ * The leaves are numbered in depth first order, and the rows of every leaf
+ * are stored contiguously, so a leaf is a bucket of row numbers. A vector is
+ * quantized to a leaf by descending to the nearest child at every level.
+ *
+ * The tree is also an approximate k nearest neighbours index (Muja and Lowe,
+ * "Scalable Nearest Neighbor Algorithms for High Dimensional Data"), searched
+ * best bin first: a query descends to a leaf and keeps the children it didn't
+ * take in a priority queue by their centroids' distances, and the search
+ * continues from the nearest of them until 'checks' rows were compared.
+ *
+ * The tree refers to the rows of the store, which must outlive it.
+ * Reading a tree is thread safe.
+ *
+ * The following functions are supported:
+ * spKMeansTreeCreate           - Builds a tree over a store
+ * spKMeansTreeQuantize         - Finds the leaf of a vector
+ * spKMeansTreeKNN              - Finds the nearest rows to a query feature
+ * spKMeansTreeGetLeavesAmount  - A getter of the number of leaves
+ * spKMeansTreeGetLeafRows      - A getter of the rows of a leaf
+ * spKMeansTreeDestroy          - Frees all resources associated with a tree
+ */
+
+typedef enum sp_kmeans_tree_msg_t {
+	SP_KMEANS_TREE_INVALID_ARGUMENT,
+	SP_KMEANS_TREE_ALLOC_FAIL,
+	SP_KMEANS_TREE_SUCCESS
+} SP_KMEANS_TREE_MSG;
+
+typedef struct sp_kmeans_tree_t* SPKMeansTree;
+
+/**
+ * Builds a tree over all the rows of store.
+ *
+ * @param store - a REAL point store
+ * @param branching - the number of children of every inner node, at most
+ * @param iterations - the maximal number of k-means iterations per node
+ * @param maxDepth - the depth of the leaves at most, 0 for no limit
+ * @param leafSize - a node of at most leafSize rows is a leaf
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new tree.
+ *
+ * - SP_KMEANS_TREE_INVALID_ARGUMENT - if store == NULL or isn't REAL or
+ * 		branching < 2 or iterations < 0 or maxDepth < 0 or leafSize < 1
+ * - SP_KMEANS_TREE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_KMEANS_TREE_SUCCESS - in case of success
+ */
+SPKMeansTree spKMeansTreeCreate(SPPointStore store, int branching, int iterations,
+		int maxDepth, int leafSize, SP_KMEANS_TREE_MSG* msg);
+
+/**
+ * Descends from the root to the nearest child at every level.
+ *
+ * @param tree - the tree
+ * @param vector - a vector of the dimension of the store
+ * @assert tree != NULL && vector != NULL
+ * @return the number of the leaf reached
+ */
+int spKMeansTreeQuantize(SPKMeansTree tree, const double* vector);
+
+/**
+ * Enqueues the nearest rows found to a query feature into bpq, up to its
+ * maximal size. Every element's index is the image index of the row and its
+ * value is its squared distance from the query feature.
+ *
+ * @param tree - the tree
+ * @param queries - a REAL store of the same dimension as the tree's
+ * @param row - the row of the query feature in queries
+ * @param checks - the number of rows to compare at least, more are compared
+ * 				   while bpq isn't full. Only the rows bpq accepts (see
+ * 				   spBPQueueAccepts) are compared and counted
+ * @param bpq - the queue to fill, its maximal size is the k in k nearest
+ * @return
+ * - SP_KMEANS_TREE_INVALID_ARGUMENT - if tree == NULL or queries == NULL or
+ * 		bpq == NULL or checks < 1 or row is out of range, or queries isn't
+ * 		REAL or its dimension doesn't match
+ * - SP_KMEANS_TREE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_KMEANS_TREE_SUCCESS - in case of success
+ */
+SP_KMEANS_TREE_MSG spKMeansTreeKNN(SPKMeansTree tree, SPPointStore queries, int row,
+		int checks, SPBPQueue bpq);
+
+/**
+ * @assert tree != NULL
+ * @return the number of leaves of the tree
+ */
+int spKMeansTreeGetLeavesAmount(SPKMeansTree tree);
+
+/**
+ * @param tree - the tree
+ * @param leaf - the number of a leaf
+ * @param rows - a pointer in which a pointer to the rows of the leaf is stored
+ * @assert tree != NULL && rows != NULL && 0 <= leaf < the number of leaves
+ * @return the number of rows of the leaf
+ */
+int spKMeansTreeGetLeafRows(SPKMeansTree tree, int leaf, const int** rows);
+
+/**
+ * Frees all resources associated with the tree. The store isn't destroyed.
+ * If tree == NULL nothing happens.
+ */
+void spKMeansTreeDestroy(SPKMeansTree tree);
+
+#endif /* SPKMEANSTREE_H_ */
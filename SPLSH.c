@@ -0,0 +1,556 @@
+#define _POSIX_C_SOURCE 200809L // For sysconf
+#include <math.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "SPLSH.h"
+
+#define TABLE_SEED 0x9E3779B97F4A7C15ULL
+#define KEY_SEED 0xCBF29CE484222325ULL
+#define PI 3.14159265358979323846
+#define MIN_CAPACITY 64
+
+typedef struct sp_lsh_table_t
+{
+	double* projections;       // the vector a of every function
+	double* offsets;           // the offset b of every function
+	unsigned long long* keys;  // the key of every bucket, ascending
+	int* starts;               // the rows of bucket i are rows[starts[i]] to rows[starts[i + 1] - 1]
+	int* rows;
+	int buckets;
+} SPLSHTable;
+
+struct sp_lsh_t
+{
+	SPPointStore store;
+	int dim;
+	int size;
+	int functions;
+	double width;
+	unsigned int seed;
+	int tablesAmount;
+	SPLSHTable* tables;
+	int next; // the next table to build
+	bool failed;
+	pthread_mutex_t nextLock;
+};
+
+/*
+ * A row and the key of its bucket.
+ */
+typedef struct sp_lsh_entry_t
+{
+	unsigned long long key;
+	int row;
+} SPLSHEntry;
+
+/*
+ * A perturbation of the query's hash values, one of the 2 * functions
+ * perturbations (by -1 or +1 of a function) sorted by their scores.
+ */
+typedef struct sp_lsh_perturbation_t
+{
+	double score; // the squared distance from the query's projection to the boundary
+	int function;
+	int step;
+} SPLSHPerturbation;
+
+/*
+ * A set of perturbations, as a mask over the sorted perturbations, and its
+ * score, the sum of theirs.
+ */
+typedef struct sp_lsh_probe_t
+{
+	double score;
+	unsigned long long mask;
+} SPLSHProbe;
+
+typedef struct sp_lsh_probe_heap_t
+{
+	SPLSHProbe* items;
+	int size;
+	int capacity;
+} SPLSHProbeHeap;
+
+/*
+ * The next number of a splitmix64 generator.
+ */
+static unsigned long long nextRandom(unsigned long long* state)
+{
+	unsigned long long x = (*state += 0x9E3779B97F4A7C15ULL);
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+/*
+ * A uniform number in (0, 1].
+ */
+static double nextUniform(unsigned long long* state)
+{
+	return ((nextRandom(state) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * A standard normal number, by the Box-Muller transform.
+ */
+static double nextGaussian(unsigned long long* state)
+{
+	double radius = sqrt(-2 * log(nextUniform(state)));
+	return radius * cos(2 * PI * nextUniform(state));
+}
+
+/*
+ * Combines the hash values of all the functions into the key of a bucket.
+ */
+static unsigned long long bucketKey(const int* codes, int functions)
+{
+	int i;
+	unsigned long long key = KEY_SEED;
+	for (i = 0; i < functions; i++)
+	{
+		key ^= (unsigned long long) (unsigned int) codes[i];
+		key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+		key ^= key >> 31;
+	}
+	return key;
+}
+
+/*
+ * The projections of a vector by all the functions of a table, in buckets:
+ * hash value i is the integer part of projections[i].
+ */
+static void project(SPLSH lsh, const SPLSHTable* table, const double* vector,
+		double* projections)
+{
+	int i, d;
+	double value;
+	const double* a;
+	for (i = 0; i < lsh->functions; i++)
+	{
+		a = table->projections + (size_t) i * lsh->dim;
+		value = table->offsets[i];
+		for (d = 0; d < lsh->dim; d++)
+			value += a[d] * vector[d];
+		projections[i] = value / lsh->width;
+	}
+}
+
+static int entryComp(const void* a, const void* b)
+{
+	const SPLSHEntry* x = (const SPLSHEntry*) a;
+	const SPLSHEntry* y = (const SPLSHEntry*) b;
+	if (x->key != y->key)
+		return x->key < y->key ? -1 : 1;
+	return x->row - y->row;
+}
+
+static int perturbationComp(const void* a, const void* b)
+{
+	const SPLSHPerturbation* x = (const SPLSHPerturbation*) a;
+	const SPLSHPerturbation* y = (const SPLSHPerturbation*) b;
+	if (x->score != y->score)
+		return x->score < y->score ? -1 : 1;
+	if (x->function != y->function)
+		return x->function - y->function;
+	return x->step - y->step;
+}
+
+static int intComp(const void* a, const void* b)
+{
+	return *(const int*) a - *(const int*) b;
+}
+
+/*
+ * Draws the functions of table number 'number' from the seed, and sorts the
+ * rows into buckets.
+ */
+static bool buildTable(SPLSH lsh, int number)
+{
+	int i, row, bucket;
+	int codes[SP_LSH_MAX_FUNCTIONS];
+	double projections[SP_LSH_MAX_FUNCTIONS];
+	unsigned long long state = (unsigned long long) lsh->seed * TABLE_SEED + number;
+	SPLSHTable* table = lsh->tables + number;
+	SPLSHEntry* entries;
+
+	table->projections = (double*) malloc((size_t) lsh->functions * lsh->dim * sizeof(double));
+	table->offsets = (double*) malloc(lsh->functions * sizeof(double));
+	table->keys = (unsigned long long*) malloc((lsh->size > 0 ? lsh->size : 1)
+			* sizeof(unsigned long long));
+	table->starts = (int*) malloc((lsh->size + 1) * sizeof(int));
+	table->rows = (int*) malloc((lsh->size > 0 ? lsh->size : 1) * sizeof(int));
+	entries = (SPLSHEntry*) malloc((lsh->size > 0 ? lsh->size : 1) * sizeof(SPLSHEntry));
+	if (table->projections == NULL || table->offsets == NULL || table->keys == NULL
+			|| table->starts == NULL || table->rows == NULL || entries == NULL)
+	{
+		free(entries);
+		return false;
+	}
+	for (i = 0; i < lsh->functions * lsh->dim; i++)
+		table->projections[i] = nextGaussian(&state);
+	for (i = 0; i < lsh->functions; i++)
+		table->offsets[i] = (1 - nextUniform(&state)) * lsh->width;
+
+	for (row = 0; row < lsh->size; row++)
+	{
+		project(lsh, table, spPointStoreGetRealRow(lsh->store, row), projections);
+		for (i = 0; i < lsh->functions; i++)
+			codes[i] = (int) floor(projections[i]);
+		entries[row].key = bucketKey(codes, lsh->functions);
+		entries[row].row = row;
+	}
+	qsort(entries, lsh->size, sizeof(SPLSHEntry), entryComp);
+	for (row = 0, bucket = 0; row < lsh->size; row++)
+	{
+		if (row == 0 || entries[row].key != entries[row - 1].key)
+		{
+			table->keys[bucket] = entries[row].key;
+			table->starts[bucket++] = row;
+		}
+		table->rows[row] = entries[row].row;
+	}
+	table->starts[bucket] = lsh->size;
+	table->buckets = bucket;
+	free(entries);
+	return true;
+}
+
+/*
+ * Builds tables until all are built, every table by a single thread.
+ */
+static void* buildWorker(void* argument)
+{
+	SPLSH lsh = (SPLSH) argument;
+	int number;
+	while (true)
+	{
+		pthread_mutex_lock(&lsh->nextLock);
+		number = lsh->failed ? lsh->tablesAmount : lsh->next++;
+		pthread_mutex_unlock(&lsh->nextLock);
+		if (number >= lsh->tablesAmount)
+			break;
+		if (!buildTable(lsh, number))
+		{
+			pthread_mutex_lock(&lsh->nextLock);
+			lsh->failed = true;
+			pthread_mutex_unlock(&lsh->nextLock);
+		}
+	}
+	return NULL;
+}
+
+/*
+ * The standard deviation of the projections of the rows on a standard normal
+ * vector, the square root of the sum of the variances of the coordinates.
+ */
+static double projectionDeviation(SPPointStore store)
+{
+	int row, d, size = spPointStoreGetSize(store), dim = spPointStoreGetDim(store);
+	double mean, variance, deviation = 0;
+	for (d = 0; d < dim && size > 0; d++)
+	{
+		mean = 0;
+		for (row = 0; row < size; row++)
+			mean += spPointStoreGetRealRow(store, row)[d];
+		mean /= size;
+		variance = 0;
+		for (row = 0; row < size; row++)
+			variance += (spPointStoreGetRealRow(store, row)[d] - mean)
+					* (spPointStoreGetRealRow(store, row)[d] - mean);
+		deviation += variance / size;
+	}
+	return deviation > 0 ? sqrt(deviation) : 1;
+}
+
+SPLSH spLSHCreate(SPPointStore store, int tables, int functions, int width, unsigned int seed,
+		int numOfThreads, SP_LSH_MSG* msg)
+{
+	SPLSH lsh;
+	int i, created;
+	pthread_t* threads;
+	assert(msg != NULL);
+	if (store == NULL || spPointStoreGetType(store) != SP_POINT_STORE_REAL || tables < 1
+			|| functions < 1 || functions > SP_LSH_MAX_FUNCTIONS || width < 1)
+	{
+		*msg = SP_LSH_INVALID_ARGUMENT;
+		return NULL;
+	}
+	lsh = (SPLSH) calloc(1, sizeof(*lsh));
+	if (lsh == NULL)
+	{
+		*msg = SP_LSH_ALLOC_FAIL;
+		return NULL;
+	}
+	lsh->store = store;
+	lsh->dim = spPointStoreGetDim(store);
+	lsh->size = spPointStoreGetSize(store);
+	lsh->functions = functions;
+	lsh->width = width / 100.0 * projectionDeviation(store);
+	lsh->seed = seed;
+	lsh->tablesAmount = tables;
+	pthread_mutex_init(&lsh->nextLock, NULL);
+	lsh->tables = (SPLSHTable*) calloc(tables, sizeof(SPLSHTable));
+	if (lsh->tables == NULL)
+	{
+		spLSHDestroy(lsh);
+		*msg = SP_LSH_ALLOC_FAIL;
+		return NULL;
+	}
+
+	if (numOfThreads <= 0)
+		numOfThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if (numOfThreads > tables)
+		numOfThreads = tables;
+	if (numOfThreads < 1)
+		numOfThreads = 1;
+	threads = (pthread_t*) malloc(numOfThreads * sizeof(pthread_t));
+	for (created = 0; threads != NULL && created < numOfThreads - 1; created++)
+		if (pthread_create(&threads[created], NULL, buildWorker, lsh) != 0)
+			break;
+	buildWorker(lsh);
+	for (i = 0; i < created; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+
+	if (lsh->failed)
+	{
+		spLSHDestroy(lsh);
+		*msg = SP_LSH_ALLOC_FAIL;
+		return NULL;
+	}
+	*msg = SP_LSH_SUCCESS;
+	return lsh;
+}
+
+static bool heapPush(SPLSHProbeHeap* heap, SPLSHProbe probe)
+{
+	int i, parent;
+	SPLSHProbe* items;
+	if (heap->size == heap->capacity)
+	{
+		items = (SPLSHProbe*) realloc(heap->items, 2 * heap->capacity * sizeof(SPLSHProbe));
+		if (items == NULL)
+			return false;
+		heap->items = items;
+		heap->capacity *= 2;
+	}
+	for (i = heap->size++; i > 0; i = parent)
+	{
+		parent = (i - 1) / 2;
+		if (heap->items[parent].score <= probe.score)
+			break;
+		heap->items[i] = heap->items[parent];
+	}
+	heap->items[i] = probe;
+	return true;
+}
+
+static SPLSHProbe heapPop(SPLSHProbeHeap* heap)
+{
+	int i = 0, child;
+	SPLSHProbe top = heap->items[0], last = heap->items[--heap->size];
+	while ((child = 2 * i + 1) < heap->size)
+	{
+		if (child + 1 < heap->size && heap->items[child + 1].score < heap->items[child].score)
+			child++;
+		if (heap->items[child].score >= last.score)
+			break;
+		heap->items[i] = heap->items[child];
+		i = child;
+	}
+	heap->items[i] = last;
+	return top;
+}
+
+/*
+ * Appends the rows of the bucket of codes in table to candidates, growing it.
+ */
+static bool addBucket(SPLSH lsh, const SPLSHTable* table, const int* codes, int** candidates,
+		int* amount, int* capacity)
+{
+	int low = 0, high = table->buckets - 1, middle, rows;
+	int* grown;
+	unsigned long long key = bucketKey(codes, lsh->functions);
+	while (low <= high)
+	{
+		middle = low + (high - low) / 2;
+		if (table->keys[middle] == key)
+			break;
+		if (table->keys[middle] < key)
+			low = middle + 1;
+		else
+			high = middle - 1;
+	}
+	if (low > high)
+		return true;
+	rows = table->starts[middle + 1] - table->starts[middle];
+	if (*amount + rows > *capacity)
+	{
+		while (*amount + rows > *capacity)
+			*capacity *= 2;
+		grown = (int*) realloc(*candidates, *capacity * sizeof(int));
+		if (grown == NULL)
+			return false;
+		*candidates = grown;
+	}
+	memcpy(*candidates + *amount, table->rows + table->starts[middle], rows * sizeof(int));
+	*amount += rows;
+	return true;
+}
+
+/*
+ * Whether a set of perturbations changes every hash value once at most.
+ */
+static bool isValidProbe(const SPLSHPerturbation* perturbations, unsigned long long mask)
+{
+	int j;
+	unsigned long long functions = 0, bit;
+	for (j = 0; mask != 0; j++, mask >>= 1)
+	{
+		if (!(mask & 1))
+			continue;
+		bit = 1ULL << perturbations[j].function;
+		if (functions & bit)
+			return false;
+		functions |= bit;
+	}
+	return true;
+}
+
+static int highestBit(unsigned long long mask)
+{
+	int j = -1;
+	for (; mask != 0; mask >>= 1)
+		j++;
+	return j;
+}
+
+/*
+ * Collects the rows of the query's bucket in table and of the probes - 1
+ * nearest buckets to it. The sets of perturbations are generated in the
+ * order of their scores by shifting and expanding the best set so far.
+ */
+static bool probeTable(SPLSH lsh, const SPLSHTable* table, const double* query, int probes,
+		SPLSHProbeHeap* heap, int** candidates, int* amount, int* capacity)
+{
+	int i, j, last, probed;
+	int codes[SP_LSH_MAX_FUNCTIONS], perturbed[SP_LSH_MAX_FUNCTIONS];
+	double projections[SP_LSH_MAX_FUNCTIONS], fraction;
+	SPLSHPerturbation perturbations[2 * SP_LSH_MAX_FUNCTIONS];
+	SPLSHProbe probe, next;
+	bool ok;
+
+	project(lsh, table, query, projections);
+	for (i = 0; i < lsh->functions; i++)
+	{
+		codes[i] = (int) floor(projections[i]);
+		fraction = projections[i] - codes[i];
+		perturbations[2 * i].score = fraction * fraction;
+		perturbations[2 * i].function = i;
+		perturbations[2 * i].step = -1;
+		perturbations[2 * i + 1].score = (1 - fraction) * (1 - fraction);
+		perturbations[2 * i + 1].function = i;
+		perturbations[2 * i + 1].step = 1;
+	}
+	ok = addBucket(lsh, table, codes, candidates, amount, capacity);
+	if (!ok || probes == 1)
+		return ok;
+
+	qsort(perturbations, 2 * lsh->functions, sizeof(SPLSHPerturbation), perturbationComp);
+	heap->size = 0;
+	probe.score = perturbations[0].score;
+	probe.mask = 1;
+	ok = heapPush(heap, probe);
+	for (probed = 1; ok && probed < probes && heap->size > 0;)
+	{
+		probe = heapPop(heap);
+		last = highestBit(probe.mask);
+		if (last + 1 < 2 * lsh->functions)
+		{
+			next.mask = (probe.mask & ~(1ULL << last)) | (1ULL << (last + 1));
+			next.score = probe.score - perturbations[last].score + perturbations[last + 1].score;
+			ok = heapPush(heap, next);
+			next.mask = probe.mask | (1ULL << (last + 1));
+			next.score = probe.score + perturbations[last + 1].score;
+			ok = ok && heapPush(heap, next);
+		}
+		if (!ok || !isValidProbe(perturbations, probe.mask))
+			continue;
+		memcpy(perturbed, codes, lsh->functions * sizeof(int));
+		for (j = 0; j <= last; j++)
+			if (probe.mask & (1ULL << j))
+				perturbed[perturbations[j].function] += perturbations[j].step;
+		ok = addBucket(lsh, table, perturbed, candidates, amount, capacity);
+		probed++;
+	}
+	return ok;
+}
+
+SP_LSH_MSG spLSHKNN(SPLSH lsh, SPPointStore queries, int row, int probes, SPBPQueue bpq)
+{
+	int t, i, amount = 0, capacity = MIN_CAPACITY;
+	int* candidates;
+	double distance;
+	const double* query;
+	bool ok = true;
+	SPLSHProbeHeap heap;
+	SPListElement element;
+	if (lsh == NULL || queries == NULL || bpq == NULL || probes < 1 || row < 0
+			|| row >= spPointStoreGetSize(queries)
+			|| spPointStoreGetType(queries) != SP_POINT_STORE_REAL
+			|| spPointStoreGetDim(queries) != lsh->dim)
+		return SP_LSH_INVALID_ARGUMENT;
+	candidates = (int*) malloc(capacity * sizeof(int));
+	heap.size = 0;
+	heap.capacity = MIN_CAPACITY;
+	heap.items = (SPLSHProbe*) malloc(heap.capacity * sizeof(SPLSHProbe));
+	if (candidates == NULL || heap.items == NULL)
+	{
+		free(candidates);
+		free(heap.items);
+		return SP_LSH_ALLOC_FAIL;
+	}
+	query = spPointStoreGetRealRow(queries, row);
+	for (t = 0; t < lsh->tablesAmount && ok; t++)
+		ok = probeTable(lsh, lsh->tables + t, query, probes, &heap, &candidates, &amount,
+				&capacity);
+	free(heap.items);
+
+	// A row may be found in several tables, it's compared once
+	qsort(candidates, amount, sizeof(int), intComp);
+	for (i = 0; i < amount && ok; i++)
+	{
+		if ((i > 0 && candidates[i] == candidates[i - 1])
+				|| !spBPQueueAccepts(bpq, spPointStoreGetImageIndex(lsh->store, candidates[i])))
+			continue;
+		distance = spPointStoreDistance(lsh->store, candidates[i], queries, row);
+		if (spBPQueueIsFull(bpq) && distance >= spBPQueueMaxValue(bpq))
+			continue;
+		element = spListElementCreate(spPointStoreGetImageIndex(lsh->store, candidates[i]),
+				distance);
+		ok = element != NULL && spBPQueueEnqueue(bpq, element) != SP_BPQUEUE_OUT_OF_MEMORY;
+		spListElementDestroy(element);
+	}
+	free(candidates);
+	return ok ? SP_LSH_SUCCESS : SP_LSH_ALLOC_FAIL;
+}
+
+void spLSHDestroy(SPLSH lsh)
+{
+	int t;
+	if (lsh == NULL)
+		return;
+	for (t = 0; lsh->tables != NULL && t < lsh->tablesAmount; t++)
+	{
+		free(lsh->tables[t].projections);
+		free(lsh->tables[t].offsets);
+		free(lsh->tables[t].keys);
+		free(lsh->tables[t].starts);
+		free(lsh->tables[t].rows);
+	}
+	free(lsh->tables);
+	pthread_mutex_destroy(&lsh->nextLock);
+	free(lsh);
+}
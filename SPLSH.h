@@ -0,0 +1,106 @@
+#ifndef SPLSH_H_
+#define SPLSH_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "SPPointStore.h"
+#include "SPBPriorityQueue.h"
+
+/**
+ * SP LSH summary
+ * An approximate k nearest neighbours index by locality sensitive hashing
+ * with p-stable projections (Datar, Immorlica, Indyk and Mirrokni,
+ * "Locality-Sensitive Hashing Scheme Based on p-Stable Distributions"),
+ * searched by multi-probe (Lv, Josephson, Wang, Charikar and Li,
+ * "Multi-Probe LSH: Efficient Indexing for High-Dimensional Similarity
+ * Search").
+ *
+ * Every table hashes a feature by 'functions' functions h(v) = floor((a.v + b) / w),
+ * where a is a random Gaussian vector and b is uniform in [0, w), so near
+ * features tend to share a bucket. The width w is given in percents of the
+ * standard deviation of the projections of the features, so it doesn't
+ * depend on their scale. The rows of every table are sorted by their
+ * buckets, so a bucket is a contiguous run of row numbers.
+ *
+ * A search probes in every table the bucket of the query and the 'probes' - 1
+ * buckets nearest to it, those of the perturbations of the query's hash values
+ * by +1 or -1 with the smallest sum of squared distances from the query's
+ * projections to the bucket boundaries. The distinct rows found are compared
+ * with the query exactly.
+ *
+ * The tables are built in parallel, one per thread at a time. Everything
+ * random is drawn from the seed, so the index doesn't depend on the number of
+ * threads. The index refers to the rows of the store, which must outlive it.
+ * Searching is thread safe.
+ *
+ * The following functions are supported:
+ * spLSHCreate  - Builds the index over a store
+ * spLSHKNN     - Finds the nearest features to a query feature
+ * spLSHDestroy - Frees all resources associated with the index
+ */
+
+/** The maximal number of hash functions per table **/
+#define SP_LSH_MAX_FUNCTIONS 32
+
+typedef enum sp_lsh_msg_t {
+	SP_LSH_INVALID_ARGUMENT,
+	SP_LSH_ALLOC_FAIL,
+	SP_LSH_SUCCESS
+} SP_LSH_MSG;
+
+typedef struct sp_lsh_t* SPLSH;
+
+/**
+ * Draws the hash functions from seed and hashes all the rows of store.
+ *
+ * @param store - a REAL point store
+ * @param tables - the number of hash tables
+ * @param functions - the number of hash functions of every table, at most
+ * 					  SP_LSH_MAX_FUNCTIONS
+ * @param width - the width of a bucket, in percents of the standard deviation
+ * 				  of the projections
+ * @param seed - the seed of the hash functions
+ * @param numOfThreads - the number of threads which build the tables,
+ * 						 the number of processors if not positive
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new index.
+ *
+ * - SP_LSH_INVALID_ARGUMENT - if store == NULL or isn't REAL, or tables < 1
+ * 		or functions < 1 or functions > SP_LSH_MAX_FUNCTIONS or width < 1
+ * - SP_LSH_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_LSH_SUCCESS - in case of success
+ */
+SPLSH spLSHCreate(SPPointStore store, int tables, int functions, int width, unsigned int seed,
+		int numOfThreads, SP_LSH_MSG* msg);
+
+/**
+ * Enqueues the nearest features found to a query feature into bpq, up to its
+ * maximal size. Every element's index is the image index of the feature and
+ * its value is its squared distance from the query feature.
+ * Only the candidates bpq accepts (see spBPQueueAccepts) are compared. The
+ * buckets probed don't depend on bpq, so a selective filter may leave it
+ * short of k features, more probes make up for it.
+ *
+ * @param lsh - the index
+ * @param queries - a REAL store of the same dimension as the index's
+ * @param row - the row of the query feature in queries
+ * @param probes - the number of buckets to probe in every table
+ * @param bpq - the queue to fill, its maximal size is the k in k nearest
+ * @return
+ * - SP_LSH_INVALID_ARGUMENT - if lsh == NULL or queries == NULL or bpq == NULL
+ * 		or row is out of range or probes < 1, or queries isn't REAL or its
+ * 		dimension doesn't match
+ * - SP_LSH_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_LSH_SUCCESS - in case of success
+ */
+SP_LSH_MSG spLSHKNN(SPLSH lsh, SPPointStore queries, int row, int probes, SPBPQueue bpq);
+
+/**
+ * Frees all resources associated with the index. The store isn't destroyed.
+ * If lsh == NULL nothing happens.
+ */
+void spLSHDestroy(SPLSH lsh);
+
+#endif /* SPLSH_H_ */
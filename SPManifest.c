@@ -0,0 +1,243 @@
+#define _POSIX_C_SOURCE 200809L // For the nanoseconds of st_mtim
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "SPManifest.h"
+#include "SPHash.h"
+
+#define MAX_LEN 1024
+#define MANIFEST_MAGIC "SPManifest"
+#define MANIFEST_VERSION 1
+#define TMP_SUFFIX ".tmp"
+
+/*
+ * The manifest file is a text file of the following format:
+ *
+ * 	SPManifest <version> <stateHash> <imagesAmount>
+ * 	<index> <imageSize> <imageMtime> <imageHash> <featsSize> <featsMtime> <imagePath>
+ * 	...
+ *
+ * The image path is the rest of its line, so it may contain spaces.
+ * One line is written for every image which has an up to date .feats file.
+ */
+
+// The recorded state of a single image
+typedef struct sp_manifest_entry_t
+{
+	bool isValid;
+	char* imagePath;
+	long long imageSize;
+	long long imageMtime;
+	unsigned long long imageHash;
+	long long featsSize;
+	long long featsMtime;
+} SPManifestEntry;
+
+struct sp_manifest_t
+{
+	unsigned long long stateHash;
+	int imagesAmount;
+	SPManifestEntry* entries;
+};
+
+// Stores the size and modification time (in nanoseconds) of the file given by path, returns false if it doesn't exist
+static bool getFileState(const char* path, long long* size, long long* mtime)
+{
+	struct stat fileStat;
+	if (stat(path, &fileStat) != 0)
+		return false;
+	*size = (long long) fileStat.st_size;
+	*mtime = (long long) fileStat.st_mtim.tv_sec * 1000000000LL + fileStat.st_mtim.tv_nsec;
+	return true;
+}
+
+// Sets the path of an entry, returns false on allocation failure
+static bool setEntryPath(SPManifestEntry* entry, const char* imagePath)
+{
+	char* copy = (char*) malloc((strlen(imagePath) + 1) * sizeof(char));
+	if (copy == NULL)
+		return false;
+	strcpy(copy, imagePath);
+	free(entry->imagePath);
+	entry->imagePath = copy;
+	return true;
+}
+
+// Loads the entries of the manifest file, malformed lines end the loading
+static void loadEntries(SPManifest manifest, const char* manifestPath)
+{
+	FILE* file;
+	int version, fileImagesAmount, index;
+	size_t pathLength;
+	unsigned long long fileStateHash;
+	char magic[MAX_LEN];
+	char imagePath[MAX_LEN];
+	SPManifestEntry entry;
+
+	file = fopen(manifestPath, "r");
+	if (file == NULL) // No manifest yet, every image will be extracted
+		return;
+
+	if (fscanf(file, "%1023s %d %llu %d", magic, &version, &fileStateHash, &fileImagesAmount) != 4
+			|| strcmp(magic, MANIFEST_MAGIC) != 0 || version != MANIFEST_VERSION
+			|| fileStateHash != manifest->stateHash)
+	{
+		fclose(file);
+		return;
+	}
+
+	// The path is the rest of the line after a single space, so it may contain spaces
+	while (fscanf(file, "%d %lld %lld %llu %lld %lld", &index, &entry.imageSize,
+			&entry.imageMtime, &entry.imageHash, &entry.featsSize, &entry.featsMtime) == 6
+			&& fgetc(file) == ' ' && fgets(imagePath, MAX_LEN, file) != NULL)
+	{
+		pathLength = strlen(imagePath);
+		if (pathLength > 0 && imagePath[pathLength - 1] == '\n')
+			imagePath[--pathLength] = '\0';
+		else if (!feof(file)) // The path is too long to be one of ours
+			break;
+		if (pathLength == 0)
+			break;
+		if (index < 0 || index >= manifest->imagesAmount) // Image was removed from the database
+			continue;
+		entry.isValid = true;
+		entry.imagePath = manifest->entries[index].imagePath;
+		if (!setEntryPath(&entry, imagePath))
+			break;
+		manifest->entries[index] = entry;
+	}
+
+	fclose(file);
+}
+
+SPManifest spManifestCreate(const char* manifestPath, int imagesAmount,
+		unsigned long long stateHash, SP_MANIFEST_MSG* msg)
+{
+	SPManifest manifest;
+	assert(msg != NULL);
+	if (manifestPath == NULL || imagesAmount <= 0)
+	{
+		*msg = SP_MANIFEST_INVALID_ARGUMENT;
+		return NULL;
+	}
+	manifest = (SPManifest) malloc(sizeof(*manifest));
+	if (manifest == NULL)
+	{
+		*msg = SP_MANIFEST_ALLOC_FAIL;
+		return NULL;
+	}
+	manifest->entries = (SPManifestEntry*) calloc(imagesAmount, sizeof(SPManifestEntry));
+	if (manifest->entries == NULL)
+	{
+		free(manifest);
+		*msg = SP_MANIFEST_ALLOC_FAIL;
+		return NULL;
+	}
+	manifest->stateHash = stateHash;
+	manifest->imagesAmount = imagesAmount;
+
+	loadEntries(manifest, manifestPath);
+
+	*msg = SP_MANIFEST_SUCCESS;
+	return manifest;
+}
+
+bool spManifestIsUpToDate(SPManifest manifest, int index, const char* imagePath,
+		const char* featsPath)
+{
+	SPManifestEntry* entry;
+	long long size, mtime;
+	unsigned long long hash;
+
+	if (manifest == NULL || imagePath == NULL || featsPath == NULL
+			|| index < 0 || index >= manifest->imagesAmount)
+		return false;
+
+	entry = &manifest->entries[index];
+	if (!entry->isValid || strcmp(entry->imagePath, imagePath) != 0)
+		return false;
+
+	// The .feats file must be exactly as we left it
+	if (!getFileState(featsPath, &size, &mtime) || size != entry->featsSize || mtime != entry->featsMtime)
+		return false;
+
+	if (!getFileState(imagePath, &size, &mtime) || size != entry->imageSize)
+		return false;
+	if (mtime == entry->imageMtime)
+		return true;
+
+	// The image was touched, only its content decides
+	if (!spHashFile(imagePath, &hash) || hash != entry->imageHash)
+		return false;
+	entry->imageMtime = mtime;
+	return true;
+}
+
+SP_MANIFEST_MSG spManifestUpdate(SPManifest manifest, int index, const char* imagePath,
+		const char* featsPath)
+{
+	SPManifestEntry* entry;
+	if (manifest == NULL || imagePath == NULL || featsPath == NULL
+			|| index < 0 || index >= manifest->imagesAmount)
+		return SP_MANIFEST_INVALID_ARGUMENT;
+
+	entry = &manifest->entries[index];
+	entry->isValid = false;
+	if (!getFileState(imagePath, &entry->imageSize, &entry->imageMtime)
+			|| !getFileState(featsPath, &entry->featsSize, &entry->featsMtime)
+			|| !spHashFile(imagePath, &entry->imageHash))
+		return SP_MANIFEST_CANNOT_OPEN_FILE;
+	if (!setEntryPath(entry, imagePath))
+		return SP_MANIFEST_ALLOC_FAIL;
+	entry->isValid = true;
+	return SP_MANIFEST_SUCCESS;
+}
+
+SP_MANIFEST_MSG spManifestSave(SPManifest manifest, const char* manifestPath)
+{
+	FILE* file;
+	int i;
+	bool success;
+	char tmpPath[MAX_LEN + sizeof(TMP_SUFFIX)];
+	SPManifestEntry* entry;
+
+	if (manifest == NULL || manifestPath == NULL || strlen(manifestPath) >= MAX_LEN)
+		return SP_MANIFEST_INVALID_ARGUMENT;
+
+	// Write to a temporary file first, so a crash never leaves a truncated manifest
+	sprintf(tmpPath, "%s%s", manifestPath, TMP_SUFFIX);
+	file = fopen(tmpPath, "w");
+	if (file == NULL)
+		return SP_MANIFEST_CANNOT_OPEN_FILE;
+
+	success = fprintf(file, "%s %d %llu %d\n", MANIFEST_MAGIC, MANIFEST_VERSION,
+			manifest->stateHash, manifest->imagesAmount) >= 0;
+	for (i = 0; i < manifest->imagesAmount && success; i++)
+	{
+		entry = &manifest->entries[i];
+		if (!entry->isValid)
+			continue;
+		success = fprintf(file, "%d %lld %lld %llu %lld %lld %s\n", i, entry->imageSize,
+				entry->imageMtime, entry->imageHash, entry->featsSize, entry->featsMtime,
+				entry->imagePath) >= 0;
+	}
+
+	if (fclose(file) != 0 || !success || rename(tmpPath, manifestPath) != 0)
+	{
+		remove(tmpPath);
+		return SP_MANIFEST_WRITE_FAIL;
+	}
+	return SP_MANIFEST_SUCCESS;
+}
+
+void spManifestDestroy(SPManifest manifest)
+{
+	int i;
+	if (manifest != NULL)
+	{
+		for (i = 0; i < manifest->imagesAmount; i++)
+			free(manifest->entries[i].imagePath);
+		free(manifest->entries);
+		free(manifest);
+	}
+}
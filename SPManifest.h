@@ -0,0 +1,113 @@
+#ifndef SPMANIFEST_H_
+#define SPMANIFEST_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+/**
+ * SP Manifest summary
+ * Records, for every image in the database, the state of the image file
+ * (path, size, modification time and content hash) and of its .feats file
+ * (size and modification time) at the time its features were extracted.
+ * It is used to skip the extraction of images which haven't changed.
+ *
+ * The manifest also records a state hash which identifies everything else the
+ * .feats files depend on (the PCA basis, the PCA dimension...). When the state
+ * hash changes, all recorded entries are discarded.
+ *
+ * spManifestIsUpToDate and spManifestUpdate only touch the entry of the given
+ * image, so they may be called concurrently for different images.
+ *
+ * The following functions are supported:
+ * spManifestCreate     - Creates a manifest, loading the entries of an existing manifest file
+ * spManifestIsUpToDate - Checks if the features of an image don't need to be extracted again
+ * spManifestUpdate     - Records the current state of an image and its .feats file
+ * spManifestSave       - Writes the manifest to a file
+ * spManifestDestroy    - Frees all resources associated with a manifest
+ */
+
+typedef enum sp_manifest_msg_t {
+	SP_MANIFEST_INVALID_ARGUMENT,
+	SP_MANIFEST_ALLOC_FAIL,
+	SP_MANIFEST_CANNOT_OPEN_FILE,
+	SP_MANIFEST_WRITE_FAIL,
+	SP_MANIFEST_SUCCESS
+} SP_MANIFEST_MSG;
+
+typedef struct sp_manifest_t* SPManifest;
+
+/**
+ * Creates a manifest for 'imagesAmount' images. If the file given by
+ * manifestPath exists and was saved with the same state hash, its entries
+ * are loaded. Otherwise (or if the file is malformed) the manifest is empty,
+ * meaning no image is up to date.
+ *
+ * @param manifestPath - the path of the manifest file
+ * @param imagesAmount - the number of images in the database
+ * @param stateHash - identifies the extraction state (PCA basis, dimension...)
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the manifest.
+ *
+ * - SP_MANIFEST_INVALID_ARGUMENT - if manifestPath == NULL or imagesAmount <= 0
+ * - SP_MANIFEST_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_MANIFEST_SUCCESS - in case of success
+ */
+SPManifest spManifestCreate(const char* manifestPath, int imagesAmount,
+		unsigned long long stateHash, SP_MANIFEST_MSG* msg);
+
+/**
+ * Checks whether the .feats file of the image 'index' is up to date. That is
+ * the image was recorded with the same path, its size and content didn't
+ * change, and its .feats file wasn't changed or removed since.
+ * The content of the image is hashed only if its modification time changed.
+ *
+ * @param manifest - the manifest
+ * @param index - the index of the image
+ * @param imagePath - the path of the image
+ * @param featsPath - the path of the .feats file of the image
+ * @return true if the features of the image don't need to be extracted again,
+ * false otherwise (or if any of the arguments is invalid).
+ */
+bool spManifestIsUpToDate(SPManifest manifest, int index, const char* imagePath,
+		const char* featsPath);
+
+/**
+ * Records the current state of the image 'index' and of its .feats file.
+ * Should be called after the .feats file of the image was saved.
+ *
+ * @param manifest - the manifest
+ * @param index - the index of the image
+ * @param imagePath - the path of the image
+ * @param featsPath - the path of the .feats file of the image
+ * @return
+ * - SP_MANIFEST_INVALID_ARGUMENT - if manifest == NULL or imagePath == NULL or
+ *   featsPath == NULL or index is out of range
+ * - SP_MANIFEST_CANNOT_OPEN_FILE - if one of the files couldn't be read
+ * - SP_MANIFEST_SUCCESS - in case of success
+ */
+SP_MANIFEST_MSG spManifestUpdate(SPManifest manifest, int index, const char* imagePath,
+		const char* featsPath);
+
+/**
+ * Writes the manifest to the file given by manifestPath. The file is
+ * replaced only once it was fully written.
+ *
+ * @param manifest - the manifest
+ * @param manifestPath - the path of the manifest file
+ * @return
+ * - SP_MANIFEST_INVALID_ARGUMENT - if manifest == NULL or manifestPath == NULL
+ * - SP_MANIFEST_CANNOT_OPEN_FILE - if the file couldn't be opened
+ * - SP_MANIFEST_WRITE_FAIL - if writing the file failed
+ * - SP_MANIFEST_SUCCESS - in case of success
+ */
+SP_MANIFEST_MSG spManifestSave(SPManifest manifest, const char* manifestPath);
+
+/**
+ * Frees all memory resources associated with manifest.
+ * If manifest == NULL nothing is done.
+ */
+void spManifestDestroy(SPManifest manifest);
+
+#endif /* SPMANIFEST_H_ */
@@ -0,0 +1,245 @@
+#include "SPMultiIndexHash.h"
+
+#define SUBSTRING_BYTES 2
+#define BITS_PER_BYTE 8
+
+struct sp_multi_index_hash_t
+{
+	SPPointStore store;
+	int bytes;
+	int substrings;
+	int* substringBits;
+	int** offsets; // per table, the first position in rows of every substring value
+	int** rows;    // per table, the rows ordered by their substring value
+};
+
+/*
+ * Returns the value of the given substring of a code.
+ */
+static unsigned int getSubstring(SPMultiIndexHash mih, const unsigned char* code, int substring)
+{
+	int i, first = substring * SUBSTRING_BYTES;
+	unsigned int value = 0;
+	for (i = 0; i < SUBSTRING_BYTES && first + i < mih->bytes; i++)
+		value |= (unsigned int) code[first + i] << (BITS_PER_BYTE * i);
+	return value;
+}
+
+static int countBits(unsigned int value)
+{
+	int count = 0;
+	for (; value != 0; value &= value - 1)
+		count++;
+	return count;
+}
+
+/*
+ * Returns the Hamming distance between a row and the query, and stores the
+ * smallest distance between their substrings and the first substring which
+ * attains it.
+ */
+static int getDistances(SPMultiIndexHash mih, int row, const unsigned int* querySubstrings,
+		int* minDistance, int* minSubstring)
+{
+	int i, distance, total = 0;
+	const unsigned char* code = spPointStoreGetBinaryRow(mih->store, row);
+	*minDistance = BITS_PER_BYTE * SUBSTRING_BYTES + 1;
+	*minSubstring = -1;
+	for (i = 0; i < mih->substrings; i++)
+	{
+		distance = countBits(getSubstring(mih, code, i) ^ querySubstrings[i]);
+		total += distance;
+		if (distance < *minDistance)
+		{
+			*minDistance = distance;
+			*minSubstring = i;
+		}
+	}
+	return total;
+}
+
+static SP_MULTI_INDEX_HASH_MSG enqueueRow(SPMultiIndexHash mih, int row, int distance,
+		SPBPQueue bpq)
+{
+	SPListElement element;
+	SP_BPQUEUE_MSG bpqMsg;
+	if (spBPQueueIsFull(bpq) && distance > spBPQueueMaxValue(bpq))
+		return SP_MULTI_INDEX_HASH_SUCCESS;
+	element = spListElementCreate(spPointStoreGetImageIndex(mih->store, row), distance);
+	if (element == NULL)
+		return SP_MULTI_INDEX_HASH_ALLOC_FAIL;
+	bpqMsg = spBPQueueEnqueue(bpq, element);
+	spListElementDestroy(element);
+	if (bpqMsg == SP_BPQUEUE_OUT_OF_MEMORY)
+		return SP_MULTI_INDEX_HASH_ALLOC_FAIL;
+	return SP_MULTI_INDEX_HASH_SUCCESS;
+}
+
+SPMultiIndexHash spMultiIndexHashCreate(SPPointStore store, SP_MULTI_INDEX_HASH_MSG* msg)
+{
+	SPMultiIndexHash mih;
+	int i, t, size, buckets;
+	int* cursor;
+	unsigned int value;
+	assert(msg != NULL);
+	if (store == NULL || spPointStoreGetType(store) != SP_POINT_STORE_BINARY)
+	{
+		*msg = SP_MULTI_INDEX_HASH_INVALID_ARGUMENT;
+		return NULL;
+	}
+	mih = (SPMultiIndexHash) calloc(1, sizeof(*mih));
+	if (mih == NULL)
+	{
+		*msg = SP_MULTI_INDEX_HASH_ALLOC_FAIL;
+		return NULL;
+	}
+	mih->store = store;
+	mih->bytes = spPointStoreGetDim(store);
+	mih->substrings = (mih->bytes + SUBSTRING_BYTES - 1) / SUBSTRING_BYTES;
+	mih->substringBits = (int*) malloc(mih->substrings * sizeof(int));
+	mih->offsets = (int**) calloc(mih->substrings, sizeof(int*));
+	mih->rows = (int**) calloc(mih->substrings, sizeof(int*));
+	if (mih->substringBits == NULL || mih->offsets == NULL || mih->rows == NULL)
+	{
+		spMultiIndexHashDestroy(mih);
+		*msg = SP_MULTI_INDEX_HASH_ALLOC_FAIL;
+		return NULL;
+	}
+
+	// Build every table as a counting sort of the rows by their substring
+	size = spPointStoreGetSize(store);
+	for (t = 0; t < mih->substrings; t++)
+	{
+		mih->substringBits[t] = BITS_PER_BYTE *
+				(t * SUBSTRING_BYTES + SUBSTRING_BYTES <= mih->bytes ?
+						SUBSTRING_BYTES : mih->bytes - t * SUBSTRING_BYTES);
+		buckets = 1 << mih->substringBits[t];
+		mih->offsets[t] = (int*) calloc(buckets + 1, sizeof(int));
+		mih->rows[t] = (int*) malloc((size > 0 ? size : 1) * sizeof(int));
+		cursor = (int*) malloc(buckets * sizeof(int));
+		if (mih->offsets[t] == NULL || mih->rows[t] == NULL || cursor == NULL)
+		{
+			free(cursor);
+			spMultiIndexHashDestroy(mih);
+			*msg = SP_MULTI_INDEX_HASH_ALLOC_FAIL;
+			return NULL;
+		}
+		for (i = 0; i < size; i++)
+			mih->offsets[t][getSubstring(mih, spPointStoreGetBinaryRow(store, i), t) + 1]++;
+		for (i = 0; i < buckets; i++)
+		{
+			mih->offsets[t][i + 1] += mih->offsets[t][i];
+			cursor[i] = mih->offsets[t][i];
+		}
+		for (i = 0; i < size; i++)
+		{
+			value = getSubstring(mih, spPointStoreGetBinaryRow(store, i), t);
+			mih->rows[t][cursor[value]++] = i;
+		}
+		free(cursor);
+	}
+	*msg = SP_MULTI_INDEX_HASH_SUCCESS;
+	return mih;
+}
+
+SP_MULTI_INDEX_HASH_MSG spMultiIndexHashKNN(SPMultiIndexHash mih, const unsigned char* query,
+		SPBPQueue bpq)
+{
+	int t, i, radius, row, distance, minDistance, minSubstring, maxBits = 0;
+	unsigned int* querySubstrings;
+	unsigned int mask, lowest, next, key;
+	double probes, combinations;
+	SP_MULTI_INDEX_HASH_MSG msg = SP_MULTI_INDEX_HASH_SUCCESS;
+	if (mih == NULL || query == NULL || bpq == NULL)
+		return SP_MULTI_INDEX_HASH_INVALID_ARGUMENT;
+	querySubstrings = (unsigned int*) malloc(mih->substrings * sizeof(unsigned int));
+	if (querySubstrings == NULL)
+		return SP_MULTI_INDEX_HASH_ALLOC_FAIL;
+	for (t = 0; t < mih->substrings; t++)
+	{
+		querySubstrings[t] = getSubstring(mih, query, t);
+		if (mih->substringBits[t] > maxBits)
+			maxBits = mih->substringBits[t];
+	}
+
+	for (radius = 0; radius <= maxBits && msg == SP_MULTI_INDEX_HASH_SUCCESS; radius++)
+	{
+		// Probing every value within this radius costs more than a scan, so
+		// scan the rows which weren't found by the smaller radii
+		probes = 0;
+		for (t = 0; t < mih->substrings; t++)
+		{
+			combinations = 1;
+			for (i = 0; i < radius; i++)
+				combinations = combinations * (mih->substringBits[t] - i) / (i + 1);
+			probes += combinations;
+		}
+		if (radius > 0 && probes > spPointStoreGetSize(mih->store))
+		{
+			for (row = 0; row < spPointStoreGetSize(mih->store)
+					&& msg == SP_MULTI_INDEX_HASH_SUCCESS; row++)
+			{
+				if (!spBPQueueAccepts(bpq, spPointStoreGetImageIndex(mih->store, row)))
+					continue;
+				distance = getDistances(mih, row, querySubstrings, &minDistance, &minSubstring);
+				if (minDistance >= radius)
+					msg = enqueueRow(mih, row, distance, bpq);
+			}
+			break;
+		}
+
+		for (t = 0; t < mih->substrings && msg == SP_MULTI_INDEX_HASH_SUCCESS; t++)
+		{
+			if (radius > mih->substringBits[t])
+				continue;
+			// Enumerate the masks of radius bits in increasing order
+			mask = (1u << radius) - 1;
+			while (mask < (1u << mih->substringBits[t]) && msg == SP_MULTI_INDEX_HASH_SUCCESS)
+			{
+				key = querySubstrings[t] ^ mask;
+				for (i = mih->offsets[t][key]; i < mih->offsets[t][key + 1]
+						&& msg == SP_MULTI_INDEX_HASH_SUCCESS; i++)
+				{
+					row = mih->rows[t][i];
+					if (!spBPQueueAccepts(bpq, spPointStoreGetImageIndex(mih->store, row)))
+						continue;
+					distance = getDistances(mih, row, querySubstrings, &minDistance, &minSubstring);
+					// A row is found by every table it's close in, it's
+					// enqueued only from its closest table
+					if (minDistance == radius && minSubstring == t)
+						msg = enqueueRow(mih, row, distance, bpq);
+				}
+				if (mask == 0)
+					break;
+				lowest = mask & (~mask + 1);
+				next = mask + lowest;
+				mask = (((next ^ mask) >> 2) / lowest) | next;
+			}
+		}
+
+		// Every row which wasn't found yet is at distance m * (radius + 1) at least
+		if (spBPQueueIsFull(bpq)
+				&& spBPQueueMaxValue(bpq) < (double) mih->substrings * (radius + 1))
+			break;
+	}
+	free(querySubstrings);
+	return msg;
+}
+
+void spMultiIndexHashDestroy(SPMultiIndexHash mih)
+{
+	int t;
+	if (mih == NULL)
+		return;
+	for (t = 0; t < mih->substrings; t++)
+	{
+		if (mih->offsets != NULL)
+			free(mih->offsets[t]);
+		if (mih->rows != NULL)
+			free(mih->rows[t]);
+	}
+	free(mih->substringBits);
+	free(mih->offsets);
+	free(mih->rows);
+	free(mih);
+}
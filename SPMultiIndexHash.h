@@ -0,0 +1,78 @@
+#ifndef SPMULTIINDEXHASH_H_
+#define SPMULTIINDEXHASH_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "SPPointStore.h"
+#include "SPBPriorityQueue.h"
+
+/**
+ * SP Multi-Index Hashing summary
+ * An exact k nearest neighbours index for binary codes under the Hamming
+ * distance (Norouzi, Punjani and Fleet, "Fast Search in Hamming Space with
+ * Multi-Index Hashing").
+ *
+ * Every code is split into substrings of 16 bits, and every substring
+ * position has its own hash table from the substring value to the rows
+ * holding it. Two codes at Hamming distance d < m * (r + 1), where m is the
+ * number of substrings, agree up to r bits on at least one substring. So the
+ * search probes every table with all the values within radius r of the
+ * query's substring, for r = 0, 1, 2..., and stops as soon as the kth best
+ * distance found is below m * (r + 1). When probing the next radius would
+ * cost more than scanning the store, the remaining rows are scanned.
+ *
+ * The index refers to the rows of a BINARY point store, which must outlive it.
+ * Searching is thread safe.
+ *
+ * The following functions are supported:
+ * spMultiIndexHashCreate  - Builds the index over a store
+ * spMultiIndexHashKNN     - Finds the nearest rows to a query code
+ * spMultiIndexHashDestroy - Frees all resources associated with the index
+ */
+
+typedef enum sp_multi_index_hash_msg_t {
+	SP_MULTI_INDEX_HASH_INVALID_ARGUMENT,
+	SP_MULTI_INDEX_HASH_ALLOC_FAIL,
+	SP_MULTI_INDEX_HASH_SUCCESS
+} SP_MULTI_INDEX_HASH_MSG;
+
+typedef struct sp_multi_index_hash_t* SPMultiIndexHash;
+
+/**
+ * Builds the index over all the rows of store.
+ *
+ * @param store - a BINARY point store
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new index.
+ *
+ * - SP_MULTI_INDEX_HASH_INVALID_ARGUMENT - if store == NULL or isn't BINARY
+ * - SP_MULTI_INDEX_HASH_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_MULTI_INDEX_HASH_SUCCESS - in case of success
+ */
+SPMultiIndexHash spMultiIndexHashCreate(SPPointStore store, SP_MULTI_INDEX_HASH_MSG* msg);
+
+/**
+ * Enqueues the nearest rows to the query code into bpq, up to its maximal
+ * size. Every element's index is the image index of the row and its value
+ * is the Hamming distance.
+ *
+ * @param mih - the index
+ * @param query - the query code, as long as the rows of the store
+ * @param bpq - the queue to fill, its maximal size is the k in k nearest
+ * @return
+ * - SP_MULTI_INDEX_HASH_INVALID_ARGUMENT - if mih == NULL or query == NULL or bpq == NULL
+ * - SP_MULTI_INDEX_HASH_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_MULTI_INDEX_HASH_SUCCESS - in case of success
+ */
+SP_MULTI_INDEX_HASH_MSG spMultiIndexHashKNN(SPMultiIndexHash mih, const unsigned char* query,
+		SPBPQueue bpq);
+
+/**
+ * Frees all resources associated with the index. The store isn't destroyed.
+ * If mih == NULL nothing happens.
+ */
+void spMultiIndexHashDestroy(SPMultiIndexHash mih);
+
+#endif /* SPMULTIINDEXHASH_H_ */
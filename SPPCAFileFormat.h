@@ -0,0 +1,9 @@
+#ifndef SPPCAFILEFORMAT_H_
+#define SPPCAFILEFORMAT_H_
+
+typedef enum sp_pca_file_format_t {
+	SP_PCA_YAML,
+	SP_PCA_BINARY
+} SP_PCA_FILE_FORMAT;
+
+#endif /* SPPCAFILEFORMAT_H_ */
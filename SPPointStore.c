@@ -0,0 +1,334 @@
+#include <string.h>
+#include <stdint.h>
+#include "SPPointStore.h"
+
+#define MIN_CAPACITY 64
+#define BYTE_MAX_VALUE 255
+
+// Counts the set bits of a 64 bit word, with the processor's popcount
+// instruction where the compiler exposes it
+#if defined(__GNUC__)
+#define POPCOUNT64(x) __builtin_popcountll(x)
+#else
+static int POPCOUNT64(uint64_t x)
+{
+	x = x - ((x >> 1) & 0x5555555555555555ULL);
+	x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+	x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int) ((x * 0x0101010101010101ULL) >> 56);
+}
+#endif
+
+struct sp_point_store_t
+{
+	SP_POINT_STORE_TYPE type;
+	int dim;
+	int size;
+	int capacity;
+	double* realRows;
+	unsigned char* binaryRows;
+	int* imageIndexes;
+	bool released; // the rows were freed, the image indexes remain
+};
+
+/*
+ * Makes room for at least one more row, doubling the capacity when full.
+ */
+static bool spPointStoreReserve(SPPointStore store)
+{
+	int capacity;
+	void* rows;
+	int* imageIndexes;
+	if (store->size < store->capacity)
+		return true;
+	capacity = store->capacity < MIN_CAPACITY ? MIN_CAPACITY : store->capacity * 2;
+	if (store->type == SP_POINT_STORE_REAL)
+	{
+		rows = realloc(store->realRows, (size_t) capacity * store->dim * sizeof(double));
+		if (rows == NULL)
+			return false;
+		store->realRows = (double*) rows;
+	}
+	else
+	{
+		rows = realloc(store->binaryRows, (size_t) capacity * store->dim);
+		if (rows == NULL)
+			return false;
+		store->binaryRows = (unsigned char*) rows;
+	}
+	imageIndexes = (int*) realloc(store->imageIndexes, (size_t) capacity * sizeof(int));
+	if (imageIndexes == NULL)
+		return false;
+	store->imageIndexes = imageIndexes;
+	store->capacity = capacity;
+	return true;
+}
+
+SPPointStore spPointStoreCreate(SP_POINT_STORE_TYPE type, int dim, int capacity,
+		SP_POINT_STORE_MSG* msg)
+{
+	SPPointStore store;
+	assert(msg != NULL);
+	if (dim <= 0 || capacity < 0)
+	{
+		*msg = SP_POINT_STORE_INVALID_ARGUMENT;
+		return NULL;
+	}
+	store = (SPPointStore) calloc(1, sizeof(*store));
+	if (store == NULL)
+	{
+		*msg = SP_POINT_STORE_ALLOC_FAIL;
+		return NULL;
+	}
+	store->type = type;
+	store->dim = dim;
+	if (capacity > 0)
+	{
+		if (type == SP_POINT_STORE_REAL)
+			store->realRows = (double*) malloc((size_t) capacity * dim * sizeof(double));
+		else
+			store->binaryRows = (unsigned char*) malloc((size_t) capacity * dim);
+		store->imageIndexes = (int*) malloc((size_t) capacity * sizeof(int));
+		if ((store->realRows == NULL && store->binaryRows == NULL)
+				|| store->imageIndexes == NULL)
+		{
+			spPointStoreDestroy(store);
+			*msg = SP_POINT_STORE_ALLOC_FAIL;
+			return NULL;
+		}
+		store->capacity = capacity;
+	}
+	*msg = SP_POINT_STORE_SUCCESS;
+	return store;
+}
+
+SPPointStore spPointStoreCreateFromPoints(SP_POINT_STORE_TYPE type, SPPoint* points,
+		int amount, int dim, SP_POINT_STORE_MSG* msg)
+{
+	SPPointStore store;
+	assert(msg != NULL);
+	if (points == NULL || amount < 0)
+	{
+		*msg = SP_POINT_STORE_INVALID_ARGUMENT;
+		return NULL;
+	}
+	store = spPointStoreCreate(type, dim, amount, msg);
+	if (store == NULL)
+		return NULL;
+	*msg = spPointStoreAddPoints(store, points, amount);
+	if (*msg != SP_POINT_STORE_SUCCESS)
+	{
+		spPointStoreDestroy(store);
+		return NULL;
+	}
+	return store;
+}
+
+SPPointStore spPointStoreCreateFromFloats(SP_POINT_STORE_TYPE type, const float* data,
+		int amount, int dim, int imageIndex, SP_POINT_STORE_MSG* msg)
+{
+	SPPointStore store;
+	size_t i;
+	float coordinate;
+	assert(msg != NULL);
+	if ((data == NULL && amount > 0) || amount < 0 || imageIndex < 0)
+	{
+		*msg = SP_POINT_STORE_INVALID_ARGUMENT;
+		return NULL;
+	}
+	store = spPointStoreCreate(type, dim, amount, msg);
+	if (store == NULL)
+		return NULL;
+	// The rows are written in place, the store was created with room for them
+	for (i = 0; i < (size_t) amount * dim; i++)
+	{
+		coordinate = data[i];
+		if (type == SP_POINT_STORE_REAL)
+			store->realRows[i] = coordinate;
+		else
+			store->binaryRows[i] = (unsigned char)
+					(coordinate < 0 ? 0 : coordinate > BYTE_MAX_VALUE ? BYTE_MAX_VALUE : coordinate);
+	}
+	for (i = 0; i < (size_t) amount; i++)
+		store->imageIndexes[i] = imageIndex;
+	store->size = amount;
+	return store;
+}
+
+SPPointStore spPointStoreCopy(SPPointStore store, SP_POINT_STORE_MSG* msg)
+{
+	SPPointStore copy;
+	assert(msg != NULL);
+	if (store == NULL || store->released)
+	{
+		*msg = SP_POINT_STORE_INVALID_ARGUMENT;
+		return NULL;
+	}
+	copy = spPointStoreCreate(store->type, store->dim, store->size, msg);
+	if (copy == NULL)
+		return NULL;
+	if (store->size > 0)
+	{
+		if (store->type == SP_POINT_STORE_REAL)
+			memcpy(copy->realRows, store->realRows,
+					(size_t) store->size * store->dim * sizeof(double));
+		else
+			memcpy(copy->binaryRows, store->binaryRows, (size_t) store->size * store->dim);
+		memcpy(copy->imageIndexes, store->imageIndexes, (size_t) store->size * sizeof(int));
+	}
+	copy->size = store->size;
+	return copy;
+}
+
+SP_POINT_STORE_MSG spPointStoreAddPoints(SPPointStore store, SPPoint* points, int amount)
+{
+	int i, j;
+	double coordinate;
+	if (store == NULL || points == NULL || amount < 0 || store->released)
+		return SP_POINT_STORE_INVALID_ARGUMENT;
+	for (i = 0; i < amount; i++)
+	{
+		if (spPointGetDimension(points[i]) != store->dim)
+			return SP_POINT_STORE_INVALID_ARGUMENT;
+		if (!spPointStoreReserve(store))
+			return SP_POINT_STORE_ALLOC_FAIL;
+		for (j = 0; j < store->dim; j++)
+		{
+			coordinate = spPointGetAxisCoor(points[i], j);
+			if (store->type == SP_POINT_STORE_REAL)
+				store->realRows[(size_t) store->size * store->dim + j] = coordinate;
+			else
+				store->binaryRows[(size_t) store->size * store->dim + j] = (unsigned char)
+						(coordinate < 0 ? 0 : coordinate > BYTE_MAX_VALUE ? BYTE_MAX_VALUE : coordinate);
+		}
+		store->imageIndexes[store->size++] = spPointGetIndex(points[i]);
+	}
+	return SP_POINT_STORE_SUCCESS;
+}
+
+SP_POINT_STORE_MSG spPointStoreAddReal(SPPointStore store, const double* data, int imageIndex)
+{
+	if (store == NULL || data == NULL || imageIndex < 0 || store->type != SP_POINT_STORE_REAL
+			|| store->released)
+		return SP_POINT_STORE_INVALID_ARGUMENT;
+	if (!spPointStoreReserve(store))
+		return SP_POINT_STORE_ALLOC_FAIL;
+	memcpy(store->realRows + (size_t) store->size * store->dim, data,
+			store->dim * sizeof(double));
+	store->imageIndexes[store->size++] = imageIndex;
+	return SP_POINT_STORE_SUCCESS;
+}
+
+SP_POINT_STORE_MSG spPointStoreAddBinary(SPPointStore store, const unsigned char* data,
+		int imageIndex)
+{
+	if (store == NULL || data == NULL || imageIndex < 0 || store->type != SP_POINT_STORE_BINARY
+			|| store->released)
+		return SP_POINT_STORE_INVALID_ARGUMENT;
+	if (!spPointStoreReserve(store))
+		return SP_POINT_STORE_ALLOC_FAIL;
+	memcpy(store->binaryRows + (size_t) store->size * store->dim, data, store->dim);
+	store->imageIndexes[store->size++] = imageIndex;
+	return SP_POINT_STORE_SUCCESS;
+}
+
+void spPointStoreDestroy(SPPointStore store)
+{
+	if (store == NULL)
+		return;
+	free(store->realRows);
+	free(store->binaryRows);
+	free(store->imageIndexes);
+	free(store);
+}
+
+void spPointStoreReleaseRows(SPPointStore store)
+{
+	if (store == NULL)
+		return;
+	free(store->realRows);
+	free(store->binaryRows);
+	store->realRows = NULL;
+	store->binaryRows = NULL;
+	store->released = true;
+}
+
+bool spPointStoreHasRows(SPPointStore store)
+{
+	assert(store != NULL);
+	return !store->released;
+}
+
+SP_POINT_STORE_TYPE spPointStoreGetType(SPPointStore store)
+{
+	assert(store != NULL);
+	return store->type;
+}
+
+int spPointStoreGetSize(SPPointStore store)
+{
+	assert(store != NULL);
+	return store->size;
+}
+
+int spPointStoreGetDim(SPPointStore store)
+{
+	assert(store != NULL);
+	return store->dim;
+}
+
+int spPointStoreGetImageIndex(SPPointStore store, int row)
+{
+	assert(store != NULL && row >= 0 && row < store->size);
+	return store->imageIndexes[row];
+}
+
+const double* spPointStoreGetRealRow(SPPointStore store, int row)
+{
+	assert(store != NULL && row >= 0 && row < store->size);
+	assert(store->type == SP_POINT_STORE_REAL && !store->released);
+	return store->realRows + (size_t) row * store->dim;
+}
+
+const unsigned char* spPointStoreGetBinaryRow(SPPointStore store, int row)
+{
+	assert(store != NULL && row >= 0 && row < store->size);
+	assert(store->type == SP_POINT_STORE_BINARY && !store->released);
+	return store->binaryRows + (size_t) row * store->dim;
+}
+
+double spPointStoreDistance(SPPointStore store, int row, SPPointStore other, int otherRow)
+{
+	int i;
+	double diff, distance = 0;
+	const double *p, *q;
+	assert(store != NULL && other != NULL);
+	assert(store->type == other->type && store->dim == other->dim);
+	if (store->type == SP_POINT_STORE_BINARY)
+		return spPointStoreHammingDistance(spPointStoreGetBinaryRow(store, row),
+				spPointStoreGetBinaryRow(other, otherRow), store->dim);
+	p = spPointStoreGetRealRow(store, row);
+	q = spPointStoreGetRealRow(other, otherRow);
+	for (i = 0; i < store->dim; i++)
+	{
+		diff = p[i] - q[i];
+		distance += diff * diff;
+	}
+	return distance;
+}
+
+int spPointStoreHammingDistance(const unsigned char* a, const unsigned char* b, int bytes)
+{
+	int i, distance = 0;
+	uint64_t x, y;
+	// Eight bytes at a time, memcpy avoids unaligned reads
+	for (i = 0; i + (int) sizeof(uint64_t) <= bytes; i += sizeof(uint64_t))
+	{
+		memcpy(&x, a + i, sizeof(uint64_t));
+		memcpy(&y, b + i, sizeof(uint64_t));
+		distance += POPCOUNT64(x ^ y);
+	}
+	for (; i < bytes; i++)
+		distance += POPCOUNT64((uint64_t) (a[i] ^ b[i]));
+	return distance;
+}
@@ -0,0 +1,258 @@
+#ifndef SPPOINTSTORE_H_
+#define SPPOINTSTORE_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "SPPoint.h"
+
+/**
+ * SP Point Store summary
+ * Holds a set of feature vectors contiguously, one row per vector, together
+ * with the index of the image every row belongs to. A store is either:
+ * - REAL: rows of 'dim' double coordinates, compared by squared L2 distance
+ *   (PCA reduced SIFT descriptors)
+ * - BINARY: rows of 'dim' bytes, compared by Hamming distance (ORB
+ *   descriptors)
+ *
+ * Rows are appended and never removed, and reading a store is thread safe.
+ * Once an index holds its own compressed copy of the rows, the rows can be
+ * released to save memory, keeping the image index of every row.
+ *
+ * The following functions are supported:
+ * spPointStoreCreate          - Creates an empty store
+ * spPointStoreCreateFromPoints - Creates a store holding an array of points
+ * spPointStoreCreateFromFloats - Creates a store holding rows of float coordinates
+ * spPointStoreCopy            - Creates a store holding the rows of another
+ * spPointStoreAddPoints       - Appends an array of points
+ * spPointStoreAddReal         - Appends a row of double coordinates
+ * spPointStoreAddBinary       - Appends a row of bytes
+ * spPointStoreDestroy         - Frees all resources associated with a store
+ * spPointStoreReleaseRows     - Frees the rows of a store, keeping their image indexes
+ * spPointStoreHasRows         - Checks whether the rows of a store weren't released
+ * spPointStoreGetType         - A getter of the type of a store
+ * spPointStoreGetSize         - A getter of the number of rows in a store
+ * spPointStoreGetDim          - A getter of the length of the rows
+ * spPointStoreGetImageIndex   - A getter of the image index of a row
+ * spPointStoreGetRealRow      - A getter of a row of a REAL store
+ * spPointStoreGetBinaryRow    - A getter of a row of a BINARY store
+ * spPointStoreDistance        - Calculates the distance between a row and a vector
+ * spPointStoreHammingDistance - Calculates the Hamming distance between two byte vectors
+ */
+
+typedef enum sp_point_store_type_t {
+	SP_POINT_STORE_REAL,
+	SP_POINT_STORE_BINARY
+} SP_POINT_STORE_TYPE;
+
+typedef enum sp_point_store_msg_t {
+	SP_POINT_STORE_INVALID_ARGUMENT,
+	SP_POINT_STORE_ALLOC_FAIL,
+	SP_POINT_STORE_SUCCESS
+} SP_POINT_STORE_MSG;
+
+typedef struct sp_point_store_t* SPPointStore;
+
+/**
+ * Creates an empty store.
+ *
+ * @param type - the type of the rows
+ * @param dim - the length of every row: coordinates for REAL, bytes for BINARY
+ * @param capacity - the number of rows to allocate room for, the store grows
+ * 					 beyond it as needed
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new store.
+ *
+ * - SP_POINT_STORE_INVALID_ARGUMENT - if dim <= 0 or capacity < 0
+ * - SP_POINT_STORE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_POINT_STORE_SUCCESS - in case of success
+ */
+SPPointStore spPointStoreCreate(SP_POINT_STORE_TYPE type, int dim, int capacity,
+		SP_POINT_STORE_MSG* msg);
+
+/**
+ * Creates a store holding the given points, see spPointStoreAddPoints.
+ *
+ * @param type - the type of the rows
+ * @param points - the points
+ * @param amount - the number of points
+ * @param dim - the dimension of every point
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new store.
+ *
+ * - SP_POINT_STORE_INVALID_ARGUMENT - if points == NULL or amount < 0,
+ * 									   or if a point's dimension isn't dim
+ * - SP_POINT_STORE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_POINT_STORE_SUCCESS - in case of success
+ */
+SPPointStore spPointStoreCreateFromPoints(SP_POINT_STORE_TYPE type, SPPoint* points,
+		int amount, int dim, SP_POINT_STORE_MSG* msg);
+
+/**
+ * Creates a store holding amount rows of float coordinates, all of them of
+ * the same image, as the features of an image are projected. The rows are
+ * converted as they're copied, without creating a point per row. In a
+ * BINARY store every coordinate holds one byte (0 to 255).
+ *
+ * @param type - the type of the rows
+ * @param data - the rows, contiguously, amount * dim floats
+ * @param amount - the number of rows
+ * @param dim - the length of every row
+ * @param imageIndex - the index of the image the rows belong to
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new store.
+ *
+ * - SP_POINT_STORE_INVALID_ARGUMENT - if data == NULL while amount > 0, or
+ * 									   amount < 0 or dim <= 0 or imageIndex < 0
+ * - SP_POINT_STORE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_POINT_STORE_SUCCESS - in case of success
+ */
+SPPointStore spPointStoreCreateFromFloats(SP_POINT_STORE_TYPE type, const float* data,
+		int amount, int dim, int imageIndex, SP_POINT_STORE_MSG* msg);
+
+/**
+ * Creates a store holding the rows of store and their image indexes, with
+ * room for exactly them.
+ *
+ * @param store - the store to copy
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new store.
+ *
+ * - SP_POINT_STORE_INVALID_ARGUMENT - if store == NULL or its rows were released
+ * - SP_POINT_STORE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_POINT_STORE_SUCCESS - in case of success
+ */
+SPPointStore spPointStoreCopy(SPPointStore store, SP_POINT_STORE_MSG* msg);
+
+/**
+ * Appends a row for every point, with the point's index as its image index.
+ * In a BINARY store every coordinate of a point holds one byte (0 to 255).
+ *
+ * @param store - the store
+ * @param points - the points
+ * @param amount - the number of points
+ * @return
+ * - SP_POINT_STORE_INVALID_ARGUMENT - if store == NULL or points == NULL or
+ * 		amount < 0 or the rows were released, or if a point's dimension isn't
+ * 		the store's dimension
+ * - SP_POINT_STORE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_POINT_STORE_SUCCESS - in case of success
+ */
+SP_POINT_STORE_MSG spPointStoreAddPoints(SPPointStore store, SPPoint* points, int amount);
+
+/**
+ * Appends a row to a REAL store.
+ *
+ * @param store - the store
+ * @param data - the dim coordinates of the row
+ * @param imageIndex - the index of the image the row belongs to
+ * @return
+ * - SP_POINT_STORE_INVALID_ARGUMENT - if store == NULL or data == NULL or
+ * 		imageIndex < 0 or the store isn't REAL or its rows were released
+ * - SP_POINT_STORE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_POINT_STORE_SUCCESS - in case of success
+ */
+SP_POINT_STORE_MSG spPointStoreAddReal(SPPointStore store, const double* data, int imageIndex);
+
+/**
+ * Appends a row to a BINARY store.
+ *
+ * @param store - the store
+ * @param data - the dim bytes of the row
+ * @param imageIndex - the index of the image the row belongs to
+ * @return
+ * - SP_POINT_STORE_INVALID_ARGUMENT - if store == NULL or data == NULL or
+ * 		imageIndex < 0 or the store isn't BINARY or its rows were released
+ * - SP_POINT_STORE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_POINT_STORE_SUCCESS - in case of success
+ */
+SP_POINT_STORE_MSG spPointStoreAddBinary(SPPointStore store, const unsigned char* data,
+		int imageIndex);
+
+/**
+ * Frees all resources associated with the store. If store == NULL nothing
+ * happens.
+ */
+void spPointStoreDestroy(SPPointStore store);
+
+/**
+ * Frees the rows of the store, keeping its type, dimension, size and the
+ * image index of every row. Afterwards rows can't be added or read.
+ * If store == NULL nothing happens.
+ */
+void spPointStoreReleaseRows(SPPointStore store);
+
+/**
+ * @assert store != NULL
+ * @return false if the rows of the store were released, true otherwise
+ */
+bool spPointStoreHasRows(SPPointStore store);
+
+/**
+ * @assert store != NULL
+ * @return the type of the store
+ */
+SP_POINT_STORE_TYPE spPointStoreGetType(SPPointStore store);
+
+/**
+ * @assert store != NULL
+ * @return the number of rows in the store
+ */
+int spPointStoreGetSize(SPPointStore store);
+
+/**
+ * @assert store != NULL
+ * @return the length of every row: coordinates for REAL, bytes for BINARY
+ */
+int spPointStoreGetDim(SPPointStore store);
+
+/**
+ * @assert store != NULL and 0 <= row < size
+ * @return the index of the image the row belongs to
+ */
+int spPointStoreGetImageIndex(SPPointStore store, int row);
+
+/**
+ * @assert store != NULL and 0 <= row < size and the store is REAL
+ * @return the dim coordinates of the row. The pointer is invalidated
+ * 		   when rows are appended.
+ */
+const double* spPointStoreGetRealRow(SPPointStore store, int row);
+
+/**
+ * @assert store != NULL and 0 <= row < size and the store is BINARY
+ * @return the dim bytes of the row. The pointer is invalidated when rows
+ * 		   are appended.
+ */
+const unsigned char* spPointStoreGetBinaryRow(SPPointStore store, int row);
+
+/**
+ * Calculates the distance between a row of store and a row of another store
+ * of the same type and dimension: the squared L2 distance for REAL stores,
+ * the Hamming distance for BINARY stores.
+ *
+ * @assert store != NULL and other != NULL and both rows are in range
+ * @param store - the store
+ * @param row - the row in store
+ * @param other - the other store, for example a store of query features
+ * @param otherRow - the row in other
+ * @return the distance between the rows
+ */
+double spPointStoreDistance(SPPointStore store, int row, SPPointStore other, int otherRow);
+
+/**
+ * Calculates the Hamming distance between two vectors of bytes, i.e. the
+ * number of bits which differ between them.
+ *
+ * @param a - the first vector
+ * @param b - the second vector
+ * @param bytes - the length of the vectors
+ * @return the Hamming distance
+ */
+int spPointStoreHammingDistance(const unsigned char* a, const unsigned char* b, int bytes);
+
+#endif /* SPPOINTSTORE_H_ */
@@ -0,0 +1,92 @@
+#include <cstdlib>
+#include <chrono>
+#include "SPQueryBatcher.h"
+extern "C" {
+#include "SPQuerySolver.h"
+}
+
+sp::QueryBatcher::QueryBatcher(const IndexHolder& indexes, int imagesAmount, int window,
+		int maxBatchSize) :
+		indexes(indexes), imagesAmount(imagesAmount), window(window > 0 ? window : 0),
+		maxBatchSize(maxBatchSize > 0 ? (size_t) maxBatchSize : 1),
+		gathering(false), batchesAmount(0), queriesAmount(0) {
+}
+
+void sp::QueryBatcher::solveBatch(std::vector<Query*>& batch) {
+	std::vector<SPPointStore> features(batch.size());
+	std::vector<int> k(batch.size()), numOfSimilar(batch.size());
+	std::vector<SPBitset> filters(batch.size());
+	for (size_t i = 0; i < batch.size(); i++) {
+		features[i] = batch[i]->features;
+		k[i] = batch[i]->k;
+		numOfSimilar[i] = batch[i]->numOfSimilar;
+		filters[i] = batch[i]->filter;
+	}
+	// The whole batch searches a single snapshot, held until it's solved
+	IndexSnapshot index = indexes.acquire();
+	int** results = SPQuerySolverSolveBatch(index.get(), &features[0], &k[0],
+			&numOfSimilar[0], (int) batch.size(), imagesAmount, &filters[0]);
+	for (size_t i = 0; i < batch.size(); i++) {
+		batch[i]->result = results != NULL ? results[i] : NULL;
+	}
+	free(results);
+}
+
+int* sp::QueryBatcher::solve(SPPointStore features, int k, int numOfSimilar,
+		SPBitset filter) {
+	if (window == 0 || maxBatchSize == 1) {
+		return SPQuerySolverSolve(indexes.acquire().get(), features, k, numOfSimilar,
+				imagesAmount, filter);
+	}
+	Query query = { features, k, numOfSimilar, filter, NULL, false, false };
+	std::unique_lock<std::mutex> lock(mutex);
+	pending.push_back(&query);
+	if (!gathering) {
+		gathering = true;
+		query.leader = true;
+	} else if (pending.size() >= maxBatchSize) {
+		batchFull.notify_one();
+	}
+	batchDone.wait(lock, [&query]() {return query.done || query.leader;});
+	if (query.done) {
+		return query.result;
+	}
+
+	// This query leads its batch: it waits for the batch to gather and
+	// solves it for all its queries
+	std::chrono::steady_clock::time_point deadline =
+			std::chrono::steady_clock::now() + std::chrono::microseconds(window);
+	batchFull.wait_until(lock, deadline,
+			[this]() {return pending.size() >= maxBatchSize;});
+	size_t batchSize = pending.size() < maxBatchSize ? pending.size() : maxBatchSize;
+	std::vector<Query*> batch(pending.begin(), pending.begin() + batchSize);
+	pending.erase(pending.begin(), pending.begin() + batchSize);
+	// The queries which didn't fit start the next batch
+	gathering = !pending.empty();
+	if (gathering) {
+		pending.front()->leader = true;
+		batchDone.notify_all();
+	}
+	lock.unlock();
+
+	solveBatch(batch);
+
+	lock.lock();
+	batchesAmount++;
+	queriesAmount += (int) batch.size();
+	for (size_t i = 0; i < batch.size(); i++) {
+		batch[i]->done = true;
+	}
+	batchDone.notify_all();
+	return query.result;
+}
+
+int sp::QueryBatcher::getBatchesAmount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return batchesAmount;
+}
+
+double sp::QueryBatcher::getAverageBatchSize() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return batchesAmount > 0 ? (double) queriesAmount / batchesAmount : 0.0;
+}
@@ -0,0 +1,99 @@
+#ifndef SPQUERYBATCHER_H_
+#define SPQUERYBATCHER_H_
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "SPIndexHolder.h"
+
+extern "C" {
+#include "SPPointStore.h"
+#include "SPBitset.h"
+}
+
+namespace sp {
+
+/**
+ * Gathers the queries which are solved concurrently by several threads into
+ * batches, and solves every batch by a single SPQuerySolverSolveBatch, so
+ * the search of their features is shared: a brute force index compares the
+ * features of the whole batch with every database feature at once, and a
+ * KD-Tree index searches them in the order of their leaves.
+ *
+ * The first query of a batch waits up to the batch window for other queries
+ * to join it, or less if the batch fills up, and then its thread solves the
+ * whole batch and hands every query its result. The batch window bounds the
+ * latency the batching adds to a query.
+ *
+ * Every batch searches a snapshot of the current index of an IndexHolder,
+ * so the index may be replaced while queries are solved.
+ */
+class QueryBatcher {
+private:
+	// A query waiting in a batch
+	struct Query {
+		SPPointStore features;
+		int k;
+		int numOfSimilar;
+		SPBitset filter;
+		int* result;
+		bool leader;
+		bool done;
+	};
+	const IndexHolder& indexes;
+	int imagesAmount;
+	int window;
+	size_t maxBatchSize;
+	std::vector<Query*> pending;
+	bool gathering;
+	int batchesAmount;
+	int queriesAmount;
+	std::mutex mutex;
+	std::condition_variable batchFull;
+	std::condition_variable batchDone;
+	void solveBatch(std::vector<Query*>& batch);
+public:
+
+	/**
+	 * Creates a new batcher of the queries to an index.
+	 * @param indexes - the holder of the index of the features of the
+	 * 					database, which outlives the batcher
+	 * @param imagesAmount - the amount of images in the database
+	 * @param window - the time a batch waits for queries, in microseconds,
+	 * 				   every query is solved by itself if 0
+	 * @param maxBatchSize - the maximal number of queries in a batch
+	 */
+	QueryBatcher(const IndexHolder& indexes, int imagesAmount, int window,
+			int maxBatchSize);
+
+	/**
+	 * Solves a query as SPQuerySolverSolve does, together with the queries
+	 * which other threads solve at about the same time.
+	 * This function may be called concurrently from several threads.
+	 *
+	 * @param features - the features of the query, a store of the same type
+	 * 					 and dimension as the index's store
+	 * @param k - the k in 'k nearest neighbors'
+	 * @param numOfSimilar - the number of similar images to return as result
+	 * @param filter - the indexes of the images to search, NULL searches all
+	 * 				   of them
+	 * @return  An array of the indexes of the 'numOfSimilar' most similar
+	 * 			images - On success
+	 * 			NULL - If an error occurred
+	 */
+	int* solve(SPPointStore features, int k, int numOfSimilar, SPBitset filter);
+
+	/**
+	 * @return the number of batches solved so far
+	 */
+	int getBatchesAmount();
+
+	/**
+	 * @return the average number of queries in a batch, 0 if no batch was
+	 * 		   solved
+	 */
+	double getAverageBatchSize();
+};
+
+}
+#endif
@@ -0,0 +1,366 @@
+#include <string.h>
+#include <pthread.h>
+#include "SPQueryCache.h"
+#include "SPHash.h"
+
+#define MIN_BUCKETS 64
+#define RESULTS_SHARE 16
+
+typedef struct sp_query_cache_entry_t
+{
+	unsigned long long key;
+	unsigned long long version; // of the index which found a result
+	SPPointStore features;
+	int* images;
+	size_t bytes;
+	struct sp_query_cache_entry_t* newer;
+	struct sp_query_cache_entry_t* older;
+	struct sp_query_cache_entry_t* chained; // the next entry of its bucket
+} SPQueryCacheEntry;
+
+/*
+ * A tier: a hash table of entries, which are also linked from the most
+ * recently used to the least
+ */
+typedef struct sp_query_cache_lru_t
+{
+	SPQueryCacheEntry** buckets;
+	int bucketsAmount;
+	int entriesAmount;
+	SPQueryCacheEntry* newest;
+	SPQueryCacheEntry* oldest;
+	size_t bytes;
+	size_t capacity;
+	long long hits;
+	long long misses;
+} SPQueryCacheLRU;
+
+struct sp_query_cache_t
+{
+	SPQueryCacheLRU tiers[2];
+	pthread_mutex_t lock;
+};
+
+/*
+ * The bucket of a key. The keys are hashes already, their low bits are as
+ * good as any.
+ */
+static int bucketOf(const SPQueryCacheLRU* lru, unsigned long long key)
+{
+	return (int) (key % (unsigned long long) lru->bucketsAmount);
+}
+
+static SPQueryCacheEntry* findEntry(const SPQueryCacheLRU* lru, unsigned long long key)
+{
+	SPQueryCacheEntry* entry = lru->buckets[bucketOf(lru, key)];
+	while (entry != NULL && entry->key != key)
+		entry = entry->chained;
+	return entry;
+}
+
+static void unlinkRecency(SPQueryCacheLRU* lru, SPQueryCacheEntry* entry)
+{
+	if (entry->newer != NULL)
+		entry->newer->older = entry->older;
+	else
+		lru->newest = entry->older;
+	if (entry->older != NULL)
+		entry->older->newer = entry->newer;
+	else
+		lru->oldest = entry->newer;
+	entry->newer = NULL;
+	entry->older = NULL;
+}
+
+static void linkNewest(SPQueryCacheLRU* lru, SPQueryCacheEntry* entry)
+{
+	entry->older = lru->newest;
+	entry->newer = NULL;
+	if (lru->newest != NULL)
+		lru->newest->newer = entry;
+	lru->newest = entry;
+	if (lru->oldest == NULL)
+		lru->oldest = entry;
+}
+
+static void removeEntry(SPQueryCacheLRU* lru, SPQueryCacheEntry* entry)
+{
+	SPQueryCacheEntry** link = &lru->buckets[bucketOf(lru, entry->key)];
+	while (*link != entry)
+		link = &(*link)->chained;
+	*link = entry->chained;
+	unlinkRecency(lru, entry);
+	lru->bytes -= entry->bytes;
+	lru->entriesAmount--;
+	spPointStoreDestroy(entry->features);
+	free(entry->images);
+	free(entry);
+}
+
+/*
+ * Doubles the buckets of a tier once it has as many entries as buckets.
+ * The tier stays as it is if the allocation fails, only its chains are longer.
+ */
+static void growBuckets(SPQueryCacheLRU* lru)
+{
+	int i, bucket, oldAmount = lru->bucketsAmount;
+	SPQueryCacheEntry **buckets, **oldBuckets = lru->buckets;
+	SPQueryCacheEntry *entry, *next;
+	if (lru->entriesAmount < lru->bucketsAmount)
+		return;
+	buckets = (SPQueryCacheEntry**) calloc(2 * oldAmount, sizeof(SPQueryCacheEntry*));
+	if (buckets == NULL)
+		return;
+	lru->buckets = buckets;
+	lru->bucketsAmount = 2 * oldAmount;
+	for (i = 0; i < oldAmount; i++)
+	{
+		for (entry = oldBuckets[i]; entry != NULL; entry = next)
+		{
+			next = entry->chained;
+			bucket = bucketOf(lru, entry->key);
+			entry->chained = buckets[bucket];
+			buckets[bucket] = entry;
+		}
+	}
+	free(oldBuckets);
+}
+
+/*
+ * Inserts an entry as the most recently used of its tier, replacing an
+ * entry of the same key and evicting the least recently used until it fits.
+ * The entry is freed if it's larger than the whole tier.
+ */
+static void insertEntry(SPQueryCacheLRU* lru, SPQueryCacheEntry* entry)
+{
+	int bucket;
+	SPQueryCacheEntry* existing = findEntry(lru, entry->key);
+	if (existing != NULL)
+		removeEntry(lru, existing);
+	if (entry->bytes > lru->capacity)
+	{
+		spPointStoreDestroy(entry->features);
+		free(entry->images);
+		free(entry);
+		return;
+	}
+	while (lru->bytes + entry->bytes > lru->capacity)
+		removeEntry(lru, lru->oldest);
+	growBuckets(lru);
+	bucket = bucketOf(lru, entry->key);
+	entry->chained = lru->buckets[bucket];
+	lru->buckets[bucket] = entry;
+	linkNewest(lru, entry);
+	lru->bytes += entry->bytes;
+	lru->entriesAmount++;
+}
+
+/*
+ * The key of a result: the key of its query image continued with the
+ * parameters of the query.
+ */
+static unsigned long long resultKey(unsigned long long hash, int k, int numOfSimilar)
+{
+	hash = spHashBytes(&k, sizeof(k), hash);
+	return spHashBytes(&numOfSimilar, sizeof(numOfSimilar), hash);
+}
+
+SPQueryCache spQueryCacheCreate(size_t memory, SP_QUERY_CACHE_MSG* msg)
+{
+	int i;
+	SPQueryCache cache;
+	assert(msg != NULL);
+	if (memory == 0)
+	{
+		*msg = SP_QUERY_CACHE_INVALID_ARGUMENT;
+		return NULL;
+	}
+	cache = (SPQueryCache) calloc(1, sizeof(*cache));
+	if (cache == NULL)
+	{
+		*msg = SP_QUERY_CACHE_ALLOC_FAIL;
+		return NULL;
+	}
+	cache->tiers[SP_QUERY_CACHE_RESULTS].capacity = memory / RESULTS_SHARE;
+	cache->tiers[SP_QUERY_CACHE_FEATURES].capacity = memory - memory / RESULTS_SHARE;
+	for (i = 0; i < 2; i++)
+	{
+		cache->tiers[i].bucketsAmount = MIN_BUCKETS;
+		cache->tiers[i].buckets = (SPQueryCacheEntry**) calloc(MIN_BUCKETS,
+				sizeof(SPQueryCacheEntry*));
+		if (cache->tiers[i].buckets == NULL)
+		{
+			free(cache->tiers[0].buckets);
+			free(cache);
+			*msg = SP_QUERY_CACHE_ALLOC_FAIL;
+			return NULL;
+		}
+	}
+	pthread_mutex_init(&cache->lock, NULL);
+	*msg = SP_QUERY_CACHE_SUCCESS;
+	return cache;
+}
+
+bool spQueryCacheHashImage(const char* imagePath, const SPConfig config,
+		unsigned long long* hash)
+{
+	SP_CONFIG_MSG configMsg;
+	int values[5];
+	if (imagePath == NULL || config == NULL || hash == NULL || !spHashFile(imagePath, hash))
+		return false;
+	values[0] = (int) spConfigGetDescriptorType(config, &configMsg);
+	values[1] = spConfigGetPCADim(config, &configMsg);
+	values[2] = spConfigGetNumOfFeatures(config, &configMsg);
+	values[3] = spConfigGetMaxImageEdge(config, &configMsg);
+	values[4] = (int) spConfigGetReducedDecodeScope(config, &configMsg);
+	*hash = spHashBytes(values, sizeof(values), *hash);
+	return true;
+}
+
+SPPointStore spQueryCacheGetFeatures(SPQueryCache cache, unsigned long long hash)
+{
+	SPQueryCacheLRU* lru;
+	SPQueryCacheEntry* entry;
+	SPPointStore features = NULL;
+	SP_POINT_STORE_MSG storeMsg;
+	if (cache == NULL)
+		return NULL;
+	lru = &cache->tiers[SP_QUERY_CACHE_FEATURES];
+	pthread_mutex_lock(&cache->lock);
+	entry = findEntry(lru, hash);
+	if (entry != NULL)
+	{
+		lru->hits++;
+		unlinkRecency(lru, entry);
+		linkNewest(lru, entry);
+		features = spPointStoreCopy(entry->features, &storeMsg);
+	}
+	else
+		lru->misses++;
+	pthread_mutex_unlock(&cache->lock);
+	return features;
+}
+
+SP_QUERY_CACHE_MSG spQueryCachePutFeatures(SPQueryCache cache, unsigned long long hash,
+		SPPointStore features)
+{
+	SPQueryCacheEntry* entry;
+	SP_POINT_STORE_MSG storeMsg;
+	size_t rowBytes;
+	if (cache == NULL || features == NULL)
+		return SP_QUERY_CACHE_INVALID_ARGUMENT;
+	entry = (SPQueryCacheEntry*) calloc(1, sizeof(SPQueryCacheEntry));
+	if (entry == NULL)
+		return SP_QUERY_CACHE_ALLOC_FAIL;
+	// The copy is made outside the lock, it's the costly part
+	entry->features = spPointStoreCopy(features, &storeMsg);
+	if (entry->features == NULL)
+	{
+		free(entry);
+		return storeMsg == SP_POINT_STORE_ALLOC_FAIL ?
+				SP_QUERY_CACHE_ALLOC_FAIL : SP_QUERY_CACHE_INVALID_ARGUMENT;
+	}
+	rowBytes = spPointStoreGetType(features) == SP_POINT_STORE_REAL ?
+			spPointStoreGetDim(features) * sizeof(double) : (size_t) spPointStoreGetDim(features);
+	entry->key = hash;
+	entry->bytes = sizeof(SPQueryCacheEntry)
+			+ (size_t) spPointStoreGetSize(features) * (rowBytes + sizeof(int));
+	pthread_mutex_lock(&cache->lock);
+	insertEntry(&cache->tiers[SP_QUERY_CACHE_FEATURES], entry);
+	pthread_mutex_unlock(&cache->lock);
+	return SP_QUERY_CACHE_SUCCESS;
+}
+
+int* spQueryCacheGetResult(SPQueryCache cache, unsigned long long hash, int k,
+		int numOfSimilar, unsigned long long version)
+{
+	SPQueryCacheLRU* lru;
+	SPQueryCacheEntry* entry;
+	int* images = NULL;
+	if (cache == NULL || numOfSimilar < 1)
+		return NULL;
+	lru = &cache->tiers[SP_QUERY_CACHE_RESULTS];
+	pthread_mutex_lock(&cache->lock);
+	entry = findEntry(lru, resultKey(hash, k, numOfSimilar));
+	// A result of an older index may miss images which were added since
+	if (entry != NULL && entry->version != version)
+	{
+		removeEntry(lru, entry);
+		entry = NULL;
+	}
+	if (entry != NULL)
+	{
+		lru->hits++;
+		unlinkRecency(lru, entry);
+		linkNewest(lru, entry);
+		images = (int*) malloc(numOfSimilar * sizeof(int));
+		if (images != NULL)
+			memcpy(images, entry->images, numOfSimilar * sizeof(int));
+	}
+	else
+		lru->misses++;
+	pthread_mutex_unlock(&cache->lock);
+	return images;
+}
+
+SP_QUERY_CACHE_MSG spQueryCachePutResult(SPQueryCache cache, unsigned long long hash, int k,
+		int numOfSimilar, unsigned long long version, const int* images)
+{
+	SPQueryCacheEntry* entry;
+	if (cache == NULL || images == NULL || numOfSimilar < 1)
+		return SP_QUERY_CACHE_INVALID_ARGUMENT;
+	entry = (SPQueryCacheEntry*) calloc(1, sizeof(SPQueryCacheEntry));
+	if (entry == NULL)
+		return SP_QUERY_CACHE_ALLOC_FAIL;
+	entry->images = (int*) malloc(numOfSimilar * sizeof(int));
+	if (entry->images == NULL)
+	{
+		free(entry);
+		return SP_QUERY_CACHE_ALLOC_FAIL;
+	}
+	memcpy(entry->images, images, numOfSimilar * sizeof(int));
+	entry->key = resultKey(hash, k, numOfSimilar);
+	entry->version = version;
+	entry->bytes = sizeof(SPQueryCacheEntry) + numOfSimilar * sizeof(int);
+	pthread_mutex_lock(&cache->lock);
+	insertEntry(&cache->tiers[SP_QUERY_CACHE_RESULTS], entry);
+	pthread_mutex_unlock(&cache->lock);
+	return SP_QUERY_CACHE_SUCCESS;
+}
+
+long long spQueryCacheGetHits(SPQueryCache cache, SP_QUERY_CACHE_TIER tier)
+{
+	long long hits;
+	if (cache == NULL)
+		return -1;
+	pthread_mutex_lock(&cache->lock);
+	hits = cache->tiers[tier].hits;
+	pthread_mutex_unlock(&cache->lock);
+	return hits;
+}
+
+long long spQueryCacheGetMisses(SPQueryCache cache, SP_QUERY_CACHE_TIER tier)
+{
+	long long misses;
+	if (cache == NULL)
+		return -1;
+	pthread_mutex_lock(&cache->lock);
+	misses = cache->tiers[tier].misses;
+	pthread_mutex_unlock(&cache->lock);
+	return misses;
+}
+
+void spQueryCacheDestroy(SPQueryCache cache)
+{
+	int i;
+	if (cache == NULL)
+		return;
+	for (i = 0; i < 2; i++)
+	{
+		while (cache->tiers[i].oldest != NULL)
+			removeEntry(&cache->tiers[i], cache->tiers[i].oldest);
+		free(cache->tiers[i].buckets);
+	}
+	pthread_mutex_destroy(&cache->lock);
+	free(cache);
+}
@@ -0,0 +1,164 @@
+#ifndef SPQUERYCACHE_H_
+#define SPQUERYCACHE_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "SPConfig.h"
+#include "SPPointStore.h"
+
+/**
+ * SP Query Cache summary
+ * A bounded cache of the work done for query images, so a query image which
+ * is sent again isn't extracted or searched again. It has two tiers, each
+ * evicting its least recently used entries:
+ * - features: the features extracted from a query image
+ * - results: the most similar images found for a query image, for a given k
+ *   and number of similar images
+ *
+ * Entries are keyed by the hash of the content of the image file together
+ * with the configuration values its features depend on, so an image which
+ * changed on disk misses even under the same path. A result is also stamped
+ * with the version of the index which found it, and a result of another
+ * version is dropped instead of returned, so the results are invalidated
+ * whenever the index changes.
+ *
+ * The memory of the cache is bounded by the given amount: a sixteenth of it
+ * for the results, the rest for the features. The hits and misses of every
+ * tier are counted. All the functions are thread safe.
+ *
+ * The following functions are supported:
+ * spQueryCacheCreate      - Creates an empty cache
+ * spQueryCacheHashImage   - Computes the key of a query image
+ * spQueryCacheGetFeatures - Finds the features of a query image
+ * spQueryCachePutFeatures - Stores the features of a query image
+ * spQueryCacheGetResult   - Finds the result of a query
+ * spQueryCachePutResult   - Stores the result of a query
+ * spQueryCacheGetHits     - A getter of the number of hits of a tier
+ * spQueryCacheGetMisses   - A getter of the number of misses of a tier
+ * spQueryCacheDestroy     - Frees all resources associated with a cache
+ */
+
+typedef enum sp_query_cache_msg_t {
+	SP_QUERY_CACHE_INVALID_ARGUMENT,
+	SP_QUERY_CACHE_ALLOC_FAIL,
+	SP_QUERY_CACHE_SUCCESS
+} SP_QUERY_CACHE_MSG;
+
+typedef enum sp_query_cache_tier_t {
+	SP_QUERY_CACHE_FEATURES,
+	SP_QUERY_CACHE_RESULTS
+} SP_QUERY_CACHE_TIER;
+
+typedef struct sp_query_cache_t* SPQueryCache;
+
+/**
+ * Creates an empty cache.
+ *
+ * @param memory - the maximal amount of memory of the cache, in bytes
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new cache.
+ *
+ * - SP_QUERY_CACHE_INVALID_ARGUMENT - if memory == 0
+ * - SP_QUERY_CACHE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_QUERY_CACHE_SUCCESS - in case of success
+ */
+SPQueryCache spQueryCacheCreate(size_t memory, SP_QUERY_CACHE_MSG* msg);
+
+/**
+ * Computes the key of a query image: the hash of the content of its file,
+ * continued with the configuration values which its features depend on.
+ *
+ * @param imagePath - the path of the query image
+ * @param config - the configuration
+ * @param hash - a pointer in which the key is stored
+ * @return
+ * true - on success
+ * false - if an argument is NULL or the file couldn't be read
+ */
+bool spQueryCacheHashImage(const char* imagePath, const SPConfig config,
+		unsigned long long* hash);
+
+/**
+ * Finds the features of the query image of the given key, and marks them as
+ * the most recently used.
+ *
+ * @param cache - the cache
+ * @param hash - the key of the query image
+ * @return a copy of the features, which the caller destroys, or NULL if
+ * 		   they aren't in the cache or an allocation failure occurred
+ */
+SPPointStore spQueryCacheGetFeatures(SPQueryCache cache, unsigned long long hash);
+
+/**
+ * Stores a copy of the features of the query image of the given key,
+ * evicting the least recently used features as needed. Features which
+ * don't fit in the memory of their tier aren't stored.
+ *
+ * @param cache - the cache
+ * @param hash - the key of the query image
+ * @param features - the features
+ * @return
+ * - SP_QUERY_CACHE_INVALID_ARGUMENT - if cache == NULL or features == NULL
+ * - SP_QUERY_CACHE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_QUERY_CACHE_SUCCESS - in case of success, also if it didn't fit
+ */
+SP_QUERY_CACHE_MSG spQueryCachePutFeatures(SPQueryCache cache, unsigned long long hash,
+		SPPointStore features);
+
+/**
+ * Finds the result of the query of the query image of the given key with
+ * the given k and number of similar images, and marks it as the most
+ * recently used. A result found by another version of the index is removed.
+ *
+ * @param cache - the cache
+ * @param hash - the key of the query image
+ * @param k - the k in 'k nearest neighbors'
+ * @param numOfSimilar - the number of similar images of the result
+ * @param version - the version of the index, see spIndexGetVersion
+ * @return a copy of the numOfSimilar indexes of the result, which the
+ * 		   caller frees, or NULL if it isn't in the cache or an allocation
+ * 		   failure occurred
+ */
+int* spQueryCacheGetResult(SPQueryCache cache, unsigned long long hash, int k,
+		int numOfSimilar, unsigned long long version);
+
+/**
+ * Stores a copy of the result of a query, evicting the least recently used
+ * results as needed.
+ *
+ * @param cache - the cache
+ * @param hash - the key of the query image
+ * @param k - the k in 'k nearest neighbors'
+ * @param numOfSimilar - the number of similar images of the result
+ * @param version - the version of the index which found the result
+ * @param images - the numOfSimilar indexes of the result
+ * @return
+ * - SP_QUERY_CACHE_INVALID_ARGUMENT - if cache == NULL or images == NULL or
+ * 		numOfSimilar < 1
+ * - SP_QUERY_CACHE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_QUERY_CACHE_SUCCESS - in case of success, also if it didn't fit
+ */
+SP_QUERY_CACHE_MSG spQueryCachePutResult(SPQueryCache cache, unsigned long long hash, int k,
+		int numOfSimilar, unsigned long long version, const int* images);
+
+/**
+ * @return the number of lookups of the tier which were found, -1 if
+ * 		   cache == NULL
+ */
+long long spQueryCacheGetHits(SPQueryCache cache, SP_QUERY_CACHE_TIER tier);
+
+/**
+ * @return the number of lookups of the tier which weren't found, -1 if
+ * 		   cache == NULL
+ */
+long long spQueryCacheGetMisses(SPQueryCache cache, SP_QUERY_CACHE_TIER tier);
+
+/**
+ * Frees all resources associated with the cache.
+ * If cache == NULL nothing happens.
+ */
+void spQueryCacheDestroy(SPQueryCache cache);
+
+#endif /* SPQUERYCACHE_H_ */
@@ -0,0 +1,10 @@
+#ifndef SPQUERYMODE_H_
+#define SPQUERYMODE_H_
+
+typedef enum sp_query_mode_t {
+	SP_QUERY_MODE_INTERACTIVE,
+	SP_QUERY_MODE_SERVER,
+	SP_QUERY_MODE_BATCH
+} SP_QUERY_MODE;
+
+#endif /* SPQUERYMODE_H_ */
@@ -0,0 +1,622 @@
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "SPQueryServer.h"
+#include "SPIndexLoader.h"
+extern "C" {
+#include "SPLogger.h"
+}
+
+#define STRING_LENGTH 1024
+#define LISTEN_BACKLOG 64
+#define REQUEST_TIMEOUT_SECONDS 10
+#define EXIT_INPUT "<>"
+#define INSERT_COMMAND "INSERT"
+#define DELETE_COMMAND "DELETE"
+#define RELOAD_COMMAND "RELOAD"
+#define KNN_FIELD "spKNN="
+#define NUM_OF_SIMILAR_FIELD "spNumOfSimilarImages="
+#define FILTER_FIELD "spImageFilter="
+
+#define RESPONSE_OK "OK\n"
+#define RESPONSE_ERROR "ERROR "
+#define BUSY_ERROR "the server is busy, try again later"
+#define BAD_REQUEST_ERROR "the request couldn't be read"
+#define EMPTY_REQUEST_ERROR "no image path was given"
+#define UNKNOWN_FIELD_ERROR "unknown field "
+#define INSERT_FIELDS_ERROR "an insert takes a single image path"
+#define DELETE_FIELDS_ERROR "a delete takes a single image path"
+#define RELOAD_FIELDS_ERROR "a reload takes no fields"
+#define INVALID_KNN_ERROR "spKNN must be a positive integer"
+#define INVALID_NUM_OF_SIMILAR_ERROR "spNumOfSimilarImages must be between 1 and the number of images"
+#define INVALID_FILTER_ERROR "spImageFilter must be a list of image indexes and ranges, e.g. 0-9,20"
+#define FEATURES_ERROR "failed to get image features"
+#define QUERY_ERROR "failed to solve query"
+#define IMAGE_PATH_ERROR "failed to get image path"
+#define INSERT_ERROR "failed to insert image"
+#define UNKNOWN_IMAGE_ERROR "no image of the index has this path"
+#define DELETE_ERROR "failed to delete image"
+#define RELOAD_RUNNING_ERROR "a reload is already running"
+
+#define SOCKET_PATH_ERROR "Server socket path couldn't be resolved or is too long"
+#define SOCKET_ERROR "Server socket couldn't be set up"
+#define ACCEPT_WARNING "Failed to accept a connection to the server"
+#define RESPONSE_WARNING "Failed to send a response to a client"
+#define RELOAD_WARNING "Failed to reload the index, the running index is kept"
+#define LISTENING_INFO "Serving queries on %s using %d workers, admitting %d requests"
+#define REQUEST_INFO "Served %s in %.1f ms"
+#define INSERT_INFO "Inserted %s as image %d in %.1f ms"
+#define DELETE_INFO "Deleted %s, %d images, in %.1f ms"
+#define RELOAD_INFO "Reloaded the index in %.1f ms"
+#define REQUEST_FAILED_INFO "Failed to serve %s: %s"
+#define STOPPED_INFO "Server stopped after serving %d requests, %d were rejected as busy"
+#define BATCH_INFO "Queries were searched in %d batches of %.1f queries on average"
+
+typedef std::chrono::steady_clock Clock;
+
+sp::QueryServer::QueryServer(const SPConfig config, ImageProc* imgProc,
+		SPIndex index, SPQueryCache cache, SP_POINT_STORE_TYPE storeType,
+		int featureDim) :
+		config(config), imgProc(imgProc), indexes(index), cache(cache), storeType(storeType),
+		featureDim(featureDim), listenFd(-1), reloading(false), stopping(false),
+		servedAmount(0), rejectedAmount(0) {
+	SP_CONFIG_MSG msg = SP_CONFIG_SUCCESS;
+	imagesAmount = spConfigGetNumOfImages(config, &msg);
+	knn = spConfigGetKNN(config, &msg);
+	numOfSimilarImages = spConfigGetNumOfSimilarImages(config, &msg);
+	numOfWorkers = spConfigGetServerWorkers(config, &msg);
+	admissionQueue.reset(new BoundedQueue<int>(
+			(size_t) spConfigGetServerQueueSize(config, &msg)));
+	batcher.reset(new QueryBatcher(indexes, imagesAmount,
+			spConfigGetBatchWindow(config, &msg), spConfigGetMaxBatchSize(config, &msg)));
+}
+
+bool sp::QueryServer::listenOnSocket() {
+	char path[STRING_LENGTH] = { '\0' };
+	struct sockaddr_un address;
+	if (spConfigGetServerSocketPath(path, config) != SP_CONFIG_SUCCESS
+			|| strlen(path) >= sizeof(address.sun_path)) {
+		spLoggerPrintError(SOCKET_PATH_ERROR, __FILE__, __func__, __LINE__);
+		return false;
+	}
+	socketPath = path;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	// A socket file left behind by a server which didn't stop cleanly would
+	// fail the bind
+	unlink(path);
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd < 0
+			|| bind(listenFd, (struct sockaddr*) &address, sizeof(address)) != 0
+			|| listen(listenFd, LISTEN_BACKLOG) != 0) {
+		spLoggerPrintError(SOCKET_ERROR, __FILE__, __func__, __LINE__);
+		if (listenFd >= 0) {
+			close(listenFd);
+			listenFd = -1;
+		}
+		return false;
+	}
+	return true;
+}
+
+void sp::QueryServer::acceptConnections() {
+	while (!stopping) {
+		int fd = accept(listenFd, NULL, NULL);
+		if (fd < 0) {
+			if (!stopping && errno != EINTR && errno != ECONNABORTED) {
+				spLoggerPrintWarning(ACCEPT_WARNING, __FILE__, __func__, __LINE__);
+			}
+			continue;
+		}
+		// A client which never sends its request mustn't hold a worker forever
+		struct timeval timeout;
+		timeout.tv_sec = REQUEST_TIMEOUT_SECONDS;
+		timeout.tv_usec = 0;
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		int admitted = fd;
+		if (!admissionQueue->tryPush(std::move(admitted))) {
+			rejectedAmount++;
+			sendResponse(fd, std::string(RESPONSE_ERROR BUSY_ERROR "\n"));
+			close(fd);
+		}
+	}
+}
+
+void sp::QueryServer::workerLoop() {
+	int fd;
+	while (admissionQueue->pop(fd)) {
+		handleConnection(fd);
+		close(fd);
+	}
+}
+
+void sp::QueryServer::handleConnection(int fd) {
+	std::string request, imagePath, error, response;
+	int k = knn, numOfSimilar = numOfSimilarImages, image = -1;
+	RequestType type = QUERY_REQUEST;
+	SPBitset filter = NULL;
+	char infoMSG[2 * STRING_LENGTH] = { '\0' };
+	Clock::time_point start = Clock::now();
+	if (!readRequest(fd, request)) {
+		response = RESPONSE_ERROR BAD_REQUEST_ERROR "\n";
+	} else if (!parseRequest(request, imagePath, &type, &k, &numOfSimilar, &filter,
+			error)) {
+		response = RESPONSE_ERROR + error + "\n";
+	} else if (type == QUERY_REQUEST && imagePath == EXIT_INPUT) {
+		response = RESPONSE_OK;
+		stop();
+	} else if (!serveRequest(type, imagePath, k, numOfSimilar, filter, &image,
+			response)) {
+		snprintf(infoMSG, sizeof(infoMSG), REQUEST_FAILED_INFO, imagePath.c_str(),
+				response.c_str());
+		spLoggerPrintInfo(infoMSG);
+		response = RESPONSE_ERROR + response + "\n";
+	} else {
+		servedAmount++;
+		double millis = std::chrono::duration<double, std::milli>(
+				Clock::now() - start).count();
+		if (type == INSERT_REQUEST) {
+			snprintf(infoMSG, sizeof(infoMSG), INSERT_INFO, imagePath.c_str(), image,
+					millis);
+		} else if (type == DELETE_REQUEST) {
+			snprintf(infoMSG, sizeof(infoMSG), DELETE_INFO, imagePath.c_str(), image,
+					millis);
+		} else {
+			snprintf(infoMSG, sizeof(infoMSG), REQUEST_INFO, imagePath.c_str(), millis);
+		}
+		spLoggerPrintInfo(infoMSG);
+	}
+	spBitsetDestroy(filter);
+	if (!sendResponse(fd, response)) {
+		spLoggerPrintWarning(RESPONSE_WARNING, __FILE__, __func__, __LINE__);
+	}
+}
+
+bool sp::QueryServer::serveRequest(RequestType type, const std::string& imagePath,
+		int k, int numOfSimilar, SPBitset filter, int* image, std::string& response) {
+	switch (type) {
+	case INSERT_REQUEST:
+		return insertImage(imagePath, image, response);
+	case DELETE_REQUEST:
+		return deleteImage(imagePath, image, response);
+	case RELOAD_REQUEST:
+		return startReload(response);
+	default:
+		return solveQuery(imagePath, k, numOfSimilar, filter, response);
+	}
+}
+
+bool sp::QueryServer::readRequest(int fd, std::string& request) {
+	char c;
+	request.clear();
+	while (request.size() < STRING_LENGTH) {
+		ssize_t amount = recv(fd, &c, 1, 0);
+		if (amount < 0 && errno == EINTR) {
+			continue;
+		}
+		if (amount <= 0) {
+			// A client may close its side instead of ending the line
+			return amount == 0 && !request.empty();
+		}
+		if (c == '\n') {
+			return true;
+		}
+		if (c != '\r') {
+			request.push_back(c);
+		}
+	}
+	return false;
+}
+
+bool sp::QueryServer::parseRequest(const std::string& request,
+		std::string& imagePath, RequestType* type, int* k, int* numOfSimilar,
+		SPBitset* filter, std::string& error) {
+	std::istringstream fields(request);
+	std::string field;
+	if (!(fields >> imagePath)) {
+		error = EMPTY_REQUEST_ERROR;
+		return false;
+	}
+	if (imagePath == INSERT_COMMAND || imagePath == DELETE_COMMAND) {
+		*type = imagePath == INSERT_COMMAND ? INSERT_REQUEST : DELETE_REQUEST;
+		if (!(fields >> imagePath) || fields >> field) {
+			error = *type == INSERT_REQUEST ? INSERT_FIELDS_ERROR : DELETE_FIELDS_ERROR;
+			return false;
+		}
+		return true;
+	}
+	if (imagePath == RELOAD_COMMAND) {
+		*type = RELOAD_REQUEST;
+		if (fields >> field) {
+			error = RELOAD_FIELDS_ERROR;
+			return false;
+		}
+		return true;
+	}
+	*type = QUERY_REQUEST;
+	while (fields >> field) {
+		char* end = NULL;
+		if (field.compare(0, strlen(KNN_FIELD), KNN_FIELD) == 0) {
+			const char* value = field.c_str() + strlen(KNN_FIELD);
+			long number = strtol(value, &end, 10);
+			if (*value == '\0' || *end != '\0' || number < 1 || number > INT_MAX) {
+				error = INVALID_KNN_ERROR;
+				return false;
+			}
+			*k = (int) number;
+		} else if (field.compare(0, strlen(NUM_OF_SIMILAR_FIELD), NUM_OF_SIMILAR_FIELD) == 0) {
+			const char* value = field.c_str() + strlen(NUM_OF_SIMILAR_FIELD);
+			long number = strtol(value, &end, 10);
+			if (*value == '\0' || *end != '\0' || number < 1 || number > imagesAmount) {
+				error = INVALID_NUM_OF_SIMILAR_ERROR;
+				return false;
+			}
+			*numOfSimilar = (int) number;
+		} else if (field.compare(0, strlen(FILTER_FIELD), FILTER_FIELD) == 0) {
+			SP_BITSET_MSG msg = SP_BITSET_SUCCESS;
+			if (*filter == NULL) {
+				*filter = spBitsetCreate(imagesAmount, &msg);
+			}
+			if (*filter == NULL
+					|| !parseFilter(field.c_str() + strlen(FILTER_FIELD), *filter)) {
+				error = INVALID_FILTER_ERROR;
+				return false;
+			}
+		} else {
+			error = UNKNOWN_FIELD_ERROR + field;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool sp::QueryServer::parseFilter(const char* ids, SPBitset filter) {
+	// Inserted images may be in the filter too
+	long last = spIndexGetImagesAmount(indexes.acquire().get()) - 1;
+	while (true) {
+		char* end = NULL;
+		long first = strtol(ids, &end, 10);
+		long rangeEnd = first;
+		if (end == ids || first < 0 || first > last) {
+			return false;
+		}
+		if (*end == '-') {
+			ids = end + 1;
+			rangeEnd = strtol(ids, &end, 10);
+			if (end == ids || rangeEnd < first || rangeEnd > last) {
+				return false;
+			}
+		}
+		if (spBitsetAddRange(filter, (int) first, (int) rangeEnd) != SP_BITSET_SUCCESS) {
+			return false;
+		}
+		if (*end == '\0') {
+			return true;
+		}
+		if (*end != ',') {
+			return false;
+		}
+		ids = end + 1;
+	}
+}
+
+bool sp::QueryServer::solveQuery(const std::string& imagePath, int k,
+		int numOfSimilar, SPBitset filter, std::string& response) {
+	char resImagePath[STRING_LENGTH] = { '\0' };
+	unsigned long long hash;
+	bool hashed = cache != NULL
+			&& spQueryCacheHashImage(imagePath.c_str(), config, &hash);
+	// A filtered result is never cached, yet the features of its image are
+	bool cached = hashed && filter == NULL;
+	// The version is read before the search, so a result found by an index
+	// which changed meanwhile is never stamped as current
+	unsigned long long version = spIndexGetVersion(indexes.acquire().get());
+	int* similarImages = cached ?
+			spQueryCacheGetResult(cache, hash, k, numOfSimilar, version) : NULL;
+	if (similarImages == NULL) {
+		SPPointStore queryFeatures = getQueryFeatures(imagePath.c_str(),
+				hashed ? &hash : NULL);
+		if (queryFeatures == NULL) {
+			response = FEATURES_ERROR;
+			return false;
+		}
+		similarImages = batcher->solve(queryFeatures, k, numOfSimilar, filter);
+		spPointStoreDestroy(queryFeatures);
+		if (similarImages == NULL) {
+			response = QUERY_ERROR;
+			return false;
+		}
+		if (cached) {
+			spQueryCachePutResult(cache, hash, k, numOfSimilar, version, similarImages);
+		}
+	}
+	response = RESPONSE_OK;
+	for (int i = 0; i < numOfSimilar && similarImages[i] >= 0; i++) {
+		if (!getImagePath(similarImages[i], resImagePath)) {
+			free(similarImages);
+			response = IMAGE_PATH_ERROR;
+			return false;
+		}
+		response += resImagePath;
+		response += "\n";
+	}
+	free(similarImages);
+	return true;
+}
+
+bool sp::QueryServer::insertImage(const std::string& imagePath, int* image,
+		std::string& response) {
+	SPPointStore store = getImageFeatures(imagePath);
+	if (store == NULL) {
+		response = FEATURES_ERROR;
+		return false;
+	}
+	{
+		// The path is known before a search can find the image
+		std::lock_guard<std::mutex> lock(insertedMutex);
+		if (spIndexInsert(indexes.acquire().get(), store, image) == SP_INDEX_SUCCESS) {
+			insertedPaths[*image] = imagePath;
+		} else {
+			*image = -1;
+		}
+	}
+	spPointStoreDestroy(store);
+	if (*image < 0) {
+		response = INSERT_ERROR;
+		return false;
+	}
+	response = RESPONSE_OK;
+	return true;
+}
+
+SPPointStore sp::QueryServer::getImageFeatures(const std::string& imagePath) {
+	int featuresAmount;
+	SP_POINT_STORE_MSG storeMsg;
+	// Every worker projects the features of its images into its own buffer
+	static thread_local std::vector<float> features;
+	// Not a database image, so there are no preprocessed descriptors of it,
+	// and spIndexInsert gives the features their image index
+	if (!imgProc->getImageFeatures(imagePath.c_str(), -1, features,
+			&featuresAmount)) {
+		return NULL;
+	}
+	return spPointStoreCreateFromFloats(storeType, features.data(),
+			featuresAmount, featureDim, 0, &storeMsg);
+}
+
+bool sp::QueryServer::deleteImage(const std::string& imagePath, int* deletedAmount,
+		std::string& response) {
+	char dbImagePath[STRING_LENGTH] = { '\0' };
+	std::vector<int> images;
+	// A path may have been inserted again after it was deleted, or name a
+	// database image too, so every image of it is deleted
+	for (int i = 0; i < imagesAmount; i++) {
+		if (spConfigGetImagePath(dbImagePath, config, i) == SP_CONFIG_SUCCESS
+				&& imagePath == dbImagePath) {
+			images.push_back(i);
+		}
+	}
+	std::lock_guard<std::mutex> lock(insertedMutex);
+	IndexSnapshot index = indexes.acquire();
+	for (std::map<int, std::string>::const_iterator inserted = insertedPaths.begin();
+			inserted != insertedPaths.end(); ++inserted) {
+		if (inserted->second == imagePath) {
+			images.push_back(inserted->first);
+		}
+	}
+	if (images.empty()) {
+		response = UNKNOWN_IMAGE_ERROR;
+		return false;
+	}
+	*deletedAmount = 0;
+	for (size_t i = 0; i < images.size(); i++) {
+		if (spIndexIsDeleted(index.get(), images[i])) {
+			continue;
+		}
+		if (spIndexDelete(index.get(), images[i]) != SP_INDEX_SUCCESS) {
+			response = DELETE_ERROR;
+			return false;
+		}
+		(*deletedAmount)++;
+	}
+	response = RESPONSE_OK;
+	return true;
+}
+
+bool sp::QueryServer::getImagePath(int image, char* imagePath) {
+	if (image < imagesAmount) {
+		return spConfigGetImagePath(imagePath, config, image) == SP_CONFIG_SUCCESS;
+	}
+	std::lock_guard<std::mutex> lock(insertedMutex);
+	std::map<int, std::string>::const_iterator inserted = insertedPaths.find(image);
+	if (inserted == insertedPaths.end() || inserted->second.size() >= STRING_LENGTH) {
+		return false;
+	}
+	strcpy(imagePath, inserted->second.c_str());
+	return true;
+}
+
+bool sp::QueryServer::startReload(std::string& response) {
+	std::lock_guard<std::mutex> lock(reloadMutex);
+	if (reloading) {
+		response = RELOAD_RUNNING_ERROR;
+		return false;
+	}
+	// The previous reload is done, its thread only has to return
+	if (reloader.joinable()) {
+		reloader.join();
+	}
+	reloading = true;
+	reloader = std::thread(&QueryServer::reloadIndex, this);
+	response = RESPONSE_OK;
+	return true;
+}
+
+void sp::QueryServer::reloadIndex() {
+	char infoMSG[STRING_LENGTH] = { '\0' };
+	Clock::time_point start = Clock::now();
+	SPIndex loaded = IndexLoader(config, imgProc, storeType, featureDim).load();
+	if (loaded != NULL && replayChanges(loaded)) {
+		snprintf(infoMSG, sizeof(infoMSG), RELOAD_INFO,
+				std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+		spLoggerPrintInfo(infoMSG);
+	} else {
+		spLoggerPrintWarning(RELOAD_WARNING, __FILE__, __func__, __LINE__);
+	}
+	std::lock_guard<std::mutex> lock(reloadMutex);
+	reloading = false;
+}
+
+bool sp::QueryServer::replayChanges(SPIndex loaded) {
+	std::map<int, std::string> inserted;
+	std::map<int, SPPointStore> features;
+	bool replayed = true;
+	{
+		std::lock_guard<std::mutex> lock(insertedMutex);
+		inserted = insertedPaths;
+	}
+	// The features of the images inserted so far are extracted off the lock,
+	// so inserts and queries of inserted images go on meanwhile
+	for (std::map<int, std::string>::const_iterator image = inserted.begin();
+			image != inserted.end(); ++image) {
+		features[image->first] = getImageFeatures(image->second);
+	}
+	{
+		std::lock_guard<std::mutex> lock(insertedMutex);
+		IndexSnapshot current = indexes.acquire();
+		// The inserted images get the same indexes in the loaded index, as
+		// they're inserted in the same order after the same database images
+		for (std::map<int, std::string>::const_iterator image = insertedPaths.begin();
+				replayed && image != insertedPaths.end(); ++image) {
+			SPPointStore& store = features[image->first];
+			if (store == NULL) {
+				store = getImageFeatures(image->second);
+			}
+			int imageIndex = -1;
+			replayed = store != NULL
+					&& spIndexInsert(loaded, store, &imageIndex) == SP_INDEX_SUCCESS
+					&& imageIndex == image->first;
+		}
+		SP_INDEX_MSG indexMsg;
+		SPBitset deleted = spIndexCopyDeleted(current.get(), &indexMsg);
+		replayed = replayed && indexMsg == SP_INDEX_SUCCESS;
+		for (int i = 0; replayed && i < spIndexGetImagesAmount(current.get()); i++) {
+			if (spBitsetContains(deleted, i)) {
+				replayed = spIndexDelete(loaded, i) == SP_INDEX_SUCCESS;
+			}
+		}
+		spBitsetDestroy(deleted);
+		if (replayed) {
+			indexes.publish(loaded);
+		}
+	}
+	for (std::map<int, SPPointStore>::iterator image = features.begin();
+			image != features.end(); ++image) {
+		spPointStoreDestroy(image->second);
+	}
+	if (!replayed) {
+		spIndexDestroy(loaded);
+	}
+	return replayed;
+}
+
+SPPointStore sp::QueryServer::getQueryFeatures(const char* imagePath,
+		const unsigned long long* hash) {
+	int queryFeaturesAmount;
+	SP_POINT_STORE_MSG storeMsg;
+	SPPointStore queryStore = NULL;
+	if (hash != NULL && (queryStore = spQueryCacheGetFeatures(cache, *hash)) != NULL) {
+		return queryStore;
+	}
+	static thread_local std::vector<float> queryFeatures;
+	if (!imgProc->getImageFeatures(imagePath, 0, queryFeatures,
+			&queryFeaturesAmount, true)) {
+		return NULL;
+	}
+	queryStore = spPointStoreCreateFromFloats(storeType, queryFeatures.data(),
+			queryFeaturesAmount, featureDim, 0, &storeMsg);
+	if (queryStore != NULL && hash != NULL) {
+		spQueryCachePutFeatures(cache, *hash, queryStore);
+	}
+	return queryStore;
+}
+
+void sp::QueryServer::stop() {
+	stopping = true;
+	// Wakes the accepting thread, which is blocked in accept
+	shutdown(listenFd, SHUT_RDWR);
+}
+
+bool sp::QueryServer::sendResponse(int fd, const std::string& response) {
+	unsigned char header[4];
+	size_t length = response.size();
+	header[0] = (unsigned char) (length >> 24);
+	header[1] = (unsigned char) (length >> 16);
+	header[2] = (unsigned char) (length >> 8);
+	header[3] = (unsigned char) length;
+	std::string message((const char*) header, sizeof(header));
+	message += response;
+	size_t sent = 0;
+	while (sent < message.size()) {
+		// A client which went away mustn't kill the server by SIGPIPE
+		ssize_t amount = send(fd, message.data() + sent, message.size() - sent,
+				MSG_NOSIGNAL);
+		if (amount < 0 && errno == EINTR) {
+			continue;
+		}
+		if (amount <= 0) {
+			return false;
+		}
+		sent += (size_t) amount;
+	}
+	return true;
+}
+
+bool sp::QueryServer::run() {
+	char infoMSG[2 * STRING_LENGTH] = { '\0' };
+	std::vector<std::thread> workers;
+	if (!listenOnSocket()) {
+		return false;
+	}
+	snprintf(infoMSG, sizeof(infoMSG), LISTENING_INFO, socketPath.c_str(),
+			numOfWorkers, (int) admissionQueue->getCapacity());
+	spLoggerPrintInfo(infoMSG);
+
+	for (int i = 0; i < numOfWorkers; i++) {
+		workers.push_back(std::thread(&QueryServer::workerLoop, this));
+	}
+	acceptConnections();
+	// The admitted requests are still answered, then the workers stop
+	admissionQueue->close();
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+	// No reload starts once the workers stopped
+	if (reloader.joinable()) {
+		reloader.join();
+	}
+	close(listenFd);
+	listenFd = -1;
+	unlink(socketPath.c_str());
+
+	snprintf(infoMSG, sizeof(infoMSG), STOPPED_INFO, (int) servedAmount,
+			(int) rejectedAmount);
+	spLoggerPrintInfo(infoMSG);
+	if (batcher->getBatchesAmount() > 0) {
+		snprintf(infoMSG, sizeof(infoMSG), BATCH_INFO, batcher->getBatchesAmount(),
+				batcher->getAverageBatchSize());
+		spLoggerPrintInfo(infoMSG);
+	}
+	return true;
+}
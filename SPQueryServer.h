@@ -0,0 +1,164 @@
+#ifndef SPQUERYSERVER_H_
+#define SPQUERYSERVER_H_
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "SPBoundedQueue.h"
+#include "SPQueryBatcher.h"
+#include "SPImageProc.h"
+#include "SPIndexHolder.h"
+
+extern "C" {
+#include "SPConfig.h"
+#include "SPPointStore.h"
+#include "SPIndex.h"
+#include "SPQueryCache.h"
+#include "SPBitset.h"
+}
+
+namespace sp {
+
+/**
+ * Answers queries sent over a Unix domain socket, so the configuration, the
+ * features and the index are loaded once and serve many queries instead of
+ * one process per query.
+ *
+ * A client connects to spServerSocketPath and sends a single request line:
+ *     <image path> [spKNN=<k>] [spNumOfSimilarImages=<n>] [spImageFilter=<ids>]
+ * where the optional fields override the configured values for this query
+ * only. spImageFilter restricts the query to a subset of the images, given
+ * by their indexes as a comma separated list of indexes and inclusive
+ * ranges, e.g. "0-99,250,300-349": only the features of those images are
+ * searched, and at most spNumOfSimilarImages of them are answered.
+ *
+ * The server answers with a 4 byte big endian length followed by that many
+ * bytes of response, and closes the connection. The response is either
+ *     OK
+ *     <the path of the most similar image>
+ *     ...
+ * with one image per line, or
+ *     ERROR <the reason>
+ * A request of the exit input "<>" stops the server.
+ *
+ * A request
+ *     INSERT <image path>
+ * inserts the image into the running index instead, see spIndexInsert, so
+ * the queries which follow may find it. It's answered with OK alone. The
+ * results of later queries name an inserted image by the path it was
+ * inserted with. A request
+ *     DELETE <image path>
+ * deletes every image of that path, of the database or inserted, from the
+ * running index, see spIndexDelete, so the queries which follow don't find
+ * it. It's answered with OK alone, also if its images were deleted before,
+ * or with an error if no image of the index has that path.
+ *
+ * A request
+ *     RELOAD
+ * loads a new index of the database in the background, see IndexLoader, and
+ * is answered with OK right away, or with an error if a reload is already
+ * running. The images inserted and deleted so far are inserted and deleted
+ * in the new index too, and then it replaces the running index by an atomic
+ * swap: the queries in flight finish on the index they started with, which
+ * is destroyed once they're done, so no query fails or waits because of a
+ * reload. The features or the .feats files may thus be rebuilt while the
+ * server runs.
+ *
+ * Accepted connections wait in an admission queue of spServerQueueSize
+ * connections and are handled by a fixed pool of spServerWorkers threads.
+ * A connection which arrives while the queue is full is answered with an
+ * error right away, so the work in flight and the memory it takes stay
+ * bounded however many clients connect.
+ *
+ * The queries which the workers solve within spBatchWindow microseconds of
+ * each other are searched as one batch of up to spMaxBatchSize queries, which
+ * serves more queries per second at the cost of that much added latency.
+ *
+ * Given a query cache, a query image which was sent before is answered from
+ * the cache, skipping its search, or at least the extraction of its features.
+ * A filtered query is always searched, since its result depends on the filter.
+ */
+class QueryServer {
+private:
+	enum RequestType {
+		QUERY_REQUEST, INSERT_REQUEST, DELETE_REQUEST, RELOAD_REQUEST
+	};
+	SPConfig config;
+	ImageProc* imgProc;
+	IndexHolder indexes;
+	SPQueryCache cache;
+	SP_POINT_STORE_TYPE storeType;
+	int featureDim;
+	int imagesAmount;
+	int knn;
+	int numOfSimilarImages;
+	int numOfWorkers;
+	int listenFd;
+	std::string socketPath;
+	std::unique_ptr<BoundedQueue<int> > admissionQueue;
+	std::unique_ptr<QueryBatcher> batcher;
+	std::mutex insertedMutex;
+	std::map<int, std::string> insertedPaths;
+	std::mutex reloadMutex;
+	std::thread reloader;
+	bool reloading;
+	std::atomic<bool> stopping;
+	std::atomic<int> servedAmount;
+	std::atomic<int> rejectedAmount;
+	bool listenOnSocket();
+	void acceptConnections();
+	void workerLoop();
+	void handleConnection(int fd);
+	bool readRequest(int fd, std::string& request);
+	bool parseRequest(const std::string& request, std::string& imagePath,
+			RequestType* type, int* k, int* numOfSimilar, SPBitset* filter,
+			std::string& error);
+	bool parseFilter(const char* ids, SPBitset filter);
+	bool serveRequest(RequestType type, const std::string& imagePath, int k,
+			int numOfSimilar, SPBitset filter, int* image, std::string& response);
+	bool solveQuery(const std::string& imagePath, int k, int numOfSimilar,
+			SPBitset filter, std::string& response);
+	bool insertImage(const std::string& imagePath, int* image, std::string& response);
+	SPPointStore getImageFeatures(const std::string& imagePath);
+	bool deleteImage(const std::string& imagePath, int* deletedAmount,
+			std::string& response);
+	bool getImagePath(int image, char* imagePath);
+	bool startReload(std::string& response);
+	void reloadIndex();
+	bool replayChanges(SPIndex loaded);
+	SPPointStore getQueryFeatures(const char* imagePath, const unsigned long long* hash);
+	void stop();
+	static bool sendResponse(int fd, const std::string& response);
+public:
+
+	/**
+	 * Creates a new server of the queries to an index, based on the
+	 * configuration file.
+	 * @param config - the configuration file
+	 * @param imgProc - the image processor used to extract the features of
+	 * 					the query images
+	 * @param index - the index of the features of the database, which the
+	 * 				  server owns from now on
+	 * @param cache - the cache of the queries, NULL if they aren't cached
+	 * @param storeType - the type of the stores of the query features
+	 * @param featureDim - the dimension of the features
+	 */
+	QueryServer(const SPConfig config, ImageProc* imgProc, SPIndex index,
+			SPQueryCache cache, SP_POINT_STORE_TYPE storeType, int featureDim);
+
+	/**
+	 * Listens on the socket and answers requests until a client sends the
+	 * exit input. Requests which were already admitted are answered, and a
+	 * reload which is running is done, before the function returns, and the
+	 * socket file is removed.
+	 * @return
+	 * true if the server stopped by request, false if the socket couldn't
+	 * be set up.
+	 */
+	bool run();
+};
+
+}
+#endif
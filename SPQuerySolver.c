@@ -17,51 +17,224 @@ int imageHitsComp(const void * a, const void * b)
 	return y->index - x->index;
 }
 
-int* SPQuerySolverSolve(SPKDTreeNode kdTreeRoot, SPPoint* queryFeatures, int queryFeaturesAmount, int k, int numOfSimilar, int imagesAmount)
+/*
+ * The number of images which may be hit by a search of index which already
+ * ran: at least imagesAmount, and all the images inserted into the index.
+ */
+static int votersAmount(SPIndex index, int imagesAmount)
 {
-	int i, j;
+	int indexImages = spIndexGetImagesAmount(index);
+	return indexImages > imagesAmount ? indexImages : imagesAmount;
+}
+
+/*
+ * Counts the image hits in amount queues, which are emptied and destroyed,
+ * and fills res with the indexes of the numOfSimilar images hit the most.
+ * Images in deleted, a copy of the deleted images of the index taken after
+ * the search, or not in filter are never returned, res is padded with -1 if
+ * fewer than numOfSimilar images are left.
+ */
+static void rankByHits(SPBitset deleted, SPBPQueue* bpqs, int amount, SPImageHits* imageHits,
+		int imagesAmount, SPBitset filter, int* res, int numOfSimilar)
+{
+	int i;
+	SPListElement head;
+
+	for(i = 0; i < imagesAmount; i++)
+	{
+		imageHits[i].index = i;
+		imageHits[i].hits = 0;
+	}
+
+	// Count image hits
+	for(i = 0; i < amount; i++)
+	{
+		while(!spBPQueueIsEmpty(bpqs[i]))
+		{
+			head = spBPQueuePeek(bpqs[i]);
+			imageHits[spListElementGetIndex(head)].hits += 1;
+			spListElementDestroy(head);
+			spBPQueueDequeue(bpqs[i]);
+		}
+		spBPQueueDestroy(bpqs[i]);
+	}
+	for(i = 0; i < imagesAmount; i++)
+	{
+		if((filter && !spBitsetContains(filter, i)) || spBitsetContains(deleted, i))
+			imageHits[i].hits = -1;
+	}
+
+	// Sort by hits
+	qsort(imageHits, imagesAmount, sizeof(SPImageHits), imageHitsComp);
+
+	// Copy best k image indexes, the excluded images sort last
+	for(i = 0; i < numOfSimilar; i++)
+		res[i] = i < imagesAmount && imageHits[i].hits >= 0 ? imageHits[i].index : -1;
+}
+
+int* SPQuerySolverSolve(SPIndex index, SPPointStore queryFeatures, int k, int numOfSimilar, int imagesAmount,
+		SPBitset filter)
+{
+	int i, amount;
 	int* res;
 	SPImageHits* imageHits;
-	int* nearestNeighbours;
-	SP_KDTREE_MSG kdTreeMsg;
+	SPBPQueue* bpqs;
+	SPBitset deleted = NULL;
+	SP_INDEX_MSG indexMsg;
+	bool failed = false;
 	
 	res = (int*)malloc(numOfSimilar * sizeof(int));
+	// A bag of words index ranks the images itself, without nearest features
+	if(res && spIndexGetType(index) == SP_INDEX_BAG_OF_WORDS)
+	{
+		if(spIndexRankImages(index, queryFeatures, imagesAmount, numOfSimilar, filter, res) == SP_INDEX_SUCCESS)
+			return res;
+		free(res);
+		return NULL;
+	}
+
+	amount = spPointStoreGetSize(queryFeatures);
+	bpqs = (SPBPQueue*)calloc(amount > 0 ? amount : 1, sizeof(SPBPQueue));
+	for(i = 0; bpqs && i < amount; i++)
+	{
+		bpqs[i] = spBPQueueCreate(k);
+		failed = failed || !bpqs[i];
+		// Features of the filtered out images never enter the queues
+		spBPQueueSetAllowed(bpqs[i], filter);
+	}
+	// The nearest features to all the query features are searched at once
+	if(res && bpqs && !failed)
+		failed = spIndexKNNAll(index, queryFeatures, bpqs) != SP_INDEX_SUCCESS;
+	// The images deleted by now are ranked out under a single lock of the index
+	if(res && bpqs && !failed)
+	{
+		deleted = spIndexCopyDeleted(index, &indexMsg);
+		failed = indexMsg != SP_INDEX_SUCCESS;
+	}
+	// Images inserted into the index vote too, all those found are counted
+	// as the number of images only grows
+	imagesAmount = votersAmount(index, imagesAmount);
 	imageHits = (SPImageHits*)malloc(imagesAmount * sizeof(SPImageHits));
-	if(!res || !imageHits)
+	if(!res || !imageHits || !bpqs || failed)
 	{
 		free(res);
 		free(imageHits);
+		for(i = 0; bpqs && i < amount; i++)
+			spBPQueueDestroy(bpqs[i]);
+		free(bpqs);
+		spBitsetDestroy(deleted);
 		return NULL;
 	}
 
-	for(i = 0; i < imagesAmount; i++)
+	rankByHits(deleted, bpqs, amount, imageHits, imagesAmount, filter, res, numOfSimilar);
+	free(bpqs);
+	free(imageHits);
+	spBitsetDestroy(deleted);
+
+	return res;
+}
+
+int** SPQuerySolverSolveBatch(SPIndex index, SPPointStore* queryFeatures, const int* k,
+		const int* numOfSimilar, int queriesAmount, int imagesAmount, const SPBitset* filters)
+{
+	int i, j, row, amount = 0;
+	int** res;
+	SPImageHits* imageHits;
+	SPBPQueue* bpqs;
+	SPPointStore batch;
+	SPBitset deleted = NULL;
+	SP_POINT_STORE_MSG storeMsg;
+	SP_INDEX_MSG indexMsg;
+	SP_POINT_STORE_TYPE type;
+	bool failed = false;
+
+	res = (int**)calloc(queriesAmount > 0 ? queriesAmount : 1, sizeof(int*));
+	if(!res)
+		return NULL;
+	// A bag of words index ranks the images of every query by itself
+	if(spIndexGetType(index) == SP_INDEX_BAG_OF_WORDS)
 	{
-		imageHits[i].index = i;
-		imageHits[i].hits = 0;
+		for(i = 0; i < queriesAmount && !failed; i++)
+		{
+			res[i] = SPQuerySolverSolve(index, queryFeatures[i], k[i], numOfSimilar[i], imagesAmount,
+					filters ? filters[i] : NULL);
+			failed = !res[i];
+		}
+		if(!failed)
+			return res;
+		for(i = 0; i < queriesAmount; i++)
+			free(res[i]);
+		free(res);
+		return NULL;
 	}
 
-	// Count image hits
-	for(i = 0; i < queryFeaturesAmount; i++)
+	// The features of all the queries are gathered into one store, the image
+	// index of every feature there is the query it belongs to
+	type = spPointStoreGetType(queryFeatures[0]);
+	for(i = 0; i < queriesAmount; i++)
+		amount += spPointStoreGetSize(queryFeatures[i]);
+	batch = spPointStoreCreate(type, spPointStoreGetDim(queryFeatures[0]), amount, &storeMsg);
+	for(i = 0; batch && i < queriesAmount && !failed; i++)
 	{
-		nearestNeighbours = SPKDTreeKNN(kdTreeRoot, queryFeatures[i], k, &kdTreeMsg);
-		if(kdTreeMsg != SP_KDTREE_SUCCESS)
+		for(j = 0; j < spPointStoreGetSize(queryFeatures[i]) && !failed; j++)
 		{
-			free(res);
-			free(imageHits);
-			return NULL;
+			if(type == SP_POINT_STORE_REAL)
+				storeMsg = spPointStoreAddReal(batch, spPointStoreGetRealRow(queryFeatures[i], j), i);
+			else
+				storeMsg = spPointStoreAddBinary(batch, spPointStoreGetBinaryRow(queryFeatures[i], j), i);
+			failed = storeMsg != SP_POINT_STORE_SUCCESS;
 		}
-		for(j = 0; j < k; j++)
-			imageHits[nearestNeighbours[j]].hits += 1;
-		free(nearestNeighbours);
 	}
+	bpqs = (SPBPQueue*)calloc(amount > 0 ? amount : 1, sizeof(SPBPQueue));
+	for(i = 0; batch && bpqs && i < amount; i++)
+	{
+		bpqs[i] = spBPQueueCreate(k[spPointStoreGetImageIndex(batch, i)]);
+		failed = failed || !bpqs[i];
+		if(filters)
+			spBPQueueSetAllowed(bpqs[i], filters[spPointStoreGetImageIndex(batch, i)]);
+	}
+	for(i = 0; i < queriesAmount && !failed; i++)
+	{
+		res[i] = (int*)malloc(numOfSimilar[i] * sizeof(int));
+		failed = !res[i];
+	}
+	// The nearest features to the features of all the queries are searched at once
+	if(batch && bpqs && !failed)
+		failed = spIndexKNNAll(index, batch, bpqs) != SP_INDEX_SUCCESS;
+	// One copy of the deleted images ranks all the queries
+	if(batch && bpqs && !failed)
+	{
+		deleted = spIndexCopyDeleted(index, &indexMsg);
+		failed = indexMsg != SP_INDEX_SUCCESS;
+	}
+	imagesAmount = votersAmount(index, imagesAmount);
+	imageHits = (SPImageHits*)malloc(imagesAmount * sizeof(SPImageHits));
+	if(!batch || !imageHits || !bpqs || failed)
+	{
+		for(i = 0; i < queriesAmount; i++)
+			free(res[i]);
+		free(res);
+		free(imageHits);
+		for(i = 0; bpqs && i < amount; i++)
+			spBPQueueDestroy(bpqs[i]);
+		free(bpqs);
+		spPointStoreDestroy(batch);
+		spBitsetDestroy(deleted);
+		return NULL;
+	}
+	spPointStoreDestroy(batch);
 
-	// Sort by hits
-	qsort(imageHits, imagesAmount, sizeof(SPImageHits), imageHitsComp);
-
-	// Copy best k image indexes
-	for(i = 0; i < numOfSimilar; i++)
-		res[i] = imageHits[i].index;
+	// Every query votes with the queues of its own features
+	for(i = 0, row = 0; i < queriesAmount; i++)
+	{
+		amount = spPointStoreGetSize(queryFeatures[i]);
+		rankByHits(deleted, bpqs + row, amount, imageHits, imagesAmount, filters ? filters[i] : NULL,
+				res[i], numOfSimilar[i]);
+		row += amount;
+	}
+	free(bpqs);
 	free(imageHits);
+	spBitsetDestroy(deleted);
 
 	return res;
 }
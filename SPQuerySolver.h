@@ -1,8 +1,8 @@
 #ifndef SPQUERYSOLVER_H_
 #define SPQUERYSOLVER_H_
 
-#include "SPPoint.h"
-#include "SPKDTree.h"
+#include "SPPointStore.h"
+#include "SPIndex.h"
 
 typedef struct sp_image_hits_t SPImageHits;
 
@@ -16,20 +16,52 @@ typedef struct sp_image_hits_t SPImageHits;
 int imageHitsComp(const void * a, const void * b);
 
 /*
- * Given a query and a kdTree containing all the features in the database,
+ * Given a query and an index containing all the features in the database,
  * For each query feature we find the k nearest features, the function returns the
  * image indexes of the images that their features were part of the k nearest features the most.
+ * Images inserted into the index by spIndexInsert are voted for like those of the database.
+ * Images deleted from the index by spIndexDelete are never returned. If fewer than
+ * 'numOfSimilar' images are left, the result ends with -1 entries.
+ * Given a filter, only the images in it are searched and voted for: the features of other
+ * images never enter the k nearest, so the whole budget of k goes to the images in the
+ * filter, and they're never returned.
+ * A BAG_OF_WORDS index ranks the images by their visual words instead, and k isn't used.
  *
  *
- * @param kdTreeRoot - the kdTree containing all the features in the database
- * @param queryFeatures - the features that represent the query
- * @param queryFeaturesAmount - the length of 'queryFeatures'
+ * @param index - the index containing all the features in the database
+ * @param queryFeatures - the features that represent the query, a store of the
+ * 						  same type and dimension as the index's store
  * @param k - the k in 'k nearest neighbors'
  * @param numOfSimilar - the number of similar images to return as result
  * @param imagesAmount - the amount of images in the database
- * @return  An array of the indexes of the 'numOfSimilar' most similar images - On success
+ * @param filter - the indexes of the images to search, NULL searches all of them
+ * @return  An array of the indexes of the 'numOfSimilar' most similar images, padded with
+ * 			-1 if fewer images may be returned - On success
 			NULL - If an error occurred
 */
-int* SPQuerySolverSolve(SPKDTreeNode kdTreeRoot, SPPoint* queryFeatures, int queryFeaturesAmount, int k, int numOfSimilar, int imagesAmount);
+int* SPQuerySolverSolve(SPIndex index, SPPointStore queryFeatures, int k, int numOfSimilar, int imagesAmount,
+		SPBitset filter);
+
+/*
+ * Solves several queries at once, as SPQuerySolverSolve solves every one of
+ * them. The features of all the queries are searched by a single
+ * spIndexKNNAll, so an index which searches many features faster than one by
+ * one serves a batch of small queries faster than each query alone.
+ *
+ * @param index - the index containing all the features in the database
+ * @param queryFeatures - the features of every query, stores of the same type
+ * 						  and dimension as the index's store
+ * @param k - the k in 'k nearest neighbors' of every query
+ * @param numOfSimilar - the number of similar images to return for every query
+ * @param queriesAmount - the number of queries, at least 1
+ * @param imagesAmount - the amount of images in the database
+ * @param filters - the filter of every query, see SPQuerySolverSolve, NULL if no query
+ * 					is filtered
+ * @return  An array of queriesAmount arrays, the ith of the indexes of the
+ * 			'numOfSimilar[i]' most similar images to the ith query - On success
+			NULL - If an error occurred
+*/
+int** SPQuerySolverSolveBatch(SPIndex index, SPPointStore* queryFeatures, const int* k,
+		const int* numOfSimilar, int queriesAmount, int imagesAmount, const SPBitset* filters);
 
 #endif /* SPQUERYSOLVER_H_ */
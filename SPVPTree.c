@@ -0,0 +1,305 @@
+#include <math.h>
+#include "SPVPTree.h"
+
+#define LEAF_SIZE 8
+#define VANTAGE_CANDIDATES 5
+#define SPREAD_SAMPLE 32
+#define MIN_NODES_CAPACITY 64
+#define VANTAGE_SEED 0x2545F4914F6CDD1DULL
+
+typedef struct sp_vp_tree_node_t
+{
+	int vantage;  // the vantage row, -1 for a leaf
+	double radius;
+	int inside;   // the node of the rows within the radius
+	int outside;  // the node of the rows beyond it
+	int first;    // a leaf's rows are rows[first] to rows[first + amount - 1]
+	int amount;
+} SPVPTreeNode;
+
+struct sp_vp_tree_t
+{
+	SPPointStore store;
+	SPVPTreeNode* nodes;
+	int nodesAmount;
+	int nodesCapacity;
+	int* rows;
+	double* distances;        // while building, the distance of every row from the vantage
+	unsigned long long state; // while building, the state of the random generator
+};
+
+/*
+ * The metric between a row of store and a row of other: the L2 distance for
+ * REAL stores, whose spPointStoreDistance is squared, the Hamming distance
+ * for BINARY stores.
+ */
+static double metric(SPPointStore store, int row, SPPointStore other, int otherRow)
+{
+	double distance = spPointStoreDistance(store, row, other, otherRow);
+	return spPointStoreGetType(store) == SP_POINT_STORE_REAL ? sqrt(distance) : distance;
+}
+
+/*
+ * A random number in [0, bound), by a xorshift64* generator.
+ */
+static int nextRandom(SPVPTree tree, int bound)
+{
+	tree->state ^= tree->state >> 12;
+	tree->state ^= tree->state << 25;
+	tree->state ^= tree->state >> 27;
+	return (int) (((tree->state * 0x2545F4914F6CDD1DULL) >> 33) % (unsigned long long) bound);
+}
+
+static void swapRows(SPVPTree tree, int i, int j)
+{
+	int row = tree->rows[i];
+	double distance = tree->distances[i];
+	tree->rows[i] = tree->rows[j];
+	tree->distances[i] = tree->distances[j];
+	tree->rows[j] = row;
+	tree->distances[j] = distance;
+}
+
+/*
+ * Appends a node, returns it or -1 on an allocation failure.
+ */
+static int addNode(SPVPTree tree)
+{
+	int capacity;
+	SPVPTreeNode* nodes;
+	if (tree->nodesAmount == tree->nodesCapacity)
+	{
+		capacity = tree->nodesCapacity < MIN_NODES_CAPACITY ?
+				MIN_NODES_CAPACITY : 2 * tree->nodesCapacity;
+		nodes = (SPVPTreeNode*) realloc(tree->nodes, capacity * sizeof(SPVPTreeNode));
+		if (nodes == NULL)
+			return -1;
+		tree->nodes = nodes;
+		tree->nodesCapacity = capacity;
+	}
+	return tree->nodesAmount++;
+}
+
+/*
+ * The position, between first and first + amount - 1, of the vantage row:
+ * the sampled candidate whose distances from a sample of the rows have the
+ * largest variance, so its median splits the rows best.
+ */
+static int selectVantage(SPVPTree tree, int first, int amount)
+{
+	int c, s, candidate, sample, best = first;
+	int candidates = amount < VANTAGE_CANDIDATES ? amount : VANTAGE_CANDIDATES;
+	int samples = amount < SPREAD_SAMPLE ? amount : SPREAD_SAMPLE;
+	double distance, sum, squares, spread, bestSpread = -1;
+	for (c = 0; c < candidates; c++)
+	{
+		candidate = first + nextRandom(tree, amount);
+		sum = 0;
+		squares = 0;
+		for (s = 0; s < samples; s++)
+		{
+			sample = first + nextRandom(tree, amount);
+			distance = metric(tree->store, tree->rows[candidate], tree->store,
+					tree->rows[sample]);
+			sum += distance;
+			squares += distance * distance;
+		}
+		spread = squares / samples - (sum / samples) * (sum / samples);
+		if (spread > bestSpread)
+		{
+			bestSpread = spread;
+			best = candidate;
+		}
+	}
+	return best;
+}
+
+/*
+ * Reorders the rows between low and high so that the one at position k has
+ * the kth smallest distance, the nearer ones before it and the farther after.
+ */
+static void selectMedian(SPVPTree tree, int low, int high, int k)
+{
+	int i, store;
+	double pivot;
+	while (low < high)
+	{
+		swapRows(tree, low + nextRandom(tree, high - low + 1), high);
+		pivot = tree->distances[high];
+		for (i = low, store = low; i < high; i++)
+			if (tree->distances[i] < pivot)
+				swapRows(tree, i, store++);
+		swapRows(tree, store, high);
+		if (store == k)
+			return;
+		if (store < k)
+			low = store + 1;
+		else
+			high = store - 1;
+	}
+}
+
+/*
+ * Builds the node of the rows between first and first + amount - 1.
+ * Returns the node or -1 on an allocation failure.
+ */
+static int buildNode(SPVPTree tree, int first, int amount)
+{
+	int i, median, inside, outside, node = addNode(tree);
+	if (node < 0)
+		return -1;
+	tree->nodes[node].first = first;
+	tree->nodes[node].amount = amount;
+	if (amount <= LEAF_SIZE)
+	{
+		tree->nodes[node].vantage = -1;
+		return node;
+	}
+
+	swapRows(tree, first, selectVantage(tree, first, amount));
+	for (i = first + 1; i < first + amount; i++)
+		tree->distances[i] = metric(tree->store, tree->rows[i], tree->store, tree->rows[first]);
+	// The median and the nearer rows are inside
+	median = (amount - 1) / 2;
+	selectMedian(tree, first + 1, first + amount - 1, first + median);
+	tree->nodes[node].vantage = tree->rows[first];
+	tree->nodes[node].radius = tree->distances[first + median];
+	inside = buildNode(tree, first + 1, median);
+	outside = inside < 0 ? -1 : buildNode(tree, first + 1 + median, amount - 1 - median);
+	if (outside < 0)
+		return -1;
+	tree->nodes[node].inside = inside;
+	tree->nodes[node].outside = outside;
+	return node;
+}
+
+SPVPTree spVPTreeCreate(SPPointStore store, SP_VP_TREE_MSG* msg)
+{
+	SPVPTree tree;
+	int i, size;
+	assert(msg != NULL);
+	if (store == NULL)
+	{
+		*msg = SP_VP_TREE_INVALID_ARGUMENT;
+		return NULL;
+	}
+	tree = (SPVPTree) calloc(1, sizeof(*tree));
+	if (tree == NULL)
+	{
+		*msg = SP_VP_TREE_ALLOC_FAIL;
+		return NULL;
+	}
+	size = spPointStoreGetSize(store);
+	tree->store = store;
+	tree->state = VANTAGE_SEED;
+	tree->rows = (int*) malloc((size > 0 ? size : 1) * sizeof(int));
+	tree->distances = (double*) malloc((size > 0 ? size : 1) * sizeof(double));
+	if (tree->rows == NULL || tree->distances == NULL)
+	{
+		spVPTreeDestroy(tree);
+		*msg = SP_VP_TREE_ALLOC_FAIL;
+		return NULL;
+	}
+	for (i = 0; i < size; i++)
+		tree->rows[i] = i;
+	if (buildNode(tree, 0, size) < 0)
+	{
+		spVPTreeDestroy(tree);
+		*msg = SP_VP_TREE_ALLOC_FAIL;
+		return NULL;
+	}
+	free(tree->distances);
+	tree->distances = NULL;
+	*msg = SP_VP_TREE_SUCCESS;
+	return tree;
+}
+
+/*
+ * Enqueues a row into bpq unless the queue doesn't accept it or is full of
+ * nearer rows, and updates the search radius tau to the metric of the kth
+ * nearest so far.
+ */
+static SP_VP_TREE_MSG enqueueRow(SPVPTree tree, int row, SPPointStore queries,
+		int queryRow, SPBPQueue bpq, double* tau)
+{
+	SPListElement element;
+	SP_BPQUEUE_MSG bpqMsg;
+	double distance;
+	if (!spBPQueueAccepts(bpq, spPointStoreGetImageIndex(tree->store, row)))
+		return SP_VP_TREE_SUCCESS;
+	distance = spPointStoreDistance(tree->store, row, queries, queryRow);
+	if (spBPQueueIsFull(bpq) && distance >= spBPQueueMaxValue(bpq))
+		return SP_VP_TREE_SUCCESS;
+	element = spListElementCreate(spPointStoreGetImageIndex(tree->store, row), distance);
+	if (element == NULL)
+		return SP_VP_TREE_ALLOC_FAIL;
+	bpqMsg = spBPQueueEnqueue(bpq, element);
+	spListElementDestroy(element);
+	if (bpqMsg == SP_BPQUEUE_OUT_OF_MEMORY)
+		return SP_VP_TREE_ALLOC_FAIL;
+	if (spBPQueueIsFull(bpq))
+		*tau = spPointStoreGetType(tree->store) == SP_POINT_STORE_REAL ?
+				sqrt(spBPQueueMaxValue(bpq)) : spBPQueueMaxValue(bpq);
+	return SP_VP_TREE_SUCCESS;
+}
+
+/*
+ * Searches the subtree of node. By the triangle inequality, a row inside is
+ * at least distance - radius from the query and a row outside at least
+ * radius - distance, so a side is skipped when that's beyond tau.
+ */
+static SP_VP_TREE_MSG searchNode(SPVPTree tree, int node, SPPointStore queries, int row,
+		SPBPQueue bpq, double* tau)
+{
+	int i;
+	double distance;
+	const SPVPTreeNode* current = tree->nodes + node;
+	SP_VP_TREE_MSG msg = SP_VP_TREE_SUCCESS;
+	if (current->vantage < 0)
+	{
+		for (i = 0; i < current->amount && msg == SP_VP_TREE_SUCCESS; i++)
+			msg = enqueueRow(tree, tree->rows[current->first + i], queries, row, bpq, tau);
+		return msg;
+	}
+	distance = metric(tree->store, current->vantage, queries, row);
+	msg = enqueueRow(tree, current->vantage, queries, row, bpq, tau);
+	if (distance < current->radius)
+	{
+		if (msg == SP_VP_TREE_SUCCESS && distance - current->radius <= *tau)
+			msg = searchNode(tree, current->inside, queries, row, bpq, tau);
+		if (msg == SP_VP_TREE_SUCCESS && current->radius - distance <= *tau)
+			msg = searchNode(tree, current->outside, queries, row, bpq, tau);
+	}
+	else
+	{
+		if (msg == SP_VP_TREE_SUCCESS && current->radius - distance <= *tau)
+			msg = searchNode(tree, current->outside, queries, row, bpq, tau);
+		if (msg == SP_VP_TREE_SUCCESS && distance - current->radius <= *tau)
+			msg = searchNode(tree, current->inside, queries, row, bpq, tau);
+	}
+	return msg;
+}
+
+SP_VP_TREE_MSG spVPTreeKNN(SPVPTree tree, SPPointStore queries, int row, SPBPQueue bpq)
+{
+	double tau = HUGE_VAL;
+	if (tree == NULL || queries == NULL || bpq == NULL || row < 0
+			|| row >= spPointStoreGetSize(queries)
+			|| spPointStoreGetType(queries) != spPointStoreGetType(tree->store)
+			|| spPointStoreGetDim(queries) != spPointStoreGetDim(tree->store))
+		return SP_VP_TREE_INVALID_ARGUMENT;
+	if (spBPQueueIsFull(bpq))
+		tau = spPointStoreGetType(tree->store) == SP_POINT_STORE_REAL ?
+				sqrt(spBPQueueMaxValue(bpq)) : spBPQueueMaxValue(bpq);
+	return searchNode(tree, 0, queries, row, bpq, &tau);
+}
+
+void spVPTreeDestroy(SPVPTree tree)
+{
+	if (tree == NULL)
+		return;
+	free(tree->nodes);
+	free(tree->rows);
+	free(tree->distances);
+	free(tree);
+}
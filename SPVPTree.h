@@ -0,0 +1,83 @@
+#ifndef SPVPTREE_H_
+#define SPVPTREE_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "SPPointStore.h"
+#include "SPBPriorityQueue.h"
+
+/**
+ * SP VP-Tree summary
+ * An exact k nearest neighbours index over a metric (Yianilos, "Data
+ * Structures and Algorithms for Nearest Neighbor Search in General Metric
+ * Spaces"): L2 over a REAL store, Hamming over a BINARY store.
+ *
+ * Every node picks a vantage row and splits the other rows by the median of
+ * their distances from it, the node's radius: the nearer half goes inside,
+ * the farther outside. The vantage row is the one of a few sampled
+ * candidates whose distances to a sample of the rows spread the most, so the
+ * split doesn't depend on the axes like a KD-Tree's. Nodes of few rows are
+ * leaves, and the rows of every leaf are stored contiguously.
+ *
+ * A search visits the side of the query first, and the other side only if
+ * the triangle inequality allows a row there nearer than the kth nearest
+ * found so far.
+ *
+ * The tree refers to the rows of the store, which must outlive it.
+ * Searching is thread safe.
+ *
+ * The following functions are supported:
+ * spVPTreeCreate  - Builds a tree over a store
+ * spVPTreeKNN     - Finds the nearest features to a query feature
+ * spVPTreeDestroy - Frees all resources associated with a tree
+ */
+
+typedef enum sp_vp_tree_msg_t {
+	SP_VP_TREE_INVALID_ARGUMENT,
+	SP_VP_TREE_ALLOC_FAIL,
+	SP_VP_TREE_SUCCESS
+} SP_VP_TREE_MSG;
+
+typedef struct sp_vp_tree_t* SPVPTree;
+
+/**
+ * Builds a tree over all the rows of store.
+ *
+ * @param store - the store, of either type
+ * @assert msg != NULL
+ * @param msg - pointer in which the msg returned by the function is stored
+ * @return NULL in case an error occurs. Otherwise, the new tree.
+ *
+ * - SP_VP_TREE_INVALID_ARGUMENT - if store == NULL
+ * - SP_VP_TREE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_VP_TREE_SUCCESS - in case of success
+ */
+SPVPTree spVPTreeCreate(SPPointStore store, SP_VP_TREE_MSG* msg);
+
+/**
+ * Enqueues the k nearest features to a query feature into bpq, where k is
+ * its maximal size. Every element's index is the image index of the feature
+ * and its value is its distance from the query feature as given by
+ * spPointStoreDistance. Only the features bpq accepts (see spBPQueueAccepts)
+ * are compared, the vantage rows are still measured to choose the sides.
+ *
+ * @param tree - the tree
+ * @param queries - a store of the same type and dimension as the tree's
+ * @param row - the row of the query feature in queries
+ * @param bpq - the queue to fill
+ * @return
+ * - SP_VP_TREE_INVALID_ARGUMENT - if tree == NULL or queries == NULL or
+ * 		bpq == NULL or row is out of range, or queries doesn't match the store
+ * - SP_VP_TREE_ALLOC_FAIL - if an allocation failure occurred
+ * - SP_VP_TREE_SUCCESS - in case of success
+ */
+SP_VP_TREE_MSG spVPTreeKNN(SPVPTree tree, SPPointStore queries, int row, SPBPQueue bpq);
+
+/**
+ * Frees all resources associated with the tree. The store isn't destroyed.
+ * If tree == NULL nothing happens.
+ */
+void spVPTreeDestroy(SPVPTree tree);
+
+#endif /* SPVPTREE_H_ */
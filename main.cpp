@@ -5,12 +5,17 @@ extern "C"
 #include "SPConfig.h"
 #include "SPPoint.h"
 #include "SPLogger.h"
-#include "SPDatabaseManager.h"
-#include "SPKDTree.h"
+#include "SPPointStore.h"
+#include "SPIndex.h"
 #include "SPQuerySolver.h"
+#include "SPQueryCache.h"
 }
 #include "SPImageProc.h"
+#include "SPIndexLoader.h"
+#include "SPQueryServer.h"
+#include "SPBatchQuerySolver.h"
 #include <string>
+#include <vector>
 
 using namespace sp;
 
@@ -27,27 +32,104 @@ using namespace sp;
 #define ERR_LOGGER_OUT_OF_MEMORY "Logger is out of memory\n"
 #define ERR_LOGGER_CANNOT_OPEN_FILE "Logger failed to open file\n"
 #define ERR_LOGGER_DEFINED "Logger is already defined\n"
-#define ERR_MEM_ALLOCATION "Memory allocation failed\n"
 #define ERR_GET_IMG_FEATS "Failed to get image features\n"
 #define ERR_GET_IMG_PATH "Failed to get image path\n"
-#define ERR_SAVE_FAILED "Failed to save features to database\n"
-#define ERR_EXTRACT_FAILED "Failed to extract image features\n"
-#define ERR_LOAD_FAILED "Failed to load image features from file\n"
 #define ERR_QUERY_FAILED "Failed to solve query\n"
+#define ERR_SERVER_FAILED "Failed to run the query server\n"
+#define ERR_BATCH_FAILED "Failed to solve the query list\n"
 
 #define MSG_ASK_FOR_QUERY "Please enter an image path:\n"
 #define MSG_BEST_CANDIDATES "Best candidates for - %s - are:\n"
 #define MSG_EXIT "Exiting..."
+#define MSG_RECALL "Recall of the index for - %s - is %.3f"
+#define WARN_RECALL_FAILED "Failed to measure the recall of the index"
+#define WARN_CACHE_FAILED "Failed to create the query cache, queries aren't cached"
+#define MSG_CACHE_STATS "Query cache: %lld feature hits, %lld feature misses, %lld result hits, %lld result misses"
 
 #define EXIT_INPUT "<>"
 #define STRING_LEN (1024)
 
+/*
+ * Extracts the features of a query image into a new store of the given type
+ * and dimension, unless the cache holds them under queryHash, which is NULL
+ * if the image has no key. Returns NULL if an error occurred.
+ */
+static SPPointStore getQueryFeatures(ImageProc* imgProc, SPQueryCache cache,
+		const unsigned long long* queryHash, const char* imagePath,
+		SP_POINT_STORE_TYPE storeType, int featureDim)
+{
+	int queryFeaturesAmount;
+	SPPointStore queryStore;
+	SP_POINT_STORE_MSG storeMsg;
+	// The projected features of every query are written into the same buffer
+	static thread_local std::vector<float> queryFeatures;
+	if(queryHash != NULL && (queryStore = spQueryCacheGetFeatures(cache, *queryHash)) != NULL)
+		return queryStore;
+	if(!imgProc->getImageFeatures(imagePath, 0, queryFeatures, &queryFeaturesAmount, true))
+		return NULL;
+	queryStore = spPointStoreCreateFromFloats(storeType, queryFeatures.data(), queryFeaturesAmount,
+			featureDim, 0, &storeMsg);
+	if(queryStore != NULL && queryHash != NULL)
+		spQueryCachePutFeatures(cache, *queryHash, queryStore);
+	return queryStore;
+}
+
+/*
+ * Solves a query as SPQuerySolverSolve does, unless the cache holds its
+ * result under queryHash, which is NULL if the image has no key.
+ */
+static int* solveQuery(SPIndex index, SPQueryCache cache, const unsigned long long* queryHash,
+		SPPointStore queryFeatures, int knn, int numOfSimilarImages, int imagesAmount)
+{
+	int* similarImages;
+	unsigned long long version = spIndexGetVersion(index);
+	if(queryHash != NULL && (similarImages = spQueryCacheGetResult(cache, *queryHash, knn,
+			numOfSimilarImages, version)) != NULL)
+		return similarImages;
+	similarImages = SPQuerySolverSolve(index, queryFeatures, knn, numOfSimilarImages, imagesAmount,
+			NULL);
+	if(similarImages != NULL && queryHash != NULL)
+		spQueryCachePutResult(cache, *queryHash, knn, numOfSimilarImages, version, similarImages);
+	return similarImages;
+}
+
+/*
+ * Logs the hits and misses of the query cache, if there is one.
+ */
+static void logCacheStats(SPQueryCache cache)
+{
+	char infoMsg[STRING_LEN];
+	if(cache == NULL)
+		return;
+	sprintf(infoMsg, MSG_CACHE_STATS, spQueryCacheGetHits(cache, SP_QUERY_CACHE_FEATURES),
+			spQueryCacheGetMisses(cache, SP_QUERY_CACHE_FEATURES),
+			spQueryCacheGetHits(cache, SP_QUERY_CACHE_RESULTS),
+			spQueryCacheGetMisses(cache, SP_QUERY_CACHE_RESULTS));
+	spLoggerPrintInfo(infoMsg);
+}
+
+/*
+ * Logs the recall of the index for a query against an exact brute force search.
+ */
+static void logRecall(SPIndex index, SPPointStore queryFeatures, int knn, const char* imagePath)
+{
+	double recall;
+	char infoMsg[2 * STRING_LEN];
+	if(spIndexMeasureRecall(index, queryFeatures, knn, &recall) != SP_INDEX_SUCCESS)
+	{
+		spLoggerPrintWarning(WARN_RECALL_FAILED, __FILE__, __func__, __LINE__);
+		return;
+	}
+	sprintf(infoMsg, MSG_RECALL, imagePath, recall);
+	spLoggerPrintInfo(infoMsg);
+}
+
 int main(int argc, char** argv)
 {
 	// ** Variables deceleration **
 
 	// Index variables
-	int i = 0, j = 0, k = 0;
+	int i = 0;
 
 	// Config and Logger init variables
 	char loggerFileName[STRING_LEN];
@@ -57,32 +139,30 @@ int main(int argc, char** argv)
 
 	// Config data variables
 	int loggerLevel = 0;
-	bool isExtractionMode = 0;
 	int imagesAmount = 0;
-	char imagePath[STRING_LEN];
 	int knn;
 	int numOfSimilarImages;
 	bool minimalGui;
-	SP_KDTREE_SPLIT_METHOD kdTreeSplitMethod;
-	int pcaDim;
+	bool measureRecall;
+	int featureDim;
+	SP_POINT_STORE_TYPE storeType;
 
 	// Features extraction variables
 	ImageProc *imgProc;
-	SPPoint** featuresByImage;
-	int* imgFeaturesAmount;
-	int totalFeaturesAmount = 0;
 
 	// Main data structure variables
-	SPKDTreeNode kdTreeRoot;
-	SP_KDTREE_MSG kdTreeMsg = SP_KDTREE_SUCCESS;
-	SPPoint* features;
+	SPIndex index;
+	SPQueryCache queryCache = NULL;
+	SP_QUERY_CACHE_MSG cacheMsg = SP_QUERY_CACHE_SUCCESS;
+	int cacheMemory;
 
 	// Query variables
 	int* similarImages;
 	char userInput[STRING_LEN];
-	SPPoint* queryFeatures;
-	int queryFeaturesAmount;
+	SPPointStore queryFeatures;
 	char resImagePath[STRING_LEN];
+	unsigned long long queryHash;
+	bool queryHashed;
 
 	// ** Config and Logger initialization **
 
@@ -140,204 +220,142 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
-	isExtractionMode = spConfigIsExtractionMode(config, &configMsg);
-
-	// ** Features extraction **
+	// ** Main data structure initialization **
 
 	imagesAmount = spConfigGetNumOfImages(config, &configMsg);
-	
+	featureDim = spConfigGetFeatureDim(config, &configMsg);
+	if(spConfigGetDescriptorType(config, &configMsg) == SP_DESCRIPTOR_ORB)
+		storeType = SP_POINT_STORE_BINARY;
+	else
+		storeType = SP_POINT_STORE_REAL;
+
 	imgProc = new ImageProc(config);
 
-	featuresByImage = (SPPoint**) malloc(imagesAmount * sizeof(SPPoint*));
-	imgFeaturesAmount = (int*) malloc(imagesAmount * sizeof(int));
-	if(featuresByImage == NULL || imgFeaturesAmount == NULL)
+	// The features are extracted or loaded from files, then indexed
+	index = IndexLoader(config, imgProc, storeType, featureDim).load();
+	if(index == NULL)
 	{
-		LOGGER_PRINT_ERROR(ERR_MEM_ALLOCATION, __FILE__, __func__, __LINE__);
 		spConfigDestroy(config);
 		spLoggerDestroy();
 		delete imgProc;
-		free(featuresByImage);
-		free(imgFeaturesAmount);
 		return 1;
 	}
 
-	if(isExtractionMode)
+	// A query image which is sent again isn't extracted or searched again
+	cacheMemory = spConfigGetQueryCacheMemory(config, &configMsg);
+	if(cacheMemory > 0)
 	{
-		totalFeaturesAmount = 0;
-		for(i = 0; i < imagesAmount; i++)
-		{
-			configMsg = spConfigGetImagePath(imagePath, config, i);
-			if(configMsg != SP_CONFIG_SUCCESS)
-			{
-				LOGGER_PRINT_ERROR(ERR_EXTRACT_FAILED, __FILE__, __func__, __LINE__);
-				spConfigDestroy(config);
-				spLoggerDestroy();
-				delete imgProc;
-				for(j = 0; j < i; j++)
-				{
-					for(k = 0; k < imgFeaturesAmount[j]; k++)
-						spPointDestroy(featuresByImage[j][k]);
-					free(featuresByImage[j]);
-				}
-				free(featuresByImage);
-				free(imgFeaturesAmount);
-				return 1;
-			}
-			featuresByImage[i] = imgProc->getImageFeatures(imagePath, i, imgFeaturesAmount + i);
-			if(featuresByImage[i] == NULL)
-			{
-				LOGGER_PRINT_ERROR(ERR_EXTRACT_FAILED, __FILE__, __func__, __LINE__);
-				spConfigDestroy(config);
-				spLoggerDestroy();
-				delete imgProc;
-				for(j = 0; j < i; j++)
-				{
-					for(k = 0; k < imgFeaturesAmount[j]; k++)
-						spPointDestroy(featuresByImage[j][k]);
-					free(featuresByImage[j]);
-				}
-				free(featuresByImage);
-				free(imgFeaturesAmount);
-				return 1;
-			}
-			totalFeaturesAmount += imgFeaturesAmount[i];
-
-			// Save
-			if(!spDatabaseManagerSave(config, i, imgFeaturesAmount[i], featuresByImage[i]))
-			{				
-				LOGGER_PRINT_ERROR(ERR_SAVE_FAILED, __FILE__, __func__, __LINE__);
-				spConfigDestroy(config);
-				spLoggerDestroy();
-				delete imgProc;
-				for(j = 0; j <= i; j++)
-				{
-					for(k = 0; k < imgFeaturesAmount[j]; k++)
-						spPointDestroy(featuresByImage[j][k]);
-					free(featuresByImage[j]);
-				}
-				free(featuresByImage);
-				free(imgFeaturesAmount);
-				return 1;
-			}
-		}
-	}
-	else // Extraction from files
-	{		
-		totalFeaturesAmount = 0;
-		for(i = 0; i < imagesAmount; i++)
-		{
-			featuresByImage[i] = spDatabaseManagerLoad(config, i, imgFeaturesAmount + i);
-			if(featuresByImage[i] == NULL)
-			{
-				LOGGER_PRINT_ERROR(ERR_LOAD_FAILED, __FILE__, __func__, __LINE__);
-				spConfigDestroy(config);
-				spLoggerDestroy();
-				delete imgProc;
-				for(j = 0; j < i; j++)
-				{					
-					for(k = 0; k < imgFeaturesAmount[j]; k++)
-						spPointDestroy(featuresByImage[j][k]);
-					free(featuresByImage[j]);
-				}
-				free(featuresByImage);
-				free(imgFeaturesAmount);
-				return 1;
-			}
-			totalFeaturesAmount += imgFeaturesAmount[i];
-		}
+		queryCache = spQueryCacheCreate((size_t)cacheMemory * 1024, &cacheMsg);
+		if(queryCache == NULL)
+			spLoggerPrintWarning(WARN_CACHE_FAILED, __FILE__, __func__, __LINE__);
 	}
 
-	// ** Main data structure initialization **
+	// ** Queries handling routine **
+
+	knn = spConfigGetKNN(config, &configMsg);
+	numOfSimilarImages = spConfigGetNumOfSimilarImages(config, &configMsg);
+	minimalGui = spConfigMinimalGui(config, &configMsg);
+	measureRecall = spConfigIsMeasureRecall(config, &configMsg);
 
-	features = (SPPoint*) malloc(totalFeaturesAmount * sizeof(SPPoint));
-	if(features == NULL)
+	if(spConfigGetQueryMode(config, &configMsg) == SP_QUERY_MODE_BATCH) // Queries are listed in a file
 	{
-		LOGGER_PRINT_ERROR(ERR_MEM_ALLOCATION, __FILE__, __func__, __LINE__);
+		BatchQuerySolver batchSolver(config, imgProc, index, queryCache, storeType, featureDim);
+		if(!batchSolver.run())
+		{
+			LOGGER_PRINT_ERROR(ERR_BATCH_FAILED, __FILE__, __func__, __LINE__);
+			spConfigDestroy(config);
+			spLoggerDestroy();
+			delete imgProc;
+			spIndexDestroy(index);
+			spQueryCacheDestroy(queryCache);
+			return 1;
+		}
+		logCacheStats(queryCache);
+		spLoggerPrintInfo(MSG_EXIT);
 		spConfigDestroy(config);
 		spLoggerDestroy();
-		delete imgProc;			
-		for(i = 0; i <= imagesAmount; i++)
-		{			
-			for(j = 0; j < imgFeaturesAmount[i]; j++)
-				spPointDestroy(featuresByImage[i][j]);
-			free(featuresByImage[i]);
-		}
-		free(featuresByImage);
-		free(imgFeaturesAmount);
-		return 1;
+		delete imgProc;
+		spIndexDestroy(index);
+		spQueryCacheDestroy(queryCache);
+		return 0;
 	}
 
-	k = 0;
-	for(i = 0; i < imagesAmount; i++)
+	if(spConfigGetQueryMode(config, &configMsg) == SP_QUERY_MODE_SERVER) // Queries arrive over a socket
 	{
-		memcpy(features + k, featuresByImage[i], imgFeaturesAmount[i] * sizeof(SPPoint));
-		k += imgFeaturesAmount[i];
-		free(featuresByImage[i]);
+		bool served;
+		{
+			// The server owns the index, which it may replace by a reload, and
+			// destroys it when it's destroyed
+			QueryServer server(config, imgProc, index, queryCache, storeType, featureDim);
+			served = server.run();
+		}
+		if(!served)
+		{
+			LOGGER_PRINT_ERROR(ERR_SERVER_FAILED, __FILE__, __func__, __LINE__);
+			spConfigDestroy(config);
+			spLoggerDestroy();
+			delete imgProc;
+			spQueryCacheDestroy(queryCache);
+			return 1;
+		}
+		logCacheStats(queryCache);
+		spLoggerPrintInfo(MSG_EXIT);
+		spConfigDestroy(config);
+		spLoggerDestroy();
+		delete imgProc;
+		spQueryCacheDestroy(queryCache);
+		return 0;
 	}
-	free(featuresByImage);
-	free(imgFeaturesAmount);
-
-	kdTreeSplitMethod = spConfigGetKDTreeSplitMethod(config, &configMsg);
-	pcaDim = spConfigGetPCADim(config, &configMsg);
-
-	kdTreeRoot = SPKDTreeInit(features, totalFeaturesAmount, pcaDim, kdTreeSplitMethod, &kdTreeMsg);
-
-	// ** Queries handling routine **
-
-	knn = spConfigGetKNN(config, &configMsg);
-	numOfSimilarImages = spConfigGetNumOfSimilarImages(config, &configMsg);
-	minimalGui = spConfigMinimalGui(config, &configMsg);
 
 	printf(MSG_ASK_FOR_QUERY);
 	scanf("%s", userInput);
 	if(strcmp(userInput, EXIT_INPUT) == 0) // Clean exit
 	{
+		logCacheStats(queryCache);
 		spLoggerPrintInfo(MSG_EXIT);
 		spConfigDestroy(config);
 		spLoggerDestroy();
 		delete imgProc;
-		for(i = 0; i < totalFeaturesAmount; i++)
-			spPointDestroy(features[i]);
-		free(features);
-		SPKDTreeDestroy(kdTreeRoot);
+		spIndexDestroy(index);
+		spQueryCacheDestroy(queryCache);
 		return 0;
 	}
-	queryFeatures = imgProc->getImageFeatures(userInput, 0, &queryFeaturesAmount);
+	queryHashed = queryCache != NULL && spQueryCacheHashImage(userInput, config, &queryHash);
+	queryFeatures = getQueryFeatures(imgProc, queryCache, queryHashed ? &queryHash : NULL,
+			userInput, storeType, featureDim);
 	if(queryFeatures == NULL)
 	{		
 		LOGGER_PRINT_ERROR(ERR_GET_IMG_FEATS, __FILE__, __func__, __LINE__);
 		spConfigDestroy(config);
 		spLoggerDestroy();
 		delete imgProc;
-		for(i = 0; i < totalFeaturesAmount; i++)
-			spPointDestroy(features[i]);
-		free(features);
-		SPKDTreeDestroy(kdTreeRoot);
+		spIndexDestroy(index);
+		spQueryCacheDestroy(queryCache);
 		return 1;
 	}
 
 	while(1)
 	{
-		similarImages = SPQuerySolverSolve(kdTreeRoot, queryFeatures, queryFeaturesAmount, knn, numOfSimilarImages, imagesAmount);
+		similarImages = solveQuery(index, queryCache, queryHashed ? &queryHash : NULL, queryFeatures,
+				knn, numOfSimilarImages, imagesAmount);
 		if(similarImages == NULL)
 		{
 			LOGGER_PRINT_ERROR(ERR_QUERY_FAILED, __FILE__, __func__, __LINE__);
 			spConfigDestroy(config);
 			spLoggerDestroy();
 			delete imgProc;
-			for(i = 0; i < totalFeaturesAmount; i++)
-				spPointDestroy(features[i]);
-			free(features);
-			SPKDTreeDestroy(kdTreeRoot);
-			for(i = 0; i < queryFeaturesAmount; i++)
-				spPointDestroy(queryFeatures[i]);
-			free(queryFeatures);
+			spIndexDestroy(index);
+			spQueryCacheDestroy(queryCache);
+			spPointStoreDestroy(queryFeatures);
 			return 1;
 		}
+		// A bag of words index ranks images, it finds no nearest features to measure
+		if(measureRecall && spIndexGetType(index) != SP_INDEX_BAG_OF_WORDS)
+			logRecall(index, queryFeatures, knn, userInput);
 
 		if(minimalGui) // Minimal GUI
 		{
-			for(i = 0; i < numOfSimilarImages; i++)
+			for(i = 0; i < numOfSimilarImages && similarImages[i] >= 0; i++)
 			{
 				configMsg = spConfigGetImagePath(resImagePath, config, similarImages[i]);
 				if(configMsg != SP_CONFIG_SUCCESS)
@@ -346,14 +364,10 @@ int main(int argc, char** argv)
 					spConfigDestroy(config);
 					spLoggerDestroy();
 					delete imgProc;
-					for(j = 0; j < totalFeaturesAmount; j++)
-						spPointDestroy(features[j]);
-					free(features);
-					SPKDTreeDestroy(kdTreeRoot);
+					spIndexDestroy(index);
+					spQueryCacheDestroy(queryCache);
 					free(similarImages);
-					for(j = 0; j < queryFeaturesAmount; j++)
-						spPointDestroy(queryFeatures[j]);
-					free(queryFeatures);
+					spPointStoreDestroy(queryFeatures);
 					return 1;
 				}
 				imgProc->showImage(resImagePath);
@@ -362,7 +376,7 @@ int main(int argc, char** argv)
 		else // No minimal GUI
 		{
 			printf(MSG_BEST_CANDIDATES, userInput);
-			for(i = 0; i < numOfSimilarImages; i++)
+			for(i = 0; i < numOfSimilarImages && similarImages[i] >= 0; i++)
 			{
 				configMsg = spConfigGetImagePath(resImagePath, config, similarImages[i]);
 				if(configMsg != SP_CONFIG_SUCCESS)
@@ -371,23 +385,17 @@ int main(int argc, char** argv)
 					spConfigDestroy(config);
 					spLoggerDestroy();
 					delete imgProc;
-					for(j = 0; j < totalFeaturesAmount; j++)
-						spPointDestroy(features[j]);
-					free(features);
-					SPKDTreeDestroy(kdTreeRoot);
+					spIndexDestroy(index);
+					spQueryCacheDestroy(queryCache);
 					free(similarImages);
-					for(j = 0; j < queryFeaturesAmount; j++)
-						spPointDestroy(queryFeatures[j]);
-					free(queryFeatures);
+					spPointStoreDestroy(queryFeatures);
 					return 1;
 				}
 				printf("%s\n", resImagePath);
 			}
 		}
 
-		for(i = 0; i < queryFeaturesAmount; i++)
-			spPointDestroy(queryFeatures[i]);
-		free(queryFeatures);
+		spPointStoreDestroy(queryFeatures);
 		free(similarImages);
 		
 		// Read next query
@@ -396,27 +404,26 @@ int main(int argc, char** argv)
 		scanf("%s", userInput);
 		if(strcmp(userInput, EXIT_INPUT) == 0) // Clean exit
 		{
+			logCacheStats(queryCache);
 			spLoggerPrintInfo(MSG_EXIT);
 			spConfigDestroy(config);
 			spLoggerDestroy();
 			delete imgProc;
-			for(i = 0; i < totalFeaturesAmount; i++)
-				spPointDestroy(features[i]);
-			free(features);
-			SPKDTreeDestroy(kdTreeRoot);
+			spIndexDestroy(index);
+			spQueryCacheDestroy(queryCache);
 			return 0;
 		}
-		queryFeatures = imgProc->getImageFeatures(userInput, 0, &queryFeaturesAmount);
+		queryHashed = queryCache != NULL && spQueryCacheHashImage(userInput, config, &queryHash);
+		queryFeatures = getQueryFeatures(imgProc, queryCache, queryHashed ? &queryHash : NULL,
+				userInput, storeType, featureDim);
 		if(queryFeatures == NULL)
 		{			
 			LOGGER_PRINT_ERROR(ERR_GET_IMG_FEATS, __FILE__, __func__, __LINE__);
 			spConfigDestroy(config);
 			spLoggerDestroy();
 			delete imgProc;
-			for(i = 0; i < totalFeaturesAmount; i++)
-				spPointDestroy(features[i]);
-			free(features);
-			SPKDTreeDestroy(kdTreeRoot);
+			spIndexDestroy(index);
+			spQueryCacheDestroy(queryCache);
 			return 1;
 		}
 	}
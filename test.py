@@ -29,6 +29,12 @@ def get_config_param(config, param, default = ""):
     return value
 
 
+def get_baseline(argv):
+    for i in range(len(argv) - 1):
+        if argv[i] == "-b":
+            return argv[i+1], argv[:i] + argv[i+2:]
+    return "", argv
+
 def open_exe(argv):
     exe_list = argv[1:]
     return Popen(exe_list, stdout=PIPE, stderr=STDOUT, stdin=PIPE)
@@ -83,6 +89,46 @@ def output_to_dict(out):
     return results
 
 
+def save_results(path, results):
+    f = open(path, "w")
+    for query in results:
+        f.write(query + " " + " ".join(results[query]) + "\n")
+    f.close()
+
+
+def load_results(path):
+    results = OrderedDict()
+    f = open(path)
+    for line in f.readlines():
+        images = line.split()
+        if len(images) > 0:
+            results[images[0]] = images[1:]
+    f.close()
+    return results
+
+
+# Compares the results against a baseline run, e.g. a full resolution run
+# when spMaxImageEdge is set
+def print_agreement(results, baseline):
+    queries = [query for query in results if query in baseline]
+    if len(queries) == 0:
+        print("no common queries with the baseline")
+        return
+    same_best = 0
+    overlap = 0.0
+    for query in queries:
+        closest = results[query]
+        expected = baseline[query]
+        if len(closest) > 0 and len(expected) > 0 and closest[0] == expected[0]:
+            same_best += 1
+        if len(expected) > 0:
+            common = len(set(closest) & set(expected))
+            overlap += float(common) / len(expected)
+    print("agreement with baseline over " + str(len(queries)) + " queries: " +
+          "best image %.1f%%, top images %.1f%%" %
+          (100.0 * same_best / len(queries), 100.0 * overlap / len(queries)))
+
+
 def dict_to_html(config, results):
     num_of_similar_images = int(get_config_param(config, "spNumOfSimilarImages", "1"))
     html = """
@@ -169,6 +215,7 @@ img {
 
 
 def main(argv):
+    baseline, argv = get_baseline(argv)
     proc = open_exe(argv);
 
     config = get_config(argv)
@@ -184,6 +231,10 @@ def main(argv):
     f.write(html)
     f.close()
 
+    save_results(os.path.splitext(config)[0] + ".results", results)
+    if baseline != "":
+        print_agreement(results, load_results(baseline))
+
 
 if __name__ == "__main__":
     if len(sys.argv) > 1: